@@ -0,0 +1,82 @@
+
+#include <benchmark/benchmark.h>
+
+#include <glm/glm.hpp>
+#include <vector>
+
+#include "ecs/entity_registry.h"
+
+struct Position {
+  glm::vec3 value;
+};
+
+struct Velocity {
+  glm::vec3 value;
+};
+
+struct Tag {};
+
+// Creates `count` entities with a position and velocity.
+std::vector<Entity> CreateMovingEntities(EntityRegistry& registry, int count) {
+  std::vector<Entity> entities;
+  entities.reserve(count);
+  for (int i = 0; i < count; i++) {
+    entities.push_back(registry.Create(Position{glm::vec3(i, 0, 0)},
+                                       Velocity{glm::vec3(0, 1, 0)}));
+  }
+  return entities;
+}
+
+// Integrates positions one chunk at a time.
+void BM_EcsEachChunk(benchmark::State& state) {
+  EntityRegistry registry;
+  CreateMovingEntities(registry, state.range(0));
+  const float delta = 1.f / 60;
+  for (auto _ : state) {
+    registry.EachChunk<Position, Velocity>(
+        [delta](size_t count, const Entity* entities, Position* positions,
+                Velocity* velocities) {
+          for (size_t i = 0; i < count; i++) {
+            positions[i].value += velocities[i].value * delta;
+          }
+        });
+    benchmark::ClobberMemory();
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_EcsEachChunk)->Arg(100000);
+
+// Integrates positions one entity at a time.
+void BM_EcsEach(benchmark::State& state) {
+  EntityRegistry registry;
+  CreateMovingEntities(registry, state.range(0));
+  const float delta = 1.f / 60;
+  for (auto _ : state) {
+    registry.Each<Position, Velocity>(
+        [delta](Entity entity, Position& position, Velocity& velocity) {
+          position.value += velocity.value * delta;
+        });
+    benchmark::ClobberMemory();
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_EcsEach)->Arg(100000);
+
+// Adds and removes a tag on every entity, moving each between archetypes.
+void BM_EcsAddRemoveComponent(benchmark::State& state) {
+  EntityRegistry registry;
+  const std::vector<Entity> entities =
+      CreateMovingEntities(registry, state.range(0));
+  for (auto _ : state) {
+    for (Entity entity : entities) {
+      registry.Add<Tag>(entity);
+    }
+    for (Entity entity : entities) {
+      registry.Remove<Tag>(entity);
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0) * 2);
+}
+BENCHMARK(BM_EcsAddRemoveComponent)
+    ->Arg(100000)
+    ->Unit(benchmark::kMillisecond);
@@ -0,0 +1,14 @@
+
+#include <benchmark/benchmark.h>
+#include <glog/logging.h>
+
+int main(int argc, char* argv[]) {
+  google::InitGoogleLogging(argv[0]);
+  benchmark::Initialize(&argc, argv);
+  if (benchmark::ReportUnrecognizedArguments(argc, argv)) {
+    return 1;
+  }
+  benchmark::RunSpecifiedBenchmarks();
+  benchmark::Shutdown();
+  return 0;
+}
@@ -0,0 +1,172 @@
+
+#include <benchmark/benchmark.h>
+
+#include <memory>
+#include <vector>
+
+#include "nodes/node.h"
+#include "nodes/transform.h"
+#include "resources/prefab.h"
+#include "utility/type_group.h"
+#include "world.h"
+
+// Builds a chain of `depth` transforms below `root`, returning the leaf.
+std::shared_ptr<Transform> BuildChain(const std::shared_ptr<Transform>& root,
+                                      int depth) {
+  std::shared_ptr<Transform> parent = root;
+  for (int i = 0; i < depth; i++) {
+    std::shared_ptr<Transform> child(new Transform());
+    child->SetPosition(glm::vec3(0, 1, 0));
+    child->AttachTo(parent);
+    parent = child;
+  }
+  return parent;
+}
+
+// Moves the root of a deep chain, then reads the leaf's global matrix, which
+// recomputes every matrix along the chain.
+void BM_TransformDeepChain(benchmark::State& state) {
+  std::shared_ptr<Transform> root(new Transform());
+  const std::shared_ptr<Transform> leaf = BuildChain(root, state.range(0));
+  float x = 0;
+  for (auto _ : state) {
+    root->SetPosition(glm::vec3(x += 1, 0, 0));
+    benchmark::DoNotOptimize(leaf->GetGlobalMatrix());
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_TransformDeepChain)->Arg(16)->Arg(256)->Arg(1024);
+
+// Moves the root of a wide tree, then reads every child's global matrix.
+void BM_TransformWideTree(benchmark::State& state) {
+  std::shared_ptr<Transform> root(new Transform());
+  std::vector<std::shared_ptr<Transform>> children;
+  for (int i = 0; i < state.range(0); i++) {
+    children.emplace_back(new Transform());
+    children.back()->SetPosition(glm::vec3(i, 0, 0));
+    children.back()->AttachTo(root);
+  }
+  float x = 0;
+  for (auto _ : state) {
+    root->SetPosition(glm::vec3(x += 1, 0, 0));
+    for (const std::shared_ptr<Transform>& child : children) {
+      benchmark::DoNotOptimize(child->GetGlobalMatrix());
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_TransformWideTree)->Arg(1000)->Arg(10000);
+
+// Builds a tree of `count` nodes where every other node is a Transform, with
+// each node having up to `branching` children.
+std::shared_ptr<Node> BuildTree(int count, int branching) {
+  std::vector<std::shared_ptr<Node>> nodes;
+  nodes.reserve(count);
+  for (int i = 0; i < count; i++) {
+    nodes.push_back(i % 2 == 0 ? std::shared_ptr<Node>(new Transform())
+                               : std::make_shared<Node>());
+    if (i > 0) {
+      nodes.back()->AttachTo(nodes[(i - 1) / branching]);
+    }
+  }
+  return nodes[0];
+}
+
+void BM_TypeGroupAddTree(benchmark::State& state) {
+  const std::shared_ptr<Node> root = BuildTree(state.range(0), 4);
+  for (auto _ : state) {
+    NodeTypeGroup<Transform> group;
+    group.AddTree(root);
+    benchmark::DoNotOptimize(group.begin());
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_TypeGroupAddTree)->Arg(100000)->Unit(benchmark::kMillisecond);
+
+void BM_TypeGroupRemoveTree(benchmark::State& state) {
+  const std::shared_ptr<Node> root = BuildTree(state.range(0), 4);
+  NodeTypeGroup<Transform> group;
+  for (auto _ : state) {
+    state.PauseTiming();
+    group.AddTree(root);
+    state.ResumeTiming();
+    group.RemoveTree(root);
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_TypeGroupRemoveTree)->Arg(100000)->Unit(benchmark::kMillisecond);
+
+// Builds and destroys a tree of `range(0)` transforms with up to four children
+// each, allocating nodes with `new` when range(1) is 0 or from the node pools
+// when it is 1.
+void BM_NodeSpawnDestroy(benchmark::State& state) {
+  const int count = state.range(0);
+  std::vector<std::shared_ptr<Transform>> nodes;
+  nodes.reserve(count);
+  for (auto _ : state) {
+    for (int i = 0; i < count; i++) {
+      nodes.push_back(state.range(1) ? World::Spawn<Transform>()
+                                     : std::shared_ptr<Transform>(
+                                           new Transform()));
+      if (i > 0) {
+        nodes.back()->AttachTo(nodes[(i - 1) / 4]);
+      }
+    }
+    nodes.clear();
+  }
+  state.SetItemsProcessed(state.iterations() * count);
+}
+BENCHMARK(BM_NodeSpawnDestroy)
+    ->ArgNames({"count", "pooled"})
+    ->Args({10000, 0})
+    ->Args({10000, 1})
+    ->Unit(benchmark::kMillisecond);
+
+// Builds `range(0)` copies of a small character hierarchy, either node by node
+// when range(1) is 0 or from a prefab when it is 1.
+void BM_PrefabInstantiate(benchmark::State& state) {
+  const int count = state.range(0);
+  Prefab prefab;
+  const uint32_t root = prefab.AddNode<Transform>(Prefab::kNoParent, "root");
+  const uint32_t body = prefab.AddNode<Transform>(root, "body");
+  prefab.SetTransform(body, glm::vec3(0, 1, 0));
+  for (int i = 0; i < 4; i++) {
+    const uint32_t limb = prefab.AddNode<Transform>(body, "limb");
+    prefab.SetTransform(limb, glm::vec3(i, 0, 0));
+    prefab.AddNode<Node>(limb, "socket");
+  }
+
+  for (auto _ : state) {
+    const std::shared_ptr<Node> parent = World::Spawn<Node>();
+    if (state.range(1)) {
+      prefab.Instantiate(count, parent);
+    } else {
+      for (int n = 0; n < count; n++) {
+        std::vector<std::shared_ptr<Node>> nodes;
+        for (const Prefab::NodeData& data : prefab.GetNodes()) {
+          std::shared_ptr<Node> node = data.spawn();
+          node->name = data.name;
+          if (data.is_transform) {
+            std::shared_ptr<Transform> transform =
+                std::static_pointer_cast<Transform>(node);
+            transform->SetPosition(data.position);
+            transform->SetRotation(data.rotation);
+            transform->SetScale(data.scale);
+          }
+          if (data.parent != Prefab::kNoParent) {
+            node->AttachTo(nodes[data.parent]);
+          }
+          nodes.push_back(std::move(node));
+        }
+        nodes[0]->AttachTo(parent);
+      }
+    }
+    benchmark::DoNotOptimize(parent->GetChildren().data());
+  }
+  state.SetItemsProcessed(state.iterations() * count);
+}
+BENCHMARK(BM_PrefabInstantiate)
+    ->ArgNames({"count", "prefab"})
+    ->Args({500, 0})
+    ->Args({500, 1})
+    ->Unit(benchmark::kMicrosecond);
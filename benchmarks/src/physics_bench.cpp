@@ -0,0 +1,90 @@
+
+#include <benchmark/benchmark.h>
+
+#include <glm/glm.hpp>
+#include <memory>
+#include <random>
+
+#include "engine.h"
+#include "nodes/rigid_body.h"
+#include "platform.h"
+#include "systems/physics_system.h"
+#include "world.h"
+
+// A headless platform that asks to quit right away, so running the engine on
+// it only initializes the engine and its worlds.
+class InitOnlyPlatform : public Platform {
+ public:
+  Clock& GetClock() override { return clock; }
+  bool ShouldQuit() override { return true; }
+  void PollEvents() override {}
+
+ private:
+  ManualClock clock;
+};
+
+// Creates a world with a floor and `count` spheres, boxes, and capsules in
+// columns above it, then steps it until the bodies are piled on each other.
+std::shared_ptr<PhysicsSystem> CreatePile(const std::shared_ptr<Engine>& engine,
+                                          int count) {
+  const std::shared_ptr<World> world = engine->CreateWorld();
+  world->CreateEmptyRoot();
+  const std::shared_ptr<PhysicsSystem> physics_system(new PhysicsSystem());
+  world->AddSystem(physics_system);
+  InitOnlyPlatform platform;
+  engine->Run(platform);
+
+  const std::shared_ptr<RigidBody> floor = World::Spawn<RigidBody>();
+  floor->SetShape(CollisionShape::Box(glm::vec3(200, 1, 200)));
+  floor->SetMass(0);
+  floor->SetPosition(glm::vec3(0, -1, 0));
+  floor->AttachTo(world->GetRoot());
+
+  std::mt19937 random(1234);
+  std::uniform_real_distribution<float> jitter(-0.1f, 0.1f);
+  constexpr int kColumns = 32;
+  for (int i = 0; i < count; i++) {
+    const std::shared_ptr<RigidBody> body = World::Spawn<RigidBody>();
+    switch (i % 3) {
+      case 0:
+        body->SetShape(CollisionShape::Sphere(0.4f));
+        break;
+      case 1:
+        body->SetShape(CollisionShape::Box(glm::vec3(0.4f)));
+        break;
+      case 2:
+        body->SetShape(CollisionShape::Capsule(0.3f, 0.3f));
+        break;
+    }
+    // Neighbouring columns overlap, so bodies fall into shared piles.
+    const int column = i % (kColumns * kColumns);
+    body->SetPosition(glm::vec3((column % kColumns) * 1.5f + jitter(random),
+                                1 + (i / (kColumns * kColumns)) * 1.2f,
+                                (column / kColumns) * 1.5f + jitter(random)));
+    body->SetRotation(glm::normalize(
+        glm::quat(1, jitter(random), jitter(random), jitter(random))));
+    body->AttachTo(world->GetRoot());
+  }
+  for (int i = 0; i < 120; i++) {
+    physics_system->Step(1.f / 60);
+  }
+  return physics_system;
+}
+
+// Steps 10k bodies piled on each other, with the given number of threads.
+void BM_PhysicsStep(benchmark::State& state) {
+  const std::shared_ptr<Engine> engine(new Engine());
+  const std::shared_ptr<PhysicsSystem> physics_system =
+      CreatePile(engine, state.range(0));
+  for (auto _ : state) {
+    physics_system->Step(1.f / 60, state.range(1));
+  }
+  const PhysicsSystem::Stats& stats = physics_system->GetStats();
+  state.counters["contacts"] = stats.contact_count;
+  state.counters["islands"] = stats.island_count;
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_PhysicsStep)
+    ->Args({10000, 1})
+    ->Args({10000, 4})
+    ->Unit(benchmark::kMillisecond);
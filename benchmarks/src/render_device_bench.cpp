@@ -0,0 +1,94 @@
+
+#include <benchmark/benchmark.h>
+
+#include <glm/glm.hpp>
+#include <memory>
+
+#include "resources/uniform_buffer.h"
+#include "systems/render_command_buffer.h"
+#include "systems/render_device.h"
+#include "systems/threaded_render_device.h"
+
+// Records a frame of `state.range(0)` objects, each binding its uniforms and
+// drawing one mesh, and submits it to a NullRenderDevice. Measures the cost
+// of recording and walking the command buffer without a GPU.
+void BM_RecordAndSubmitFrame(benchmark::State& state) {
+  const int object_count = state.range(0);
+  NullRenderDevice device(glm::ivec2(1280, 720));
+  RenderCommandBuffer commands;
+  for (auto _ : state) {
+    commands.Reset();
+    commands.Record(RenderCommandBuffer::BeginPass{"Camera pass"});
+    commands.Record(RenderCommandBuffer::SetViewport{0, 0, 1280, 720});
+    commands.Record(RenderCommandBuffer::Clear{glm::vec4(0), true, true});
+    commands.RecordUniforms(UniformBinding::Frame, FrameUniforms());
+    for (int i = 0; i < object_count; i++) {
+      ObjectUniforms uniforms;
+      uniforms.model = glm::mat4(1.f);
+      uniforms.model[3].x = (float)i;
+      uniforms.model_view_projection = uniforms.model;
+      commands.RecordUniforms(UniformBinding::Object, uniforms);
+      DrawElementsIndirectCommand draw{};
+      draw.count = 36;
+      draw.instance_count = 1;
+      draw.first_index = 36 * (i % 16);
+      commands.Record(RenderCommandBuffer::Draw{nullptr, nullptr, draw});
+    }
+    commands.Record(RenderCommandBuffer::EndPass{});
+
+    device.BeginFrame();
+    device.Submit(commands);
+    device.EndFrame();
+    benchmark::DoNotOptimize(device.GetFrameStats().draws);
+  }
+  state.SetItemsProcessed(state.iterations() * object_count);
+}
+BENCHMARK(BM_RecordAndSubmitFrame)->Arg(1000)->Arg(10000);
+
+// Replays a captured frame of 10000 objects on a NullRenderDevice.
+void BM_ReplayCapturedFrame(benchmark::State& state) {
+  CaptureRenderDevice capture(nullptr, glm::ivec2(1280, 720));
+  RenderCommandBuffer commands;
+  for (int i = 0; i < 10000; i++) {
+    commands.RecordUniforms(UniformBinding::Object, ObjectUniforms());
+    DrawElementsIndirectCommand draw{};
+    draw.count = 36;
+    draw.instance_count = 1;
+    commands.Record(RenderCommandBuffer::Draw{nullptr, nullptr, draw});
+  }
+  capture.BeginFrame();
+  capture.Submit(commands);
+  capture.EndFrame();
+
+  NullRenderDevice device(glm::ivec2(1280, 720));
+  for (auto _ : state) {
+    CaptureRenderDevice::Replay(capture.GetFrames().back(), device);
+    benchmark::DoNotOptimize(device.GetFrameStats().commands);
+  }
+}
+BENCHMARK(BM_ReplayCapturedFrame);
+
+// Submits frames of 10000 objects to a ThreadedRenderDevice wrapping a
+// NullRenderDevice. Measures the cost the recording thread pays to snapshot
+// and hand off each frame.
+void BM_ThreadedSubmitFrame(benchmark::State& state) {
+  ThreadedRenderDevice device(
+      std::make_unique<NullRenderDevice>(glm::ivec2(1280, 720)),
+      ThreadedRenderDevice::ContextHooks(), state.range(0));
+  RenderCommandBuffer commands;
+  for (int i = 0; i < 10000; i++) {
+    commands.RecordUniforms(UniformBinding::Object, ObjectUniforms());
+    DrawElementsIndirectCommand draw{};
+    draw.count = 36;
+    draw.instance_count = 1;
+    commands.Record(RenderCommandBuffer::Draw{nullptr, nullptr, draw});
+  }
+  for (auto _ : state) {
+    device.BeginFrame();
+    device.Submit(commands);
+    device.EndFrame();
+  }
+  device.Flush();
+  benchmark::DoNotOptimize(device.GetFrameStats().draws);
+}
+BENCHMARK(BM_ThreadedSubmitFrame)->Arg(1)->Arg(2);
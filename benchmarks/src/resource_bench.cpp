@@ -0,0 +1,261 @@
+
+#include <benchmark/benchmark.h>
+#include <glog/logging.h>
+#include <png.h>
+
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <string>
+
+#include "resources/derived_cache.h"
+#include "resources/mesh.h"
+#include "resources/mesh_formats/obj_mesh.h"
+#include "resources/resource.h"
+#include "resources/texture_formats/png_texture.h"
+#include "resources/transit/transit.h"
+#include "resources/transit/transit_write.h"
+
+// Returns the path of `name` in a scratch directory for benchmark inputs.
+std::string GetScratchPath(const std::string& name) {
+  const std::filesystem::path directory =
+      std::filesystem::temp_directory_path() / "sheep_bench";
+  std::filesystem::create_directories(directory);
+  return (directory / name).generic_string();
+}
+
+// Creates a flat grid mesh with `size` by `size` quads.
+std::shared_ptr<Mesh> CreateGridMesh(int size) {
+  std::shared_ptr<Mesh> mesh(new Mesh());
+  for (int y = 0; y <= size; y++) {
+    for (int x = 0; x <= size; x++) {
+      mesh->vertices.push_back(
+          {glm::vec3(x, 0, y), glm::vec2(x, y) / (float)size,
+           glm::vec4(1, 1, 1, 1), glm::vec3(0, 1, 0), glm::vec3(1, 0, 0),
+           glm::vec3(0, 0, 1)});
+    }
+  }
+  for (int y = 0; y < size; y++) {
+    for (int x = 0; x < size; x++) {
+      const unsigned int corner = y * (size + 1) + x;
+      mesh->triangles.push_back({{corner, corner + size + 1, corner + 1}});
+      mesh->triangles.push_back(
+          {{corner + 1, corner + size + 1, corner + size + 2}});
+    }
+  }
+  return mesh;
+}
+
+void BM_TransitLoadMesh(benchmark::State& state) {
+  const std::string path =
+      GetScratchPath("grid_" + std::to_string(state.range(0)) + ".tmesh");
+  const std::shared_ptr<Mesh> source = CreateGridMesh(state.range(0));
+  {
+    std::ofstream file(path, std::ios_base::out | std::ios_base::binary);
+    CHECK(transit::Save(file, source).ok());
+  }
+  for (auto _ : state) {
+    absl::StatusOr<std::shared_ptr<Mesh>> mesh =
+        transit::Load<Mesh>({path});
+    CHECK(mesh.ok()) << mesh.status();
+    benchmark::DoNotOptimize(mesh->get());
+  }
+  state.SetItemsProcessed(state.iterations() * source->vertices.size());
+  state.SetBytesProcessed(state.iterations() *
+                          std::filesystem::file_size(path));
+}
+BENCHMARK(BM_TransitLoadMesh)
+    ->Arg(100)
+    ->Arg(1000)
+    ->Unit(benchmark::kMillisecond);
+
+// Loads a mesh saved with its BVH, compared to BM_TransitLoadMesh followed by
+// BM_MeshBVHBuild.
+void BM_TransitLoadMeshWithBVH(benchmark::State& state) {
+  const std::string path =
+      GetScratchPath("grid_bvh_" + std::to_string(state.range(0)) + ".tmesh");
+  const std::shared_ptr<Mesh> source = CreateGridMesh(state.range(0));
+  source->GetBVH();
+  {
+    std::ofstream file(path, std::ios_base::out | std::ios_base::binary);
+    CHECK(transit::Save(file, source).ok());
+  }
+  for (auto _ : state) {
+    absl::StatusOr<std::shared_ptr<Mesh>> mesh =
+        transit::Load<Mesh>({path});
+    CHECK(mesh.ok()) << mesh.status();
+    CHECK((*mesh)->GetBuiltBVH());
+    benchmark::DoNotOptimize(mesh->get());
+  }
+  state.SetItemsProcessed(state.iterations() * source->vertices.size());
+}
+BENCHMARK(BM_TransitLoadMeshWithBVH)
+    ->Arg(1000)
+    ->Unit(benchmark::kMillisecond);
+
+// Builds the BVH of a grid mesh on range(1) threads.
+void BM_MeshBVHBuild(benchmark::State& state) {
+  const std::shared_ptr<Mesh> mesh = CreateGridMesh(state.range(0));
+  MeshBVH::Settings settings;
+  settings.thread_count = state.range(1);
+  for (auto _ : state) {
+    MeshBVH bvh = MeshBVH::Build(*mesh, settings);
+    benchmark::DoNotOptimize(bvh.GetNodes().data());
+  }
+  state.SetItemsProcessed(state.iterations() * mesh->triangles.size());
+}
+BENCHMARK(BM_MeshBVHBuild)
+    ->Args({1000, 1})
+    ->Args({1000, 4})
+    ->Unit(benchmark::kMillisecond);
+
+// Casts slanted rays at a grid mesh. With range(1) set to 1, the BVH is a
+// single leaf, so every triangle is tested.
+void BM_MeshBVHRaycast(benchmark::State& state) {
+  const std::shared_ptr<Mesh> mesh = CreateGridMesh(state.range(0));
+  MeshBVH::Settings settings;
+  if (state.range(1) == 1) {
+    settings.max_leaf_triangles = mesh->triangles.size();
+  }
+  const MeshBVH bvh = MeshBVH::Build(*mesh, settings);
+  int query = 0;
+  for (auto _ : state) {
+    const float x = (query * 7919) % state.range(0) + 0.5f;
+    const float z = (query * 104729) % state.range(0) + 0.5f;
+    query++;
+    const Ray ray(glm::vec3(x, 10, z), glm::vec3(0.3f, -1, 0.2f));
+    MeshBVH::RayHit hit;
+    benchmark::DoNotOptimize(bvh.Raycast(*mesh, ray, 100, hit));
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_MeshBVHRaycast)->Args({300, 0})->Args({300, 1});
+
+// Writes a `size` by `size` grid as an OBJ file to `path`.
+void WriteGridObj(const std::string& path, int size) {
+  std::ofstream file(path, std::ios_base::out | std::ios_base::trunc);
+  file << "o Grid\n";
+  for (int y = 0; y <= size; y++) {
+    for (int x = 0; x <= size; x++) {
+      file << "v " << x << " 0 " << y << "\n";
+      file << "vt " << (float)x / size << " " << (float)y / size << "\n";
+    }
+  }
+  file << "vn 0 1 0\n";
+  for (int y = 0; y < size; y++) {
+    for (int x = 0; x < size; x++) {
+      // OBJ indices start at 1.
+      const int corner = y * (size + 1) + x + 1;
+      const int corners[4] = {corner, corner + size + 1, corner + size + 2,
+                              corner + 1};
+      file << "f";
+      for (int c : corners) {
+        file << " " << c << "/" << c << "/1";
+      }
+      file << "\n";
+    }
+  }
+}
+
+// Loads an OBJ file with the derived data cache disabled when range(1) is 0,
+// or warm when it is 1.
+void BM_ObjModelLoad(benchmark::State& state) {
+  const std::string path =
+      GetScratchPath("grid_" + std::to_string(state.range(0)) + ".obj");
+  WriteGridObj(path, state.range(0));
+  DerivedDataCache::Get().SetDirectory(
+      state.range(1) ? GetScratchPath("derived_data") : "");
+  for (auto _ : state) {
+    absl::StatusOr<std::shared_ptr<ObjModel>> model = ObjModel::Load({path});
+    CHECK(model.ok()) << model.status();
+    benchmark::DoNotOptimize(model->get());
+  }
+  DerivedDataCache::Get().SetDirectory("");
+  state.SetBytesProcessed(state.iterations() *
+                          std::filesystem::file_size(path));
+}
+BENCHMARK(BM_ObjModelLoad)
+    ->ArgNames({"size", "cached"})
+    ->Args({100, 0})
+    ->Args({100, 1})
+    ->Args({400, 0})
+    ->Args({400, 1})
+    ->Unit(benchmark::kMillisecond);
+
+// Writes a `size` by `size` 8-bit RGBA PNG with a noisy gradient to `path`.
+void WritePng(const std::string& path, int size) {
+  FILE* file = fopen(path.c_str(), "wb");
+  CHECK(file) << "Failed to open " << path;
+  png_structp png =
+      png_create_write_struct(PNG_LIBPNG_VER_STRING, NULL, NULL, NULL);
+  png_infop info = png_create_info_struct(png);
+  CHECK(png && info);
+  png_init_io(png, file);
+  png_set_IHDR(png, info, size, size, 8, PNG_COLOR_TYPE_RGBA,
+               PNG_INTERLACE_NONE, PNG_COMPRESSION_TYPE_DEFAULT,
+               PNG_FILTER_TYPE_DEFAULT);
+  png_write_info(png, info);
+  std::vector<png_byte> row(size * 4);
+  uint32_t noise = 1;
+  for (int y = 0; y < size; y++) {
+    for (int x = 0; x < size; x++) {
+      noise = noise * 1664525 + 1013904223;
+      row[x * 4 + 0] = x;
+      row[x * 4 + 1] = y;
+      row[x * 4 + 2] = noise >> 24;
+      row[x * 4 + 3] = 255;
+    }
+    png_write_row(png, row.data());
+  }
+  png_write_end(png, NULL);
+  png_destroy_write_struct(&png, &info);
+  fclose(file);
+}
+
+// Loads a PNG with the derived data cache disabled when range(1) is 0, or warm
+// when it is 1.
+void BM_PngTextureLoad(benchmark::State& state) {
+  const std::string path =
+      GetScratchPath("noise_" + std::to_string(state.range(0)) + ".png");
+  WritePng(path, state.range(0));
+  DerivedDataCache::Get().SetDirectory(
+      state.range(1) ? GetScratchPath("derived_data") : "");
+  for (auto _ : state) {
+    absl::StatusOr<std::shared_ptr<Texture>> texture =
+        PngTexture::Load({path});
+    CHECK(texture.ok()) << texture.status();
+    benchmark::DoNotOptimize(texture->get());
+  }
+  DerivedDataCache::Get().SetDirectory("");
+  state.SetItemsProcessed(state.iterations() * state.range(0) *
+                          state.range(0));
+}
+BENCHMARK(BM_PngTextureLoad)
+    ->ArgNames({"size", "cached"})
+    ->Args({512, 0})
+    ->Args({512, 1})
+    ->Args({2048, 0})
+    ->Args({2048, 1})
+    ->Unit(benchmark::kMillisecond);
+
+// Loads a resource that is already loaded, which should only cost a lookup.
+void BM_ResourceLoaderCacheHit(benchmark::State& state) {
+  const std::string name = "bench_cached_mesh";
+  // The loader is global, so the resource may exist from a previous run.
+  ResourceLoader::Get()
+      .Add<Mesh>(name,
+                 []() -> absl::StatusOr<std::shared_ptr<Mesh>> {
+                   return CreateGridMesh(1);
+                 })
+      .IgnoreError();
+  const absl::StatusOr<std::shared_ptr<Mesh>> held =
+      ResourceLoader::Get().Load<Mesh>(name);
+  CHECK(held.ok()) << held.status();
+  for (auto _ : state) {
+    absl::StatusOr<std::shared_ptr<Mesh>> mesh =
+        ResourceLoader::Get().Load<Mesh>(name);
+    benchmark::DoNotOptimize(mesh->get());
+  }
+}
+BENCHMARK(BM_ResourceLoaderCacheHit);
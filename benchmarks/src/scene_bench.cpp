@@ -0,0 +1,80 @@
+
+#include <benchmark/benchmark.h>
+#include <glog/logging.h>
+
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "nodes/camera.h"
+#include "nodes/node.h"
+#include "nodes/transform.h"
+#include "resources/scene.h"
+#include "world.h"
+
+// Builds a scene of `count` nodes, mostly Transforms with some plain nodes and
+// cameras, with up to eight children per node.
+std::shared_ptr<Node> BuildScene(int count) {
+  std::vector<std::shared_ptr<Node>> nodes;
+  nodes.reserve(count);
+  for (int i = 0; i < count; i++) {
+    std::shared_ptr<Node> node;
+    if (i % 100 == 99) {
+      node = World::Spawn<Camera>();
+    } else if (i % 4 == 3) {
+      node = World::Spawn<Node>();
+    } else {
+      std::shared_ptr<Transform> transform = World::Spawn<Transform>();
+      transform->SetPosition(glm::vec3(i, 0, 0));
+      node = transform;
+    }
+    node->name = "node" + std::to_string(i);
+    if (i > 0) {
+      node->AttachTo(nodes[(i - 1) / 8]);
+    }
+    nodes.push_back(std::move(node));
+  }
+  return nodes[0];
+}
+
+void BM_SceneWrite(benchmark::State& state) {
+  const std::shared_ptr<Node> root = BuildScene(state.range(0));
+  for (auto _ : state) {
+    std::stringstream stream;
+    const absl::Status status = SceneWriter::Write(stream, root);
+    CHECK(status.ok()) << status;
+    benchmark::DoNotOptimize(stream.tellp());
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_SceneWrite)->Arg(1000000)->Unit(benchmark::kMillisecond);
+
+// Loads a scene of `range(0)` nodes using `range(1)` threads. Destroying the
+// loaded tree is not timed.
+void BM_SceneRead(benchmark::State& state) {
+  std::string scene;
+  {
+    std::stringstream stream;
+    const absl::Status status =
+        SceneWriter::Write(stream, BuildScene(state.range(0)));
+    CHECK(status.ok()) << status;
+    scene = stream.str();
+  }
+  for (auto _ : state) {
+    std::istringstream stream(scene);
+    absl::StatusOr<std::shared_ptr<Node>> root =
+        SceneReader::Read(stream, state.range(1));
+    CHECK(root.ok()) << root.status();
+    state.PauseTiming();
+    root->reset();
+    state.ResumeTiming();
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_SceneRead)
+    ->ArgNames({"nodes", "threads"})
+    ->Args({1000000, 1})
+    ->Args({1000000, 4})
+    ->Unit(benchmark::kMillisecond)
+    ->UseRealTime();
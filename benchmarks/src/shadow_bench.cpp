@@ -0,0 +1,50 @@
+
+#include <benchmark/benchmark.h>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include "nodes/camera.h"
+#include "nodes/light.h"
+#include "utility/geometry.h"
+#include "world.h"
+
+// Fits four cascades to a camera, as is done for every camera each frame.
+void BM_ComputeShadowCascades(benchmark::State& state) {
+  const std::shared_ptr<Camera> camera = World::Spawn<Camera>();
+  camera->SetPosition(glm::vec3(10, 2, -5));
+  camera->SetRotation(glm::quat(glm::radians(glm::vec3(-10, 30, 0))));
+  const std::shared_ptr<DirectionalLight> light =
+      World::Spawn<DirectionalLight>();
+  light->SetRotation(glm::quat(glm::radians(glm::vec3(-45, 45, 0))));
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(light->ComputeCascades(*camera, 16.f / 9.f));
+  }
+}
+BENCHMARK(BM_ComputeShadowCascades);
+
+// Tests 10000 boxes scattered around a camera against its frustum.
+void BM_FrustumCull(benchmark::State& state) {
+  std::mt19937 random(1);
+  std::uniform_real_distribution<float> position(-100.f, 100.f);
+  std::vector<AABB> boxes;
+  for (int i = 0; i < 10000; i++) {
+    boxes.push_back(AABB::FromCenter(
+        glm::vec3(position(random), position(random), position(random)),
+        glm::vec3(1.f)));
+  }
+  const std::shared_ptr<Camera> camera = World::Spawn<Camera>();
+  const Frustum frustum(camera->GetProjectionView(16.f / 9.f));
+  for (auto _ : state) {
+    int visible = 0;
+    for (const AABB& box : boxes) {
+      visible += frustum.Intersects(box);
+    }
+    benchmark::DoNotOptimize(visible);
+  }
+  state.SetItemsProcessed(state.iterations() * boxes.size());
+}
+BENCHMARK(BM_FrustumCull);
@@ -0,0 +1,40 @@
+
+#include <benchmark/benchmark.h>
+#include <glog/logging.h>
+
+#include <memory>
+#include <string>
+
+#include "resources/skeleton.h"
+
+// Builds a skeleton of `bone_count` bones where every bone has up to three
+// children. Skeletons cache matrices through a pointer to themselves, so they
+// must not be copied.
+std::unique_ptr<Skeleton> BuildSkeleton(int bone_count) {
+  std::unique_ptr<Skeleton> skeleton(new Skeleton());
+  skeleton->bones.resize(bone_count);
+  for (int i = 0; i < bone_count; i++) {
+    Skeleton::Bone& bone = skeleton->bones[i];
+    bone.name = "bone_" + std::to_string(i);
+    bone.bind_pose = {glm::vec3(0, 0.1f, 0),
+                      glm::angleAxis(0.1f, glm::vec3(0, 0, 1)),
+                      glm::vec3(1, 1, 1)};
+    if (i > 0) {
+      skeleton->bones[(i - 1) / 3].children.push_back(i);
+    }
+  }
+  return skeleton;
+}
+
+void BM_SkeletonComputePoseMatrices(benchmark::State& state) {
+  const std::unique_ptr<Skeleton> skeleton = BuildSkeleton(state.range(0));
+  const std::vector<Skeleton::Bone::Pose> pose = skeleton->GetBindPose();
+  for (auto _ : state) {
+    absl::StatusOr<std::vector<glm::mat4>> matrices =
+        skeleton->ComputePoseMatrices(pose);
+    CHECK(matrices.ok());
+    benchmark::DoNotOptimize(matrices->data());
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_SkeletonComputePoseMatrices)->Arg(64)->Arg(256);
@@ -0,0 +1,72 @@
+
+#include <benchmark/benchmark.h>
+
+#include <cmath>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <memory>
+
+#include "resources/mesh.h"
+#include "systems/software_rasterizer.h"
+
+// Creates a sphere of radius 1 with `rings` rings of `rings * 2` quads.
+Mesh CreateSphere(int rings) {
+  Mesh mesh;
+  const int segments = rings * 2;
+  for (int ring = 0; ring <= rings; ring++) {
+    const float latitude = 3.14159f * ring / rings;
+    for (int segment = 0; segment <= segments; segment++) {
+      const float longitude = 2 * 3.14159f * segment / segments;
+      const glm::vec3 normal(sin(latitude) * cos(longitude), cos(latitude),
+                             sin(latitude) * sin(longitude));
+      mesh.vertices.push_back(
+          {normal, glm::vec2((float)segment / segments, (float)ring / rings),
+           glm::vec4(1), normal});
+    }
+  }
+  for (int ring = 0; ring < rings; ring++) {
+    for (int segment = 0; segment < segments; segment++) {
+      const unsigned int top = ring * (segments + 1) + segment;
+      const unsigned int bottom = top + segments + 1;
+      mesh.triangles.push_back({{top, top + 1, bottom}});
+      mesh.triangles.push_back({{bottom, top + 1, bottom + 1}});
+    }
+  }
+  return mesh;
+}
+
+// Renders a 720p frame of 400 overlapping textured spheres, with the given
+// number of threads.
+void BM_SoftwareRasterizerFrame(benchmark::State& state) {
+  const Mesh sphere = CreateSphere(24);
+  std::shared_ptr<Texture> texture(
+      new Texture(Texture::PixelType::RGBA, 8, 64, 64));
+  for (uint32_t i = 0; i < 64 * 64; i++) {
+    texture->GetDataAsRGBA8()[i] = ((i / 8 + i / 512) % 2)
+                                       ? Texture::pixel_rgba_8(255)
+                                       : Texture::pixel_rgba_8(64, 64, 64, 255);
+  }
+  SoftwareMaterial material;
+  material.texture = texture;
+
+  SoftwareRasterizer rasterizer(1280, 720);
+  const glm::mat4 projection_view =
+      glm::perspective(1.2f, 1280.f / 720.f, 0.1f, 100.f) *
+      glm::lookAt(glm::vec3(0, 8, 20), glm::vec3(0), glm::vec3(0, 1, 0));
+  for (auto _ : state) {
+    rasterizer.Clear(glm::vec4(0), true, true);
+    for (int x = 0; x < 20; x++) {
+      for (int z = 0; z < 20; z++) {
+        const glm::mat4 model = glm::translate(
+            glm::mat4(1), glm::vec3(x * 1.5f - 15, 0, z * -1.5f));
+        rasterizer.DrawMesh(sphere, model, projection_view * model, material);
+      }
+    }
+    rasterizer.Flush(state.range(0));
+  }
+  state.SetItemsProcessed(state.iterations() * 400 * sphere.triangles.size());
+}
+BENCHMARK(BM_SoftwareRasterizerFrame)
+    ->Arg(1)
+    ->Arg(4)
+    ->Unit(benchmark::kMillisecond);
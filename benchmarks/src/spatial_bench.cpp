@@ -0,0 +1,139 @@
+
+#include <benchmark/benchmark.h>
+
+#include <glm/glm.hpp>
+#include <random>
+#include <vector>
+
+#include "utility/geometry.h"
+#include "utility/loose_octree.h"
+
+// Creates `count` small boxes scattered through a 1000 unit cube.
+std::vector<AABB> CreateScatteredBoxes(int count) {
+  std::mt19937 random(1234);
+  std::uniform_real_distribution<float> position(-500, 500);
+  std::uniform_real_distribution<float> size(0.5f, 2.f);
+  std::vector<AABB> boxes;
+  boxes.reserve(count);
+  for (int i = 0; i < count; i++) {
+    boxes.push_back(AABB::FromCenter(
+        glm::vec3(position(random), position(random), position(random)),
+        glm::vec3(size(random))));
+  }
+  return boxes;
+}
+
+LooseOctree CreateOctree(const std::vector<AABB>& boxes) {
+  LooseOctree octree;
+  for (uint32_t i = 0; i < boxes.size(); i++) {
+    octree.Insert(i, boxes[i]);
+  }
+  return octree;
+}
+
+// Moves every box slightly, as if every node moved during a frame.
+void BM_OctreeUpdate(benchmark::State& state) {
+  std::vector<AABB> boxes = CreateScatteredBoxes(state.range(0));
+  LooseOctree octree = CreateOctree(boxes);
+  float offset = 0.1f;
+  for (auto _ : state) {
+    for (uint32_t i = 0; i < boxes.size(); i++) {
+      boxes[i].min.x += offset;
+      boxes[i].max.x += offset;
+      octree.Update(i, boxes[i]);
+    }
+    offset = -offset;
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_OctreeUpdate)->Arg(100000);
+
+// Finds the boxes within 20 units of a box, using the octree.
+void BM_OctreeQueryBox(benchmark::State& state) {
+  const std::vector<AABB> boxes = CreateScatteredBoxes(state.range(0));
+  const LooseOctree octree = CreateOctree(boxes);
+  std::vector<uint32_t> results;
+  size_t query = 0;
+  for (auto _ : state) {
+    const AABB& box = boxes[query++ % boxes.size()];
+    results.clear();
+    octree.QueryBox(AABB(box.min - glm::vec3(20), box.max + glm::vec3(20)),
+                    results);
+    benchmark::DoNotOptimize(results.data());
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_OctreeQueryBox)->Arg(100000);
+
+// Finds the boxes within 20 units of a box by testing every box.
+void BM_BruteForceQueryBox(benchmark::State& state) {
+  const std::vector<AABB> boxes = CreateScatteredBoxes(state.range(0));
+  std::vector<uint32_t> results;
+  size_t query = 0;
+  for (auto _ : state) {
+    const AABB& box = boxes[query++ % boxes.size()];
+    const AABB search(box.min - glm::vec3(20), box.max + glm::vec3(20));
+    results.clear();
+    for (uint32_t i = 0; i < boxes.size(); i++) {
+      if (boxes[i].Intersects(search)) {
+        results.push_back(i);
+      }
+    }
+    benchmark::DoNotOptimize(results.data());
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_BruteForceQueryBox)->Arg(100000);
+
+// Finds the 8 boxes nearest to a point.
+void BM_OctreeQueryNearest(benchmark::State& state) {
+  const std::vector<AABB> boxes = CreateScatteredBoxes(state.range(0));
+  const LooseOctree octree = CreateOctree(boxes);
+  std::vector<uint32_t> results;
+  size_t query = 0;
+  for (auto _ : state) {
+    results.clear();
+    octree.QueryNearest(boxes[query++ % boxes.size()].GetCenter() +
+                            glm::vec3(3, 0, 0),
+                        8, results);
+    benchmark::DoNotOptimize(results.data());
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_OctreeQueryNearest)->Arg(100000);
+
+// Casts rays from the center towards random boxes.
+void BM_OctreeRaycast(benchmark::State& state) {
+  const std::vector<AABB> boxes = CreateScatteredBoxes(state.range(0));
+  const LooseOctree octree = CreateOctree(boxes);
+  size_t query = 0;
+  for (auto _ : state) {
+    const Ray ray(glm::vec3(0, 0, 0),
+                  glm::normalize(boxes[query++ % boxes.size()].GetCenter()));
+    uint32_t id;
+    float distance;
+    benchmark::DoNotOptimize(octree.Raycast(ray, 1000, id, distance));
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_OctreeRaycast)->Arg(100000);
+
+// Casts the same rays as `BM_OctreeRaycast` by testing every box.
+void BM_BruteForceRaycast(benchmark::State& state) {
+  const std::vector<AABB> boxes = CreateScatteredBoxes(state.range(0));
+  size_t query = 0;
+  for (auto _ : state) {
+    const Ray ray(glm::vec3(0, 0, 0),
+                  glm::normalize(boxes[query++ % boxes.size()].GetCenter()));
+    float closest = 1000;
+    for (const AABB& box : boxes) {
+      float distance;
+      if (IntersectRay(ray, box, closest, distance)) {
+        closest = distance;
+      }
+    }
+    benchmark::DoNotOptimize(closest);
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_BruteForceRaycast)->Arg(100000);
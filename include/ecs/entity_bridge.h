@@ -0,0 +1,35 @@
+
+#pragma once
+
+#include "ecs/entity_registry.h"
+#include "nodes/node_handle.h"
+
+class Node;
+
+// The component every bridged node's entity has, linking it back to the node.
+struct NodeComponent {
+  // Not owned. Valid while the entity exists.
+  Node* node;
+  NodeHandle handle;
+};
+
+// Implemented by nodes that keep data in their world's entity registry, so
+// systems can process them in bulk. When such a node joins a world, an entity
+// is created for it with a `NodeComponent` and any components added by
+// `CreateComponents`. The entity is destroyed when the node leaves the world.
+class EntityBridge {
+ public:
+  virtual ~EntityBridge() = default;
+
+  // Returns the entity of this node, or a null entity if it is not in a world.
+  Entity GetEntity() const { return entity; }
+
+ protected:
+  // Adds this node's components to `entity` in `registry`.
+  virtual void CreateComponents(EntityRegistry& registry, Entity entity) {}
+
+ private:
+  Entity entity;
+
+  friend class World;
+};
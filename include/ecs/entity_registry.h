@@ -0,0 +1,307 @@
+
+#pragma once
+
+#include <absl/container/flat_hash_map.h>
+#include <glog/logging.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+using ComponentId = uint32_t;
+// A set of component types, with one bit per `ComponentId`.
+using ComponentMask = uint64_t;
+
+// The maximum number of distinct component types in a program.
+constexpr ComponentId kMaxComponentTypes = 64;
+
+// How to store and move a component type without knowing the type.
+struct ComponentInfo {
+  size_t size;
+  size_t alignment;
+  // Move constructs the component at `destination` from `source`, then
+  // destroys `source`.
+  void (*relocate)(void* destination, void* source);
+  void (*destroy)(void* component);
+};
+
+// Returns the info of the component type with `id`.
+const ComponentInfo& GetComponentInfo(ComponentId id);
+
+// Returns the id of `Component`, assigning one on first use.
+template <typename Component>
+ComponentId GetComponentId();
+
+// A reference to an entity within a registry. An entity stays valid until it
+// is destroyed, and a stale reference is detected even if its slot is reused.
+struct Entity {
+  static constexpr uint32_t kInvalidIndex = ~0U;
+
+  uint32_t index = kInvalidIndex;
+  uint32_t generation = 0;
+
+  bool IsNull() const { return index == kInvalidIndex; }
+
+  bool operator==(const Entity& other) const {
+    return index == other.index && generation == other.generation;
+  }
+  bool operator!=(const Entity& other) const { return !(*this == other); }
+
+  template <typename H>
+  friend H AbslHashValue(H state, const Entity& entity) {
+    return H::combine(std::move(state), entity.index, entity.generation);
+  }
+};
+
+// Stores every entity with the same set of components. Entities are packed
+// into fixed-size chunks, with each component type in its own contiguous
+// column, so iterating a component touches memory linearly.
+class Archetype {
+ public:
+  // The size in bytes of each chunk.
+  static constexpr size_t kChunkSize = 16 * 1024;
+
+  Archetype(ComponentMask mask_);
+  ~Archetype();
+
+  Archetype(const Archetype&) = delete;
+  Archetype& operator=(const Archetype&) = delete;
+
+  ComponentMask GetMask() const { return mask; }
+  bool Has(ComponentId id) const { return mask & (ComponentMask(1) << id); }
+
+  size_t GetChunkCount() const { return chunks.size(); }
+  // Returns the number of entities in the chunk at `chunk`.
+  uint32_t GetCount(size_t chunk) const { return chunks[chunk].count; }
+  const Entity* GetEntities(size_t chunk) const {
+    return reinterpret_cast<const Entity*>(chunks[chunk].data);
+  }
+  // Returns the column for the component with `id` in the chunk at `chunk`.
+  // The archetype must have the component.
+  void* GetColumn(ComponentId id, size_t chunk) const {
+    return chunks[chunk].data + column_offsets[id];
+  }
+  // Returns the component with `id` of the entity at `row` of `chunk`.
+  void* GetComponent(ComponentId id, size_t chunk, uint32_t row) const {
+    return (unsigned char*)GetColumn(id, chunk) +
+           row * GetComponentInfo(id).size;
+  }
+
+ private:
+  struct Chunk {
+    unsigned char* data;
+    uint32_t count;
+  };
+
+  // Adds a row for `entity` whose components are left uninitialized. Returns
+  // the chunk and row.
+  std::pair<uint32_t, uint32_t> AddRow(Entity entity);
+  // Removes the row at `row` of `chunk`, whose components must already be
+  // destroyed or relocated, by moving the last row into it. Returns the entity
+  // that was moved, or a null entity if none was.
+  Entity RemoveRow(uint32_t chunk, uint32_t row);
+  // Destroys every component in the row at `row` of `chunk`.
+  void DestroyRow(uint32_t chunk, uint32_t row);
+
+  ComponentMask mask;
+  std::vector<ComponentId> components;
+  // The byte offset of each component's column within a chunk, indexed by
+  // `ComponentId`.
+  size_t column_offsets[kMaxComponentTypes] = {};
+  size_t chunk_alignment = alignof(Entity);
+  uint32_t chunk_capacity;
+  std::vector<Chunk> chunks;
+
+  friend class EntityRegistry;
+};
+
+// Stores entities and their components by archetype. Structural changes
+// (creating or destroying entities, and adding or removing components) move
+// components in memory, so pointers to components are only valid until the
+// next structural change, and structural changes are not allowed while
+// iterating.
+class EntityRegistry {
+ public:
+  EntityRegistry() = default;
+  EntityRegistry(const EntityRegistry&) = delete;
+  EntityRegistry& operator=(const EntityRegistry&) = delete;
+
+  // Creates an entity with no components.
+  Entity Create();
+  // Creates an entity with `components`.
+  template <typename... Components>
+  Entity Create(Components&&... components);
+  // Destroys `entity` and its components. No error if it is already destroyed.
+  void Destroy(Entity entity);
+  bool IsAlive(Entity entity) const;
+
+  // Adds a `Component` constructed from `args` to `entity`, which must not
+  // already have one. Returns the new component.
+  template <typename Component, typename... Args>
+  Component& Add(Entity entity, Args&&... args);
+  // Removes the `Component` of `entity`. No error if it has none.
+  template <typename Component>
+  void Remove(Entity entity);
+  // Returns the `Component` of `entity`, or null if it has none.
+  template <typename Component>
+  Component* Get(Entity entity) const;
+  template <typename Component>
+  bool Has(Entity entity) const {
+    return Get<Component>(entity) != nullptr;
+  }
+
+  // Calls `function(count, entities, columns...)` for every chunk of entities
+  // that have all of `Components`, where each column points to `count`
+  // contiguous components. This is the fastest way to process many entities.
+  template <typename... Components, typename Function>
+  void EachChunk(Function&& function);
+  // Calls `function(entity, components...)` for every entity that has all of
+  // `Components`.
+  template <typename... Components, typename Function>
+  void Each(Function&& function);
+
+  size_t GetEntityCount() const { return entity_count; }
+
+ private:
+  struct EntityRecord {
+    Archetype* archetype;
+    uint32_t chunk;
+    uint32_t row;
+    uint32_t generation;
+  };
+
+  // Returns the archetype for `mask`, creating it if needed.
+  Archetype* GetArchetype(ComponentMask mask);
+  // Moves `entity` to the archetype for `mask`, relocating the components both
+  // archetypes share and destroying the rest. Components only in the new
+  // archetype are left uninitialized.
+  void MoveEntity(Entity entity, ComponentMask mask);
+  // Updates the record of the entity moved by `Archetype::RemoveRow`.
+  void UpdateMovedEntity(Entity moved, uint32_t chunk, uint32_t row);
+
+  const EntityRecord* GetRecord(Entity entity) const;
+
+  std::vector<EntityRecord> records;
+  std::vector<uint32_t> free_records;
+  size_t entity_count = 0;
+
+  absl::flat_hash_map<ComponentMask, std::unique_ptr<Archetype>> archetypes;
+  // Every archetype in creation order, for iteration.
+  std::vector<Archetype*> archetype_list;
+
+  // The number of iterations in progress, during which structural changes are
+  // not allowed.
+  int iteration_depth = 0;
+};
+
+// ===== Template Implementation ===== //
+
+// Registers a component type described by `info`, returning its id.
+ComponentId RegisterComponent(const ComponentInfo& info);
+
+template <typename Component>
+ComponentId GetComponentId() {
+  static_assert(std::is_nothrow_move_constructible_v<Component>,
+                "Components must be nothrow move constructible.");
+  static const ComponentId id = RegisterComponent(
+      {sizeof(Component), alignof(Component),
+       [](void* destination, void* source) {
+         Component* source_component = static_cast<Component*>(source);
+         new (destination) Component(std::move(*source_component));
+         source_component->~Component();
+       },
+       [](void* component) {
+         static_cast<Component*>(component)->~Component();
+       }});
+  return id;
+}
+
+// Returns the mask containing `Components`.
+template <typename... Components>
+ComponentMask GetComponentMask() {
+  return (ComponentMask(0) | ... |
+          (ComponentMask(1) << GetComponentId<Components>()));
+}
+
+template <typename... Components>
+Entity EntityRegistry::Create(Components&&... components) {
+  const Entity entity = Create();
+  MoveEntity(entity, GetComponentMask<std::decay_t<Components>...>());
+  const EntityRecord& record = records[entity.index];
+  (new (record.archetype->GetComponent(
+       GetComponentId<std::decay_t<Components>>(), record.chunk, record.row))
+       std::decay_t<Components>(std::forward<Components>(components)),
+   ...);
+  return entity;
+}
+
+template <typename Component, typename... Args>
+Component& EntityRegistry::Add(Entity entity, Args&&... args) {
+  const EntityRecord* record = GetRecord(entity);
+  CHECK(record) << "Adding a component to a destroyed entity.";
+  const ComponentId id = GetComponentId<Component>();
+  CHECK(!record->archetype->Has(id)) << "Entity already has the component.";
+  MoveEntity(entity, record->archetype->GetMask() | (ComponentMask(1) << id));
+  record = &records[entity.index];
+  void* component =
+      record->archetype->GetComponent(id, record->chunk, record->row);
+  // Aggregates cannot be constructed with parentheses until C++20.
+  if constexpr (std::is_aggregate_v<Component>) {
+    return *new (component) Component{std::forward<Args>(args)...};
+  } else {
+    return *new (component) Component(std::forward<Args>(args)...);
+  }
+}
+
+template <typename Component>
+void EntityRegistry::Remove(Entity entity) {
+  const EntityRecord* record = GetRecord(entity);
+  const ComponentId id = GetComponentId<Component>();
+  if (!record || !record->archetype->Has(id)) {
+    return;
+  }
+  MoveEntity(entity, record->archetype->GetMask() & ~(ComponentMask(1) << id));
+}
+
+template <typename Component>
+Component* EntityRegistry::Get(Entity entity) const {
+  const EntityRecord* record = GetRecord(entity);
+  const ComponentId id = GetComponentId<Component>();
+  if (!record || !record->archetype->Has(id)) {
+    return nullptr;
+  }
+  return static_cast<Component*>(
+      record->archetype->GetComponent(id, record->chunk, record->row));
+}
+
+template <typename... Components, typename Function>
+void EntityRegistry::EachChunk(Function&& function) {
+  const ComponentMask mask = GetComponentMask<Components...>();
+  iteration_depth++;
+  for (Archetype* archetype : archetype_list) {
+    if ((archetype->GetMask() & mask) != mask) {
+      continue;
+    }
+    for (size_t chunk = 0; chunk < archetype->GetChunkCount(); chunk++) {
+      function((size_t)archetype->GetCount(chunk),
+               archetype->GetEntities(chunk),
+               static_cast<Components*>(archetype->GetColumn(
+                   GetComponentId<Components>(), chunk))...);
+    }
+  }
+  iteration_depth--;
+}
+
+template <typename... Components, typename Function>
+void EntityRegistry::Each(Function&& function) {
+  EachChunk<Components...>([&function](size_t count, const Entity* entities,
+                                       Components*... columns) {
+    for (size_t i = 0; i < count; i++) {
+      function(entities[i], columns[i]...);
+    }
+  });
+}
@@ -4,9 +4,12 @@
 #include <GL/glew.h>
 #include <GLFW/glfw3.h>
 
+#include <cstdint>
 #include <memory>
 #include <vector>
 
+#include "frame_pacer.h"
+#include "platform.h"
 #include "systems/super_system.h"
 #include "world.h"
 
@@ -28,8 +31,50 @@ class Engine : public std::enable_shared_from_this<Engine> {
   // it only makes this the last frame that will be run.
   void Quit();
 
+  // Runs the engine on `platform` until it quits.
+  void Run(Platform& platform);
+  // Runs the engine on a platform driven by `window`.
   void Run(GLFWwindow* window);
 
+  // Returns the platform the engine is running on, or null if it is not
+  // running.
+  Platform* GetPlatform() const { return platform; }
+
+  // The timing of a single frame, for replaying a run with identical steps.
+  struct FrameRecord {
+    // The length of the frame in nanoseconds.
+    uint64_t delta_ns;
+    // The number of fixed updates run during the frame.
+    unsigned int fixed_updates;
+  };
+
+  // Starts recording the timing of every frame, discarding any previous
+  // recording.
+  void StartRecording();
+  // Stops recording and returns the frames recorded since `StartRecording`.
+  std::vector<FrameRecord> StopRecording();
+  // Replays `frames` in place of the clock, so every frame has the recorded
+  // delta and number of fixed updates regardless of how long it really takes.
+  // The engine quits after the last frame. Combined with replayed input, this
+  // reproduces a run exactly.
+  void Replay(std::vector<FrameRecord> frames);
+  bool IsReplaying() const { return replay_index < replay_frames.size(); }
+
+  // Returns the pacer that limits the frame rate and measures frame times.
+  FramePacer& GetFramePacer() { return frame_pacer; }
+  const FramePacer& GetFramePacer() const { return frame_pacer; }
+
+  // Returns the number of frames run so far.
+  uint64_t GetFrameCount() const { return frame_count; }
+  // Returns the number of fixed updates run so far.
+  uint64_t GetFixedUpdateCount() const { return fixed_update_count; }
+  // Returns whether a fixed update is running. Transforms changed during one
+  // are interpolated; changes at any other time are treated as teleports.
+  bool IsInFixedUpdate() const { return in_fixed_update; }
+  // Returns how far the engine is into the next fixed update, from 0 to 1.
+  // Rendering can use this to interpolate between the last two fixed updates.
+  float GetFixedUpdateAlpha() const;
+
   const std::vector<std::shared_ptr<World>>& GetWorlds() const;
   const std::vector<std::shared_ptr<SuperSystem>>& GetSuperSystems() const;
 
@@ -45,6 +90,21 @@ class Engine : public std::enable_shared_from_this<Engine> {
 
   bool is_initialized = false;
   bool is_running = false;
+  Platform* platform = nullptr;
+  FramePacer frame_pacer;
+
+  uint64_t frame_count = 0;
+  uint64_t fixed_update_count = 0;
+  bool in_fixed_update = false;
+  // Game time not yet consumed by fixed updates, in nanoseconds. Kept as an
+  // integer so identical frame deltas always produce identical step counts.
+  uint64_t fixed_time_accumulator_ns = 0;
+  uint64_t fixed_update_ns = 0;
+
+  bool is_recording = false;
+  std::vector<FrameRecord> recorded_frames;
+  std::vector<FrameRecord> replay_frames;
+  size_t replay_index = 0;
 
   // Performs initialization of the engine. Occurs only once at the start of the
   // engine.
@@ -0,0 +1,70 @@
+
+#pragma once
+
+#include <functional>
+#include <vector>
+
+#include "platform.h"
+
+// Paces frames to a target rate and keeps statistics about frame times.
+class FramePacer {
+ public:
+  FramePacer();
+
+  struct Stats {
+    // Percentiles of the time between frames, in seconds, over the recent
+    // history.
+    double p50 = 0;
+    double p95 = 0;
+    double p99 = 0;
+    // The exponentially smoothed time between frames, in seconds.
+    double smoothed = 0;
+    // The exponentially smoothed time spent working each frame, excluding any
+    // time waiting for the next frame, in seconds.
+    double smoothed_work = 0;
+  };
+
+  // Called when the work of a frame overruns the frame budget, with the time
+  // the work took and the budget, both in seconds. Listeners can shed work,
+  // such as by lowering the render resolution or level of detail.
+  using OverrunCallback =
+      std::function<void(double work_seconds, double budget_seconds)>;
+
+  // The frames per second to pace to, or 0 for no limit. With a `ManualClock`,
+  // this is also how far the clock advances each frame.
+  float target_frames_per_second = 0;
+  // The weight of each new frame in the smoothed times, from 0 to 1.
+  float smoothing = 0.1f;
+  // How far past the budget a frame's work may go before it is reported as an
+  // overrun, as a fraction of the budget.
+  float overrun_tolerance = 0.05f;
+
+  void AddOverrunCallback(const OverrunCallback& callback);
+
+  // Starts pacing from the current time of `clock`.
+  void Reset(Clock& clock);
+  // Waits until the next frame should start, then returns its start time.
+  double BeginFrame(Clock& clock);
+  // Marks the end of the work for the current frame.
+  void EndFrame(Clock& clock);
+
+  // Returns statistics over the recent frames. Percentiles are computed on
+  // demand, so avoid calling this more than once per frame.
+  Stats GetStats() const;
+
+ private:
+  // The number of frame times kept for percentiles.
+  static constexpr size_t kHistorySize = 512;
+
+  double next_frame_time = 0;
+  double frame_start_time = 0;
+  // Whether `frame_start_time` refers to a real frame, rather than `Reset`.
+  bool has_frame = false;
+
+  std::vector<double> frame_times;
+  size_t frame_time_index = 0;
+  double smoothed_frame_time = 0;
+  double smoothed_work_time = 0;
+
+  std::vector<OverrunCallback> overrun_callbacks;
+};
@@ -40,6 +40,9 @@ class Camera : public Transform {
   // ratio.
   glm::mat4 GetProjectionMatrix(float aspect) const;
 
+  // Computes the view matrix, which transforms world space into camera space.
+  glm::mat4 GetViewMatrix() const;
+
   // Computes the inverted view and projection matrices given the view surface
   // aspect ratio.
   glm::mat4 GetProjectionView(float aspect) const;
@@ -0,0 +1,56 @@
+
+#pragma once
+
+#include <glm/glm.hpp>
+#include <vector>
+
+#include "nodes/camera.h"
+#include "nodes/transform.h"
+
+// One slice of a camera's view covered by one layer of a shadow map.
+struct ShadowCascade {
+  // Transforms world space into the cascade's clip space.
+  glm::mat4 projection_view;
+  // The view-space distance from the camera at which the cascade ends.
+  float split_distance;
+};
+
+// A light infinitely far away, such as the sun, shining along the node's
+// forward (-z) axis. The first light in a world lights and shadows everything
+// its cameras see.
+class DirectionalLight : public Transform {
+ public:
+  glm::vec3 colour = glm::vec3(1.f);
+  float intensity = 1.f;
+
+  // Whether the light casts shadows, rendered into a cascaded shadow map.
+  bool cast_shadows = true;
+  // The number of cascades the camera's view is split into, from 1 to
+  // kMaxShadowCascades. Each cascade is one layer of the shadow map.
+  int cascade_count = 4;
+  // The width and height of each cascade's layer of the shadow map, in texels.
+  int shadow_resolution = 2048;
+  // The distance from the camera at which shadows end. The cascades cover the
+  // camera's view up to this or its far plane, whichever is nearer.
+  float shadow_distance = 100.f;
+  // Blends the cascade splits between evenly spaced (0) and logarithmically
+  // spaced (1). Logarithmic splits give more resolution near the camera.
+  float cascade_split_lambda = 0.75f;
+  // How far towards the light from each cascade casters are still rendered,
+  // so objects outside the camera's view can shadow it.
+  float shadow_caster_distance = 100.f;
+  // The depth offset applied to casters, to stop surfaces shadowing
+  // themselves. `slope_bias` scales with the surface's slope to the light.
+  float depth_bias = 1.f;
+  float slope_bias = 2.f;
+
+  // Returns the world-space direction the light travels in.
+  glm::vec3 GetDirection() const;
+
+  // Fits the cascades of the light to `camera`'s view with aspect ratio
+  // `aspect`. Each cascade is fit to a sphere around its slice of the view and
+  // snapped to whole texels, so the cascades do not change size as the camera
+  // turns and do not shimmer as it moves.
+  std::vector<ShadowCascade> ComputeCascades(const Camera& camera,
+                                             float aspect) const;
+};
@@ -4,20 +4,37 @@
 #include <memory>
 
 #include "nodes/transform.h"
+#include "resources/material.h"
 #include "resources/renderable_mesh.h"
-#include "resources/shader.h"
 #include "systems/render_system.h"
+#include "systems/software_render_system.h"
+#include "systems/spatial_system.h"
 
-class MeshRenderer : public Transform, public Renderable {
+class MeshRenderer : public Transform, public Renderable, public Bounded {
  public:
   struct MeshInfo {
     std::shared_ptr<RenderableMesh> mesh;
-    std::shared_ptr<Program> material;
+    std::shared_ptr<Material> material;
+    // How the mesh is shaded by the SoftwareRenderSuperSystem, which cannot
+    // run `material`.
+    SoftwareMaterial software_material;
   };
   std::vector<MeshInfo> meshes;
 
+  // Registers MeshRenderer as the scene node type "MeshRenderer". Meshes and
+  // materials are saved by the names they were loaded with from the
+  // ResourceLoader, and loaded from it again.
+  static void RegisterSceneNodeType();
+
+  // Returns the bounds of all the meshes. Call SpatialSystem::Refresh after
+  // changing `meshes` so the new bounds are used.
+  AABB GetLocalBounds() const override;
+
  protected:
   void Render(const std::shared_ptr<RenderSuperSystem>& super_system,
               const std::shared_ptr<RenderSystem>& system,
               const glm::mat4& ProjectionView) override;
+  void RenderSoftware(
+      const std::shared_ptr<SoftwareRenderSuperSystem>& super_system,
+      const glm::mat4& ProjectionView) override;
 };
@@ -1,14 +1,23 @@
 
 #pragma once
 
+#include <absl/container/inlined_vector.h>
+
 #include <memory>
 #include <string>
 #include <vector>
 
+#include "nodes/node_handle.h"
+#include "nodes/node_type_tag.h"
+
 class World;
 
 class Node : public std::enable_shared_from_this<Node> {
  public:
+  // Most nodes have few children, so they are stored inline to avoid a heap
+  // allocation per node.
+  using ChildList = absl::InlinedVector<std::shared_ptr<Node>, 4>;
+
   std::string name;
 
   // Attaches this node to `parent` at the specified `index` safely. If this
@@ -22,8 +31,14 @@ class Node : public std::enable_shared_from_this<Node> {
   std::vector<std::shared_ptr<Node>> GetAncestry() const;
 
   std::shared_ptr<World> GetWorld() const;
+  // Returns the handle of this node in its world, or a null handle if it is
+  // not in a world.
+  NodeHandle GetHandle() const { return handle; }
+  // Returns the tags of every tagged type this node is an instance of. See
+  // `GetNodeTypeTag`.
+  NodeTypeMask GetTypeMask() const;
   std::shared_ptr<Node> GetParent() const;
-  const std::vector<std::shared_ptr<Node>>& GetChildren() const;
+  const ChildList& GetChildren() const;
 
  protected:
   // Attaches `child` to this node at the specified `index`. Negative `index`s
@@ -48,9 +63,16 @@ class Node : public std::enable_shared_from_this<Node> {
 
  private:
   std::weak_ptr<World> world;
+  NodeHandle handle;
+
+  mutable NodeTypeMask type_mask = 0;
+  // The number of tags `type_mask` was computed for.
+  mutable uint32_t type_mask_tag_count = 0;
 
   std::weak_ptr<Node> parent;
-  std::vector<std::shared_ptr<Node>> children;
+  ChildList children;
 
+  friend class Prefab;
+  friend class SceneReader;
   friend class World;
 };
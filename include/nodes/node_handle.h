@@ -0,0 +1,28 @@
+
+#pragma once
+
+#include <cstdint>
+#include <utility>
+
+// A weak reference to a node within a world, made of an index into the world's
+// node slots and the generation of that slot. Resolving a handle costs an array
+// lookup and no reference counting. A handle goes stale once its node leaves
+// the world, even if the slot is reused.
+struct NodeHandle {
+  static constexpr uint32_t kInvalidIndex = ~0U;
+
+  uint32_t index = kInvalidIndex;
+  uint32_t generation = 0;
+
+  bool IsNull() const { return index == kInvalidIndex; }
+
+  bool operator==(const NodeHandle& other) const {
+    return index == other.index && generation == other.generation;
+  }
+  bool operator!=(const NodeHandle& other) const { return !(*this == other); }
+
+  template <typename H>
+  friend H AbslHashValue(H state, const NodeHandle& handle) {
+    return H::combine(std::move(state), handle.index, handle.generation);
+  }
+};
@@ -0,0 +1,39 @@
+
+#pragma once
+
+#include <cstdint>
+
+class Node;
+
+// A set of node type tags, with one bit per tagged type.
+using NodeTypeMask = uint64_t;
+
+// The maximum number of distinct tagged node types in a program.
+constexpr uint32_t kMaxNodeTypeTags = 64;
+
+// Returns the tag bit of `NodeType`, assigning one on first use. A node's type
+// mask (see `Node::GetTypeMask`) contains the bit if the node is a
+// `NodeType`, so membership can be tested without RTTI.
+template <typename NodeType>
+NodeTypeMask GetNodeTypeTag();
+
+// Returns the number of tags assigned so far.
+uint32_t GetNodeTypeTagCount();
+
+// Returns the tags of the first `tag_count` tagged types that `node` is an
+// instance of. Results are cached per class, so each class only tests each tag
+// once.
+NodeTypeMask ComputeNodeTypeMask(const Node& node, uint32_t tag_count);
+
+// ===== Template Implementation ===== //
+
+// Assigns a tag to the type whose instances satisfy `matches`.
+NodeTypeMask RegisterNodeTypeTag(bool (*matches)(const Node& node));
+
+template <typename NodeType>
+NodeTypeMask GetNodeTypeTag() {
+  static const NodeTypeMask tag = RegisterNodeTypeTag([](const Node& node) {
+    return dynamic_cast<const NodeType*>(&node) != nullptr;
+  });
+  return tag;
+}
@@ -0,0 +1,58 @@
+
+#pragma once
+
+#include <cstdint>
+#include <glm/glm.hpp>
+
+#include "nodes/transform.h"
+#include "systems/spatial_system.h"
+#include "utility/collision.h"
+
+class PhysicsSystem;
+
+// A Transform moved by its world's PhysicsSystem. Bodies are simulated in
+// world space, so moving a body's ancestors does not move it, but setting its
+// own position or rotation teleports it.
+class RigidBody : public Transform, public Bounded {
+ public:
+  const CollisionShape& GetShape() const { return shape; }
+  void SetShape(const CollisionShape& value);
+  // The mass of the body. Bodies without mass are not pushed by collisions or
+  // gravity, but still move at their velocity, so they can be static or moved
+  // by scripts.
+  float GetMass() const { return mass; }
+  void SetMass(float value);
+  // How much the body resists sliding, usually between 0 and 1.
+  float GetFriction() const { return friction; }
+  void SetFriction(float value);
+  // How much of the body's speed is kept when it bounces, between 0 and 1.
+  float GetRestitution() const { return restitution; }
+  void SetRestitution(float value);
+
+  glm::vec3 GetLinearVelocity() const;
+  void SetLinearVelocity(const glm::vec3& value);
+  // The angular velocity in radians per second, around world axes.
+  glm::vec3 GetAngularVelocity() const;
+  void SetAngularVelocity(const glm::vec3& value);
+  // Applies `impulse` at the global `point`, changing both velocities. Does
+  // nothing to bodies without mass.
+  void ApplyImpulse(const glm::vec3& impulse, const glm::vec3& point);
+
+  AABB GetLocalBounds() const override { return shape.GetLocalBounds(); }
+
+ private:
+  CollisionShape shape;
+  float mass = 1;
+  float friction = 0.5f;
+  float restitution = 0;
+  // The velocities while the body is not simulated. While it is, they are kept
+  // by the system.
+  glm::vec3 linear_velocity = glm::vec3(0);
+  glm::vec3 angular_velocity = glm::vec3(0);
+
+  // The system simulating this body, and the body's index in it.
+  PhysicsSystem* system = nullptr;
+  uint32_t body_index = 0;
+
+  friend class PhysicsSystem;
+};
@@ -5,7 +5,7 @@
 #include <vector>
 
 #include "nodes/transform.h"
-#include "resources/shader.h"
+#include "resources/material.h"
 #include "resources/skeleton.h"
 #include "resources/skinned_mesh.h"
 #include "systems/render_system.h"
@@ -14,12 +14,10 @@ class SkinnedMeshRenderer : public Transform, public Renderable {
  public:
   struct MeshInfo {
     std::shared_ptr<SkinnedMesh> mesh;
-    std::shared_ptr<Program> material;
+    std::shared_ptr<Material> material;
   };
   std::vector<MeshInfo> meshes;
 
-  virtual ~SkinnedMeshRenderer();
-
   void SetSkeleton(const std::shared_ptr<Skeleton>& new_skeleton);
   const std::shared_ptr<Skeleton>& GetSkeleton() const;
 
@@ -29,6 +27,4 @@ class SkinnedMeshRenderer : public Transform, public Renderable {
               const glm::mat4& ProjectionView) override;
 
   std::shared_ptr<Skeleton> skeleton;
-  GLuint pose_buffer = 0;
-  bool rebuild_pose_buffer = true;
 };
@@ -4,9 +4,23 @@
 #include <glm/glm.hpp>
 #include <glm/gtc/quaternion.hpp>
 
+#include <cstdint>
+
 #include "nodes/node.h"
 #include "utility/cached.h"
 
+class Transform;
+
+// Receives changes to the global transforms of Transforms.
+class TransformListener {
+ public:
+  virtual ~TransformListener() = default;
+
+  // Handles the global matrix of `transform` being invalidated, whether by a
+  // change to it or its ancestors, or by it moving to a new parent.
+  virtual void NotifyOfGlobalTransformChange(Transform& transform) = 0;
+};
+
 class Transform : public Node {
  public:
   Transform();
@@ -27,12 +41,32 @@ class Transform : public Node {
 
   void SetGlobalPosition(const glm::vec3& value);
   void SetGlobalRotation(const glm::quat& value);
+  // Sets the global position and rotation together, which is cheaper than
+  // setting them one at a time.
+  void SetGlobalPose(const glm::vec3& global_position,
+                     const glm::quat& global_rotation_);
+
+  // Returns the local matrix blended between its state before and after the
+  // last fixed update, using the engine's fixed update alpha. Only changes made
+  // during the last fixed update are blended, and any change since then
+  // outside a fixed update is a teleport; otherwise this is the same as
+  // `GetMatrix`.
+  glm::mat4 GetInterpolatedMatrix() const;
+  // Returns the global matrix built from the interpolated matrices of this and
+  // its ancestors. Rendering should use this so motion driven by fixed updates
+  // stays smooth at any frame rate.
+  glm::mat4 GetInterpolatedGlobalMatrix() const;
 
   std::shared_ptr<Transform> GetParentTransform() const;
 
   static std::shared_ptr<Transform> GetFirstTransform(
       const std::shared_ptr<Node>& leaf);
 
+  // Sets the listener notified of changes to this transform's global matrix.
+  // A transform has at most one listener, which must outlive it or be cleared.
+  void SetListener(TransformListener* listener_) { listener = listener_; }
+  TransformListener* GetListener() const { return listener; }
+
  protected:
   void AttachNode(const std::shared_ptr<Node>& child, int index) override;
   void DetachNode(const std::shared_ptr<Node>& child) override;
@@ -52,7 +86,38 @@ class Transform : public Node {
   Cached<glm::mat4> global_matrix;
   Cached<glm::quat> global_rotation;
 
+  // Marks `snapshot_fixed_update` when the state is not being interpolated.
+  static constexpr uint64_t kNoSnapshot = ~0ULL;
+  // The local state before the first change in the fixed update numbered
+  // `snapshot_fixed_update`, or kNoSnapshot if the state is not in motion.
+  glm::vec3 previous_position = glm::vec3(0, 0, 0);
+  glm::quat previous_rotation = glm::quat(1, 0, 0, 0);
+  glm::vec3 previous_scale = glm::vec3(1, 1, 1);
+  uint64_t snapshot_fixed_update = kNoSnapshot;
+
+  // The interpolated global matrix, valid during the frame numbered
+  // `interpolated_frame`.
+  mutable glm::mat4 interpolated_global_matrix;
+  mutable uint64_t interpolated_frame = ~0ULL;
+
+  TransformListener* listener = nullptr;
+
+  // Saves the current local state as the previous state if this is the first
+  // change during the current fixed update. Outside fixed updates, stops the
+  // state being interpolated instead.
+  void SnapshotState();
+
+  // Invalidates the global matrix, and the global rotation if
+  // `rotation_changed`, and notifies the listener.
+  void InvalidateGlobal(bool rotation_changed);
+  // Invalidates the global state of this transform and every transform below
+  // it, after a change to its local state.
+  void InvalidateSubtree(bool rotation_changed);
+
   static glm::mat4 ComputeMatrix(const Transform* transform);
   static glm::mat4 ComputeGlobalMatrix(const Transform* transform);
   static glm::quat ComputeGlobalRotation(const Transform* transform);
+
+  friend class Prefab;
+  friend class SceneReader;
 };
@@ -13,3 +13,8 @@ std::vector<std::shared_ptr<Node>> CollectPreOrderNodes(
 // Constructs a post-order traversal of `root`.
 std::vector<std::shared_ptr<Node>> CollectPostOrderNodes(
     const std::shared_ptr<Node>& root);
+
+// Returns the nodes of `nodes` whose parent is not in `nodes`, i.e. the roots
+// of the subtrees `nodes` is made of. Keeps the order of `nodes`.
+std::vector<std::shared_ptr<Node>> CollectSubtreeRoots(
+    const std::vector<std::shared_ptr<Node>>& nodes);
@@ -0,0 +1,95 @@
+
+#pragma once
+
+#include <GLFW/glfw3.h>
+
+#include <chrono>
+#include <memory>
+
+// A source of time for the engine. Times are in seconds from an arbitrary
+// epoch.
+class Clock {
+ public:
+  virtual ~Clock() = default;
+
+  // Returns the current time.
+  virtual double Now() = 0;
+  // Blocks until `Now()` is at least `time`.
+  virtual void SleepUntil(double time) = 0;
+};
+
+// A clock that follows the steady wall clock.
+class SteadyClock : public Clock {
+ public:
+  SteadyClock();
+
+  double Now() override;
+  // Sleeps until shortly before `time`, then spins the rest of the way, since
+  // sleeping alone commonly overshoots by a millisecond or more.
+  void SleepUntil(double time) override;
+
+  // How long before the deadline to stop sleeping and start spinning.
+  double spin_seconds = 0.002;
+
+ private:
+  std::chrono::steady_clock::time_point start;
+};
+
+// A clock that only moves when told to. Sleeping jumps straight to the
+// deadline, so simulations run as fast as possible and are independent of the
+// machine.
+class ManualClock : public Clock {
+ public:
+  double Now() override { return time; }
+  void SleepUntil(double time_) override;
+
+  // Moves the clock forward by `seconds`.
+  void Advance(double seconds) { time += seconds; }
+
+ private:
+  double time = 0;
+};
+
+// The environment the engine runs in. Provides the clock and the event loop.
+class Platform {
+ public:
+  virtual ~Platform() = default;
+
+  virtual Clock& GetClock() = 0;
+  // Returns whether the platform wants the engine to stop.
+  virtual bool ShouldQuit() = 0;
+  // Processes pending events, such as input. Called once per frame.
+  virtual void PollEvents() = 0;
+  // Returns the window, or null if there is none.
+  virtual GLFWwindow* GetWindow() { return nullptr; }
+};
+
+// A platform driven by a GLFW window.
+class GlfwPlatform : public Platform {
+ public:
+  GlfwPlatform(GLFWwindow* window_);
+
+  Clock& GetClock() override { return clock; }
+  bool ShouldQuit() override;
+  void PollEvents() override;
+  GLFWwindow* GetWindow() override { return window; }
+
+ private:
+  GLFWwindow* window;
+  SteadyClock clock;
+};
+
+// A platform without a window or GL context, such as for simulation servers.
+// It never asks to quit; use `Engine::Quit` instead.
+class HeadlessPlatform : public Platform {
+ public:
+  // Runs on `clock_`, or the steady wall clock if null.
+  HeadlessPlatform(std::unique_ptr<Clock> clock_ = nullptr);
+
+  Clock& GetClock() override { return *clock; }
+  bool ShouldQuit() override { return false; }
+  void PollEvents() override {}
+
+ private:
+  std::unique_ptr<Clock> clock;
+};
@@ -0,0 +1,64 @@
+
+#pragma once
+
+#include <absl/status/statusor.h>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Stores the processed output of resource loaders on disk, keyed by a hash of
+// the source data and the version of the loader that produced it. Loaders opt
+// in by looking up their key before doing any work, and storing their output
+// afterwards. The cache is disabled until a directory is set.
+class DerivedDataCache {
+ public:
+  struct Key {
+    // Name of the loader producing the data. Different loaders never share
+    // entries.
+    std::string loader;
+    // Version of the loader. Bump this whenever the format of the processed
+    // data changes, so stale entries are ignored.
+    uint32_t loader_version;
+    // Hash of all the source data the processed data depends on.
+    uint64_t source_hash;
+  };
+
+  // Sets the directory entries are stored in, creating it if needed. An empty
+  // `directory` disables the cache.
+  void SetDirectory(const std::string& directory);
+  const std::string& GetDirectory() const;
+  // Whether a directory has been set.
+  bool IsEnabled() const;
+
+  // Reads the processed data stored for `key`. Returns a NotFound error if
+  // there is no valid entry.
+  absl::StatusOr<std::vector<unsigned char>> Read(const Key& key) const;
+
+  // Stores `data` as the processed data for `key`, replacing any existing
+  // entry. Does nothing if the cache is disabled.
+  absl::Status Write(const Key& key,
+                     const std::vector<unsigned char>& data) const;
+
+  // Computes a stable 64-bit hash of `length` bytes starting at `data`.
+  // Passing a previous hash as `seed` combines the two.
+  static uint64_t Hash(const void* data, size_t length,
+                       uint64_t seed = kHashSeed);
+  static uint64_t Hash(const std::string& data, uint64_t seed = kHashSeed);
+
+  // Reads the whole file at `path` into `contents` and hashes it.
+  static absl::StatusOr<uint64_t> HashFile(const std::string& path,
+                                           std::string& contents);
+
+  static DerivedDataCache& Get() { return instance; }
+
+  static constexpr uint64_t kHashSeed = 0xcbf29ce484222325ULL;
+
+ private:
+  static DerivedDataCache instance;
+
+  // Computes the path of the entry for `key`.
+  std::string GetEntryPath(const Key& key) const;
+
+  std::string directory;
+};
@@ -0,0 +1,90 @@
+
+#pragma once
+
+#include <GL/glew.h>
+
+#include <mutex>
+#include <vector>
+
+#include "utility/range_allocator.h"
+
+// The arguments of one indirect indexed draw, as read by
+// glMultiDrawElementsIndirect.
+struct DrawElementsIndirectCommand {
+  GLuint count;
+  GLuint instance_count;
+  GLuint first_index;
+  GLint base_vertex;
+  GLuint base_instance;
+};
+
+// Large vertex and index buffers shared by every mesh with the same vertex
+// layout. Meshes are sub-allocated from the buffers, so they all share one
+// VAO and can be drawn together with a single indirect draw. Indices are
+// always 32-bit and relative to the mesh's first vertex. Every layout also
+// has the per-instance attribute kObjectIndexAttribute, which reads the draw's
+// base instance so each draw of a batch can find its object's uniforms.
+class GeometryArena {
+ public:
+  enum class Layout {
+    // A single stream of Mesh::Vertex, in attributes 0-5.
+    Static,
+    // Mesh::Vertex in attributes 0-5, plus a stream of Skin::Vertex in
+    // attributes 6-7.
+    Skinned,
+  };
+
+  // A mesh's share of the arena.
+  struct Range {
+    GLuint base_vertex = 0;
+    GLuint vertex_count = 0;
+    GLuint first_index = 0;
+    GLuint index_count = 0;
+  };
+
+  // Returns the arena for `layout`, creating it on first use. Requires a
+  // current GL context.
+  static GeometryArena& Get(Layout layout);
+
+  // Copies `vertex_count` vertices from each of `streams` (one per stream of
+  // the layout), and `index_count` indices into the arena, growing it if
+  // needed.
+  Range Allocate(const std::vector<const void*>& streams, GLuint vertex_count,
+                 const GLuint* indices, GLuint index_count);
+
+  // Returns `range` to the arena. Its contents are left in place. Safe to call
+  // from any thread, since meshes retained by a frame are released by the
+  // thread that executed it.
+  void Free(const Range& range);
+
+  // Returns the command that draws `range`.
+  static DrawElementsIndirectCommand GetDrawCommand(const Range& range);
+
+  GLuint GetVertexArray() const;
+  Layout GetLayout() const;
+
+ private:
+  GeometryArena(Layout layout_);
+
+  // Reallocates the vertex streams to hold `vertex_capacity` vertices.
+  void GrowVertices(GLuint vertex_capacity);
+  // Reallocates the index buffer to hold `index_capacity` indices.
+  void GrowIndices(GLuint index_capacity);
+  // Points the VAO's attributes at the current vertex streams.
+  void BindAttributes();
+
+  Layout layout;
+  GLuint vao = 0;
+  // One buffer per vertex stream.
+  std::vector<GLuint> vertex_buffers;
+  std::vector<GLsizei> vertex_strides;
+  GLuint index_buffer = 0;
+  // Holds the indices 0 to kMaxBatchObjects - 1, read by
+  // kObjectIndexAttribute.
+  GLuint object_index_buffer = 0;
+
+  // Guards `vertices` and `indices`.
+  std::mutex allocator_mutex;
+  RangeAllocator vertices;
+  RangeAllocator indices;
+};
@@ -0,0 +1,81 @@
+
+#pragma once
+
+#include <GL/glew.h>
+#include <absl/status/statusor.h>
+#include <glog/logging.h>
+
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "resources/shader.h"
+#include "resources/texture.h"
+#include "systems/gl_state_tracker.h"
+#include "utility/resource_handle.h"
+
+// A program together with the values of its "Material" uniform block and the
+// textures it samples. The program's "Frame", "Material", "Object", "Bones"
+// and "Shadow" blocks are bound to the matching UniformBinding, and its
+// "shadow_map" sampler to kShadowMapTextureUnit.
+class Material {
+ public:
+  struct TextureBinding {
+    // Name of the sampler uniform.
+    std::string uniform;
+    ResourceHandle<RenderableTexture> texture;
+  };
+
+  struct Details {
+    ResourceHandle<Program> program;
+    // Textures are assigned texture units in order.
+    std::vector<TextureBinding> textures;
+  };
+  using detail_type = Details;
+
+  static absl::StatusOr<std::shared_ptr<Material>> Load(const Details& details);
+
+  virtual ~Material();
+
+  // Sets the member named `name` of the "Material" block to `value`. The value
+  // is uploaded the next time the material is used.
+  template <typename T>
+  void SetParameter(const std::string& name, const T& value);
+
+  // Uses the program, and binds the parameters and textures through `state`.
+  void Use(GLStateTracker& state);
+
+  const std::shared_ptr<Program>& GetProgram() const;
+
+ private:
+  std::shared_ptr<Program> program;
+  std::vector<std::shared_ptr<RenderableTexture>> textures;
+
+  const Program::UniformBlockInfo* parameter_block = nullptr;
+  std::vector<unsigned char> parameters;
+  bool parameters_dirty = false;
+  GLuint parameter_buffer = 0;
+};
+
+// ===== Template Implementation ===== //
+
+template <typename T>
+void Material::SetParameter(const std::string& name, const T& value) {
+  if (!parameter_block) {
+    LOG(ERROR) << "Material has no parameter \"" << name << "\"";
+    return;
+  }
+  const auto offset_it = parameter_block->member_offsets.find(name);
+  if (offset_it == parameter_block->member_offsets.end() ||
+      offset_it->second + sizeof(T) > parameters.size()) {
+    LOG(ERROR) << "Material has no parameter \"" << name << "\"";
+    return;
+  }
+  unsigned char* const destination = parameters.data() + offset_it->second;
+  if (memcmp(destination, &value, sizeof(T)) == 0) {
+    return;
+  }
+  memcpy(destination, &value, sizeof(T));
+  parameters_dirty = true;
+}
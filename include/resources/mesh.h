@@ -2,8 +2,11 @@
 #pragma once
 
 #include <glm/glm.hpp>
+#include <memory>
 #include <vector>
 
+#include "resources/mesh_bvh.h"
+
 class Mesh {
  public:
   struct Vertex {
@@ -25,4 +28,19 @@ class Mesh {
   std::vector<Vertex> vertices;
   std::vector<Triangle> triangles;
   std::vector<SmallTriangle> small_triangles;
+
+  // Returns the BVH of this mesh, building it with `settings` on first use.
+  // Safe to call from several threads, though each may build its own BVH if
+  // they race. The BVH must be cleared after changing the mesh.
+  std::shared_ptr<const MeshBVH> GetBVH(
+      const MeshBVH::Settings& settings = MeshBVH::Settings()) const;
+  // Returns the BVH of this mesh if it has been built or loaded, or null.
+  std::shared_ptr<const MeshBVH> GetBuiltBVH() const;
+  // Replaces the BVH of this mesh, such as with one loaded from a file. A null
+  // `new_bvh` clears the BVH, so the next `GetBVH` builds it again.
+  void SetBVH(std::shared_ptr<const MeshBVH> new_bvh);
+
+ private:
+  // Accessed atomically, since it is built lazily by const functions.
+  mutable std::shared_ptr<const MeshBVH> bvh;
 };
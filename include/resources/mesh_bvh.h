@@ -0,0 +1,98 @@
+
+#pragma once
+
+#include <absl/status/statusor.h>
+
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <limits>
+#include <vector>
+
+#include "utility/geometry.h"
+
+class Mesh;
+
+// A bounding volume hierarchy over the triangles of a mesh, for finding the
+// triangles hit by a ray or closest to a point. The hierarchy only refers to
+// triangles by index, so it must be used with the mesh it was built from.
+class MeshBVH {
+ public:
+  struct Node {
+    AABB bounds;
+    // For leaves, the index in `triangle_order` of the first triangle. For
+    // inner nodes, the distance to the second child. The first child always
+    // directly follows its parent.
+    uint32_t offset;
+    // The number of triangles in a leaf, or 0 for inner nodes.
+    uint32_t triangle_count;
+
+    bool IsLeaf() const { return triangle_count != 0; }
+  };
+
+  struct Settings {
+    // Nodes with this many triangles or fewer always become leaves.
+    uint32_t max_leaf_triangles = 4;
+    // The number of candidate split positions along each axis.
+    int bin_count = 16;
+    // Subtrees with at least this many triangles are built on their own
+    // thread, up to `thread_count` threads.
+    uint32_t parallel_triangles = 1 << 15;
+    int thread_count = 1;
+  };
+
+  struct RayHit {
+    uint32_t triangle;
+    float distance;
+    // The weights of the second and third points of the triangle at the hit.
+    glm::vec2 barycentric;
+  };
+
+  struct ClosestPoint {
+    uint32_t triangle;
+    glm::vec3 point;
+    float distance;
+  };
+
+  // Builds the hierarchy of `mesh`, choosing splits with the surface area
+  // heuristic over `settings.bin_count` bins per axis.
+  static MeshBVH Build(const Mesh& mesh, const Settings& settings);
+  static MeshBVH Build(const Mesh& mesh) { return Build(mesh, Settings()); }
+
+  // Finds the first triangle of `mesh` hit by `ray` within `max_distance`.
+  // Both sides of triangles are hit.
+  bool Raycast(const Mesh& mesh, const Ray& ray, float max_distance,
+               RayHit& hit) const;
+  // Finds the closest point of `mesh` to `point` within `max_distance`.
+  bool FindClosestPoint(
+      const Mesh& mesh, const glm::vec3& point, ClosestPoint& result,
+      float max_distance = std::numeric_limits<float>::infinity()) const;
+
+  // Returns the bounds of the whole mesh, which are empty for meshes without
+  // triangles.
+  AABB GetBounds() const;
+
+  const std::vector<Node>& GetNodes() const { return nodes; }
+  const std::vector<uint32_t>& GetTriangleOrder() const {
+    return triangle_order;
+  }
+
+  // Creates a hierarchy from `nodes_` and `triangle_order_`, as read from a
+  // file. Fails if they do not form a valid hierarchy over `triangle_count`
+  // triangles.
+  static absl::StatusOr<MeshBVH> Create(std::vector<Node> nodes_,
+                                        std::vector<uint32_t> triangle_order_,
+                                        uint32_t triangle_count);
+
+ private:
+  // The nodes in depth-first order, starting with the root.
+  std::vector<Node> nodes;
+  // The triangles of the mesh, ordered so each leaf's triangles are together.
+  std::vector<uint32_t> triangle_order;
+};
+
+// Returns the number of triangles in `mesh`. Meshes without indices use every
+// three vertices as a triangle.
+uint32_t GetTriangleCount(const Mesh& mesh);
+// Returns the positions of the points of the triangle at `triangle`.
+void GetTrianglePoints(const Mesh& mesh, uint32_t triangle,
+                       glm::vec3 (&points)[3]);
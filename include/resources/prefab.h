@@ -0,0 +1,133 @@
+
+#pragma once
+
+#include <absl/status/statusor.h>
+#include <glog/logging.h>
+
+#include <cstdint>
+#include <functional>
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include <memory>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include "nodes/node.h"
+#include "nodes/transform.h"
+#include "world.h"
+
+// A template for a tree of nodes, stored as a flat array where every node
+// refers to its parent by index. Instantiating a prefab spawns all of its
+// nodes, fills in their transforms, and links them together directly, so the
+// finished tree is attached with a single notification to systems. Prefabs are
+// either built in code or loaded from scene files.
+class Prefab {
+ public:
+  // The parent index of the root node.
+  static constexpr uint32_t kNoParent = ~0u;
+
+  struct Details {
+    // The scene file the prefab's tree is read from.
+    std::string file;
+  };
+  using detail_type = Details;
+
+  // Loads the tree of the scene file at `details.file` as a prefab. The node
+  // types of the scene must be registered in SceneNodeTypes.
+  static absl::StatusOr<std::shared_ptr<Prefab>> Load(const Details& details);
+
+  // Builds a prefab from the tree of `root`. Every node's type must be
+  // registered in SceneNodeTypes; the fields of each node are copied with its
+  // type's field writer, and read back into every instance by its initializer.
+  static absl::StatusOr<std::shared_ptr<Prefab>> FromTree(const Node& root);
+
+  struct NodeData {
+    // The index of the parent node, or `kNoParent` for the root. Parents
+    // always come before their children.
+    uint32_t parent;
+    std::string name;
+    // Creates a node of this node's type.
+    std::shared_ptr<Node> (*spawn)();
+    // Whether the node is a Transform. If so, it starts with the local
+    // `position`, `rotation` and `scale`.
+    bool is_transform;
+    glm::vec3 position = glm::vec3(0, 0, 0);
+    glm::quat rotation = glm::quat(1, 0, 0, 0);
+    glm::vec3 scale = glm::vec3(1, 1, 1);
+    // Sets up the rest of the node's state. Called on the instantiating thread
+    // after the nodes of an instance are linked, but before the instance is
+    // attached. May be empty.
+    std::function<void(Node& node)> initialize;
+  };
+
+  // Adds a node of type `NodeType` as the last child of the node at `parent`,
+  // returning the index of the new node. The first node must be the root,
+  // added with `parent` of `kNoParent`. `initialize` is called on every
+  // instance of the node, and may be empty.
+  template <typename NodeType>
+  uint32_t AddNode(uint32_t parent, const std::string& name = "",
+                   std::function<void(NodeType& node)> initialize = nullptr);
+
+  // Sets the local transform of the Transform node at `index`.
+  void SetTransform(uint32_t index, const glm::vec3& position,
+                    const glm::quat& rotation = glm::quat(1, 0, 0, 0),
+                    const glm::vec3& scale = glm::vec3(1, 1, 1));
+
+  const std::vector<NodeData>& GetNodes() const { return nodes; }
+
+  // Creates an instance of this prefab and returns its root. If `parent` is
+  // not null, the instance is attached to it.
+  std::shared_ptr<Node> Instantiate(
+      const std::shared_ptr<Node>& parent = nullptr) const;
+
+  // Creates `count` instances of this prefab and returns their roots. If
+  // `parent` is not null, the instances are attached to it, and systems are
+  // notified of all of them at once. The nodes of the instances are spawned
+  // and linked on up to `thread_count` threads, since spawning only touches
+  // the node pools; initializers always run on the calling thread.
+  std::vector<std::shared_ptr<Node>> Instantiate(
+      int count, const std::shared_ptr<Node>& parent,
+      int thread_count = 1) const;
+
+ private:
+  // Spawns the nodes of an instance into `instance`, writes their transforms
+  // and links them together. Touches nothing outside the new nodes, so
+  // instances can be built in parallel.
+  void BuildInstance(std::vector<std::shared_ptr<Node>>& instance) const;
+  // Runs the initializers of the nodes of `instance`.
+  void InitializeInstance(
+      const std::vector<std::shared_ptr<Node>>& instance) const;
+
+  std::vector<NodeData> nodes;
+};
+
+// ===== Template Implementation ===== //
+
+template <typename NodeType>
+uint32_t Prefab::AddNode(uint32_t parent, const std::string& name,
+                         std::function<void(NodeType& node)> initialize) {
+  static_assert(std::is_base_of_v<Node, NodeType>,
+                "Only nodes can be added to a prefab.");
+  if (nodes.empty()) {
+    CHECK(parent == kNoParent) << "The first node of a prefab is its root.";
+  } else {
+    CHECK(parent < nodes.size()) << "Prefab parent index " << parent
+                                 << " is out of range.";
+  }
+
+  NodeData data;
+  data.parent = parent;
+  data.name = name;
+  data.spawn = []() -> std::shared_ptr<Node> {
+    return World::Spawn<NodeType>();
+  };
+  data.is_transform = std::is_base_of_v<Transform, NodeType>;
+  if (initialize) {
+    data.initialize = [initialize = std::move(initialize)](Node& node) {
+      initialize(static_cast<NodeType&>(node));
+    };
+  }
+  nodes.push_back(std::move(data));
+  return nodes.size() - 1;
+}
@@ -6,15 +6,25 @@
 
 #include <memory>
 #include <optional>
+#include <vector>
 
+#include "resources/geometry_arena.h"
 #include "resources/mesh.h"
 #include "resources/skin.h"
+#include "utility/geometry.h"
 #include "utility/resource_handle.h"
 
 class RenderableMesh {
  public:
   struct Details {
     ResourceHandle<Mesh> mesh;
+    // Whether to upload the mesh to the GPU. Meshes that are not uploaded need
+    // no GL context, but can only be drawn by the SoftwareRenderSuperSystem.
+    bool upload = true;
+    // Whether to keep the source mesh once it is uploaded, so the mesh can
+    // also be drawn by the SoftwareRenderSuperSystem. Meshes that are not
+    // uploaded always keep it.
+    bool keep_source = false;
   };
   using detail_type = Details;
 
@@ -23,14 +33,31 @@ class RenderableMesh {
 
   virtual ~RenderableMesh();
 
+  // Draws the mesh on its own. Prefer RenderSuperSystem::QueueDraw, which
+  // batches draws from the same arena.
   void Draw();
 
- protected:
-  enum class Indexing { None, Small, Large };
+  GeometryArena& GetArena() const;
+  // Returns the command that draws this mesh from its arena.
+  DrawElementsIndirectCommand GetDrawCommand() const;
+
+  // Returns the bounds of the mesh's vertices.
+  const AABB& GetBounds() const { return bounds; }
 
-  std::vector<GLuint> buffers;
-  GLuint vao = 0;
-  unsigned int elements;
-  unsigned int vertex_attribute_count;
-  Indexing indexing = Indexing::None;
+  // Returns whether the mesh is in its arena, so it can be drawn with GL.
+  bool IsUploaded() const { return arena != nullptr; }
+  // Returns the mesh this was loaded from, which the software renderer draws.
+  // Null for meshes that do not keep it, like uploaded meshes without
+  // `keep_source` and SkinnedMeshes.
+  const std::shared_ptr<const Mesh>& GetSourceMesh() const { return source; }
+
+ protected:
+  // Collects the indices of `mesh` as 32-bit indices, generating them if the
+  // mesh is not indexed.
+  static absl::StatusOr<std::vector<GLuint>> CollectIndices(const Mesh& mesh);
+
+  GeometryArena* arena = nullptr;
+  GeometryArena::Range range;
+  AABB bounds;
+  std::shared_ptr<const Mesh> source;
 };
@@ -51,6 +51,12 @@ class ResourceLoader {
   // if loading depth becomes negative.
   void DecrementLoadingDepth() { loadingDepth--; }
 
+  // Returns the name `resource` was loaded with. Searches every resource, so
+  // this is meant for saving rather than per-frame use.
+  template <typename ResourceType>
+  absl::StatusOr<std::string> GetName(
+      const std::shared_ptr<ResourceType>& resource) const;
+
   // Releases any resources that are currently being held. If these resources
   // have no other references, the resource will be unloaded.
   void ManualRelease() { heldResources.clear(); }
@@ -155,6 +161,18 @@ absl::StatusOr<std::shared_ptr<ResourceType>> ResourceLoader::Load(
   return *ptr_status_or;
 }
 
+template <typename ResourceType>
+absl::StatusOr<std::string> ResourceLoader::GetName(
+    const std::shared_ptr<ResourceType>& resource) const {
+  for (const auto& [name, info] : resourceInfo) {
+    if (info.type == typeid(ResourceType) &&
+        info.ref.lock().get() == resource.get()) {
+      return name;
+    }
+  }
+  return absl::NotFoundError("Resource was not loaded by the ResourceLoader");
+}
+
 template <typename ResourceType>
 absl::Status ResourceLoader::Add(
     const std::string& resourceName,
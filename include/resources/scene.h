@@ -0,0 +1,205 @@
+
+#pragma once
+
+#include <absl/container/flat_hash_map.h>
+#include <absl/status/statusor.h>
+
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <istream>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <type_traits>
+#include <typeindex>
+#include <vector>
+
+#include "nodes/node.h"
+#include "nodes/transform.h"
+#include "utility/hton_extra.h"
+#include "utility/status.h"
+#include "world.h"
+
+// Scenes are transit files with the type "SCNE". The JSON lists the names of
+// the node types used by the scene, and the binary data holds a record for
+// every node in pre-order, followed by the names and fields of the nodes.
+
+// Writes the fields of a node that are not covered by the scene format (its
+// name and, for Transforms, its local transform). Values are written in big
+// endian order.
+class SceneFieldWriter {
+ public:
+  explicit SceneFieldWriter(std::vector<unsigned char>& data_) : data(data_) {}
+
+  // Writes `value`, which must be a uint8_t, uint16_t, uint32_t, float, or a
+  // glm vector or quaternion.
+  template <typename T>
+  void Write(const T& value);
+  void WriteString(const std::string& value);
+
+ private:
+  std::vector<unsigned char>& data;
+};
+
+// Reads the fields written by `SceneFieldWriter`, failing instead of reading
+// past the fields of the node.
+class SceneFieldReader {
+ public:
+  SceneFieldReader(const unsigned char* data_, size_t length)
+      : data(data_), remaining(length) {}
+
+  template <typename T>
+  absl::StatusOr<T> Read();
+  absl::StatusOr<std::string> ReadString();
+
+ private:
+  // Checks that `length` more bytes can be read.
+  absl::Status Require(size_t length) const;
+
+  const unsigned char* data;
+  size_t remaining;
+};
+
+// The node types that can be saved to and loaded from scenes. Node,
+// Transform and Camera are always registered.
+class SceneNodeTypes {
+ public:
+  struct TypeInfo {
+    // The name of the type in scene files.
+    std::string name;
+    // Creates a node of this type.
+    std::shared_ptr<Node> (*spawn)();
+    bool is_transform;
+    // Writes and reads the fields of nodes of this type. May be empty.
+    std::function<absl::Status(const Node& node, SceneFieldWriter& writer)>
+        write_fields;
+    std::function<absl::Status(Node& node, SceneFieldReader& reader)>
+        read_fields;
+  };
+
+  // Registers `NodeType` with `name`. Nodes of a derived type are only saved
+  // if the derived type is registered as well. `read_fields` may load
+  // resources, so it is only called on the loading thread.
+  template <typename NodeType>
+  void Register(
+      const std::string& name,
+      std::function<absl::Status(const NodeType& node,
+                                 SceneFieldWriter& writer)>
+          write_fields = nullptr,
+      std::function<absl::Status(NodeType& node, SceneFieldReader& reader)>
+          read_fields = nullptr);
+
+  // Returns the type named `name`, or null if there is none.
+  const TypeInfo* Find(const std::string& name) const;
+  // Returns the type of `node`, or null if it is not registered.
+  const TypeInfo* Find(const Node& node) const;
+
+  static SceneNodeTypes& Get();
+
+ private:
+  SceneNodeTypes();
+
+  void Add(std::type_index type, std::unique_ptr<TypeInfo> info);
+
+  std::vector<std::unique_ptr<TypeInfo>> types;
+  absl::flat_hash_map<std::string, const TypeInfo*> types_by_name;
+  absl::flat_hash_map<std::type_index, const TypeInfo*> types_by_type;
+};
+
+// Saves node trees to scene files.
+class SceneWriter {
+ public:
+  // Writes the tree of `root` to `stream`. Fails if any node's type is not
+  // registered in SceneNodeTypes.
+  static absl::Status Write(std::ostream& stream,
+                            const std::shared_ptr<Node>& root);
+};
+
+struct SceneNodeRecord;
+
+// Loads node trees from scene files.
+class SceneReader {
+ public:
+  // Reads a tree from `stream`, returning its root. The tree is not attached
+  // to anything, so attaching it notifies systems once. The subtrees of the
+  // root are built on up to `thread_count` threads; fields are always read on
+  // the calling thread.
+  static absl::StatusOr<std::shared_ptr<Node>> Read(std::istream& stream,
+                                                    int thread_count = 1);
+
+  // Reads a tree from the scene file at `file`. See `Read`.
+  static absl::StatusOr<std::shared_ptr<Node>> Load(const std::string& file,
+                                                    int thread_count = 1);
+
+ private:
+  // Spawns the nodes of `records` in [`begin`, `end`), which must be whole
+  // subtrees, into `nodes`, and links every node to its parent if the parent
+  // is also in the range.
+  static void BuildNodes(const std::vector<SceneNodeRecord>& records,
+                         const std::vector<const SceneNodeTypes::TypeInfo*>&
+                             record_types,
+                         const unsigned char* strings, uint32_t begin,
+                         uint32_t end,
+                         std::vector<std::shared_ptr<Node>>& nodes);
+};
+
+// ===== Template Implementation ===== //
+
+template <typename T>
+void SceneFieldWriter::Write(const T& value) {
+  T big_endian_value;
+  if constexpr (sizeof(T) == 1) {
+    big_endian_value = value;
+  } else {
+    big_endian_value = htob(value);
+  }
+  const size_t offset = data.size();
+  data.resize(offset + sizeof(T));
+  memcpy(data.data() + offset, &big_endian_value, sizeof(T));
+}
+
+template <typename T>
+absl::StatusOr<T> SceneFieldReader::Read() {
+  RETURN_IF_ERROR(Require(sizeof(T)));
+  T value;
+  memcpy(&value, data, sizeof(T));
+  data += sizeof(T);
+  remaining -= sizeof(T);
+  if constexpr (sizeof(T) == 1) {
+    return value;
+  } else {
+    return btoh(value);
+  }
+}
+
+template <typename NodeType>
+void SceneNodeTypes::Register(
+    const std::string& name,
+    std::function<absl::Status(const NodeType& node,
+                               SceneFieldWriter& writer)>
+        write_fields,
+    std::function<absl::Status(NodeType& node, SceneFieldReader& reader)>
+        read_fields) {
+  static_assert(std::is_base_of_v<Node, NodeType>,
+                "Only nodes can be registered as scene node types.");
+  std::unique_ptr<TypeInfo> info(new TypeInfo());
+  info->name = name;
+  info->spawn = []() -> std::shared_ptr<Node> {
+    return World::Spawn<NodeType>();
+  };
+  info->is_transform = std::is_base_of_v<Transform, NodeType>;
+  if (write_fields) {
+    info->write_fields = [write_fields = std::move(write_fields)](
+                             const Node& node, SceneFieldWriter& writer) {
+      return write_fields(static_cast<const NodeType&>(node), writer);
+    };
+  }
+  if (read_fields) {
+    info->read_fields = [read_fields = std::move(read_fields)](
+                            Node& node, SceneFieldReader& reader) {
+      return read_fields(static_cast<NodeType&>(node), reader);
+    };
+  }
+  Add(typeid(NodeType), std::move(info));
+}
@@ -2,8 +2,11 @@
 #pragma once
 
 #include <GL/glew.h>
+#include <absl/container/flat_hash_map.h>
 #include <absl/status/statusor.h>
+#include <glog/logging.h>
 
+#include <glm/glm.hpp>
 #include <memory>
 #include <string>
 #include <vector>
@@ -21,11 +24,18 @@ class Shader {
   };
   using detail_type = Details;
 
+  // Reads the shader source. Compilation is deferred until a Program needs it,
+  // since a cached program binary can make it unnecessary.
   static absl::StatusOr<std::shared_ptr<Shader>> Load(const Details& details);
 
   virtual ~Shader();
 
  private:
+  // Compiles the shader if it has not already been compiled.
+  absl::Status Compile();
+
+  std::string source;
+  Type type;
   GLuint id = 0;
 
   friend class Program;
@@ -39,16 +49,128 @@ class Program {
   };
   using detail_type = Details;
 
+  // A uniform of type `T` resolved against a specific program, so setting it
+  // needs no string lookups.
+  template <typename T>
+  struct UniformHandle {
+    // The program this handle was resolved against.
+    const Program* program = nullptr;
+    GLint location = -1;
+    // Index of the uniform in the program's uniform table.
+    int index = -1;
+
+    // Whether the handle refers to an active uniform.
+    bool IsValid() const { return location >= 0; }
+  };
+
+  // Describes the layout of an active uniform block.
+  struct UniformBlockInfo {
+    GLuint index;
+    // Size of the block's data in bytes.
+    GLint data_size;
+    // Byte offset of each member of the block.
+    absl::flat_hash_map<std::string, GLint> member_offsets;
+  };
+
+  // Links the program from its shaders. If the derived data cache is enabled
+  // and the driver supports program binaries, the linked binary is cached and
+  // reused on later runs with the same sources and driver.
   static absl::StatusOr<std::shared_ptr<Program>> Load(const Details& details);
 
   virtual ~Program();
 
   void Use();
 
+  GLuint GetId() const;
+
+  // Resolves the uniform named `name` to a handle. If there is no active
+  // uniform with that name, or it cannot hold a `T`, returns a handle that is
+  // not valid. Setting an invalid handle does nothing.
+  template <typename T>
+  UniformHandle<T> GetUniform(const std::string& name) const;
+
+  // Sets the uniform referred to by `handle` to `value`. Skips the upload if
+  // the uniform already holds `value`. The program must be in use.
+  template <typename T>
+  void SetUniform(const UniformHandle<T>& handle, const T& value);
+
   GLuint GetUniformLocation(const std::string& name) const;
   GLuint GetUniformBlockIndex(const std::string& name) const;
+  // Returns the layout of the uniform block named `name`, or null if there is
+  // no active block with that name.
+  const UniformBlockInfo* GetUniformBlock(const std::string& name) const;
   void SetUniformBlockBinding(GLuint block_index, GLuint block_binding);
 
  private:
+  struct UniformInfo {
+    GLint location;
+    GLenum type;
+    GLint size;
+    // Offset of the last uploaded value in `shadow_values`, or -1 if values of
+    // this uniform are not shadowed.
+    int shadow_offset;
+    // Whether the shadow value has been set.
+    bool shadow_valid;
+  };
+
+  // Queries all active uniforms and uniform blocks from GL.
+  void Introspect();
+
+  // Compares `value` against the shadow value of the uniform at `index`,
+  // replacing it if it differs. Returns whether `value` needs uploading.
+  bool UpdateShadow(int index, const void* value, size_t size);
+
+  static bool MatchesType(GLenum type, const float*);
+  static bool MatchesType(GLenum type, const int*);
+  static bool MatchesType(GLenum type, const unsigned int*);
+  static bool MatchesType(GLenum type, const glm::vec2*);
+  static bool MatchesType(GLenum type, const glm::vec3*);
+  static bool MatchesType(GLenum type, const glm::vec4*);
+  static bool MatchesType(GLenum type, const glm::mat4*);
+
+  static void Upload(GLint location, float value);
+  static void Upload(GLint location, int value);
+  static void Upload(GLint location, unsigned int value);
+  static void Upload(GLint location, const glm::vec2& value);
+  static void Upload(GLint location, const glm::vec3& value);
+  static void Upload(GLint location, const glm::vec4& value);
+  static void Upload(GLint location, const glm::mat4& value);
+
   GLuint id = 0;
+
+  std::vector<UniformInfo> uniforms;
+  absl::flat_hash_map<std::string, int> uniform_indices;
+  std::vector<unsigned char> shadow_values;
+
+  std::vector<UniformBlockInfo> uniform_blocks;
+  absl::flat_hash_map<std::string, GLuint> uniform_block_indices;
+  // The binding last set for each uniform block index.
+  std::vector<GLint> uniform_block_bindings;
 };
+
+// ===== Template Implementation ===== //
+
+template <typename T>
+Program::UniformHandle<T> Program::GetUniform(const std::string& name) const {
+  UniformHandle<T> handle;
+  handle.program = this;
+  const auto index_it = uniform_indices.find(name);
+  if (index_it == uniform_indices.end() ||
+      !MatchesType(uniforms[index_it->second].type, (const T*)nullptr)) {
+    return handle;
+  }
+  handle.location = uniforms[index_it->second].location;
+  handle.index = index_it->second;
+  return handle;
+}
+
+template <typename T>
+void Program::SetUniform(const UniformHandle<T>& handle, const T& value) {
+  if (!handle.IsValid()) {
+    return;
+  }
+  DCHECK(handle.program == this) << "Uniform handle is for another program";
+  if (UpdateShadow(handle.index, &value, sizeof(T))) {
+    Upload(handle.location, value);
+  }
+}
@@ -42,6 +42,11 @@ class Texture {
   pixel_rgb_32* GetDataAsRGB32() const;
   pixel_grey_32* GetDataAsGrey32() const;
 
+  // Returns the pixel data without regard for its type.
+  void* GetData() const;
+  // Returns the size of the pixel data in bytes.
+  size_t GetDataSize() const;
+
   uint32_t GetWidth() const;
   uint32_t GetHeight() const;
   PixelType GetPixelType() const;
@@ -93,6 +98,8 @@ class RenderableTexture {
 
   void Use(unsigned int texture_unit);
 
+  GLuint GetId() const;
+
   uint32_t GetWidth() const;
   uint32_t GetHeight() const;
 
@@ -4,6 +4,7 @@
 #include <absl/status/statusor.h>
 
 #include <memory>
+#include <string>
 
 #include "resources/texture.h"
 
@@ -15,4 +16,7 @@ struct Details {
 
 absl::StatusOr<std::shared_ptr<Texture>> Load(const Details& details);
 
+// Writes `texture` to `file` as a PNG, with its first row at the top.
+absl::Status Save(const Texture& texture, const std::string& file);
+
 }  // namespace PngTexture
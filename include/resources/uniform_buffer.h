@@ -0,0 +1,120 @@
+
+#pragma once
+
+#include <GL/glew.h>
+
+#include <glm/glm.hpp>
+
+#include "systems/gl_state_tracker.h"
+
+// The uniform buffer binding points shared by every program. Materials bind
+// their programs' blocks to these, so buffers only need to be bound once.
+enum class UniformBinding : GLuint {
+  Bones = 0,
+  Frame = 1,
+  Material = 2,
+  Object = 3,
+  Shadow = 4,
+};
+
+// The texture unit the shadow map is bound to. Materials set their programs'
+// "shadow_map" sampler to it, so it must not be used by material textures.
+constexpr GLuint kShadowMapTextureUnit = 15;
+
+// The most shadow cascades a directional light can have.
+constexpr int kMaxShadowCascades = 4;
+
+// The number of ObjectUniforms in the "Object" block's array, so the most
+// objects one batch of draws can cover. Fills the 16KB every implementation
+// allows a uniform block.
+constexpr int kMaxBatchObjects = 128;
+
+// The per-instance vertex attribute holding the index of each draw's object
+// within the "Object" block. Draws select their object through their base
+// instance.
+constexpr GLuint kObjectIndexAttribute = 8;
+
+// Data for the "Frame" uniform block, laid out according to std140. Set once
+// per camera.
+struct FrameUniforms {
+  glm::mat4 view;
+  glm::mat4 projection;
+  glm::mat4 projection_view;
+  // The camera's world-space position. The w component is unused.
+  glm::vec4 camera_position;
+};
+
+// Data for one element of the "Object" uniform block's array, laid out
+// according to std140. Set once per rendered node.
+struct ObjectUniforms {
+  glm::mat4 model;
+  glm::mat4 model_view_projection;
+};
+
+// Data for the "Shadow" uniform block, laid out according to std140. Set once
+// per camera.
+struct ShadowUniforms {
+  // Transforms world space into each cascade's shadow map, with x, y and depth
+  // in [0, 1].
+  glm::mat4 cascade_matrices[kMaxShadowCascades];
+  // The view-space distance from the camera at which each cascade ends.
+  glm::vec4 cascade_splits;
+  // The world-space direction the light travels in. The w component is the
+  // number of cascades in the shadow map, or 0 if there are no shadows.
+  glm::vec4 light_direction;
+  // The light's colour multiplied by its intensity. The w component is unused.
+  glm::vec4 light_colour;
+};
+
+// A uniform buffer that is linearly allocated from each frame. The buffer is
+// split into one segment per frame in flight, and a segment is only reused once
+// the GPU has finished the frame that used it, so data can be written without
+// stalling. Binding an allocation is then just an offset bind.
+class UniformRingBuffer {
+ public:
+  // Creates a ring with `frame_size` bytes available to each frame.
+  UniformRingBuffer(GLsizeiptr frame_size);
+  ~UniformRingBuffer();
+
+  // Starts allocating from the next segment, waiting for the GPU to finish
+  // with it if needed.
+  void BeginFrame();
+  // Marks the end of all allocations for the current frame.
+  void EndFrame();
+
+  // Copies `size` bytes of `data` into the current segment and binds them to
+  // `binding` through `state`. At least `bound_size` bytes are bound, so
+  // blocks larger than the data are still backed by the buffer. Returns false
+  // if the segment is full, in which case the ring grows at the start of the
+  // next frame.
+  bool Push(GLStateTracker& state, UniformBinding binding, const void* data,
+            GLsizeiptr size, GLsizeiptr bound_size = 0);
+
+  template <typename T>
+  bool Push(GLStateTracker& state, UniformBinding binding, const T& data) {
+    return Push(state, binding, &data, sizeof(T));
+  }
+
+ private:
+  static constexpr int kFramesInFlight = 3;
+
+  // Creates the buffer with room for `frame_size` bytes per frame.
+  void Create(GLsizeiptr frame_size_);
+  // Waits for all segments and deletes the buffer.
+  void Destroy();
+
+  GLuint id = 0;
+  // Write pointer when the buffer is persistently mapped, or null if data is
+  // uploaded with glBufferSubData.
+  unsigned char* mapped = nullptr;
+
+  GLsizeiptr frame_size = 0;
+  GLint offset_alignment = 256;
+
+  int frame = 0;
+  // Offset of the next allocation within the current segment.
+  GLsizeiptr frame_offset = 0;
+  // Whether an allocation did not fit in the current segment.
+  bool overflowed = false;
+  GLsync fences[kFramesInFlight] = {};
+};
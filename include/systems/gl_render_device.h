@@ -0,0 +1,116 @@
+
+#pragma once
+
+#include <GL/glew.h>
+#include <GLFW/glfw3.h>
+
+#include <glm/glm.hpp>
+#include <memory>
+#include <vector>
+
+#include "resources/geometry_arena.h"
+#include "resources/material.h"
+#include "resources/uniform_buffer.h"
+#include "systems/gl_state_tracker.h"
+#include "systems/gpu_timer.h"
+#include "systems/render_device.h"
+
+// Executes commands with OpenGL, presenting frames to a GLFW window.
+// Consecutive draws with the same material and arena are submitted together
+// as one indirect draw, even across objects: object uniforms are gathered into
+// the "Object" block's array and each draw selects its object through its base
+// instance. Draws into depth targets ignore their materials and
+// use a vertex-only program, so no fragment shading is done for them. Must
+// only be used on the thread whose context is current.
+class GLRenderDevice : public RenderDevice {
+ public:
+  // Draws to `window_`, waiting for `swap_interval` screen refreshes before
+  // swapping buffers, with `object_uniform_capacity` bytes of uniform data
+  // available to each frame before the ring buffer has to grow.
+  GLRenderDevice(GLFWwindow* window_, int swap_interval,
+                 GLsizeiptr object_uniform_capacity);
+  ~GLRenderDevice();
+
+  glm::ivec2 GetSurfaceSize() override;
+
+  void BeginFrame() override;
+  void Submit(const RenderCommandBuffer& commands) override;
+  void EndFrame() override;
+
+  const Stats& GetFrameStats() const override;
+
+  // Returns the tracker that rendering state should be changed through.
+  GLStateTracker& GetGLState();
+
+ private:
+  void Execute(const RenderCommandBuffer::SetViewport& command,
+               const RenderCommandBuffer& commands);
+  void Execute(const RenderCommandBuffer::Clear& command,
+               const RenderCommandBuffer& commands);
+  void Execute(const RenderCommandBuffer::SetUniforms& command,
+               const RenderCommandBuffer& commands);
+  void Execute(const RenderCommandBuffer::Draw& command,
+               const RenderCommandBuffer& commands);
+  void Execute(const RenderCommandBuffer::BeginPass& command,
+               const RenderCommandBuffer& commands);
+  void Execute(const RenderCommandBuffer::EndPass& command,
+               const RenderCommandBuffer& commands);
+  void Execute(const RenderCommandBuffer::SetRenderTarget& command,
+               const RenderCommandBuffer& commands);
+  void Execute(const RenderCommandBuffer::SetDepthBias& command,
+               const RenderCommandBuffer& commands);
+  void Execute(const RenderCommandBuffer::BindTargetTexture& command,
+               const RenderCommandBuffer& commands);
+
+  // Submits all queued draws, along with the objects they read. Must be called
+  // before changing any state the queued draws depend on.
+  void FlushDraws();
+
+  // An array of depth textures with a framebuffer drawing to each layer.
+  struct DepthTarget {
+    GLuint texture = 0;
+    std::vector<GLuint> framebuffers;
+    int width = 0;
+    int height = 0;
+  };
+  // Recreates `target` as `layers` depth textures of `width` by `height`.
+  void ResizeDepthTarget(DepthTarget& target, int width, int height,
+                         int layers);
+  void DeleteDepthTarget(DepthTarget& target);
+  void BindFramebuffer(GLuint framebuffer);
+
+  GLFWwindow* window;
+
+  GLStateTracker gl_state;
+  // Times each pass on the GPU when profiling.
+  GpuTimer gpu_timer;
+  std::unique_ptr<UniformRingBuffer> uniform_ring;
+  glm::vec4 clear_colour;
+  // A bit for each UniformBinding whose last push did not fit in the ring.
+  // Draws are skipped while any are set, rather than reading stale data.
+  unsigned int failed_bindings = 0;
+
+  std::vector<DepthTarget> depth_targets;
+  GLuint bound_framebuffer = 0;
+  // Whether draws go into a depth target, and so use `depth_materials`.
+  bool drawing_depth = false;
+  // A depth-only material for each GeometryArena::Layout.
+  std::shared_ptr<Material> depth_materials[2];
+  // The constant and slope depth offsets currently set.
+  glm::vec2 depth_bias = glm::vec2(0.f);
+
+  Material* queued_material = nullptr;
+  GeometryArena* queued_arena = nullptr;
+  std::vector<DrawElementsIndirectCommand> queued_draws;
+  // The objects read by the queued draws. The last is the object later draws
+  // use, and is kept when the draws are flushed.
+  std::vector<ObjectUniforms> queued_objects;
+  // The most objects flushed together. Without base instances, draws cannot
+  // select their object, so this is 1.
+  size_t max_batch_objects = 1;
+  GLuint indirect_buffer = 0;
+
+  unsigned int commands_executed = 0;
+  unsigned int draws_executed = 0;
+  Stats frame_stats;
+};
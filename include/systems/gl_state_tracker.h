@@ -0,0 +1,66 @@
+
+#pragma once
+
+#include <GL/glew.h>
+
+#include <vector>
+
+// Mirrors the GL bindings changed while rendering, so binds that would not
+// change anything can be skipped. Also counts the GL calls made each frame.
+class GLStateTracker {
+ public:
+  struct Stats {
+    // GL calls made, including those made outside the tracker and reported
+    // through CountCalls.
+    unsigned int calls = 0;
+    // Binds skipped because the state was already set.
+    unsigned int skipped_calls = 0;
+    // Draw calls made.
+    unsigned int draws = 0;
+  };
+
+  void BindVertexArray(GLuint vao);
+  void UseProgram(GLuint program);
+  void BindUniformBuffer(GLuint binding, GLuint buffer);
+  void BindUniformBufferRange(GLuint binding, GLuint buffer, GLintptr offset,
+                              GLsizeiptr size);
+  void BindTexture2D(GLuint unit, GLuint texture);
+  // Binds `texture` to `target` of `unit`. Only the texture is tracked per
+  // unit, so units should only be used with one target.
+  void BindTexture(GLuint unit, GLenum target, GLuint texture);
+
+  // Records `count` GL calls made without going through the tracker.
+  void CountCalls(unsigned int count = 1);
+  // Records a draw call made without going through the tracker.
+  void CountDraw();
+
+  // Forgets all tracked state. Must be called whenever the tracked bindings
+  // may have been changed without going through the tracker.
+  void Invalidate();
+
+  // Finishes counting the current frame.
+  void EndFrame();
+  // Returns the stats of the last finished frame.
+  const Stats& GetFrameStats() const;
+
+ private:
+  // Stands in for bindings whose value is not known, so the next bind is never
+  // skipped.
+  static constexpr GLuint kUnknown = ~0U;
+
+  struct BufferRange {
+    GLuint buffer = kUnknown;
+    GLintptr offset = 0;
+    // The size of the range, or -1 if the whole buffer is bound.
+    GLsizeiptr size = -1;
+  };
+
+  GLuint vao = kUnknown;
+  GLuint program = kUnknown;
+  GLuint active_texture_unit = kUnknown;
+  std::vector<BufferRange> uniform_buffers;
+  std::vector<GLuint> textures;
+
+  Stats current_stats;
+  Stats frame_stats;
+};
@@ -0,0 +1,38 @@
+
+#pragma once
+
+#include <GL/glew.h>
+
+#include <deque>
+#include <vector>
+
+// Times GPU work with timestamp queries, and records it on the profiler's
+// "GPU" track once the results are available, so reading them never stalls.
+// Does nothing while the profiler is disabled.
+class GpuTimer {
+ public:
+  ~GpuTimer();
+
+  // Starts timing the GPU work submitted after this call under `name`, which
+  // must outlive the profiler. Scopes must not overlap.
+  void Begin(const char* name);
+  // Stops timing the scope started by the last call to Begin.
+  void End();
+
+  // Records every finished scope with the profiler.
+  void Collect();
+
+ private:
+  struct Scope {
+    const char* name;
+    GLuint start_query;
+    GLuint end_query;
+  };
+
+  GLuint AcquireQuery();
+
+  std::vector<GLuint> free_queries;
+  // Scopes that have been submitted, in submission order.
+  std::deque<Scope> pending;
+  bool is_open = false;
+};
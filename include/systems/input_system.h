@@ -7,11 +7,17 @@
 
 #include <glm/glm.hpp>
 
+#include <cstdint>
+#include <vector>
+
 #include "systems/super_system.h"
 
 class InputSuperSystem : public SuperSystem {
  public:
-  InputSuperSystem(GLFWwindow* window_);
+  // Reads input from `window_`, or the window of the engine's platform if null.
+  // Without any window, such as on a headless platform, no input is ever
+  // received.
+  InputSuperSystem(GLFWwindow* window_ = nullptr);
 
   struct ButtonDefinition {
     enum class Type { Key, MouseButton } type;
@@ -76,6 +82,36 @@ class InputSuperSystem : public SuperSystem {
   glm::vec2 GetMousePosition() const;
   bool IsMouseInWindow() const;
 
+  // A single event received from the window.
+  struct InputEvent {
+    enum class Type { Key, MouseButton, MouseMove, MouseEnter, Scroll } type;
+    // The key or mouse button, for Key and MouseButton events.
+    int key;
+    // The GLFW action, for Key and MouseButton events, or whether the mouse
+    // entered, for MouseEnter events.
+    int action;
+    int modifiers;
+    // The mouse position for MouseMove and MouseEnter events, or the offset
+    // for Scroll events.
+    glm::vec2 value;
+  };
+
+  struct RecordedInputEvent {
+    // The engine frame the event was received on.
+    uint64_t frame;
+    InputEvent event;
+  };
+
+  // Starts recording every event received from the window, discarding any
+  // previous recording.
+  void StartRecording();
+  // Stops recording and returns the events recorded since `StartRecording`.
+  std::vector<RecordedInputEvent> StopRecording();
+  // Replays `events` in place of the window's events, delivering each at the
+  // end of the frame it was recorded on. Together with `Engine::Replay`, this
+  // reproduces a recorded run.
+  void Replay(std::vector<RecordedInputEvent> events);
+
  protected:
   void Init() override;
 
@@ -123,6 +159,17 @@ class InputSuperSystem : public SuperSystem {
 
   absl::flat_hash_map<unsigned int, std::vector<KeyWatch>> key_watches;
 
+  bool is_recording = false;
+  std::vector<RecordedInputEvent> recorded_events;
+  bool is_replaying = false;
+  std::vector<RecordedInputEvent> replay_events;
+  size_t replay_index = 0;
+
+  // Records `event` if recording, then applies it unless replaying.
+  void ReceiveEvent(const InputEvent& event);
+  // Updates the input state with `event`.
+  void ApplyEvent(const InputEvent& event);
+
   static void KeyCallback(GLFWwindow* window, int key, int scancode, int action,
                           int mods);
   static void MouseButtonCallback(GLFWwindow* window, int key, int action,
@@ -0,0 +1,225 @@
+
+#pragma once
+
+#include <absl/container/flat_hash_map.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "nodes/node.h"
+#include "nodes/rigid_body.h"
+#include "systems/super_system.h"
+#include "systems/system.h"
+#include "utility/collision.h"
+#include "utility/geometry.h"
+#include "utility/parallel.h"
+#include "utility/type_group.h"
+
+// Returns the diagonal of the local inverse inertia tensor of `shape` with
+// `mass`, or zero if it has no mass.
+glm::vec3 GetInverseInertia(const CollisionShape& shape, float mass);
+// Returns the inverse inertia tensor in world space of a body with the local
+// diagonal `inverse_inertia`, rotated by `rotation`.
+glm::mat3 GetWorldInverseInertia(const glm::vec3& inverse_inertia,
+                                 const glm::quat& rotation);
+
+// Simulates the RigidBodies of a world. Each step finds overlapping bodies by
+// sweeping their bounds along one axis, finds their contacts in parallel, and
+// then solves each island of touching bodies on its own thread. The threads
+// are kept between steps.
+class PhysicsSystem : public System {
+ public:
+  struct Settings {
+    glm::vec3 gravity = glm::vec3(0, -9.81f, 0);
+    // The number of times contacts are solved each step. More iterations make
+    // stacks steadier.
+    int iterations = 10;
+    // The fraction of the overlap between bodies removed each step.
+    float position_correction = 0.2f;
+    // The overlap allowed between resting bodies, which keeps them from
+    // jittering.
+    float penetration_slop = 0.01f;
+    // Contacts are found between bodies this close to touching, so they slow
+    // down before they overlap.
+    float contact_margin = 0.02f;
+    // Bodies only bounce when hitting faster than this.
+    float restitution_threshold = 1;
+    // The fraction of velocity lost per second.
+    float linear_damping = 0.01f;
+    float angular_damping = 0.05f;
+  };
+
+  struct Stats {
+    size_t body_count = 0;
+    // The number of pairs of bodies with overlapping bounds.
+    size_t pair_count = 0;
+    // The number of pairs of bodies touching.
+    size_t contact_count = 0;
+    size_t island_count = 0;
+  };
+
+  PhysicsSystem() {}
+  explicit PhysicsSystem(const Settings& settings_) : settings(settings_) {}
+  ~PhysicsSystem();
+
+  Settings settings;
+
+  // Advances the simulation by `delta_seconds` using up to `thread_count`
+  // threads, then writes the new poses to the bodies' Transforms. The threads
+  // are started by the first step and kept until `thread_count` changes.
+  void Step(float delta_seconds, int thread_count = 1);
+
+  // Returns the stats of the last step.
+  const Stats& GetStats() const { return stats; }
+
+ protected:
+  void NotifyOfNodeTreeAttachment(
+      const std::vector<std::shared_ptr<Node>>& nodes) override;
+  void NotifyOfNodeTreeDetachment(
+      const std::vector<std::shared_ptr<Node>>& nodes) override;
+
+ private:
+  // The state of every body, with each field stored separately so each stage
+  // of a step only touches the fields it needs.
+  struct Bodies {
+    std::vector<RigidBody*> nodes;
+    // The global pose of each body.
+    std::vector<glm::vec3> positions;
+    std::vector<glm::quat> rotations;
+    // The local pose last written to each node, to detect when it is moved by
+    // anything else.
+    std::vector<glm::vec3> written_positions;
+    std::vector<glm::quat> written_rotations;
+    std::vector<glm::vec3> linear_velocities;
+    std::vector<glm::vec3> angular_velocities;
+    std::vector<float> inverse_masses;
+    // The diagonal of the local inverse inertia tensor.
+    std::vector<glm::vec3> inverse_inertias;
+    std::vector<glm::mat3> world_inverse_inertias;
+    std::vector<CollisionShape> shapes;
+    std::vector<float> frictions;
+    std::vector<float> restitutions;
+    // The bounds covering each body for the whole step.
+    std::vector<AABB> bounds;
+
+    size_t size() const { return nodes.size(); }
+    // Adds a body, returning its index.
+    uint32_t Add();
+    // Removes the body at `index` by moving the last body into its place.
+    void SwapRemove(uint32_t index);
+  };
+
+  // A pair of touching bodies, along with the state of solving each point.
+  struct Contact {
+    struct PointState {
+      // The offsets of the point from the center of each body.
+      glm::vec3 offset_a;
+      glm::vec3 offset_b;
+      glm::vec3 tangents[2];
+      float normal_mass;
+      float tangent_masses[2];
+      // The relative speed along the normal the bodies should separate at.
+      float target_velocity;
+      float normal_impulse;
+      float tangent_impulses[2];
+    };
+
+    uint32_t body_a;
+    uint32_t body_b;
+    float friction;
+    float restitution;
+    ContactManifold manifold;
+    PointState states[ContactManifold::kMaxPoints];
+  };
+
+  // Starts simulating `body`.
+  void AddBody(RigidBody* body);
+  // Stops simulating the body at `index`, copying its velocities back to its
+  // node.
+  void RemoveBody(uint32_t index);
+  // Copies the shape, mass, and material of the body at `index` from its node.
+  void ReadBodyProperties(uint32_t index);
+  // Drops the state kept between steps that refers to bodies by index, after
+  // the indices change.
+  void ForgetBodyIndices();
+
+  // Reads the poses of bodies that were moved since the last step.
+  void ReadTransforms();
+  // Applies gravity and damping, and finds the bounds of each body.
+  void IntegrateVelocities(float delta_seconds);
+  void FindPairs();
+  void FindContacts(float delta_seconds);
+  // Starts the impulses of `contact` from those of the matching points in the
+  // last step.
+  void FindPreviousImpulses(Contact& contact) const;
+  // Groups the contacts into islands of bodies that touch each other.
+  void BuildIslands();
+  void SolveIsland(size_t island, float delta_seconds);
+  void IntegratePositions(float delta_seconds);
+  void WriteTransforms();
+
+  // Runs the parallel stages of each step.
+  std::unique_ptr<WorkerPool> pool;
+
+  Bodies bodies;
+  // The body indices sorted by the lower bound of their bounds along
+  // `sweep_axis`. Bodies move little between steps, so this is kept sorted
+  // rather than sorted again each step.
+  std::vector<uint32_t> sweep_order;
+  int sweep_axis = 0;
+  // The pairs of bodies with overlapping bounds, lower index first.
+  std::vector<std::pair<uint32_t, uint32_t>> pairs;
+  std::vector<Contact> contacts;
+  // The contacts of the last step, and their index by pair of bodies.
+  std::vector<Contact> previous_contacts;
+  absl::flat_hash_map<uint64_t, uint32_t> previous_contact_indices;
+  // The contacts found by each range of pairs, kept to reuse their memory.
+  std::vector<std::vector<Contact>> range_contacts;
+  // The contacts of each island, where island `i` has the contacts in
+  // [`island_offsets[i]`, `island_offsets[i + 1]`).
+  std::vector<uint32_t> island_contacts;
+  std::vector<uint32_t> island_offsets;
+  // The islands ordered from most to fewest contacts, so the largest islands
+  // start solving first.
+  std::vector<uint32_t> island_order;
+  Stats stats;
+
+  friend class RigidBody;
+};
+
+// Steps the PhysicsSystem of every world on each fixed update.
+class PhysicsSuperSystem : public SuperSystem {
+ public:
+  enum class PhysicsSystemAddition {
+    None,        // PhysicsSystems must be manually attached to all worlds.
+    InitWorlds,  // PhysicsSystems will only be added to worlds present on
+                 // initialization.
+    AllWorlds,   // PhysicsSystems will be added to all worlds as they are
+                 // initialized.
+  };
+
+  PhysicsSystemAddition addition_mode = PhysicsSystemAddition::AllWorlds;
+
+  // The number of threads each step may use.
+  int thread_count = 1;
+
+ protected:
+  void Init() override;
+
+  void FixedUpdate(float delta_seconds) override;
+
+  void NotifyOfWorldInitialization(
+      const std::shared_ptr<World>& world) override;
+  void NotifyOfSystemAddition(const std::shared_ptr<World>& world,
+                              const std::shared_ptr<System>& system) override;
+  void NotifyOfSystemRemoval(const std::shared_ptr<World>& world,
+                             const std::shared_ptr<System>& system) override;
+
+ private:
+  SystemTypeGroup<PhysicsSystem> physics_systems;
+};
@@ -0,0 +1,217 @@
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <glm/glm.hpp>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+#include "resources/geometry_arena.h"
+#include "resources/uniform_buffer.h"
+
+class Material;
+
+// A list of rendering commands, recorded without touching the graphics API so
+// it can be filled on any thread and executed later by a RenderDevice.
+// Commands are packed one after another in a single allocation, which is kept
+// when the buffer is reset so steady-state recording does not allocate.
+class RenderCommandBuffer {
+ public:
+  enum class CommandType : uint8_t {
+    SetViewport,
+    Clear,
+    SetUniforms,
+    Draw,
+    BeginPass,
+    EndPass,
+    SetRenderTarget,
+    SetDepthBias,
+    BindTargetTexture,
+  };
+
+  // Identifies the surface frames are presented to, in place of a depth
+  // target.
+  static constexpr int32_t kSurface = -1;
+
+  // Maps later draws to the given rectangle of the surface, in pixels from
+  // the bottom left.
+  struct SetViewport {
+    static constexpr CommandType kType = CommandType::SetViewport;
+    int x, y, width, height;
+  };
+  // Clears the whole surface.
+  struct Clear {
+    static constexpr CommandType kType = CommandType::Clear;
+    glm::vec4 colour;
+    bool clear_colour;
+    bool clear_depth;
+  };
+  // Binds uniform data stored in the buffer to `binding`. Use RecordUniforms
+  // to record it.
+  struct SetUniforms {
+    static constexpr CommandType kType = CommandType::SetUniforms;
+    UniformBinding binding;
+    // The location of the data within the buffer's uniform data.
+    uint32_t data_offset;
+    uint32_t size;
+  };
+  // Draws a range of `arena` with `material`. The range is not kept alive by
+  // the command itself, so the mesh owning it must be retained along with the
+  // material, as RenderSuperSystem::QueueDraw does.
+  struct Draw {
+    static constexpr CommandType kType = CommandType::Draw;
+    Material* material;
+    GeometryArena* arena;
+    DrawElementsIndirectCommand command;
+  };
+  // Marks the start of a pass named `name`, which must outlive the buffer,
+  // such as for GPU timing.
+  struct BeginPass {
+    static constexpr CommandType kType = CommandType::BeginPass;
+    const char* name;
+  };
+  // Marks the end of the last pass.
+  struct EndPass {
+    static constexpr CommandType kType = CommandType::EndPass;
+  };
+  // Directs later clears and draws into `layer` of the depth target numbered
+  // `target`, or into the surface if `target` is kSurface. Depth targets are
+  // arrays of `layers` depth textures of `width` by `height`, owned by the
+  // device and created or resized when needed. Draws into a depth target only
+  // write depth, so devices may ignore their materials. The viewport must be
+  // set again after changing targets.
+  struct SetRenderTarget {
+    static constexpr CommandType kType = CommandType::SetRenderTarget;
+    int32_t target;
+    int32_t layer;
+    int32_t width;
+    int32_t height;
+    int32_t layers;
+  };
+  // Offsets the depth of later draws away from the viewer by `constant`
+  // depth units, plus `slope` times the polygon's depth slope. Zero for both
+  // disables the offset.
+  struct SetDepthBias {
+    static constexpr CommandType kType = CommandType::SetDepthBias;
+    float constant;
+    float slope;
+  };
+  // Binds the depth target numbered `target` to texture `unit`, for sampling
+  // as a shadow map. The target must have been drawn to before.
+  struct BindTargetTexture {
+    static constexpr CommandType kType = CommandType::BindTargetTexture;
+    uint32_t unit;
+    int32_t target;
+  };
+
+  // Appends `command`.
+  template <typename Command>
+  void Record(const Command& command);
+  // Copies `size` bytes of `data` into the buffer, and appends a SetUniforms
+  // command binding them to `binding`.
+  void RecordUniforms(UniformBinding binding, const void* data, size_t size);
+  template <typename T>
+  void RecordUniforms(UniformBinding binding, const T& data) {
+    RecordUniforms(binding, &data, sizeof(T));
+  }
+  // Keeps `resource` alive for as long as the buffer holds its commands, such
+  // as the materials of recorded draws.
+  void Retain(std::shared_ptr<const void> resource);
+
+  // Removes all commands and releases retained resources, keeping the memory.
+  void Reset();
+
+  size_t GetCommandCount() const { return command_count; }
+  bool IsEmpty() const { return command_count == 0; }
+  // Returns the uniform data at `offset`, as stored by RecordUniforms.
+  const unsigned char* GetUniformData(uint32_t offset) const;
+
+  // Calls `visitor` with each command in the order they were recorded. The
+  // visitor must be callable with every command type.
+  template <typename Visitor>
+  void ForEach(Visitor&& visitor) const;
+
+ private:
+  // Precedes each command in `commands`.
+  struct Header {
+    CommandType type;
+    // The size of the command following the header.
+    uint32_t size;
+  };
+  // Commands are padded to a multiple of this. They are always read with
+  // memcpy, so this only keeps them tidy in memory rather than being required.
+  static constexpr size_t kAlignment = 8;
+
+  // Copies `size` bytes of `data` with a header of `type` onto the end of
+  // `commands`.
+  void Append(CommandType type, const void* data, size_t size);
+  // Reads the command stored at `data`.
+  template <typename Command>
+  static Command Read(const unsigned char* data);
+
+  std::vector<unsigned char> commands;
+  std::vector<unsigned char> uniform_data;
+  std::vector<std::shared_ptr<const void>> retained;
+  size_t command_count = 0;
+};
+
+// ===== Template Implementation ===== //
+
+template <typename Command>
+void RenderCommandBuffer::Record(const Command& command) {
+  static_assert(std::is_trivially_copyable<Command>::value,
+                "Commands must be trivially copyable.");
+  Append(Command::kType, &command, sizeof(Command));
+}
+
+template <typename Command>
+Command RenderCommandBuffer::Read(const unsigned char* data) {
+  Command command;
+  memcpy(&command, data, sizeof(Command));
+  return command;
+}
+
+template <typename Visitor>
+void RenderCommandBuffer::ForEach(Visitor&& visitor) const {
+  constexpr size_t header_size =
+      (sizeof(Header) + kAlignment - 1) / kAlignment * kAlignment;
+  size_t offset = 0;
+  while (offset < commands.size()) {
+    const Header header = Read<Header>(&commands[offset]);
+    const unsigned char* const data = &commands[offset + header_size];
+    switch (header.type) {
+      case CommandType::SetViewport:
+        visitor(Read<SetViewport>(data));
+        break;
+      case CommandType::Clear:
+        visitor(Read<Clear>(data));
+        break;
+      case CommandType::SetUniforms:
+        visitor(Read<SetUniforms>(data));
+        break;
+      case CommandType::Draw:
+        visitor(Read<Draw>(data));
+        break;
+      case CommandType::BeginPass:
+        visitor(Read<BeginPass>(data));
+        break;
+      case CommandType::EndPass:
+        visitor(Read<EndPass>(data));
+        break;
+      case CommandType::SetRenderTarget:
+        visitor(Read<SetRenderTarget>(data));
+        break;
+      case CommandType::SetDepthBias:
+        visitor(Read<SetDepthBias>(data));
+        break;
+      case CommandType::BindTargetTexture:
+        visitor(Read<BindTargetTexture>(data));
+        break;
+    }
+    offset += header_size +
+              (header.size + kAlignment - 1) / kAlignment * kAlignment;
+  }
+}
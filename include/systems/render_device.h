@@ -0,0 +1,115 @@
+
+#pragma once
+
+#include <glm/glm.hpp>
+#include <memory>
+#include <vector>
+
+#include "systems/render_command_buffer.h"
+
+// Executes recorded command buffers on some graphics back end. Each frame is
+// started with BeginFrame, followed by any number of Submits, and finished
+// with EndFrame. Devices are only used from the thread that owns them, which
+// for GL devices is the thread whose context is current.
+class RenderDevice {
+ public:
+  struct Stats {
+    // Commands executed.
+    unsigned int commands = 0;
+    // Draw commands executed.
+    unsigned int draws = 0;
+    // Calls made into the graphics API, if the device makes any.
+    unsigned int calls = 0;
+    // Calls skipped because the state was already set.
+    unsigned int skipped_calls = 0;
+  };
+
+  virtual ~RenderDevice() = default;
+
+  // Returns the size of the surface frames are drawn to, in pixels.
+  virtual glm::ivec2 GetSurfaceSize() = 0;
+
+  virtual void BeginFrame() = 0;
+  // Executes `commands`. The buffer may be reset once this returns.
+  virtual void Submit(const RenderCommandBuffer& commands) = 0;
+  // Finishes the frame, presenting it if the device has somewhere to.
+  virtual void EndFrame() = 0;
+  // Blocks until every finished frame has been executed. Devices that execute
+  // frames within EndFrame have nothing to wait for.
+  virtual void Flush() {}
+
+  // Returns the stats of the last finished frame.
+  virtual const Stats& GetFrameStats() const = 0;
+};
+
+// Executes nothing, only counting the commands submitted to it, so rendering
+// can run without a GPU, such as in tests and benchmarks.
+class NullRenderDevice : public RenderDevice {
+ public:
+  NullRenderDevice(glm::ivec2 surface_size_);
+
+  glm::ivec2 GetSurfaceSize() override;
+
+  void BeginFrame() override;
+  void Submit(const RenderCommandBuffer& commands) override;
+  void EndFrame() override;
+
+  const Stats& GetFrameStats() const override;
+
+ private:
+  glm::ivec2 surface_size;
+  Stats current_stats;
+  Stats frame_stats;
+};
+
+// Keeps a copy of every frame submitted to it, and passes them on to `target`
+// if it has one. Captured frames can be inspected, or replayed later, such as
+// to profile a frame again or to run it through a NullRenderDevice.
+class CaptureRenderDevice : public RenderDevice {
+ public:
+  // The command buffers submitted during one frame, in submission order.
+  struct Frame {
+    std::vector<RenderCommandBuffer> submissions;
+  };
+
+  // Forwards to `target_` if it is not null. Otherwise reports a surface of
+  // `surface_size_`.
+  CaptureRenderDevice(std::unique_ptr<RenderDevice> target_,
+                      glm::ivec2 surface_size_ = glm::ivec2(0, 0));
+
+  // Whether submitted frames are captured. Frames are still forwarded while
+  // this is false.
+  bool capturing = true;
+  // The most frames kept, dropping the oldest first. 0 keeps every frame.
+  size_t max_frames = 0;
+
+  glm::ivec2 GetSurfaceSize() override;
+
+  void BeginFrame() override;
+  void Submit(const RenderCommandBuffer& commands) override;
+  void EndFrame() override;
+  void Flush() override;
+
+  const Stats& GetFrameStats() const override;
+
+  // Returns the captured frames, oldest first.
+  const std::vector<Frame>& GetFrames() const;
+  void ClearFrames();
+
+  // Replays `frame` as one whole frame on `device`. Captured frames retain the
+  // materials and meshes they draw, so these stay valid for as long as the
+  // frame is kept. They are GL objects of the capturing context, though, so
+  // GL devices can only replay frames captured on the same context, and
+  // frames must be dropped while it is current.
+  static void Replay(const Frame& frame, RenderDevice& device);
+
+ private:
+  std::unique_ptr<RenderDevice> target;
+  glm::ivec2 surface_size;
+
+  std::vector<Frame> frames;
+  // The frame being captured, between BeginFrame and EndFrame.
+  Frame current_frame;
+  // Counts commands when there is no target to forward to.
+  NullRenderDevice counter;
+};
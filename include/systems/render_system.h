@@ -4,39 +4,67 @@
 #include <GL/glew.h>
 #include <GLFW/glfw3.h>
 
+#include <glm/glm.hpp>
+#include <memory>
+#include <vector>
+
 #include "nodes/camera.h"
+#include "nodes/light.h"
 #include "nodes/node.h"
+#include "resources/geometry_arena.h"
+#include "resources/material.h"
+#include "resources/renderable_mesh.h"
+#include "resources/uniform_buffer.h"
+#include "systems/render_command_buffer.h"
+#include "systems/render_device.h"
 #include "systems/super_system.h"
 #include "systems/system.h"
 #include "utility/type_group.h"
 
 class RenderSystem;
 class RenderSuperSystem;
+class SoftwareRenderSuperSystem;
 
 class Renderable {
  protected:
   virtual void Render(const std::shared_ptr<RenderSuperSystem>& super_system,
                       const std::shared_ptr<RenderSystem>& system,
                       const glm::mat4& ProjectionView) = 0;
+  // Renders through the software rasterizer, for machines without a GPU.
+  // Renderables that do not override this are not drawn there.
+  virtual void RenderSoftware(
+      const std::shared_ptr<SoftwareRenderSuperSystem>& super_system,
+      const glm::mat4& ProjectionView) {}
 
   friend class RenderSuperSystem;
+  friend class SoftwareRenderSuperSystem;
 };
 
 class RenderSystem : public System {
  protected:
-  void NotifyOfNodeAttachment(const std::shared_ptr<Node>& new_node) override;
-  void NotifyOfNodeDetachment(const std::shared_ptr<Node>& new_node) override;
+  void NotifyOfNodeTreeAttachment(
+      const std::vector<std::shared_ptr<Node>>& nodes) override;
+  void NotifyOfNodeTreeDetachment(
+      const std::vector<std::shared_ptr<Node>>& nodes) override;
 
  private:
   NodeTypeGroup<Renderable> renderables;
   NodeTypeGroup<Camera> cameras;
+  NodeTypeGroup<DirectionalLight> lights;
 
   friend class RenderSuperSystem;
+  friend class SoftwareRenderSuperSystem;
 };
 
 class RenderSuperSystem : public SuperSystem {
  public:
-  RenderSuperSystem(GLFWwindow* window_);
+  // Renders to `window_`, or the window of the engine's platform if null,
+  // through a GLRenderDevice. Requires a window and GL context, so headless
+  // engines must not have one.
+  RenderSuperSystem(GLFWwindow* window_ = nullptr);
+  // Renders through `device_`, such as a NullRenderDevice to run without a
+  // GPU.
+  RenderSuperSystem(std::unique_ptr<RenderDevice> device_);
 
   enum class RenderSystemAddition {
     None,        // RenderSystems must be manually attached to all worlds.
@@ -48,10 +76,58 @@ class RenderSuperSystem : public SuperSystem {
 
   RenderSystemAddition addition_mode = RenderSystemAddition::AllWorlds;
 
+  // The number of screen refreshes to wait for before swapping buffers, set on
+  // initialization. 0 disables vsync, leaving pacing to the engine's
+  // `FramePacer`. Only used when rendering to a window.
+  int swap_interval = 1;
+
+  // Bytes of uniform data available to each frame before the ring buffer has
+  // to grow. Each batch of draws takes a whole "Object" block of
+  // kMaxBatchObjects objects. Only used when rendering to a window.
+  GLsizeiptr object_uniform_capacity = 1 << 20;
+
+  // Whether frames are executed on a dedicated render thread, set on
+  // initialization. The scene is still recorded on the engine's thread at the
+  // end of each frame, but executing and presenting it overlaps with the next
+  // frame's simulation. The GL context is only current on the engine's thread
+  // outside of LateUpdate once `GetDevice()->Flush()` has been called, so GL
+  // resources must be loaded before the engine runs or after flushing.
+  bool render_thread = false;
+  // The most frames recorded ahead of the render thread before the engine
+  // waits for it. 1 double buffers frames and 2 triple buffers them.
+  int max_frames_in_flight = 1;
+
+  // Whether lights with `cast_shadows` render shadow maps. Each camera renders
+  // the shadow map of its world's light just before it renders the world.
+  bool shadows = true;
+
+  // The colour cameras clear to.
+  glm::vec4 clear_colour = glm::vec4(0.f, 0.f, 0.4f, 0.f);
+
+  // Sets the object the following draws read from the "Object" block's array.
+  // If the batch holding it does not fit in the device's uniform memory, its
+  // draws are skipped.
+  void BindObjectUniforms(const ObjectUniforms& uniforms);
+  // Binds `size` bytes of `data` to `binding` for the following draws.
+  void BindUniforms(UniformBinding binding, const void* data, size_t size);
+
+  // Queues `mesh` to be drawn with `material` and the currently bound
+  // uniforms. Both are kept alive until the frame has been executed, which may
+  // be on the render thread after they are dropped by the caller.
+  void QueueDraw(const std::shared_ptr<Material>& material,
+                 const std::shared_ptr<const RenderableMesh>& mesh);
+
+  // Returns the device frames are rendered through. Null before
+  // initialization when rendering to a window.
+  RenderDevice* GetDevice();
+  // Returns the stats of the last rendered frame.
+  const RenderDevice::Stats& GetFrameStats() const;
+
  protected:
   void Init() override;
 
   void LateUpdate(float delta_seconds) override;
+  void Shutdown() override;
 
   void NotifyOfWorldInitialization(
       const std::shared_ptr<World>& world) override;
@@ -61,6 +137,28 @@ class RenderSuperSystem : public SuperSystem {
                              const std::shared_ptr<System>& system) override;
 
  private:
+  // The depth target shadow maps are rendered into. Cameras are rendered one
+  // after another, so they all share one.
+  static constexpr int32_t kShadowTarget = 0;
+
+  // Records a depth-only pass into the shadow map for each of `light`'s
+  // cascades over `camera`'s view, and fills in `shadow_uniforms` to match.
+  void RecordShadowPasses(const std::shared_ptr<RenderSuperSystem>& self,
+                          const std::shared_ptr<RenderSystem>& render_system,
+                          const Camera& camera, float aspect,
+                          const DirectionalLight& light,
+                          ShadowUniforms& shadow_uniforms);
+
   SystemTypeGroup<RenderSystem> render_systems;
-  GLFWwindow* window;
+  GLFWwindow* window = nullptr;
+
+  std::unique_ptr<RenderDevice> device;
+  // The commands of the frame being recorded. Empty outside of LateUpdate, so
+  // it never holds the last reference to a resource between frames.
+  RenderCommandBuffer commands;
+  // The material last retained by `commands`, so consecutive draws with the
+  // same material only retain it once.
+  Material* retained_material = nullptr;
+  // The mesh last retained by `commands`.
+  const RenderableMesh* retained_mesh = nullptr;
 };
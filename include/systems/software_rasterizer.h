@@ -0,0 +1,134 @@
+
+#pragma once
+
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <memory>
+#include <vector>
+
+#include "resources/mesh.h"
+#include "resources/texture.h"
+
+// How the SoftwareRasterizer shades a mesh. The software counterpart of a
+// Material, since programs cannot run without a GPU.
+struct SoftwareMaterial {
+  glm::vec4 colour = glm::vec4(1);
+  // Sampled with the mesh's texture coordinates, repeating, and multiplied
+  // with `colour`. May be null.
+  std::shared_ptr<const Texture> texture;
+  // Whether to filter `texture` bilinearly, rather than taking the nearest
+  // texel.
+  bool linear_filter = true;
+  // Whether to shade the mesh with the rasterizer's light.
+  bool lit = true;
+};
+
+// Draws triangles into colour and depth buffers on the CPU. Triangles are
+// transformed and clipped as they are drawn, and binned into the square tiles
+// of the frame they touch. Flushing then rasterizes each tile on its own
+// thread, keeping the order triangles were drawn in within each tile, so the
+// result does not depend on the number of threads.
+//
+// Follows GL conventions: pixels are counted from the bottom left, triangles
+// wound clockwise on screen are culled, and nearer depths win.
+class SoftwareRasterizer {
+ public:
+  // The width and height of each tile in pixels.
+  static constexpr int kTileSize = 64;
+
+  SoftwareRasterizer(uint32_t width, uint32_t height);
+
+  // Resizes the frame, discarding its contents and any queued triangles.
+  void Resize(uint32_t width, uint32_t height);
+  uint32_t GetWidth() const { return width; }
+  uint32_t GetHeight() const { return height; }
+
+  // The direction towards the light, in world space, used by lit materials.
+  glm::vec3 light_direction = glm::normalize(glm::vec3(1, 1, 1));
+  // The fraction of light lit materials receive when facing away from it.
+  float ambient = 0.2f;
+
+  // Maps later draws to the given rectangle of the frame, like glViewport.
+  void SetViewport(int x, int y, int viewport_width, int viewport_height);
+  // Clears the whole frame, like glClear. Queued triangles must be flushed
+  // first.
+  void Clear(const glm::vec4& colour, bool clear_colour, bool clear_depth);
+
+  // Queues the triangles of `mesh`, transformed to world space by `model` and
+  // to clip space by `model_view_projection`. `mesh` and the texture of
+  // `material` need not outlive the call.
+  void DrawMesh(const Mesh& mesh, const glm::mat4& model,
+                const glm::mat4& model_view_projection,
+                const SoftwareMaterial& material);
+  // Rasterizes all queued triangles using up to `thread_count` threads.
+  void Flush(int thread_count = 1);
+
+  // Returns a copy of the frame as an 8-bit RGBA texture, with its top row
+  // first as in image files.
+  std::shared_ptr<Texture> ReadPixels() const;
+  // Returns the depth of a pixel, between 0 (near) and 1 (far).
+  float GetDepth(uint32_t x, uint32_t y) const;
+
+ private:
+  // The attributes interpolated across a triangle.
+  struct Varyings {
+    glm::vec2 uv;
+    glm::vec3 normal;
+  };
+
+  // A vertex in clip space.
+  struct ClipVertex {
+    glm::vec4 position;
+    Varyings varyings;
+  };
+
+  // A triangle ready to be rasterized. Positions are in pixels with
+  // `kSubpixelBits` of fraction. Edge `i` is opposite vertex `i`, and is
+  // positive inside the triangle.
+  struct Triangle {
+    int32_t edge_x[3];
+    int32_t edge_y[3];
+    int64_t edge_offset[3];
+    // The pixel bounds of the triangle, inclusive.
+    int min_x, min_y, max_x, max_y;
+    float inverse_area;
+    float depths[3];
+    // The reciprocal of each vertex's w, and its varyings divided by w, for
+    // perspective correct interpolation.
+    float inverse_ws[3];
+    Varyings varyings[3];
+    uint32_t material;
+  };
+
+  // Clips `triangle` against the view frustum and queues what remains.
+  void QueueClipped(const ClipVertex (&triangle)[3], uint32_t material);
+  // Sets up and bins one triangle that is entirely inside the frustum.
+  void QueueTriangle(const ClipVertex& a, const ClipVertex& b,
+                     const ClipVertex& c, uint32_t material);
+  void RasterizeTile(int tile);
+  void RasterizeTriangle(const Triangle& triangle, int min_x, int min_y,
+                         int max_x, int max_y);
+  // Shades a pixel covered by `triangle` with the barycentric weights of its
+  // second and third vertices.
+  glm::vec4 Shade(const Triangle& triangle, float weight_1,
+                  float weight_2) const;
+
+  uint32_t width;
+  uint32_t height;
+  int viewport[4];
+  int tile_columns;
+  int tile_rows;
+
+  // Rows from the bottom of the frame.
+  std::vector<uint32_t> colours;
+  std::vector<float> depths;
+
+  // `light_direction` normalized, while flushing.
+  glm::vec3 shading_light;
+  // The vertices of the mesh being drawn, kept to reuse their memory.
+  std::vector<ClipVertex> clip_vertices;
+  std::vector<SoftwareMaterial> materials;
+  std::vector<Triangle> triangles;
+  // The triangles touching each tile, in the order they were drawn.
+  std::vector<std::vector<uint32_t>> tile_triangles;
+};
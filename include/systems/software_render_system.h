@@ -0,0 +1,71 @@
+
+#pragma once
+
+#include <absl/status/status.h>
+
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <memory>
+#include <string>
+
+#include "resources/mesh.h"
+#include "resources/texture.h"
+#include "systems/render_system.h"
+#include "systems/software_rasterizer.h"
+#include "systems/super_system.h"
+#include "utility/type_group.h"
+
+// Renders the cameras of every world into a frame in memory on the CPU, for
+// machines without a GPU or display, such as servers, headless tests and
+// thumbnail generation. Renderables and cameras are found through the same
+// RenderSystems as RenderSuperSystem, and draw themselves through
+// `Renderable::RenderSoftware`. Meshes are drawn from their source, so they
+// must be loaded without uploading or with `keep_source`.
+class SoftwareRenderSuperSystem : public SuperSystem {
+ public:
+  SoftwareRenderSuperSystem(uint32_t width, uint32_t height);
+
+  RenderSuperSystem::RenderSystemAddition addition_mode =
+      RenderSuperSystem::RenderSystemAddition::AllWorlds;
+
+  // The number of threads each frame is rasterized with.
+  int thread_count = 1;
+  // The colour cameras clear to.
+  glm::vec4 clear_colour = glm::vec4(0.f, 0.f, 0.4f, 0.f);
+
+  // Queues `mesh` to be drawn in the current camera pass, transformed to world
+  // space by `model` and to clip space by `model_view_projection`.
+  void DrawMesh(const Mesh& mesh, const glm::mat4& model,
+                const glm::mat4& model_view_projection,
+                const SoftwareMaterial& material);
+
+  // Renders every camera into the frame. Called on each late update, but may
+  // also be called directly, such as to render a scene once.
+  void Render();
+
+  // Resizes the frame, clearing it.
+  void Resize(uint32_t width, uint32_t height);
+  // Returns a copy of the frame, with its top row first.
+  std::shared_ptr<Texture> GetFrame() const;
+  // Saves the frame to `file` as a PNG.
+  absl::Status SaveFrame(const std::string& file) const;
+
+  // Returns the rasterizer frames are drawn with, such as to change its light.
+  SoftwareRasterizer& GetRasterizer();
+
+ protected:
+  void Init() override;
+
+  void LateUpdate(float delta_seconds) override;
+
+  void NotifyOfWorldInitialization(
+      const std::shared_ptr<World>& world) override;
+  void NotifyOfSystemAddition(const std::shared_ptr<World>& world,
+                              const std::shared_ptr<System>& system) override;
+  void NotifyOfSystemRemoval(const std::shared_ptr<World>& world,
+                             const std::shared_ptr<System>& system) override;
+
+ private:
+  SystemTypeGroup<RenderSystem> render_systems;
+  SoftwareRasterizer rasterizer;
+};
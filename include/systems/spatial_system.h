@@ -0,0 +1,112 @@
+
+#pragma once
+
+#include <absl/container/flat_hash_map.h>
+
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <limits>
+#include <memory>
+#include <vector>
+
+#include "nodes/node.h"
+#include "nodes/transform.h"
+#include "systems/system.h"
+#include "utility/geometry.h"
+#include "utility/loose_octree.h"
+
+// A node with bounds. Bounded Transforms are tracked by SpatialSystem.
+class Bounded {
+ public:
+  // Returns the bounds of the node in its local space.
+  virtual AABB GetLocalBounds() const = 0;
+};
+
+struct SpatialHit {
+  // The node that was hit, or null if nothing was hit.
+  Transform* node = nullptr;
+  float distance = 0;
+};
+
+// Tracks the global bounds of every Bounded Transform in the world, to find
+// the nodes near a point, inside a box, or along a ray without visiting every
+// node.
+//
+// Nodes that moved are updated before each of the system's updates, or on
+// `Flush`, so queries see the nodes as of the last update. Queries may be
+// called concurrently from any thread, but not while nodes are attached or
+// detached or while the system updates. Returned nodes stay valid until they
+// are detached. The system must not outlive the nodes it tracks.
+class SpatialSystem : public System, public TransformListener {
+ public:
+  explicit SpatialSystem(
+      const LooseOctree::Settings& settings = LooseOctree::Settings());
+  ~SpatialSystem() override;
+
+  // Updates the bounds of every node that moved since the last update.
+  void Flush();
+  // Marks the bounds of `node` as changed, such as when its local bounds
+  // change. Takes effect on the next update or `Flush`.
+  void Refresh(Transform& node);
+
+  // Finds the nodes whose bounds intersect `box`.
+  std::vector<Transform*> QueryBox(const AABB& box) const;
+  // Finds the nodes whose bounds are within `radius` of `center`.
+  std::vector<Transform*> QuerySphere(const glm::vec3& center,
+                                      float radius) const;
+  // Finds up to `count` nodes whose bounds are closest to `point`, nearest
+  // first.
+  std::vector<Transform*> QueryNearest(
+      const glm::vec3& point, int count,
+      float max_distance = std::numeric_limits<float>::infinity()) const;
+  // Finds the first node whose bounds are hit by `ray`.
+  SpatialHit Raycast(
+      const Ray& ray,
+      float max_distance = std::numeric_limits<float>::infinity()) const;
+
+  // Batched versions of the queries, which split the queries between up to
+  // `thread_count` threads. Results are in the same order as the queries.
+  std::vector<std::vector<Transform*>> QueryBoxBatch(
+      const std::vector<AABB>& boxes, int thread_count = 1) const;
+  std::vector<std::vector<Transform*>> QueryNearestBatch(
+      const std::vector<glm::vec3>& points, int count,
+      float max_distance = std::numeric_limits<float>::infinity(),
+      int thread_count = 1) const;
+  std::vector<SpatialHit> RaycastBatch(
+      const std::vector<Ray>& rays,
+      float max_distance = std::numeric_limits<float>::infinity(),
+      int thread_count = 1) const;
+
+ protected:
+  void NotifyOfNodeTreeAttachment(
+      const std::vector<std::shared_ptr<Node>>& nodes) override;
+  void NotifyOfNodeTreeDetachment(
+      const std::vector<std::shared_ptr<Node>>& nodes) override;
+
+  void Update(float delta_seconds) override { Flush(); }
+  void FixedUpdate(float delta_seconds) override { Flush(); }
+  void LateUpdate(float delta_seconds) override { Flush(); }
+
+  void NotifyOfGlobalTransformChange(Transform& transform) override;
+
+ private:
+  struct Entry {
+    // The tracked node, or null if the entry is unused.
+    Transform* transform = nullptr;
+    const Bounded* bounded = nullptr;
+    bool dirty = false;
+  };
+
+  // Marks the entry with `id` to be updated on the next flush.
+  void MarkDirty(uint32_t id);
+  // Appends the nodes with the ids in `results` to `nodes`.
+  void ToNodes(const std::vector<uint32_t>& results,
+               std::vector<Transform*>& nodes) const;
+
+  LooseOctree octree;
+  // The tracked nodes, indexed by their id in `octree`.
+  std::vector<Entry> entries;
+  std::vector<uint32_t> free_ids;
+  absl::flat_hash_map<const Transform*, uint32_t> ids;
+  std::vector<uint32_t> dirty_ids;
+};
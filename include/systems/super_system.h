@@ -28,6 +28,9 @@ class SuperSystem : public std::enable_shared_from_this<SuperSystem> {
   // Performs an update every frame. Occurs at the end of a frame.
   // `delta_seconds` is the amount of time passed for this frame.
   virtual void LateUpdate(float delta_seconds) {}
+  // Performs cleanup when Engine::Run is about to return, such as waiting for
+  // work still running on other threads.
+  virtual void Shutdown() {}
 
   // Notifies this super system that `world` has been initialized. Called after
   // world has been initialized.
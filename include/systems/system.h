@@ -2,6 +2,7 @@
 #pragma once
 
 #include <memory>
+#include <vector>
 
 #include "nodes/node.h"
 
@@ -26,6 +27,17 @@ class System : public std::enable_shared_from_this<System> {
   // the node is detached. Systems are not notified of child nodes of
   // `new_node`.
   virtual void NotifyOfNodeDetachment(const std::shared_ptr<Node>& new_node) {}
+  // Handles subtrees being attached to the node tree, where `nodes` is the
+  // pre-order traversal of each subtree in turn. The traversal is shared by
+  // every system, so overriding this avoids traversing the subtrees again. By
+  // default, calls `NotifyOfNodeAttachment` with the root of each subtree.
+  virtual void NotifyOfNodeTreeAttachment(
+      const std::vector<std::shared_ptr<Node>>& nodes);
+  // Handles subtrees being detached from the node tree, where `nodes` is the
+  // pre-order traversal of each subtree in turn. By default, calls
+  // `NotifyOfNodeDetachment` with the root of each subtree.
+  virtual void NotifyOfNodeTreeDetachment(
+      const std::vector<std::shared_ptr<Node>>& nodes);
 
   // Performs an update every frame. Occurs at the start of a frame.
   // `delta_seconds` is the amount of time passed for this frame.
@@ -0,0 +1,100 @@
+
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <glm/glm.hpp>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "systems/render_command_buffer.h"
+#include "systems/render_device.h"
+
+// Executes frames on `target` from a dedicated render thread, so the thread
+// recording frames can simulate the next frame while the last one is rendered
+// and presented. Each submitted buffer is copied into a snapshot of the frame,
+// so the caller may reset and re-record its buffers as soon as Submit returns.
+// Resources retained by a snapshot are released on the render thread once it
+// has executed the frame, so their destructors must be safe to run there.
+class ThreadedRenderDevice : public RenderDevice {
+ public:
+  // Moves the graphics context between threads. `acquire` makes the context
+  // current on the calling thread and `release` detaches it from the calling
+  // thread. Either may be empty for devices without a context.
+  struct ContextHooks {
+    std::function<void()> acquire;
+    std::function<void()> release;
+  };
+
+  // Executes frames on `target_`, whose context must be current on the
+  // constructing thread. Up to `max_frames_in_flight_` finished frames may be
+  // waiting on or being executed by the render thread before EndFrame blocks:
+  // 1 double buffers frames and 2 triple buffers them.
+  ThreadedRenderDevice(std::unique_ptr<RenderDevice> target_,
+                       ContextHooks hooks_ = ContextHooks(),
+                       int max_frames_in_flight_ = 1);
+  // Finishes all frames in flight and returns the context to the destroying
+  // thread.
+  ~ThreadedRenderDevice();
+
+  // Forwards to `target` on the calling thread, so it must be safe to call
+  // while a frame is being executed.
+  glm::ivec2 GetSurfaceSize() override;
+
+  void BeginFrame() override;
+  void Submit(const RenderCommandBuffer& commands) override;
+  // Hands the frame to the render thread, first waiting for a frame to finish
+  // if too many are in flight. Releases the context from the calling thread.
+  void EndFrame() override;
+  // Waits for all frames in flight to finish, then makes the context current
+  // on the calling thread until the next EndFrame. Must be called before
+  // making graphics calls outside the device, such as to upload resources.
+  void Flush() override;
+
+  // Returns the stats of the last frame finished by the render thread, which
+  // usually lags the last submitted frame.
+  const Stats& GetFrameStats() const override;
+
+ private:
+  struct Frame {
+    std::vector<RenderCommandBuffer> submissions;
+    // The number of `submissions` in use. Buffers past this are kept to reuse
+    // their memory.
+    size_t submission_count = 0;
+  };
+
+  // Executes frames until told to stop.
+  void RenderLoop();
+
+  std::unique_ptr<RenderDevice> target;
+  ContextHooks hooks;
+  int max_frames_in_flight;
+  // Whether the context is current on the recording thread.
+  bool caller_has_context = true;
+
+  // The frame being recorded, between BeginFrame and EndFrame.
+  std::unique_ptr<Frame> recording;
+  Stats frame_stats;
+
+  // Guards everything below, which is shared with the render thread.
+  std::mutex mutex;
+  std::condition_variable condition;
+  // Finished frames waiting to be executed, oldest first.
+  std::deque<std::unique_ptr<Frame>> pending;
+  // Executed frames kept to record into again.
+  std::vector<std::unique_ptr<Frame>> free_frames;
+  // Whether the render thread is executing a frame taken from `pending`.
+  bool executing = false;
+  // Whether the context is current on the render thread.
+  bool worker_has_context = false;
+  // Asks the render thread to release the context once it is idle.
+  bool release_requested = false;
+  bool stopping = false;
+  // The stats of the last frame the render thread finished.
+  Stats worker_stats;
+
+  std::thread worker;
+};
@@ -0,0 +1,122 @@
+
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+// Appends raw values to a byte buffer. Values are written in host byte order,
+// so blobs are only meant to be read back on the machine that wrote them.
+struct BlobWriter {
+ public:
+  std::vector<unsigned char> data;
+
+  // Writes the bytes of `value`.
+  template <typename T>
+  void Write(const T& value);
+
+  // Writes the length of `values` followed by its elements.
+  template <typename T>
+  void WriteVector(const std::vector<T>& values);
+
+  // Writes the length of `value` followed by its characters.
+  void WriteString(const std::string& value);
+
+  // Writes `length` raw bytes from `bytes`.
+  void WriteBytes(const void* bytes, size_t length);
+};
+
+// Reads raw values back out of a byte buffer written by BlobWriter. All reads
+// return false once the buffer has been exhausted.
+struct BlobReader {
+ public:
+  BlobReader(const std::vector<unsigned char>& data_)
+      : data(data_.data()), end(data_.data() + data_.size()) {}
+
+  // Reads the bytes of `value`.
+  template <typename T>
+  bool Read(T& value);
+
+  // Reads a length followed by that many elements into `values`.
+  template <typename T>
+  bool ReadVector(std::vector<T>& values);
+
+  // Reads a length followed by that many characters into `value`.
+  bool ReadString(std::string& value);
+
+  // Reads `length` raw bytes into `bytes`.
+  bool ReadBytes(void* bytes, size_t length);
+
+  // Whether every byte of the buffer has been read.
+  bool IsDone() const { return data == end; }
+
+ private:
+  const unsigned char* data;
+  const unsigned char* end;
+};
+
+// ===== Template Implementation ===== //
+
+template <typename T>
+void BlobWriter::Write(const T& value) {
+  static_assert(std::is_trivially_copyable<T>::value,
+                "Blob values must be trivially copyable");
+  WriteBytes(&value, sizeof(T));
+}
+
+template <typename T>
+void BlobWriter::WriteVector(const std::vector<T>& values) {
+  static_assert(std::is_trivially_copyable<T>::value,
+                "Blob values must be trivially copyable");
+  Write<uint64_t>(values.size());
+  WriteBytes(values.data(), sizeof(T) * values.size());
+}
+
+inline void BlobWriter::WriteString(const std::string& value) {
+  Write<uint64_t>(value.size());
+  WriteBytes(value.data(), value.size());
+}
+
+inline void BlobWriter::WriteBytes(const void* bytes, size_t length) {
+  const unsigned char* begin = static_cast<const unsigned char*>(bytes);
+  data.insert(data.end(), begin, begin + length);
+}
+
+template <typename T>
+bool BlobReader::Read(T& value) {
+  static_assert(std::is_trivially_copyable<T>::value,
+                "Blob values must be trivially copyable");
+  return ReadBytes(&value, sizeof(T));
+}
+
+template <typename T>
+bool BlobReader::ReadVector(std::vector<T>& values) {
+  static_assert(std::is_trivially_copyable<T>::value,
+                "Blob values must be trivially copyable");
+  uint64_t length;
+  if (!Read(length) || length > (end - data) / sizeof(T)) {
+    return false;
+  }
+  values.resize(length);
+  return ReadBytes(values.data(), sizeof(T) * length);
+}
+
+inline bool BlobReader::ReadString(std::string& value) {
+  uint64_t length;
+  if (!Read(length) || length > (uint64_t)(end - data)) {
+    return false;
+  }
+  value.resize(length);
+  return ReadBytes(value.data(), length);
+}
+
+inline bool BlobReader::ReadBytes(void* bytes, size_t length) {
+  if (length > (size_t)(end - data)) {
+    return false;
+  }
+  memcpy(bytes, data, length);
+  data += length;
+  return true;
+}
@@ -0,0 +1,66 @@
+
+#pragma once
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include "utility/geometry.h"
+
+// The shape of a rigid body, centered on the body's origin.
+struct CollisionShape {
+  enum class Type {
+    Sphere,
+    Capsule,
+    Box,
+  };
+
+  Type type = Type::Sphere;
+  // The radius of spheres and capsules.
+  float radius = 0.5f;
+  // Half the distance between the centers of a capsule's end spheres. Capsules
+  // lie along their local Y axis.
+  float half_height = 0.5f;
+  // The half size of boxes along each local axis.
+  glm::vec3 half_extents = glm::vec3(0.5f);
+
+  static CollisionShape Sphere(float radius);
+  static CollisionShape Capsule(float radius, float half_height);
+  static CollisionShape Box(const glm::vec3& half_extents);
+
+  // Returns the bounds of the shape in its local space.
+  AABB GetLocalBounds() const;
+  // Returns the bounds of the shape placed at `position` with `rotation`.
+  AABB GetBounds(const glm::vec3& position, const glm::quat& rotation) const;
+  // Returns the diagonal of the inertia tensor of the shape with `mass`.
+  glm::vec3 GetInertia(float mass) const;
+};
+
+struct ContactPoint {
+  // The point midway between the two surfaces.
+  glm::vec3 position;
+  // The direction from the first shape to the second.
+  glm::vec3 normal;
+  // How far the shapes overlap along `normal`. Negative if they are apart.
+  float depth;
+};
+
+// The points where two shapes touch, or are about to.
+struct ContactManifold {
+  static constexpr int kMaxPoints = 4;
+
+  int point_count = 0;
+  ContactPoint points[kMaxPoints];
+};
+
+// A shape placed in the world.
+struct PlacedShape {
+  const CollisionShape& shape;
+  glm::vec3 position;
+  glm::quat rotation;
+};
+
+// Finds where `a` and `b` touch, including points where they are up to
+// `margin` apart. Returns false if they are further apart. Normals point from
+// `a` to `b`.
+bool Collide(const PlacedShape& a, const PlacedShape& b, float margin,
+             ContactManifold& manifold);
@@ -0,0 +1,73 @@
+
+#pragma once
+
+#include <glm/glm.hpp>
+#include <limits>
+
+// An axis-aligned bounding box. A box with any `min` component greater than
+// the matching `max` component is empty.
+struct AABB {
+  glm::vec3 min = glm::vec3(std::numeric_limits<float>::infinity());
+  glm::vec3 max = glm::vec3(-std::numeric_limits<float>::infinity());
+
+  AABB() {}
+  AABB(const glm::vec3& min_, const glm::vec3& max_) : min(min_), max(max_) {}
+
+  // Returns the box with `center` and half size `extents`.
+  static AABB FromCenter(const glm::vec3& center, const glm::vec3& extents);
+
+  bool IsEmpty() const;
+
+  glm::vec3 GetCenter() const { return (min + max) * 0.5f; }
+  // Returns half the size of the box.
+  glm::vec3 GetExtents() const { return (max - min) * 0.5f; }
+  float GetSurfaceArea() const;
+
+  // Grows the box to contain `point` or `box`.
+  void Expand(const glm::vec3& point);
+  void Expand(const AABB& box);
+
+  bool Contains(const glm::vec3& point) const;
+  bool Contains(const AABB& box) const;
+  bool Intersects(const AABB& box) const;
+  // Returns the squared distance from `point` to the closest point in the box,
+  // which is 0 if `point` is inside.
+  float DistanceSquared(const glm::vec3& point) const;
+
+  // Returns the box containing this box after being transformed by `matrix`.
+  AABB Transformed(const glm::mat4& matrix) const;
+};
+
+// The volume a projection matrix maps into clip space, bounded by six planes.
+struct Frustum {
+  // Extracts the planes of `matrix`, in the space `matrix` transforms from. For
+  // a model-view-projection matrix, that is the model's local space.
+  explicit Frustum(const glm::mat4& matrix);
+
+  // Returns whether `box` may be inside the frustum. Boxes outside but near a
+  // corner can pass, so this is only suitable for culling.
+  bool Intersects(const AABB& box) const;
+
+  // Each plane's inward-facing normal in xyz and distance in w, so points
+  // inside have a non-negative dot product with every plane.
+  glm::vec4 planes[6];
+};
+
+struct Ray {
+  Ray(const glm::vec3& origin_, const glm::vec3& direction_);
+
+  glm::vec3 origin;
+  // Need not be normalized; distances along the ray are in multiples of it.
+  glm::vec3 direction;
+  // The reciprocal of each component of `direction`, for slab tests.
+  glm::vec3 inverse_direction;
+
+  glm::vec3 GetPoint(float distance) const {
+    return origin + direction * distance;
+  }
+};
+
+// Returns whether `ray` enters `box` within `max_distance`, setting
+// `distance` to where it enters (0 if `ray` starts inside `box`).
+bool IntersectRay(const Ray& ray, const AABB& box, float max_distance,
+                  float& distance);
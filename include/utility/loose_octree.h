@@ -0,0 +1,117 @@
+
+#pragma once
+
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <limits>
+#include <vector>
+
+#include "utility/geometry.h"
+
+// Indexes boxes by location. Each box lives in the smallest existing cell that
+// holds its center and is at least as large as the box, and every cell is
+// searched as if it were twice its size, so a box never straddles cells and
+// moving a box only touches the cells it leaves and enters. Cells are split
+// once they hold too many boxes, so the octree is only deep where boxes are
+// crowded. Boxes outside the root cell are kept in the root.
+//
+// Boxes are identified by small integer ids chosen by the caller, which should
+// be dense since they index an array. Queries never modify the octree, so they
+// may run concurrently with each other, but not with changes to the octree.
+class LooseOctree {
+ public:
+  struct Settings {
+    glm::vec3 center = glm::vec3(0, 0, 0);
+    // Half the size of the root cell.
+    float half_size = 1024;
+    // The depth of the smallest cells, where the root has depth 0.
+    int max_depth = 10;
+    // The number of boxes a cell may hold before it is split.
+    size_t split_count = 8;
+  };
+
+  LooseOctree() : LooseOctree(Settings()) {}
+  explicit LooseOctree(const Settings& settings_);
+
+  // Adds `bounds` with `id`, which must not already be in the octree.
+  // `bounds` must not be empty.
+  void Insert(uint32_t id, const AABB& bounds);
+  // Moves the box with `id` to `bounds`, which must not be empty.
+  void Update(uint32_t id, const AABB& bounds);
+  // Removes the box with `id`.
+  void Remove(uint32_t id);
+
+  bool Contains(uint32_t id) const;
+  // Returns the bounds of `id`, which must be in the octree.
+  const AABB& GetBounds(uint32_t id) const;
+  // Returns the number of boxes in the octree.
+  size_t size() const { return cells[kRootCell].subtree_count; }
+
+  // The query functions append their results to `results`.
+
+  // Finds the boxes that intersect `box`.
+  void QueryBox(const AABB& box, std::vector<uint32_t>& results) const;
+  // Finds the boxes within `radius` of `center`.
+  void QuerySphere(const glm::vec3& center, float radius,
+                   std::vector<uint32_t>& results) const;
+  // Finds up to `count` boxes closest to `point` and within `max_distance`,
+  // nearest first. Points inside a box have a distance of 0 to it.
+  void QueryNearest(
+      const glm::vec3& point, int count, std::vector<uint32_t>& results,
+      float max_distance = std::numeric_limits<float>::infinity()) const;
+  // Finds the first box hit by `ray` within `max_distance`. Returns whether a
+  // box was hit, and if so sets `id` and `distance`.
+  bool Raycast(const Ray& ray, float max_distance, uint32_t& id,
+               float& distance) const;
+
+ private:
+  static constexpr uint32_t kNoCell = ~0u;
+  static constexpr uint32_t kRootCell = 0;
+
+  struct Cell {
+    glm::vec3 center;
+    float half_size;
+    uint32_t parent;
+    // The index of the first of eight consecutive children, or `kNoCell`.
+    uint32_t first_child = kNoCell;
+    int depth;
+    // The number of boxes in this cell and its descendants. Empty subtrees are
+    // skipped by queries.
+    uint32_t subtree_count = 0;
+    std::vector<uint32_t> objects;
+  };
+
+  struct Object {
+    AABB bounds;
+    // The cell containing the object, or `kNoCell` if the id is unused.
+    uint32_t cell = kNoCell;
+    // The index of the object within its cell's `objects`.
+    uint32_t slot;
+  };
+
+  // Returns the cell that `bounds` belongs in, searching down from `cell`,
+  // which must contain `bounds`.
+  uint32_t FindCell(const AABB& bounds, uint32_t cell) const;
+  // Creates the children of `cell` and moves down the boxes that fit in them.
+  void SplitCell(uint32_t cell);
+  // Returns whether `cell` is a leaf with too many boxes.
+  bool CanSplit(uint32_t cell) const;
+  // Returns the bounds searched for boxes in `cell`.
+  AABB GetLooseBounds(uint32_t cell) const;
+
+  // Adds and removes the object with `id` to and from `cell`, and updates the
+  // counts of its ancestors. Adding may split `cell`.
+  void AddToCell(uint32_t id, uint32_t cell);
+  void RemoveFromCell(uint32_t id);
+  // Releases the descendants of the highest empty cell among `cell` and its
+  // ancestors.
+  void ReleaseEmptyCells(uint32_t cell);
+  // Releases the descendants of `cell`, which must all be empty.
+  void ReleaseChildren(uint32_t cell);
+
+  Settings settings;
+  std::vector<Cell> cells;
+  // The first child of released groups of children, to be reused.
+  std::vector<uint32_t> free_children;
+  std::vector<Object> objects;
+};
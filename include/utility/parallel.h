@@ -0,0 +1,118 @@
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Calls `run` with every index in [0, `count`), spread between up to
+// `thread_count` threads, including the calling thread. Indices are handed out
+// in order as threads become free, so uneven work stays balanced. Callers with
+// many tiny items should pass ranges of items as each index.
+template <typename Function>
+void ForEachIndex(size_t count, int thread_count, const Function& run);
+
+// A set of threads kept alive between calls, which run the indices of a job
+// together with the calling thread. Starting a job only wakes the threads, so
+// callers running several small jobs every frame do not pay to create threads
+// each time.
+class WorkerPool {
+ public:
+  // Starts `thread_count - 1` threads; the calling thread makes up the last.
+  explicit WorkerPool(int thread_count);
+  ~WorkerPool();
+
+  WorkerPool(const WorkerPool&) = delete;
+  WorkerPool& operator=(const WorkerPool&) = delete;
+
+  // Returns the number of threads jobs run on, including the calling thread.
+  int GetThreadCount() const { return workers.size() + 1; }
+
+  // Calls `run` with every index in [0, `count`) on the pool's threads, as
+  // the free ForEachIndex does, and returns once all of them have finished.
+  // Must only be called by one thread at a time, and not from within `run`.
+  template <typename Function>
+  void ForEachIndex(size_t count, const Function& run);
+
+ private:
+  // Waits for jobs and runs them until the pool is destroyed.
+  void WorkerLoop();
+  // Runs indices of the current job until none remain.
+  void RunJob();
+
+  std::vector<std::thread> workers;
+
+  // Guards the job fields below, apart from `next_index`.
+  std::mutex mutex;
+  std::condition_variable job_ready;
+  std::condition_variable job_done;
+  // Incremented for every job, so workers can tell a new job from the last.
+  uint64_t generation = 0;
+  bool stopping = false;
+  // The number of workers still running the current job.
+  size_t busy_workers = 0;
+
+  size_t job_count = 0;
+  // The job's function, and a call of it with an index.
+  const void* job_function = nullptr;
+  void (*job_run)(const void* function, size_t index) = nullptr;
+  std::atomic<size_t> next_index{0};
+};
+
+// ===== Template Implementation ===== //
+
+template <typename Function>
+void ForEachIndex(size_t count, int thread_count, const Function& run) {
+  thread_count = static_cast<int>(
+      std::max<size_t>(1, std::min<size_t>(std::max(thread_count, 1), count)));
+  if (thread_count == 1) {
+    for (size_t index = 0; index < count; index++) {
+      run(index);
+    }
+    return;
+  }
+  std::atomic<size_t> next_index(0);
+  const auto work = [&]() {
+    for (size_t index = next_index++; index < count; index = next_index++) {
+      run(index);
+    }
+  };
+  std::vector<std::thread> threads;
+  for (int i = 1; i < thread_count; i++) {
+    threads.emplace_back(work);
+  }
+  work();
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+}
+
+template <typename Function>
+void WorkerPool::ForEachIndex(size_t count, const Function& run) {
+  if (workers.empty() || count <= 1) {
+    for (size_t index = 0; index < count; index++) {
+      run(index);
+    }
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    job_count = count;
+    job_function = &run;
+    job_run = [](const void* function, size_t index) {
+      (*static_cast<const Function*>(function))(index);
+    };
+    next_index.store(0, std::memory_order_relaxed);
+    busy_workers = workers.size();
+    generation++;
+  }
+  job_ready.notify_all();
+  RunJob();
+  std::unique_lock<std::mutex> lock(mutex);
+  job_done.wait(lock, [this]() { return busy_workers == 0; });
+}
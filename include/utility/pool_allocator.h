@@ -0,0 +1,103 @@
+
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <vector>
+
+// Allocates blocks of a single size from large chunks, reusing freed blocks.
+// Chunks are never returned to the system.
+class FixedSizePool {
+ public:
+  // Creates a pool of `block_size` byte blocks aligned to `alignment`.
+  FixedSizePool(size_t block_size, size_t alignment);
+  ~FixedSizePool();
+
+  FixedSizePool(const FixedSizePool&) = delete;
+  FixedSizePool& operator=(const FixedSizePool&) = delete;
+
+  void* Allocate();
+  void Free(void* block);
+
+  // Returns the pool for blocks of `block_size` and `alignment`. Pools are
+  // never destroyed, so objects may outlive static destruction.
+  template <size_t block_size, size_t alignment>
+  static FixedSizePool& Get();
+
+ private:
+  // The number of bytes in each chunk, unless a single block is larger.
+  static constexpr size_t kChunkSize = 64 * 1024;
+
+  struct FreeBlock {
+    FreeBlock* next;
+  };
+
+  // Allocates a new chunk and adds its blocks to the free list.
+  void AddChunk();
+
+  size_t block_size;
+  size_t alignment;
+  size_t blocks_per_chunk;
+
+  std::mutex mutex;
+  FreeBlock* free_list = nullptr;
+  std::vector<void*> chunks;
+};
+
+// A standard allocator that takes single objects from a `FixedSizePool` shared
+// by every allocator of the same type. Arrays fall back to the global heap.
+// Used with `std::allocate_shared`, the control block and object are pooled as
+// one block.
+template <typename T>
+class PoolAllocator {
+ public:
+  using value_type = T;
+
+  PoolAllocator() = default;
+  template <typename U>
+  PoolAllocator(const PoolAllocator<U>&) {}
+
+  T* allocate(size_t count);
+  void deallocate(T* pointer, size_t count);
+
+  template <typename U>
+  bool operator==(const PoolAllocator<U>&) const {
+    return true;
+  }
+  template <typename U>
+  bool operator!=(const PoolAllocator<U>&) const {
+    return false;
+  }
+
+ private:
+  static FixedSizePool& GetPool() {
+    return FixedSizePool::Get<sizeof(T), alignof(T)>();
+  }
+};
+
+// ===== Template Implementation ===== //
+
+template <size_t block_size, size_t alignment>
+FixedSizePool& FixedSizePool::Get() {
+  static FixedSizePool* pool = new FixedSizePool(block_size, alignment);
+  return *pool;
+}
+
+template <typename T>
+T* PoolAllocator<T>::allocate(size_t count) {
+  if (count != 1) {
+    return static_cast<T*>(::operator new(count * sizeof(T)));
+  }
+  return static_cast<T*>(GetPool().Allocate());
+}
+
+template <typename T>
+void PoolAllocator<T>::deallocate(T* pointer, size_t count) {
+  if (count != 1) {
+    ::operator delete(pointer);
+    return;
+  }
+  GetPool().Free(pointer);
+}
@@ -0,0 +1,121 @@
+
+#pragma once
+
+#include <absl/container/flat_hash_map.h>
+#include <absl/status/status.h>
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <typeindex>
+#include <typeinfo>
+#include <vector>
+
+// Records timed scopes from any thread and exports them as a Chrome trace
+// (chrome://tracing or Perfetto). Scopes are only recorded while the profiler
+// is enabled, and the profiling macros compile to nothing unless
+// SHEEP_PROFILER is defined.
+class Profiler {
+ public:
+  struct Event {
+    // Name of the scope. Must outlive the profiler, such as a string literal.
+    const char* name;
+    uint64_t start_ns;
+    uint64_t end_ns;
+  };
+
+  // Number of events kept per thread. Older events are overwritten.
+  static constexpr uint64_t kEventsPerThread = 1 << 16;
+
+  void SetEnabled(bool enabled_);
+  bool IsEnabled() const { return enabled.load(std::memory_order_relaxed); }
+
+  // Records an event on the calling thread.
+  void Record(const Event& event);
+
+  // Records an event on the track named `track` rather than the calling
+  // thread, such as for GPU timings.
+  void RecordOnTrack(const char* track, const Event& event);
+
+  // Writes all recorded events to `path` as Chrome trace JSON.
+  absl::Status WriteChromeTrace(const std::string& path) const;
+
+  // Returns the current time in nanoseconds, on the clock all events use.
+  static uint64_t Now();
+
+  // Returns the readable name of `type`, for naming scopes after the type of
+  // an object. The name lives as long as the profiler. Only the first lookup
+  // of a type on each thread locks.
+  const char* GetTypeName(const std::type_info& type);
+
+  static Profiler& Get() { return instance; }
+
+ private:
+  // A ring of events written by a single thread. Writers never block; the
+  // exporter may observe events being overwritten if the ring wraps while it
+  // reads.
+  struct ThreadBuffer {
+    std::string name;
+    std::unique_ptr<Event[]> events{new Event[kEventsPerThread]};
+    std::atomic<uint64_t> write_index{0};
+  };
+
+  static Profiler instance;
+
+  // Returns the calling thread's buffer, creating it on first use.
+  ThreadBuffer& GetThreadBuffer();
+  // Returns the buffer for `track`, creating it on first use.
+  ThreadBuffer& GetTrackBuffer(const char* track);
+
+  static void Push(ThreadBuffer& buffer, const Event& event);
+
+  std::atomic<bool> enabled{false};
+
+  // Guards `buffers` and `track_names`, but not the contents of the buffers.
+  mutable std::mutex buffers_mutex;
+  std::vector<std::unique_ptr<ThreadBuffer>> buffers;
+  std::vector<const char*> track_names;
+  std::vector<ThreadBuffer*> track_buffers;
+
+  std::mutex type_names_mutex;
+  absl::flat_hash_map<std::type_index, std::unique_ptr<std::string>>
+      type_names;
+};
+
+// Records the time between its construction and destruction.
+class ProfileScope {
+ public:
+  ProfileScope(const char* name_)
+      : name(name_),
+        start_ns(name && Profiler::Get().IsEnabled() ? Profiler::Now() : 0) {}
+  ~ProfileScope() {
+    if (start_ns) {
+      Profiler::Get().Record({name, start_ns, Profiler::Now()});
+    }
+  }
+
+ private:
+  const char* name;
+  uint64_t start_ns;
+};
+
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+
+#ifdef SHEEP_PROFILER
+// Times the rest of the enclosing scope under `name`, which must outlive the
+// profiler.
+#define PROFILE_SCOPE(name) \
+  ProfileScope PROFILE_CONCAT(__profile_scope_, __LINE__)(name)
+// Times the rest of the enclosing scope under the dynamic type of `object`.
+#define PROFILE_SCOPE_TYPE(object)                          \
+  ProfileScope PROFILE_CONCAT(__profile_scope_, __LINE__)( \
+      Profiler::Get().IsEnabled()                           \
+          ? Profiler::Get().GetTypeName(typeid(object))     \
+          : nullptr)
+#else
+#define PROFILE_SCOPE(name)
+#define PROFILE_SCOPE_TYPE(object)
+#endif
@@ -0,0 +1,33 @@
+
+#pragma once
+
+#include <cstdint>
+#include <map>
+
+// Allocates contiguous ranges from a linear space, such as a GPU buffer.
+// Ranges are placed first-fit, and freed ranges are merged with their free
+// neighbours.
+class RangeAllocator {
+ public:
+  static constexpr uint64_t kInvalidOffset = ~0ULL;
+
+  RangeAllocator(uint64_t capacity_ = 0);
+
+  // Allocates `size` units and returns the offset of the range, or
+  // kInvalidOffset if no free range is large enough.
+  uint64_t Allocate(uint64_t size);
+
+  // Frees the range previously allocated at `offset` with `size` units.
+  void Free(uint64_t offset, uint64_t size);
+
+  // Extends the space to `new_capacity` units. Existing ranges keep their
+  // offsets.
+  void Grow(uint64_t new_capacity);
+
+  uint64_t GetCapacity() const;
+
+ private:
+  uint64_t capacity;
+  // Maps the offset of each free range to its size.
+  std::map<uint64_t, uint64_t> free_ranges;
+};
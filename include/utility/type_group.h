@@ -1,19 +1,24 @@
 
 #pragma once
 
-#include <absl/container/flat_hash_set.h>
+#include <absl/container/flat_hash_map.h>
 
 #include <memory>
+#include <type_traits>
+#include <vector>
 
 #include "nodes/node.h"
+#include "nodes/node_type_tag.h"
 #include "nodes/utility.h"
 #include "systems/system.h"
 
+// A set of elements of type `TargetType`, stored densely for fast iteration.
+// Elements keep the order they were added in, except that removing an element
+// moves the last element into its place.
 template <typename TargetType, typename SourceType>
 struct TypeGroup {
  public:
-  using ContainerType =
-      typename absl::flat_hash_set<std::shared_ptr<TargetType>>;
+  using ContainerType = std::vector<std::shared_ptr<TargetType>>;
 
   // Adds several `elements` to this group.
   void Add(const std::vector<std::shared_ptr<SourceType>>& elements);
@@ -21,6 +26,9 @@ struct TypeGroup {
   // Removes several `elements` from this group.
   void Remove(const std::vector<std::shared_ptr<SourceType>>& elements);
 
+  size_t size() const { return cast_elements.size(); }
+  bool empty() const { return cast_elements.empty(); }
+
   typename ContainerType::const_iterator begin() const {
     return cast_elements.begin();
   }
@@ -35,26 +43,36 @@ struct TypeGroup {
     return cast_elements.cend();
   }
 
+ protected:
+  // Adds `element` if it is not already in this group.
+  void Insert(std::shared_ptr<TargetType> element);
+  // Removes `element` if it is in this group.
+  void Erase(const TargetType* element);
+
  private:
   ContainerType cast_elements;
+  // The index of each element in `cast_elements`.
+  absl::flat_hash_map<const TargetType*, size_t> indices;
 };
 
+// A group of nodes of type `NodeType`. Membership is tested with node type
+// tags, so only nodes that belong to the group are cast.
 template <typename NodeType>
 struct NodeTypeGroup : public TypeGroup<NodeType, Node> {
  public:
-  void Add(const std::vector<std::shared_ptr<Node>>& nodes) {
-    TypeGroup<NodeType, Node>::Add(nodes);
-  }
+  void Add(const std::vector<std::shared_ptr<Node>>& nodes);
 
-  void Remove(const std::vector<std::shared_ptr<Node>>& nodes) {
-    TypeGroup<NodeType, Node>::Remove(nodes);
-  }
+  void Remove(const std::vector<std::shared_ptr<Node>>& nodes);
 
   // Adds a tree of nodes with `root` to this group.
   void AddTree(const std::shared_ptr<Node>& root);
 
   // Removes a tree of nodes with `root` from this group.
   void RemoveTree(const std::shared_ptr<Node>& root);
+
+ private:
+  // Returns `node` as a `NodeType`. `node` must be a `NodeType`.
+  static NodeType* Cast(Node* node);
 };
 
 template <typename SystemType>
@@ -81,9 +99,9 @@ template <typename TargetType, typename SourceType>
 void TypeGroup<TargetType, SourceType>::Add(
     const std::vector<std::shared_ptr<SourceType>>& elements) {
   for (const std::shared_ptr<SourceType>& element : elements) {
-    const auto cast_element = std::dynamic_pointer_cast<TargetType>(element);
+    auto cast_element = std::dynamic_pointer_cast<TargetType>(element);
     if (cast_element) {
-      cast_elements.insert(cast_element);
+      Insert(std::move(cast_element));
     }
   }
 }
@@ -92,9 +110,56 @@ template <typename TargetType, typename SourceType>
 void TypeGroup<TargetType, SourceType>::Remove(
     const std::vector<std::shared_ptr<SourceType>>& elements) {
   for (const std::shared_ptr<SourceType>& element : elements) {
-    const auto cast_element = std::dynamic_pointer_cast<TargetType>(element);
+    const TargetType* cast_element =
+        dynamic_cast<const TargetType*>(element.get());
     if (cast_element) {
-      cast_elements.erase(cast_element);
+      Erase(cast_element);
+    }
+  }
+}
+
+template <typename TargetType, typename SourceType>
+void TypeGroup<TargetType, SourceType>::Insert(
+    std::shared_ptr<TargetType> element) {
+  if (indices.try_emplace(element.get(), cast_elements.size()).second) {
+    cast_elements.push_back(std::move(element));
+  }
+}
+
+template <typename TargetType, typename SourceType>
+void TypeGroup<TargetType, SourceType>::Erase(const TargetType* element) {
+  const auto it = indices.find(element);
+  if (it == indices.end()) {
+    return;
+  }
+  const size_t index = it->second;
+  indices.erase(it);
+  if (index != cast_elements.size() - 1) {
+    cast_elements[index] = std::move(cast_elements.back());
+    indices[cast_elements[index].get()] = index;
+  }
+  cast_elements.pop_back();
+}
+
+template <typename NodeType>
+void NodeTypeGroup<NodeType>::Add(
+    const std::vector<std::shared_ptr<Node>>& nodes) {
+  const NodeTypeMask tag = GetNodeTypeTag<NodeType>();
+  for (const std::shared_ptr<Node>& node : nodes) {
+    if (node->GetTypeMask() & tag) {
+      // Share ownership with `node` rather than casting the shared pointer.
+      this->Insert(std::shared_ptr<NodeType>(node, Cast(node.get())));
+    }
+  }
+}
+
+template <typename NodeType>
+void NodeTypeGroup<NodeType>::Remove(
+    const std::vector<std::shared_ptr<Node>>& nodes) {
+  const NodeTypeMask tag = GetNodeTypeTag<NodeType>();
+  for (const std::shared_ptr<Node>& node : nodes) {
+    if (node->GetTypeMask() & tag) {
+      this->Erase(Cast(node.get()));
     }
   }
 }
@@ -109,6 +174,16 @@ void NodeTypeGroup<NodeType>::RemoveTree(const std::shared_ptr<Node>& root) {
   Remove(CollectPreOrderNodes(root));
 }
 
+template <typename NodeType>
+NodeType* NodeTypeGroup<NodeType>::Cast(Node* node) {
+  // Interfaces that do not derive from Node still need a cross cast.
+  if constexpr (std::is_base_of_v<Node, NodeType>) {
+    return static_cast<NodeType*>(node);
+  } else {
+    return dynamic_cast<NodeType*>(node);
+  }
+}
+
 template <typename SystemType>
 void SystemTypeGroup<SystemType>::AddSystem(
     const std::shared_ptr<System>& system) {
@@ -1,11 +1,19 @@
 
 #pragma once
 
+#include <absl/container/flat_hash_map.h>
+#include <glog/logging.h>
+
+#include <cstdint>
 #include <memory>
+#include <type_traits>
+#include <utility>
 #include <vector>
 
+#include "ecs/entity_registry.h"
 #include "nodes/node.h"
 #include "systems/system.h"
+#include "utility/pool_allocator.h"
 
 class Engine;
 
@@ -23,6 +31,37 @@ class World : public std::enable_shared_from_this<World> {
 
   std::shared_ptr<Node> CreateEmptyRoot();
 
+  // Starts deferring system notifications of nodes being attached and detached
+  // until the matching `EndBatch`, so building or tearing down many nodes
+  // notifies systems once. Nodes still join and leave the world immediately,
+  // so handles, entities and ancestor notifications are unaffected. Batches
+  // may be nested.
+  void BeginBatch();
+  // Ends the batch started by the matching `BeginBatch`. Ending the outermost
+  // batch notifies systems of every node that left the world during the batch,
+  // then of every node that joined it. Nodes that were only moved within the
+  // world, or that joined and left again, are not reported. Detached nodes are
+  // no longer in the world when systems are notified.
+  void EndBatch();
+
+  // Creates a node of type `NodeType` from `args`. The node and its reference
+  // count share one block from a pool for its type, so spawning and destroying
+  // many nodes avoids the general-purpose heap. The node is not attached to
+  // anything.
+  template <typename NodeType, typename... Args>
+  static std::shared_ptr<NodeType> Spawn(Args&&... args);
+
+  // Returns the node `handle` refers to, or null if the handle is stale.
+  // `NodeType` must be the type, or a base of the type, of the node the handle
+  // was taken from.
+  template <typename NodeType = Node>
+  NodeType* Resolve(NodeHandle handle) const;
+
+  // Returns the entities and components of this world. Nodes that implement
+  // `EntityBridge` have an entity here while they are in the world.
+  EntityRegistry& GetEntities() { return entities; }
+  const EntityRegistry& GetEntities() const { return entities; }
+
   std::shared_ptr<Node> GetRoot() const;
   std::shared_ptr<Engine> GetEngine() const;
   const std::vector<std::shared_ptr<System>>& GetSystems() const;
@@ -47,12 +86,42 @@ class World : public std::enable_shared_from_this<World> {
   // frame. `delta_seconds` is the amount of time passed for this frame.
   void LateUpdate(float delta_seconds);
 
-  void PropagateNodeAttachment(const std::shared_ptr<Node>& node);
-  void PropagateNodeDetachment(const std::shared_ptr<Node>& node);
+  // Notifies systems of subtrees with the pre-order traversals `nodes` being
+  // attached or detached, or records them if a batch is in progress.
+  void PropagateNodeAttachment(const std::vector<std::shared_ptr<Node>>& nodes);
+  void PropagateNodeDetachment(const std::vector<std::shared_ptr<Node>>& nodes);
+
+  // Records that `nodes` were attached (if `attached`) or detached during a
+  // batch.
+  void RecordBatchedNodes(const std::vector<std::shared_ptr<Node>>& nodes,
+                          bool attached);
+
+  // Adds `nodes` to this world, giving each a handle.
+  void RegisterNodes(const std::vector<std::shared_ptr<Node>>& nodes);
+  // Removes `nodes` from this world, invalidating their handles.
+  void UnregisterNodes(const std::vector<std::shared_ptr<Node>>& nodes);
 
   std::shared_ptr<Node> root;
   std::vector<std::shared_ptr<System>> systems;
 
+  struct NodeSlot {
+    // Not owned. Null if the slot is free.
+    Node* node;
+    // Incremented every time the slot is freed.
+    uint32_t generation;
+  };
+  std::vector<NodeSlot> node_slots;
+  std::vector<uint32_t> free_node_slots;
+
+  EntityRegistry entities;
+
+  int batch_depth = 0;
+  // Every node attached or detached during the current batch, in the order
+  // they were first seen.
+  std::vector<std::shared_ptr<Node>> batch_nodes;
+  // Whether each node of `batch_nodes` was in this world when the batch began.
+  absl::flat_hash_map<const Node*, bool> batch_node_was_attached;
+
   std::weak_ptr<Engine> engine;
 
   bool is_initialized = false;
@@ -63,6 +132,27 @@ class World : public std::enable_shared_from_this<World> {
 
 // ===== Template Implementation ===== //
 
+template <typename NodeType>
+NodeType* World::Resolve(NodeHandle handle) const {
+  if (handle.index >= node_slots.size()) {
+    return nullptr;
+  }
+  const NodeSlot& slot = node_slots[handle.index];
+  if (slot.generation != handle.generation) {
+    return nullptr;
+  }
+  DCHECK(!slot.node || dynamic_cast<NodeType*>(slot.node));
+  return static_cast<NodeType*>(slot.node);
+}
+
+template <typename NodeType, typename... Args>
+std::shared_ptr<NodeType> World::Spawn(Args&&... args) {
+  static_assert(std::is_base_of_v<Node, NodeType>,
+                "Only nodes can be spawned.");
+  return std::allocate_shared<NodeType>(PoolAllocator<NodeType>(),
+                                        std::forward<Args>(args)...);
+}
+
 template <typename SystemType>
 std::shared_ptr<SystemType> World::GetSystem() const {
   for (const std::shared_ptr<System>& system : systems) {
@@ -0,0 +1,215 @@
+
+#include "ecs/entity_registry.h"
+
+#include <algorithm>
+#include <mutex>
+
+// The info of every registered component type, indexed by id. Entries are
+// never removed, so references to them stay valid.
+struct ComponentTypes {
+  std::mutex mutex;
+  ComponentInfo infos[kMaxComponentTypes];
+  ComponentId count = 0;
+};
+
+ComponentTypes& GetComponentTypes() {
+  static ComponentTypes* types = new ComponentTypes();
+  return *types;
+}
+
+ComponentId RegisterComponent(const ComponentInfo& info) {
+  ComponentTypes& types = GetComponentTypes();
+  std::lock_guard<std::mutex> lock(types.mutex);
+  CHECK(types.count < kMaxComponentTypes)
+      << "Too many component types; at most " << kMaxComponentTypes
+      << " are supported.";
+  types.infos[types.count] = info;
+  return types.count++;
+}
+
+const ComponentInfo& GetComponentInfo(ComponentId id) {
+  return GetComponentTypes().infos[id];
+}
+
+// Rounds `value` up to a multiple of `alignment`.
+size_t AlignUp(size_t value, size_t alignment) {
+  return (value + alignment - 1) / alignment * alignment;
+}
+
+Archetype::Archetype(ComponentMask mask_) : mask(mask_) {
+  size_t row_size = sizeof(Entity);
+  for (ComponentId id = 0; id < kMaxComponentTypes; id++) {
+    if (Has(id)) {
+      components.push_back(id);
+      const ComponentInfo& info = GetComponentInfo(id);
+      row_size += info.size;
+      chunk_alignment = std::max(chunk_alignment, info.alignment);
+    }
+  }
+
+  // Lay out the entity column followed by each component column, shrinking
+  // the capacity until the aligned columns fit in a chunk.
+  chunk_capacity = std::max<size_t>(kChunkSize / row_size, 1);
+  while (true) {
+    size_t offset = sizeof(Entity) * chunk_capacity;
+    for (ComponentId id : components) {
+      const ComponentInfo& info = GetComponentInfo(id);
+      offset = AlignUp(offset, info.alignment);
+      column_offsets[id] = offset;
+      offset += info.size * chunk_capacity;
+    }
+    if (offset <= kChunkSize || chunk_capacity == 1) {
+      break;
+    }
+    chunk_capacity--;
+  }
+}
+
+Archetype::~Archetype() {
+  for (uint32_t chunk = 0; chunk < chunks.size(); chunk++) {
+    for (uint32_t row = 0; row < chunks[chunk].count; row++) {
+      DestroyRow(chunk, row);
+    }
+    ::operator delete(chunks[chunk].data, std::align_val_t(chunk_alignment));
+  }
+}
+
+std::pair<uint32_t, uint32_t> Archetype::AddRow(Entity entity) {
+  if (chunks.empty() || chunks.back().count == chunk_capacity) {
+    // A chunk may need more than `kChunkSize` bytes if a single row does not
+    // fit.
+    size_t size = std::max(kChunkSize, sizeof(Entity) * chunk_capacity);
+    for (ComponentId id : components) {
+      size = std::max(size, column_offsets[id] +
+                                GetComponentInfo(id).size * chunk_capacity);
+    }
+    chunks.push_back({static_cast<unsigned char*>(::operator new(
+                          size, std::align_val_t(chunk_alignment))),
+                      0});
+  }
+  Chunk& chunk = chunks.back();
+  const uint32_t row = chunk.count++;
+  reinterpret_cast<Entity*>(chunk.data)[row] = entity;
+  return {(uint32_t)chunks.size() - 1, row};
+}
+
+Entity Archetype::RemoveRow(uint32_t chunk, uint32_t row) {
+  Chunk& last_chunk = chunks.back();
+  const uint32_t last_row = last_chunk.count - 1;
+  Entity moved;
+  if (chunk != chunks.size() - 1 || row != last_row) {
+    for (ComponentId id : components) {
+      GetComponentInfo(id).relocate(GetComponent(id, chunk, row),
+                                    GetComponent(id, chunks.size() - 1,
+                                                 last_row));
+    }
+    moved = reinterpret_cast<Entity*>(last_chunk.data)[last_row];
+    reinterpret_cast<Entity*>(chunks[chunk].data)[row] = moved;
+  }
+  last_chunk.count--;
+  if (last_chunk.count == 0) {
+    ::operator delete(last_chunk.data, std::align_val_t(chunk_alignment));
+    chunks.pop_back();
+  }
+  return moved;
+}
+
+void Archetype::DestroyRow(uint32_t chunk, uint32_t row) {
+  for (ComponentId id : components) {
+    GetComponentInfo(id).destroy(GetComponent(id, chunk, row));
+  }
+}
+
+Entity EntityRegistry::Create() {
+  DCHECK_EQ(iteration_depth, 0)
+      << "Entities cannot be created while iterating.";
+  uint32_t index;
+  if (free_records.empty()) {
+    index = records.size();
+    records.push_back({nullptr, 0, 0, 0});
+  } else {
+    index = free_records.back();
+    free_records.pop_back();
+  }
+  EntityRecord& record = records[index];
+  const Entity entity{index, record.generation};
+  record.archetype = GetArchetype(0);
+  std::tie(record.chunk, record.row) = record.archetype->AddRow(entity);
+  entity_count++;
+  return entity;
+}
+
+void EntityRegistry::Destroy(Entity entity) {
+  DCHECK_EQ(iteration_depth, 0)
+      << "Entities cannot be destroyed while iterating.";
+  if (!GetRecord(entity)) {
+    return;
+  }
+  EntityRecord& record = records[entity.index];
+  record.archetype->DestroyRow(record.chunk, record.row);
+  UpdateMovedEntity(record.archetype->RemoveRow(record.chunk, record.row),
+                    record.chunk, record.row);
+  record.archetype = nullptr;
+  record.generation++;
+  free_records.push_back(entity.index);
+  entity_count--;
+}
+
+bool EntityRegistry::IsAlive(Entity entity) const {
+  return GetRecord(entity) != nullptr;
+}
+
+Archetype* EntityRegistry::GetArchetype(ComponentMask mask) {
+  std::unique_ptr<Archetype>& archetype = archetypes[mask];
+  if (!archetype) {
+    archetype.reset(new Archetype(mask));
+    archetype_list.push_back(archetype.get());
+  }
+  return archetype.get();
+}
+
+void EntityRegistry::MoveEntity(Entity entity, ComponentMask mask) {
+  DCHECK_EQ(iteration_depth, 0)
+      << "Components cannot be added or removed while iterating.";
+  EntityRecord& record = records[entity.index];
+  Archetype* source = record.archetype;
+  Archetype* target = GetArchetype(mask);
+  const auto [chunk, row] = target->AddRow(entity);
+  for (ComponentId id : source->components) {
+    if (target->Has(id)) {
+      GetComponentInfo(id).relocate(target->GetComponent(id, chunk, row),
+                                    source->GetComponent(id, record.chunk,
+                                                         record.row));
+    } else {
+      GetComponentInfo(id).destroy(
+          source->GetComponent(id, record.chunk, record.row));
+    }
+  }
+  UpdateMovedEntity(source->RemoveRow(record.chunk, record.row), record.chunk,
+                    record.row);
+  record.archetype = target;
+  record.chunk = chunk;
+  record.row = row;
+}
+
+void EntityRegistry::UpdateMovedEntity(Entity moved, uint32_t chunk,
+                                       uint32_t row) {
+  if (moved.IsNull()) {
+    return;
+  }
+  EntityRecord& record = records[moved.index];
+  record.chunk = chunk;
+  record.row = row;
+}
+
+const EntityRegistry::EntityRecord* EntityRegistry::GetRecord(
+    Entity entity) const {
+  if (entity.index >= records.size()) {
+    return nullptr;
+  }
+  const EntityRecord& record = records[entity.index];
+  if (record.generation != entity.generation || !record.archetype) {
+    return nullptr;
+  }
+  return &record;
+}
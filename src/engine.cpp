@@ -3,6 +3,11 @@
 
 #include <glog/logging.h>
 
+#include <algorithm>
+#include <cmath>
+
+#include "utility/profiler.h"
+
 std::shared_ptr<World> Engine::CreateWorld() {
   std::shared_ptr<World> world(new World());
   world->engine = this->shared_from_this();
@@ -80,6 +85,28 @@ void Engine::RemoveSuperSystem(
   }
 }
 
+void Engine::StartRecording() {
+  is_recording = true;
+  recorded_frames.clear();
+}
+
+std::vector<Engine::FrameRecord> Engine::StopRecording() {
+  is_recording = false;
+  return std::move(recorded_frames);
+}
+
+void Engine::Replay(std::vector<FrameRecord> frames) {
+  replay_frames = std::move(frames);
+  replay_index = 0;
+}
+
+float Engine::GetFixedUpdateAlpha() const {
+  if (!fixed_update_ns) {
+    return 0;
+  }
+  return (float)((double)fixed_time_accumulator_ns / fixed_update_ns);
+}
+
 const std::vector<std::shared_ptr<World>>& Engine::GetWorlds() const {
   return worlds;
 }
@@ -90,37 +117,72 @@ const std::vector<std::shared_ptr<SuperSystem>>& Engine::GetSuperSystems()
 
 void Engine::Quit() { is_running = false; }
 
-void Engine::Run(GLFWwindow* window) {
+void Engine::Run(Platform& platform_) {
+  platform = &platform_;
   Init();
 
-  double previous_time = glfwGetTime();
-  double game_time_offset = 0;
+  Clock& clock = platform->GetClock();
+  double previous_time = clock.Now();
+  frame_pacer.Reset(clock);
 
-  while (is_running && !glfwWindowShouldClose(window)) {
-    const double time = glfwGetTime();
-    const double delta = time - previous_time;
+  while (is_running && !platform->ShouldQuit()) {
+    const double time = frame_pacer.BeginFrame(clock);
+    PROFILE_SCOPE("Frame");
+    uint64_t delta_ns =
+        (uint64_t)std::llround(std::max(time - previous_time, 0.0) * 1e9);
     previous_time = time;
-
-    // printf("Delta: %f\n", 1.0f / delta);
+    const FrameRecord* replay_frame = nullptr;
+    if (IsReplaying()) {
+      replay_frame = &replay_frames[replay_index++];
+      delta_ns = replay_frame->delta_ns;
+    }
+    const float delta = (float)(delta_ns * 1e-9);
 
     Update(delta);
 
-    const double fixed_update_delta = 1.0 / fixed_updates_per_second;
-    game_time_offset += delta;
-    unsigned int desired_frames =
-        (unsigned int)(game_time_offset * fixed_updates_per_second);
-    game_time_offset -= desired_frames * fixed_update_delta;
-
+    fixed_update_ns =
+        (uint64_t)std::llround(1e9 / (double)fixed_updates_per_second);
+    fixed_time_accumulator_ns += delta_ns;
     // Ignore any frames passed `max_fixed_updates_per_frame`.
-    desired_frames = std::min(desired_frames, max_fixed_updates_per_frame);
+    unsigned int desired_frames = (unsigned int)std::min<uint64_t>(
+        fixed_time_accumulator_ns / fixed_update_ns,
+        max_fixed_updates_per_frame);
+    fixed_time_accumulator_ns %= fixed_update_ns;
+    if (replay_frame) {
+      LOG_IF(WARNING, desired_frames != replay_frame->fixed_updates)
+          << "Replay diverged on frame " << frame_count << ": expected "
+          << replay_frame->fixed_updates << " fixed updates, computed "
+          << desired_frames;
+      desired_frames = replay_frame->fixed_updates;
+    }
+    if (is_recording) {
+      recorded_frames.push_back({delta_ns, desired_frames});
+    }
+    const float fixed_update_delta = (float)(fixed_update_ns * 1e-9);
     for (int i = 0; i < desired_frames; i++) {
       FixedUpdate(fixed_update_delta);
+      fixed_update_count++;
     }
 
     LateUpdate(delta);
 
-    glfwPollEvents();
+    platform->PollEvents();
+    frame_count++;
+    frame_pacer.EndFrame(clock);
+
+    if (replay_frame && !IsReplaying()) {
+      Quit();
+    }
+  }
+  for (const std::shared_ptr<SuperSystem>& super_system : super_systems) {
+    super_system->Shutdown();
   }
+  platform = nullptr;
+}
+
+void Engine::Run(GLFWwindow* window) {
+  GlfwPlatform glfw_platform(window);
+  Run(glfw_platform);
 }
 
 void Engine::Init() {
@@ -138,34 +200,42 @@ void Engine::Init() {
 }
 
 void Engine::Update(float delta_seconds) {
+  PROFILE_SCOPE("Update");
   for (const std::shared_ptr<World>& world : worlds) {
     if (world->is_initialized) {
       world->Update(delta_seconds);
     }
   }
   for (const std::shared_ptr<SuperSystem>& super_system : super_systems) {
+    PROFILE_SCOPE_TYPE(*super_system);
     super_system->Update(delta_seconds);
   }
 }
 
 void Engine::FixedUpdate(float delta_seconds) {
+  PROFILE_SCOPE("FixedUpdate");
+  in_fixed_update = true;
   for (const std::shared_ptr<World>& world : worlds) {
     if (world->is_initialized) {
       world->FixedUpdate(delta_seconds);
     }
   }
   for (const std::shared_ptr<SuperSystem>& super_system : super_systems) {
+    PROFILE_SCOPE_TYPE(*super_system);
     super_system->FixedUpdate(delta_seconds);
   }
+  in_fixed_update = false;
 }
 
 void Engine::LateUpdate(float delta_seconds) {
+  PROFILE_SCOPE("LateUpdate");
   for (const std::shared_ptr<World>& world : worlds) {
     if (world->is_initialized) {
       world->LateUpdate(delta_seconds);
     }
   }
   for (const std::shared_ptr<SuperSystem>& super_system : super_systems) {
+    PROFILE_SCOPE_TYPE(*super_system);
     super_system->LateUpdate(delta_seconds);
   }
 }
@@ -0,0 +1,87 @@
+
+#include "frame_pacer.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "utility/profiler.h"
+
+FramePacer::FramePacer() { frame_times.reserve(kHistorySize); }
+
+void FramePacer::AddOverrunCallback(const OverrunCallback& callback) {
+  overrun_callbacks.push_back(callback);
+}
+
+void FramePacer::Reset(Clock& clock) {
+  next_frame_time = clock.Now();
+  has_frame = false;
+}
+
+// Blends `sample` into `average` by `weight`, starting from the first sample.
+void Smooth(double& average, double sample, float weight) {
+  average = average == 0 ? sample : average + (sample - average) * weight;
+}
+
+double FramePacer::BeginFrame(Clock& clock) {
+  if (target_frames_per_second > 0) {
+    PROFILE_SCOPE("FramePacing");
+    const double frame_seconds = 1.0 / target_frames_per_second;
+    // Allow catching up by at most one frame, so a hitch does not cause a
+    // burst of unlimited frames.
+    next_frame_time = std::max(next_frame_time + frame_seconds,
+                               clock.Now() - frame_seconds);
+    clock.SleepUntil(next_frame_time);
+  }
+
+  const double time = clock.Now();
+  if (has_frame) {
+    const double frame_time = time - frame_start_time;
+    if (frame_times.size() < kHistorySize) {
+      frame_times.push_back(frame_time);
+    } else {
+      frame_times[frame_time_index] = frame_time;
+    }
+    frame_time_index = (frame_time_index + 1) % kHistorySize;
+    Smooth(smoothed_frame_time, frame_time, smoothing);
+  }
+  frame_start_time = time;
+  has_frame = true;
+  return time;
+}
+
+void FramePacer::EndFrame(Clock& clock) {
+  const double work_time = clock.Now() - frame_start_time;
+  Smooth(smoothed_work_time, work_time, smoothing);
+  if (target_frames_per_second <= 0) {
+    return;
+  }
+  const double budget = 1.0 / target_frames_per_second;
+  if (work_time > budget * (1 + overrun_tolerance)) {
+    for (const OverrunCallback& callback : overrun_callbacks) {
+      callback(work_time, budget);
+    }
+  }
+}
+
+// Returns the `percentile` (from 0 to 1) of `sorted_values` by nearest rank.
+double Percentile(const std::vector<double>& sorted_values,
+                  double percentile) {
+  if (sorted_values.empty()) {
+    return 0;
+  }
+  const size_t rank = (size_t)std::ceil(percentile * sorted_values.size());
+  return sorted_values[std::clamp<size_t>(rank, 1, sorted_values.size()) - 1];
+}
+
+FramePacer::Stats FramePacer::GetStats() const {
+  std::vector<double> sorted_times = frame_times;
+  std::sort(sorted_times.begin(), sorted_times.end());
+
+  Stats stats;
+  stats.p50 = Percentile(sorted_times, 0.5);
+  stats.p95 = Percentile(sorted_times, 0.95);
+  stats.p99 = Percentile(sorted_times, 0.99);
+  stats.smoothed = smoothed_frame_time;
+  stats.smoothed_work = smoothed_work_time;
+  return stats;
+}
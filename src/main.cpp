@@ -1,6 +1,8 @@
 
 #include <GL/glew.h>
 #include <GLFW/glfw3.h>
+#include <absl/flags/flag.h>
+#include <absl/flags/parse.h>
 #include <glog/logging.h>
 #include <math.h>
 #include <stdio.h>
@@ -8,17 +10,23 @@
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/quaternion.hpp>
 #include <glm/gtx/string_cast.hpp>
+#include <fstream>
 #include <memory>
 #include <sstream>
 #include <string>
 
 #include "engine.h"
+#include "nodes/light.h"
 #include "nodes/mesh_renderer.h"
 #include "nodes/skinned_mesh_renderer.h"
 #include "nodes/transform.h"
+#include "resources/derived_cache.h"
+#include "resources/material.h"
 #include "resources/mesh_formats/obj_mesh.h"
+#include "resources/prefab.h"
 #include "resources/renderable_mesh.h"
 #include "resources/resource.h"
+#include "resources/scene.h"
 #include "resources/shader.h"
 #include "resources/skinned_mesh.h"
 #include "resources/texture_formats/png_texture.h"
@@ -26,8 +34,16 @@
 #include "systems/input_system.h"
 #include "systems/render_system.h"
 #include "utility/cached.h"
+#include "utility/profiler.h"
 #include "utility/status.h"
 
+ABSL_FLAG(std::string, trace_file, "",
+          "If set, profiles the run and writes a Chrome trace to this file.");
+ABSL_FLAG(std::string, save_scene, "",
+          "If set, saves the starting scene to this file.");
+ABSL_FLAG(bool, render_thread, false,
+          "If set, renders frames on a dedicated render thread.");
+
 std::shared_ptr<Mesh> triangleMesh() {
   std::shared_ptr<Mesh> source_mesh(new Mesh());
   source_mesh->vertices = {{glm::vec3(-1.f, -1.f, 0.f)},
@@ -58,11 +74,19 @@ std::shared_ptr<Mesh> squareMesh() {
   "layout(location = 3) in vec3 normal;\n"                        \
   "layout(location = 6) in vec4 bone_weights;\n"                  \
   "layout(location = 7) in ivec4 bones;\n"                        \
-  "uniform mat4 MVP;\n"                                           \
+  "layout(location = 8) in uint object_index;\n"                  \
+  "struct ObjectData {\n"                                         \
+  "  mat4 model;\n"                                               \
+  "  mat4 MVP;\n"                                                 \
+  "};\n"                                                          \
+  "layout(std140) uniform Object {\n"                             \
+  "  ObjectData objects[128];\n"                                  \
+  "};\n"                                                          \
   "layout(std140) uniform Bones {\n"                              \
   "  mat4 pose_data[256];\n"                                      \
   "};\n"                                                          \
   "out vec3 normal_frag;\n"                                       \
+  "out vec3 world_position;\n"                                    \
   "out vec2 uv;\n"                                                \
   "vec4 apply_pose(vec4 point, vec4 weights, ivec4 indices) {\n"  \
   "  return point;\n"                                             \
@@ -72,21 +96,57 @@ std::shared_ptr<Mesh> squareMesh() {
   "    + (pose_data[indices.w] * point) * bone_weights.w;\n"      \
   "}\n"                                                           \
   "void main() {\n"                                               \
-  "  gl_Position = MVP * vec4(apply_pose(\n"                      \
+  "  ObjectData object = objects[object_index];\n"                \
+  "  vec4 posed = vec4(apply_pose(\n"                             \
   "    vec4(position, 1.0), bone_weights, bones).xyz, 1.0);\n"    \
-  "  normal_frag = (MVP * vec4(apply_pose(\n"                     \
+  "  gl_Position = object.MVP * posed;\n"                         \
+  "  world_position = (object.model * posed).xyz;\n"              \
+  "  normal_frag = (object.model * vec4(apply_pose(\n"            \
   "    vec4(normal, 0.0), bone_weights, bones).xyz, 0.0)).xyz;\n" \
   "  uv = vert_uv;\n"                                             \
   "}\n"
-#define FRAGMENT_SHADER                         \
-  "#version 330 core\n"                         \
-  "in vec2 uv;\n"                               \
-  "in vec3 normal_frag;\n"                      \
-  "out vec3 color;\n"                           \
-  "uniform sampler2D tex;\n"                    \
-  "void main() {\n"                             \
-  "  vec3 sun_dir = normalize(vec3(1,1,1));\n"  \
-  "  color = vec3(texture(tex, uv).a, 0, 0);\n" \
+#define FRAGMENT_SHADER                                                \
+  "#version 330 core\n"                                                \
+  "in vec2 uv;\n"                                                      \
+  "in vec3 normal_frag;\n"                                             \
+  "in vec3 world_position;\n"                                          \
+  "out vec3 color;\n"                                                  \
+  "uniform sampler2D tex;\n"                                           \
+  "uniform sampler2DArrayShadow shadow_map;\n"                         \
+  "layout(std140) uniform Frame {\n"                                   \
+  "  mat4 view;\n"                                                     \
+  "  mat4 projection;\n"                                               \
+  "  mat4 projection_view;\n"                                          \
+  "  vec4 camera_position;\n"                                          \
+  "};\n"                                                               \
+  "layout(std140) uniform Shadow {\n"                                  \
+  "  mat4 cascade_matrices[4];\n"                                      \
+  "  vec4 cascade_splits;\n"                                           \
+  "  vec4 light_direction;\n"                                          \
+  "  vec4 light_colour;\n"                                             \
+  "};\n"                                                               \
+  "float lit_fraction() {\n"                                           \
+  "  int cascade_count = int(light_direction.w);\n"                    \
+  "  float depth = -(view * vec4(world_position, 1.0)).z;\n"           \
+  "  if (cascade_count == 0 ||\n"                                      \
+  "      depth > cascade_splits[cascade_count - 1]) {\n"               \
+  "    return 1.0;\n"                                                  \
+  "  }\n"                                                              \
+  "  int cascade = 0;\n"                                               \
+  "  while (depth > cascade_splits[cascade]) {\n"                      \
+  "    cascade++;\n"                                                   \
+  "  }\n"                                                              \
+  "  vec4 shadow_position =\n"                                         \
+  "    cascade_matrices[cascade] * vec4(world_position, 1.0);\n"       \
+  "  return texture(shadow_map, vec4(shadow_position.xy, cascade,\n"   \
+  "                                  shadow_position.z));\n"           \
+  "}\n"                                                                \
+  "void main() {\n"                                                    \
+  "  vec3 albedo = vec3(texture(tex, uv).a, 0, 0);\n"                  \
+  "  float diffuse =\n"                                                \
+  "    max(dot(normalize(normal_frag), -light_direction.xyz), 0.0);\n" \
+  "  float lit = diffuse * lit_fraction();\n"                          \
+  "  color = albedo * (0.2 + light_colour.rgb * lit);\n"               \
   "}\n"
 
 absl::Status initResources() {
@@ -100,6 +160,9 @@ absl::Status initResources() {
   RETURN_IF_ERROR(ResourceLoader::Get().Add<Program>(
       "main_program",
       Program::Details{{"main_shader_vertex"}, {"main_shader_fragment"}}));
+  RETURN_IF_ERROR(ResourceLoader::Get().Add<Material>(
+      "main_material",
+      Material::Details{"main_program", {{"tex", "rtexture"}}}));
 
   RETURN_IF_ERROR(
       ResourceLoader::Get().Add<Mesh>("triangle_mesh", triangleMesh));
@@ -214,11 +277,13 @@ class PlayerControlSystem : public System {
     }
   }
 
-  void NotifyOfNodeAttachment(const std::shared_ptr<Node>& root) override {
-    player_nodes.AddTree(root);
+  void NotifyOfNodeTreeAttachment(
+      const std::vector<std::shared_ptr<Node>>& nodes) override {
+    player_nodes.Add(nodes);
   }
-  void NotifyOfNodeDetachment(const std::shared_ptr<Node>& root) override {
-    player_nodes.RemoveTree(root);
+  void NotifyOfNodeTreeDetachment(
+      const std::vector<std::shared_ptr<Node>>& nodes) override {
+    player_nodes.Remove(nodes);
   }
 
  private:
@@ -232,6 +297,9 @@ void glfw_error(int error, const char* description) {
 
 int main(int argc, char* argv[]) {
   google::InitGoogleLogging(argv[0]);
+  absl::ParseCommandLine(argc, argv);
+  const std::string trace_file = absl::GetFlag(FLAGS_trace_file);
+  Profiler::Get().SetEnabled(!trace_file.empty());
 
   if (!glfwInit()) {
     LOG(FATAL) << "Error initializing GLFW";
@@ -252,6 +320,10 @@ int main(int argc, char* argv[]) {
     return 1;
   }
 
+  // Keep processed resources around between runs so warm starts skip
+  // reparsing and decoding.
+  DerivedDataCache::Get().SetDirectory("derived_data");
+
   absl::Status status = initResources();
   if (!status.ok()) {
     LOG(FATAL) << "Failed to initialize resources: " << status;
@@ -259,7 +331,12 @@ int main(int argc, char* argv[]) {
   }
 
   std::shared_ptr<Engine> engine(new Engine());
-  engine->AddSuperSystem(std::make_shared<RenderSuperSystem>(window));
+  {
+    std::shared_ptr<RenderSuperSystem> render_system =
+        std::make_shared<RenderSuperSystem>(window);
+    render_system->render_thread = absl::GetFlag(FLAGS_render_thread);
+    engine->AddSuperSystem(render_system);
+  }
   {
     auto input_system = std::static_pointer_cast<InputSuperSystem>(
         engine->AddSuperSystem(std::make_shared<InputSuperSystem>(window)));
@@ -294,34 +371,24 @@ int main(int argc, char* argv[]) {
   world->CreateEmptyRoot();
   world->AddSystem(std::make_shared<PlayerControlSystem>());
 
-  std::shared_ptr<RenderableTexture> texture;
-  std::shared_ptr<Transform> camera_pivot;
-  std::shared_ptr<Camera> camera;
   {
-    std::shared_ptr<MeshRenderer> mesh_renderer(new MeshRenderer());
+    std::shared_ptr<DirectionalLight> sun = World::Spawn<DirectionalLight>();
+    sun->AttachTo(world->GetRoot());
+    sun->SetRotation(FromEuler(glm::vec3(-45, 45, 0)));
+  }
+  {
+    std::shared_ptr<MeshRenderer> mesh_renderer =
+        World::Spawn<MeshRenderer>();
     mesh_renderer->AttachTo(world->GetRoot());
     mesh_renderer->SetScale(glm::vec3(3, 3, 3));
     mesh_renderer->SetRotation(FromEuler(glm::vec3(-90, 90, 0)));
 
-    const absl::StatusOr<std::shared_ptr<Program>> material =
-        ResourceLoader::Get().Load<Program>("main_program");
+    const absl::StatusOr<std::shared_ptr<Material>> material =
+        ResourceLoader::Get().Load<Material>("main_material");
     if (!material.ok()) {
-      LOG(FATAL) << "Failed to load \"main_program\": " << material.status();
+      LOG(FATAL) << "Failed to load \"main_material\": " << material.status();
       return 1;
     }
-    (*material)->Use();
-    glUniform1i((*material)->GetUniformLocation("tex"), 0);
-    (*material)->SetUniformBlockBinding(
-        (*material)->GetUniformBlockIndex("Bones"), 0);
-
-    const absl::StatusOr<std::shared_ptr<RenderableTexture>> texture_status =
-        ResourceLoader::Get().Load<RenderableTexture>("rtexture");
-    if (!texture_status.ok()) {
-      LOG(FATAL) << "Failed to load \"rtexture\": " << texture_status.status();
-      return 1;
-    }
-    texture = *texture_status;
-    texture->Use(0);
     ResourceLoader::Get().IncrementLoadingDepth();
     {
       const absl::StatusOr<std::shared_ptr<RenderableMesh>> mesh =
@@ -353,19 +420,50 @@ int main(int argc, char* argv[]) {
     }
     ResourceLoader::Get().DecrementLoadingDepth();
 
-    camera_pivot = std::shared_ptr<Transform>(new Transform());
-    camera = std::shared_ptr<Camera>(new Camera());
-    camera->SetPosition(glm::vec3(0, 0, 5));
-    camera->AttachTo(camera_pivot);
-    camera_pivot->AttachTo(world->GetRoot());
+    Prefab player;
+    const uint32_t camera_pivot =
+        player.AddNode<Transform>(Prefab::kNoParent, "camera_pivot");
+    const uint32_t camera = player.AddNode<Camera>(camera_pivot, "camera");
+    player.SetTransform(camera, glm::vec3(0, 0, 5));
+    player.AddNode<PlayerControlSystem::PlayerNode>(camera, "player");
+    player.Instantiate(world->GetRoot());
+  }
 
-    std::shared_ptr<PlayerControlSystem::PlayerNode>(
-        new PlayerControlSystem::PlayerNode())
-        ->AttachTo(camera);
+  const std::string save_scene = absl::GetFlag(FLAGS_save_scene);
+  if (!save_scene.empty()) {
+    MeshRenderer::RegisterSceneNodeType();
+    SceneNodeTypes::Get().Register<PlayerControlSystem::PlayerNode>(
+        "PlayerNode",
+        [](const PlayerControlSystem::PlayerNode& node,
+           SceneFieldWriter& writer) {
+          writer.Write(node.look_sensitivity);
+          writer.Write(node.move_speed);
+          return absl::OkStatus();
+        },
+        [](PlayerControlSystem::PlayerNode& node, SceneFieldReader& reader) {
+          ASSIGN_OR_RETURN((node.look_sensitivity), reader.Read<float>());
+          ASSIGN_OR_RETURN((node.move_speed), reader.Read<float>());
+          return absl::OkStatus();
+        });
+    std::ofstream scene_file(save_scene,
+                             std::ios_base::binary | std::ios_base::out);
+    const absl::Status scene_status =
+        SceneWriter::Write(scene_file, world->GetRoot());
+    if (!scene_status.ok()) {
+      LOG(ERROR) << "Failed to save scene: " << scene_status;
+    }
   }
 
   engine->Run(window);
 
+  if (!trace_file.empty()) {
+    const absl::Status trace_status =
+        Profiler::Get().WriteChromeTrace(trace_file);
+    if (!trace_status.ok()) {
+      LOG(ERROR) << "Failed to write trace: " << trace_status;
+    }
+  }
+
   glfwDestroyWindow(window);
   glfwTerminate();
   return 0;
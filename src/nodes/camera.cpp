@@ -18,6 +18,10 @@ glm::mat4 Camera::GetProjectionMatrix(float aspect) const {
   }
 }
 
+glm::mat4 Camera::GetViewMatrix() const {
+  return glm::affineInverse(GetInterpolatedGlobalMatrix());
+}
+
 glm::mat4 Camera::GetProjectionView(float aspect) const {
-  return GetProjectionMatrix(aspect) * glm::affineInverse(GetGlobalMatrix());
+  return GetProjectionMatrix(aspect) * GetViewMatrix();
 }
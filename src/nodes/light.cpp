@@ -0,0 +1,93 @@
+
+#include "nodes/light.h"
+
+#include <algorithm>
+#include <cmath>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "resources/uniform_buffer.h"
+
+glm::vec3 DirectionalLight::GetDirection() const {
+  return glm::normalize(
+      glm::vec3(GetInterpolatedGlobalMatrix() * glm::vec4(0, 0, -1, 0)));
+}
+
+std::vector<ShadowCascade> DirectionalLight::ComputeCascades(
+    const Camera& camera, float aspect) const {
+  std::vector<ShadowCascade> cascades;
+  const int count = std::clamp(cascade_count, 1, kMaxShadowCascades);
+  const float view_near = camera.near;
+  const float view_far = std::min(camera.far, shadow_distance);
+  if (view_far <= view_near || shadow_resolution <= 0) {
+    return cascades;
+  }
+  const bool perspective =
+      camera.projection_type == Camera::Projection::Perspective;
+  // The squared distance from the view axis to the corners of the view, at a
+  // distance of 1 for perspective cameras or at any distance otherwise.
+  float corner_offset_squared;
+  if (perspective) {
+    const float tan_half_fov = std::tan(camera.fov * 3.14159f / 360.f);
+    corner_offset_squared =
+        tan_half_fov * tan_half_fov * (1.f + aspect * aspect);
+  } else {
+    const float half_size = 0.5f * camera.size;
+    corner_offset_squared = half_size * half_size * (1.f + aspect * aspect);
+  }
+
+  const glm::mat4 camera_matrix = camera.GetInterpolatedGlobalMatrix();
+  const glm::vec3 direction = GetDirection();
+  const glm::vec3 up = std::abs(direction.y) > 0.99f ? glm::vec3(0, 0, 1)
+                                                      : glm::vec3(0, 1, 0);
+  // Only rotates, so snapping in light space is the same wherever the light
+  // node is.
+  const glm::mat4 light_view = glm::lookAt(glm::vec3(0), direction, up);
+
+  cascades.reserve(count);
+  float slice_near = view_near;
+  for (int i = 0; i < count; i++) {
+    const float fraction = (float)(i + 1) / (float)count;
+    const float log_split =
+        view_near * std::pow(view_far / view_near, fraction);
+    const float even_split = view_near + (view_far - view_near) * fraction;
+    const float slice_far = even_split + (log_split - even_split) *
+                                             cascade_split_lambda;
+
+    // The smallest sphere around the slice. The slice is symmetric about the
+    // view axis, so the sphere is centred on it and its size does not depend
+    // on the camera's rotation.
+    float centre_distance, radius_squared;
+    if (perspective) {
+      centre_distance = std::min(
+          0.5f * (slice_near + slice_far) * (1.f + corner_offset_squared),
+          slice_far);
+      const float far_offset = slice_far - centre_distance;
+      radius_squared = far_offset * far_offset +
+                       slice_far * slice_far * corner_offset_squared;
+    } else {
+      centre_distance = 0.5f * (slice_near + slice_far);
+      const float half_depth = 0.5f * (slice_far - slice_near);
+      radius_squared = half_depth * half_depth + corner_offset_squared;
+    }
+    // Rounding keeps the radius identical between frames despite float error.
+    const float radius = std::ceil(std::sqrt(radius_squared) * 16.f) / 16.f;
+    const glm::vec3 centre =
+        glm::vec3(camera_matrix * glm::vec4(0, 0, -centre_distance, 1));
+
+    // Moving the cascade in whole texels keeps the texels over the same parts
+    // of the world as the camera moves.
+    const float texel_size = 2.f * radius / (float)shadow_resolution;
+    glm::vec3 light_centre = glm::vec3(light_view * glm::vec4(centre, 1));
+    light_centre.x = std::floor(light_centre.x / texel_size) * texel_size;
+    light_centre.y = std::floor(light_centre.y / texel_size) * texel_size;
+
+    const glm::mat4 projection = glm::ortho(
+        light_centre.x - radius, light_centre.x + radius,
+        light_centre.y - radius, light_centre.y + radius,
+        -light_centre.z - radius - shadow_caster_distance,
+        -light_centre.z + radius);
+    cascades.push_back({projection * light_view, slice_far});
+    slice_near = slice_far;
+  }
+  return cascades;
+}
@@ -3,18 +3,88 @@
 
 #include <glm/gtx/string_cast.hpp>
 
+#include "resources/resource.h"
+#include "resources/scene.h"
+
 void MeshRenderer::Render(
     const std::shared_ptr<RenderSuperSystem>& super_system,
     const std::shared_ptr<RenderSystem>& system,
     const glm::mat4& ProjectionView) {
+  const glm::mat4 model = GetInterpolatedGlobalMatrix();
+  const glm::mat4 model_view_projection = ProjectionView * model;
+  // Planes in local space, so mesh bounds can be tested untransformed.
+  const Frustum frustum(model_view_projection);
+  bool uniforms_bound = false;
   for (const MeshInfo& mesh_info : meshes) {
-    if (!mesh_info.mesh || !mesh_info.material) {
+    if (!mesh_info.mesh || !mesh_info.material ||
+        !mesh_info.mesh->IsUploaded() ||
+        !frustum.Intersects(mesh_info.mesh->GetBounds())) {
       continue;
     }
-    mesh_info.material->Use();
-    const glm::mat4 mvp = ProjectionView * GetGlobalMatrix();
-    glUniformMatrix4fv(mesh_info.material->GetUniformLocation("MVP"), 1, false,
-                       &mvp[0][0]);
-    mesh_info.mesh->Draw();
+    if (!uniforms_bound) {
+      super_system->BindObjectUniforms({model, model_view_projection});
+      uniforms_bound = true;
+    }
+    super_system->QueueDraw(mesh_info.material, mesh_info.mesh);
   }
 }
+
+void MeshRenderer::RenderSoftware(
+    const std::shared_ptr<SoftwareRenderSuperSystem>& super_system,
+    const glm::mat4& ProjectionView) {
+  const glm::mat4 model = GetInterpolatedGlobalMatrix();
+  const glm::mat4 model_view_projection = ProjectionView * model;
+  for (const MeshInfo& mesh_info : meshes) {
+    if (!mesh_info.mesh || !mesh_info.mesh->GetSourceMesh()) {
+      continue;
+    }
+    super_system->DrawMesh(*mesh_info.mesh->GetSourceMesh(), model,
+                           model_view_projection,
+                           mesh_info.software_material);
+  }
+}
+
+AABB MeshRenderer::GetLocalBounds() const {
+  AABB bounds;
+  for (const MeshInfo& info : meshes) {
+    if (info.mesh) {
+      bounds.Expand(info.mesh->GetBounds());
+    }
+  }
+  return bounds;
+}
+
+absl::Status WriteMeshRendererFields(const MeshRenderer& renderer,
+                                     SceneFieldWriter& writer) {
+  writer.Write<uint32_t>(renderer.meshes.size());
+  for (const MeshRenderer::MeshInfo& mesh_info : renderer.meshes) {
+    ASSIGN_OR_RETURN((const std::string& mesh),
+                     ResourceLoader::Get().GetName(mesh_info.mesh));
+    ASSIGN_OR_RETURN((const std::string& material),
+                     ResourceLoader::Get().GetName(mesh_info.material));
+    writer.WriteString(mesh);
+    writer.WriteString(material);
+  }
+  return absl::OkStatus();
+}
+
+absl::Status ReadMeshRendererFields(MeshRenderer& renderer,
+                                    SceneFieldReader& reader) {
+  ASSIGN_OR_RETURN((const uint32_t mesh_count), reader.Read<uint32_t>());
+  for (uint32_t i = 0; i < mesh_count; i++) {
+    ASSIGN_OR_RETURN((const std::string& mesh_name), reader.ReadString());
+    ASSIGN_OR_RETURN((const std::string& material_name), reader.ReadString());
+    ASSIGN_OR_RETURN(
+        (std::shared_ptr<RenderableMesh> mesh),
+        ResourceLoader::Get().Load<RenderableMesh>(mesh_name));
+    ASSIGN_OR_RETURN((std::shared_ptr<Material> material),
+                     ResourceLoader::Get().Load<Material>(material_name));
+    renderer.meshes.push_back({std::move(mesh), std::move(material)});
+  }
+  return absl::OkStatus();
+}
+
+void MeshRenderer::RegisterSceneNodeType() {
+  SceneNodeTypes::Get().Register<MeshRenderer>(
+      "MeshRenderer", WriteMeshRendererFields, ReadMeshRendererFields);
+}
@@ -9,8 +9,9 @@
 
 void Node::AttachNode(const std::shared_ptr<Node>& child, int index) {
   CHECK(child.get() && !child->GetParent().get());
-  child->world = GetWorld();
-  child->parent = this->shared_from_this();
+  const std::shared_ptr<Node> self = this->shared_from_this();
+  const std::shared_ptr<World> world = GetWorld();
+  child->parent = self;
   if (index < 0) {
     index += children.size() + 1;
     CHECK(index >= 0);
@@ -19,29 +20,34 @@ void Node::AttachNode(const std::shared_ptr<Node>& child, int index) {
   }
   children.insert(children.begin() + index, child);
 
-  for (const std::shared_ptr<Node>& node : CollectPreOrderNodes(child)) {
-    node->NotifyOfAncestorAttachment(this->shared_from_this(), child);
+  const std::vector<std::shared_ptr<Node>> nodes = CollectPreOrderNodes(child);
+  if (world) {
+    world->RegisterNodes(nodes);
+  }
+  for (const std::shared_ptr<Node>& node : nodes) {
+    node->NotifyOfAncestorAttachment(self, child);
   }
 
-  const std::shared_ptr<World> world = GetWorld();
   if (world) {
-    world->PropagateNodeAttachment(child);
+    world->PropagateNodeAttachment(nodes);
   }
 }
 
 void Node::DetachNode(const std::shared_ptr<Node>& child) {
   CHECK(child.get() && child->GetParent().get() == this);
+  const std::shared_ptr<Node> self = this->shared_from_this();
+  const std::shared_ptr<World> world = GetWorld();
 
-  for (const std::shared_ptr<Node>& node : CollectPreOrderNodes(child)) {
-    node->NotifyOfAncestorDetachment(this->shared_from_this(), child);
+  const std::vector<std::shared_ptr<Node>> nodes = CollectPreOrderNodes(child);
+  for (const std::shared_ptr<Node>& node : nodes) {
+    node->NotifyOfAncestorDetachment(self, child);
   }
 
-  const std::shared_ptr<World> world = GetWorld();
   if (world) {
-    world->PropagateNodeAttachment(child);
+    world->PropagateNodeDetachment(nodes);
+    world->UnregisterNodes(nodes);
   }
 
-  child->world = std::shared_ptr<World>();
   child->parent = std::shared_ptr<Node>();
   const auto node_it = std::find(children.begin(), children.end(), child);
   children.erase(node_it);
@@ -67,10 +73,19 @@ std::vector<std::shared_ptr<Node>> Node::GetAncestry() const {
   return ancestors;
 }
 
+NodeTypeMask Node::GetTypeMask() const {
+  const uint32_t tag_count = GetNodeTypeTagCount();
+  if (type_mask_tag_count != tag_count) {
+    type_mask = ComputeNodeTypeMask(*this, tag_count);
+    type_mask_tag_count = tag_count;
+  }
+  return type_mask;
+}
+
 std::shared_ptr<World> Node::GetWorld() const { return world.lock(); }
 
 std::shared_ptr<Node> Node::GetParent() const { return parent.lock(); }
 
-const std::vector<std::shared_ptr<Node>>& Node::GetChildren() const {
+const Node::ChildList& Node::GetChildren() const {
   return children;
 }
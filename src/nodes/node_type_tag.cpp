@@ -0,0 +1,63 @@
+
+#include "nodes/node_type_tag.h"
+
+#include <absl/container/flat_hash_map.h>
+#include <glog/logging.h>
+
+#include <atomic>
+#include <mutex>
+#include <typeindex>
+
+#include "nodes/node.h"
+
+struct NodeTypeTags {
+  std::mutex mutex;
+  bool (*matchers[kMaxNodeTypeTags])(const Node& node);
+  std::atomic<uint32_t> count{0};
+
+  struct ClassMask {
+    NodeTypeMask mask;
+    // The number of tags `mask` was computed for.
+    uint32_t tag_count;
+  };
+  absl::flat_hash_map<std::type_index, ClassMask> class_masks;
+};
+
+NodeTypeTags& GetNodeTypeTags() {
+  static NodeTypeTags* tags = new NodeTypeTags();
+  return *tags;
+}
+
+NodeTypeMask RegisterNodeTypeTag(bool (*matches)(const Node& node)) {
+  NodeTypeTags& tags = GetNodeTypeTags();
+  std::lock_guard<std::mutex> lock(tags.mutex);
+  const uint32_t index = tags.count.load(std::memory_order_relaxed);
+  CHECK(index < kMaxNodeTypeTags)
+      << "Too many node type tags; at most " << kMaxNodeTypeTags
+      << " are supported.";
+  tags.matchers[index] = matches;
+  tags.count.store(index + 1, std::memory_order_release);
+  return NodeTypeMask(1) << index;
+}
+
+uint32_t GetNodeTypeTagCount() {
+  return GetNodeTypeTags().count.load(std::memory_order_acquire);
+}
+
+NodeTypeMask ComputeNodeTypeMask(const Node& node, uint32_t tag_count) {
+  NodeTypeTags& tags = GetNodeTypeTags();
+  std::lock_guard<std::mutex> lock(tags.mutex);
+  NodeTypeTags::ClassMask& class_mask =
+      tags.class_masks.try_emplace(std::type_index(typeid(node)),
+                                   NodeTypeTags::ClassMask{0, 0})
+          .first->second;
+  for (; class_mask.tag_count < tag_count; class_mask.tag_count++) {
+    if (tags.matchers[class_mask.tag_count](node)) {
+      class_mask.mask |= NodeTypeMask(1) << class_mask.tag_count;
+    }
+  }
+  // The class may have been computed for more tags than requested.
+  return class_mask.mask & (tag_count == kMaxNodeTypeTags
+                                ? ~NodeTypeMask(0)
+                                : (NodeTypeMask(1) << tag_count) - 1);
+}
@@ -0,0 +1,74 @@
+
+#include "nodes/rigid_body.h"
+
+#include "systems/physics_system.h"
+
+void RigidBody::SetShape(const CollisionShape& value) {
+  shape = value;
+  if (system) {
+    system->ReadBodyProperties(body_index);
+  }
+}
+
+void RigidBody::SetMass(float value) {
+  mass = value;
+  if (system) {
+    system->ReadBodyProperties(body_index);
+  }
+}
+
+void RigidBody::SetFriction(float value) {
+  friction = value;
+  if (system) {
+    system->ReadBodyProperties(body_index);
+  }
+}
+
+void RigidBody::SetRestitution(float value) {
+  restitution = value;
+  if (system) {
+    system->ReadBodyProperties(body_index);
+  }
+}
+
+glm::vec3 RigidBody::GetLinearVelocity() const {
+  return system ? system->bodies.linear_velocities[body_index]
+                : linear_velocity;
+}
+
+void RigidBody::SetLinearVelocity(const glm::vec3& value) {
+  if (system) {
+    system->bodies.linear_velocities[body_index] = value;
+  } else {
+    linear_velocity = value;
+  }
+}
+
+glm::vec3 RigidBody::GetAngularVelocity() const {
+  return system ? system->bodies.angular_velocities[body_index]
+                : angular_velocity;
+}
+
+void RigidBody::SetAngularVelocity(const glm::vec3& value) {
+  if (system) {
+    system->bodies.angular_velocities[body_index] = value;
+  } else {
+    angular_velocity = value;
+  }
+}
+
+void RigidBody::ApplyImpulse(const glm::vec3& impulse,
+                             const glm::vec3& point) {
+  if (mass <= 0) {
+    return;
+  }
+  const glm::vec3 center =
+      system ? system->bodies.positions[body_index] : GetGlobalPosition();
+  const glm::quat rotation =
+      system ? system->bodies.rotations[body_index] : GetGlobalRotation();
+  const glm::mat3 inverse_inertia =
+      GetWorldInverseInertia(GetInverseInertia(shape, mass), rotation);
+  SetLinearVelocity(GetLinearVelocity() + impulse / mass);
+  SetAngularVelocity(GetAngularVelocity() +
+                     inverse_inertia * glm::cross(point - center, impulse));
+}
@@ -6,7 +6,9 @@
 #include <glm/gtx/quaternion.hpp>
 #include <glm/gtx/string_cast.hpp>
 
+#include "engine.h"
 #include "nodes/utility.h"
+#include "world.h"
 
 glm::mat4 TRSMatrix(const glm::vec3& translation, const glm::quat& rotation,
                     const glm::vec3& scale) {
@@ -25,44 +27,22 @@ glm::vec3 Transform::GetScale() const { return scale; }
 glm::mat4 Transform::GetMatrix() const { return *matrix; }
 
 void Transform::SetPosition(const glm::vec3& value) {
+  SnapshotState();
   position = value;
   matrix.Invalidate();
-  for (const std::shared_ptr<Node>& child :
-       CollectPreOrderNodes(this->shared_from_this())) {
-    const std::shared_ptr<Transform> child_transform =
-        std::dynamic_pointer_cast<Transform>(child);
-    if (!child_transform) {
-      continue;
-    }
-    child_transform->global_matrix.Invalidate();
-  }
+  InvalidateSubtree(false);
 }
 void Transform::SetRotation(const glm::quat& value) {
+  SnapshotState();
   rotation = value;
   matrix.Invalidate();
-  for (const std::shared_ptr<Node>& child :
-       CollectPreOrderNodes(this->shared_from_this())) {
-    const std::shared_ptr<Transform> child_transform =
-        std::dynamic_pointer_cast<Transform>(child);
-    if (!child_transform) {
-      continue;
-    }
-    child_transform->global_matrix.Invalidate();
-    child_transform->global_rotation.Invalidate();
-  }
+  InvalidateSubtree(true);
 }
 void Transform::SetScale(const glm::vec3& value) {
+  SnapshotState();
   scale = value;
   matrix.Invalidate();
-  for (const std::shared_ptr<Node>& child :
-       CollectPreOrderNodes(this->shared_from_this())) {
-    const std::shared_ptr<Transform> child_transform =
-        std::dynamic_pointer_cast<Transform>(child);
-    if (!child_transform) {
-      continue;
-    }
-    child_transform->global_matrix.Invalidate();
-  }
+  InvalidateSubtree(false);
 }
 
 glm::vec3 Transform::GetGlobalPosition() const {
@@ -82,6 +62,7 @@ glm::vec3 Transform::GetLossyScale() const {
 glm::mat4 Transform::GetGlobalMatrix() const { return *global_matrix; }
 
 void Transform::SetGlobalPosition(const glm::vec3& value) {
+  SnapshotState();
   const std::shared_ptr<Transform> parent = this->GetParentTransform();
   if (parent) {
     position = glm::vec3(glm::inverse(parent->GetGlobalMatrix()) *
@@ -90,18 +71,11 @@ void Transform::SetGlobalPosition(const glm::vec3& value) {
     position = value;
   }
   matrix.Invalidate();
-  for (const std::shared_ptr<Node>& child :
-       CollectPreOrderNodes(this->shared_from_this())) {
-    const std::shared_ptr<Transform> child_transform =
-        std::dynamic_pointer_cast<Transform>(child);
-    if (!child_transform) {
-      continue;
-    }
-    child_transform->global_matrix.Invalidate();
-  }
+  InvalidateSubtree(false);
 }
 
 void Transform::SetGlobalRotation(const glm::quat& value) {
+  SnapshotState();
   const std::shared_ptr<Transform> parent = this->GetParentTransform();
   if (parent) {
     rotation = glm::inverse(parent->GetGlobalRotation()) * value;
@@ -109,6 +83,67 @@ void Transform::SetGlobalRotation(const glm::quat& value) {
     rotation = value;
   }
   matrix.Invalidate();
+  InvalidateSubtree(true);
+}
+
+void Transform::SetGlobalPose(const glm::vec3& global_position,
+                              const glm::quat& global_rotation_) {
+  SnapshotState();
+  const std::shared_ptr<Transform> parent = this->GetParentTransform();
+  if (parent) {
+    position = glm::vec3(glm::inverse(parent->GetGlobalMatrix()) *
+                         glm::vec4(global_position, 1.0));
+    rotation = glm::inverse(parent->GetGlobalRotation()) * global_rotation_;
+  } else {
+    position = global_position;
+    rotation = global_rotation_;
+  }
+  matrix.Invalidate();
+  InvalidateSubtree(true);
+}
+
+// Returns the engine `transform` is simulated by, or null if it is not in a
+// world.
+std::shared_ptr<Engine> GetTransformEngine(const Transform* transform) {
+  const std::shared_ptr<World> world = transform->GetWorld();
+  return world ? world->GetEngine() : nullptr;
+}
+
+void Transform::SnapshotState() {
+  const std::shared_ptr<Engine> engine = GetTransformEngine(this);
+  if (!engine || !engine->IsInFixedUpdate()) {
+    // Changes outside fixed updates, such as from Update, take effect
+    // immediately rather than blending from a pose that may be frames old.
+    snapshot_fixed_update = kNoSnapshot;
+    return;
+  }
+  const uint64_t fixed_update = engine->GetFixedUpdateCount();
+  if (snapshot_fixed_update == fixed_update) {
+    return;
+  }
+  snapshot_fixed_update = fixed_update;
+  previous_position = position;
+  previous_rotation = rotation;
+  previous_scale = scale;
+}
+
+void Transform::InvalidateGlobal(bool rotation_changed) {
+  global_matrix.Invalidate();
+  interpolated_frame = ~0ULL;
+  if (rotation_changed) {
+    global_rotation.Invalidate();
+  }
+  if (listener) {
+    listener->NotifyOfGlobalTransformChange(*this);
+  }
+}
+
+void Transform::InvalidateSubtree(bool rotation_changed) {
+  // Most transforms are leaves, which do not need the traversal.
+  if (GetChildren().empty()) {
+    InvalidateGlobal(rotation_changed);
+    return;
+  }
   for (const std::shared_ptr<Node>& child :
        CollectPreOrderNodes(this->shared_from_this())) {
     const std::shared_ptr<Transform> child_transform =
@@ -116,11 +151,41 @@ void Transform::SetGlobalRotation(const glm::quat& value) {
     if (!child_transform) {
       continue;
     }
-    child_transform->global_matrix.Invalidate();
-    child_transform->global_rotation.Invalidate();
+    child_transform->InvalidateGlobal(rotation_changed);
   }
 }
 
+glm::mat4 Transform::GetInterpolatedMatrix() const {
+  const std::shared_ptr<Engine> engine = GetTransformEngine(this);
+  // The state is only in motion if it last changed during the latest fixed
+  // update. The sentinel is checked on its own, since it wraps to 0 and would
+  // otherwise match before the first fixed update.
+  if (!engine || snapshot_fixed_update == kNoSnapshot ||
+      snapshot_fixed_update + 1 != engine->GetFixedUpdateCount()) {
+    return GetMatrix();
+  }
+  const float alpha = engine->GetFixedUpdateAlpha();
+  return TRSMatrix(glm::mix(previous_position, position, alpha),
+                   glm::slerp(previous_rotation, rotation, alpha),
+                   glm::mix(previous_scale, scale, alpha));
+}
+
+glm::mat4 Transform::GetInterpolatedGlobalMatrix() const {
+  const std::shared_ptr<Engine> engine = GetTransformEngine(this);
+  if (!engine) {
+    return GetGlobalMatrix();
+  }
+  if (interpolated_frame == engine->GetFrameCount()) {
+    return interpolated_global_matrix;
+  }
+  const std::shared_ptr<Transform> parent = GetParentTransform();
+  interpolated_global_matrix =
+      parent ? parent->GetInterpolatedGlobalMatrix() * GetInterpolatedMatrix()
+             : GetInterpolatedMatrix();
+  interpolated_frame = engine->GetFrameCount();
+  return interpolated_global_matrix;
+}
+
 std::shared_ptr<Transform> Transform::GetParentTransform() const {
   return GetFirstTransform(GetParent());
 }
@@ -150,15 +215,13 @@ void Transform::DetachNode(const std::shared_ptr<Node>& child) {
 void Transform::NotifyOfAncestorAttachment(
     const std::shared_ptr<Node>& new_parent,
     const std::shared_ptr<Node>& root_ancestor) {
-  global_matrix.Invalidate();
-  global_rotation.Invalidate();
+  InvalidateGlobal(true);
 }
 
 void Transform::NotifyOfAncestorDetachment(
     const std::shared_ptr<Node>& parent,
     const std::shared_ptr<Node>& root_ancestor) {
-  global_matrix.Invalidate();
-  global_rotation.Invalidate();
+  InvalidateGlobal(true);
 }
 
 glm::mat4 Transform::ComputeMatrix(const Transform* transform) {
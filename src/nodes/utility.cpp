@@ -1,6 +1,8 @@
 
 #include "nodes/utility.h"
 
+#include <absl/container/flat_hash_set.h>
+
 #include <functional>
 
 void TraversePreOrder(const std::shared_ptr<Node>& node,
@@ -32,3 +34,22 @@ std::vector<std::shared_ptr<Node>> CollectPostOrderNodes(
   TraversePostOrder(root, nodes);
   return nodes;
 }
+
+std::vector<std::shared_ptr<Node>> CollectSubtreeRoots(
+    const std::vector<std::shared_ptr<Node>>& nodes) {
+  if (nodes.size() == 1) {
+    return nodes;
+  }
+  absl::flat_hash_set<const Node*> node_set;
+  node_set.reserve(nodes.size());
+  for (const std::shared_ptr<Node>& node : nodes) {
+    node_set.insert(node.get());
+  }
+  std::vector<std::shared_ptr<Node>> roots;
+  for (const std::shared_ptr<Node>& node : nodes) {
+    if (!node_set.contains(node->GetParent().get())) {
+      roots.push_back(node);
+    }
+  }
+  return roots;
+}
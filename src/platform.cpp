@@ -0,0 +1,34 @@
+
+#include "platform.h"
+
+#include <algorithm>
+#include <thread>
+
+SteadyClock::SteadyClock() : start(std::chrono::steady_clock::now()) {}
+
+double SteadyClock::Now() {
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                       start)
+      .count();
+}
+
+void SteadyClock::SleepUntil(double time) {
+  const double sleep_seconds = time - Now() - spin_seconds;
+  if (sleep_seconds > 0) {
+    std::this_thread::sleep_for(std::chrono::duration<double>(sleep_seconds));
+  }
+  while (Now() < time) {
+    std::this_thread::yield();
+  }
+}
+
+void ManualClock::SleepUntil(double time_) { time = std::max(time, time_); }
+
+GlfwPlatform::GlfwPlatform(GLFWwindow* window_) : window(window_) {}
+
+bool GlfwPlatform::ShouldQuit() { return glfwWindowShouldClose(window); }
+
+void GlfwPlatform::PollEvents() { glfwPollEvents(); }
+
+HeadlessPlatform::HeadlessPlatform(std::unique_ptr<Clock> clock_)
+    : clock(clock_ ? std::move(clock_) : std::make_unique<SteadyClock>()) {}
@@ -0,0 +1,168 @@
+
+#include "resources/derived_cache.h"
+
+#include <glog/logging.h>
+
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+
+#include "utility/status.h"
+
+DerivedDataCache DerivedDataCache::instance;
+
+// Defines the header of every cache entry.
+struct EntryHeader {
+  // Bytes to identify whether or not this is a cache entry.
+  char cache_id[4];
+  uint32_t loader_version;
+  uint64_t source_hash;
+  // Length of the processed data.
+  uint64_t data_length;
+  // Hash of the processed data, to detect truncated or corrupt entries.
+  uint64_t data_hash;
+};
+
+void DerivedDataCache::SetDirectory(const std::string& directory_) {
+  directory = directory_;
+  if (directory.empty()) {
+    return;
+  }
+  std::error_code error;
+  std::filesystem::create_directories(directory, error);
+  if (error) {
+    LOG(WARNING) << "Failed to create derived data cache directory \""
+                 << directory << "\": " << error.message();
+    directory.clear();
+  }
+}
+
+const std::string& DerivedDataCache::GetDirectory() const { return directory; }
+
+bool DerivedDataCache::IsEnabled() const { return !directory.empty(); }
+
+absl::StatusOr<std::vector<unsigned char>> DerivedDataCache::Read(
+    const Key& key) const {
+  if (!IsEnabled()) {
+    return absl::NotFoundError("Derived data cache is disabled");
+  }
+  const std::string path = GetEntryPath(key);
+  std::ifstream file(path, std::ios_base::binary | std::ios_base::in);
+  if (!file.is_open()) {
+    return absl::NotFoundError(
+        STATUS_MESSAGE("No cache entry \"" << path << "\""));
+  }
+
+  EntryHeader header;
+  file.read((char*)&header, sizeof(EntryHeader));
+  if (file.gcount() != sizeof(EntryHeader) ||
+      memcmp(header.cache_id, "SDDC", 4) != 0) {
+    return absl::NotFoundError(
+        STATUS_MESSAGE("Cache entry \"" << path << "\" has a bad header"));
+  }
+  // Different keys can map to the same file name, so make sure this entry is
+  // actually for `key`.
+  if (header.loader_version != key.loader_version ||
+      header.source_hash != key.source_hash) {
+    return absl::NotFoundError(
+        STATUS_MESSAGE("Cache entry \"" << path << "\" is stale"));
+  }
+
+  // Entries are exactly a header followed by the data, so a length that does
+  // not match the file is corrupt. Checking before allocating keeps a bad
+  // length from allocating arbitrarily large buffers.
+  std::error_code error;
+  const uintmax_t file_size = std::filesystem::file_size(path, error);
+  if (error || file_size - sizeof(EntryHeader) != header.data_length) {
+    return absl::NotFoundError(
+        STATUS_MESSAGE("Cache entry \"" << path << "\" has a bad length"));
+  }
+
+  std::vector<unsigned char> data;
+  data.resize(header.data_length);
+  file.read((char*)data.data(), header.data_length);
+  if ((uint64_t)file.gcount() != header.data_length ||
+      Hash(data.data(), data.size()) != header.data_hash) {
+    return absl::NotFoundError(
+        STATUS_MESSAGE("Cache entry \"" << path << "\" is corrupt"));
+  }
+  return data;
+}
+
+absl::Status DerivedDataCache::Write(
+    const Key& key, const std::vector<unsigned char>& data) const {
+  if (!IsEnabled()) {
+    return absl::OkStatus();
+  }
+  const std::string path = GetEntryPath(key);
+  // Write to a temporary file first so a crash or a concurrent reader never
+  // sees a partially written entry.
+  const std::string temp_path = path + ".tmp";
+  {
+    std::ofstream file(temp_path, std::ios_base::binary | std::ios_base::out |
+                                      std::ios_base::trunc);
+    if (!file.is_open()) {
+      return absl::FailedPreconditionError(
+          STATUS_MESSAGE("Failed to open file \"" << temp_path << "\""));
+    }
+    EntryHeader header = {{'S', 'D', 'D', 'C'},
+                          key.loader_version,
+                          key.source_hash,
+                          data.size(),
+                          Hash(data.data(), data.size())};
+    file.write((const char*)&header, sizeof(EntryHeader));
+    file.write((const char*)data.data(), data.size());
+    if (file.bad()) {
+      return absl::UnknownError(
+          STATUS_MESSAGE("Failed to write file \"" << temp_path << "\""));
+    }
+  }
+  std::error_code error;
+  std::filesystem::rename(temp_path, path, error);
+  if (error) {
+    return absl::UnknownError(STATUS_MESSAGE("Failed to move \""
+                                             << temp_path << "\" to \"" << path
+                                             << "\": " << error.message()));
+  }
+  return absl::OkStatus();
+}
+
+uint64_t DerivedDataCache::Hash(const void* data, size_t length,
+                                uint64_t seed) {
+  // 64-bit FNV-1a. Unlike absl::Hash, this is stable across runs.
+  const unsigned char* bytes = static_cast<const unsigned char*>(data);
+  uint64_t hash = seed;
+  for (size_t i = 0; i < length; i++) {
+    hash ^= bytes[i];
+    hash *= 0x100000001b3ULL;
+  }
+  return hash;
+}
+
+uint64_t DerivedDataCache::Hash(const std::string& data, uint64_t seed) {
+  return Hash(data.data(), data.size(), seed);
+}
+
+absl::StatusOr<uint64_t> DerivedDataCache::HashFile(const std::string& path,
+                                                    std::string& contents) {
+  std::ifstream file(path, std::ios_base::binary | std::ios_base::in);
+  if (!file.is_open()) {
+    return absl::NotFoundError(
+        STATUS_MESSAGE("Failed to read file \"" << path << "\""));
+  }
+  std::stringstream stream;
+  stream << file.rdbuf();
+  contents = stream.str();
+  return Hash(contents);
+}
+
+std::string DerivedDataCache::GetEntryPath(const Key& key) const {
+  const uint64_t key_hash =
+      Hash(&key.loader_version, sizeof(key.loader_version),
+           Hash(&key.source_hash, sizeof(key.source_hash)));
+  const std::string file_name =
+      STATUS_MESSAGE(key.loader << "-" << std::hex << std::setw(16)
+                                << std::setfill('0') << key_hash << ".ddc");
+  return (std::filesystem::path(directory) / file_name).generic_string();
+}
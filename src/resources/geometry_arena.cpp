@@ -0,0 +1,170 @@
+
+#include "resources/geometry_arena.h"
+
+#include <glog/logging.h>
+
+#include <algorithm>
+#include <numeric>
+
+#include "resources/mesh.h"
+#include "resources/skin.h"
+#include "resources/uniform_buffer.h"
+
+// Initial capacities, in vertices and indices, of each arena.
+constexpr GLuint kInitialVertexCapacity = 1 << 16;
+constexpr GLuint kInitialIndexCapacity = 1 << 18;
+
+// Copies the first `size` bytes of `buffer` into a new buffer of
+// `new_size` bytes, deletes `buffer` and returns the new buffer.
+GLuint ReallocateBuffer(GLuint buffer, GLsizeiptr size, GLsizeiptr new_size) {
+  GLuint new_buffer;
+  glGenBuffers(1, &new_buffer);
+  glBindBuffer(GL_COPY_WRITE_BUFFER, new_buffer);
+  glBufferData(GL_COPY_WRITE_BUFFER, new_size, nullptr, GL_STATIC_DRAW);
+  if (buffer && size > 0) {
+    glBindBuffer(GL_COPY_READ_BUFFER, buffer);
+    glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, size);
+  }
+  glDeleteBuffers(1, &buffer);
+  return new_buffer;
+}
+
+GeometryArena& GeometryArena::Get(Layout layout) {
+  // Arenas are intentionally leaked, since the GL context is gone by the time
+  // static destructors run.
+  static GeometryArena* arenas[2] = {};
+  GeometryArena*& arena = arenas[(int)layout];
+  if (!arena) {
+    arena = new GeometryArena(layout);
+  }
+  return *arena;
+}
+
+GeometryArena::GeometryArena(Layout layout_) : layout(layout_) {
+  vertex_strides.push_back(sizeof(Mesh::Vertex));
+  if (layout == Layout::Skinned) {
+    vertex_strides.push_back(sizeof(Skin::Vertex));
+  }
+  vertex_buffers.resize(vertex_strides.size(), 0);
+
+  glGenVertexArrays(1, &vao);
+  glBindVertexArray(vao);
+  // Attribute arrays are part of the VAO's state, so they only need enabling
+  // once.
+  const GLuint attribute_count = layout == Layout::Skinned ? 8 : 6;
+  for (GLuint i = 0; i < attribute_count; i++) {
+    glEnableVertexAttribArray(i);
+  }
+  // The object index advances once per instance, so each draw reads the
+  // element at its base instance.
+  GLuint object_indices[kMaxBatchObjects];
+  std::iota(object_indices, object_indices + kMaxBatchObjects, 0u);
+  glGenBuffers(1, &object_index_buffer);
+  glBindBuffer(GL_ARRAY_BUFFER, object_index_buffer);
+  glBufferData(GL_ARRAY_BUFFER, sizeof(object_indices), object_indices,
+               GL_STATIC_DRAW);
+  glEnableVertexAttribArray(kObjectIndexAttribute);
+  glVertexAttribIPointer(kObjectIndexAttribute, 1, GL_UNSIGNED_INT, 0,
+                         nullptr);
+  glVertexAttribDivisor(kObjectIndexAttribute, 1);
+  GrowVertices(kInitialVertexCapacity);
+  GrowIndices(kInitialIndexCapacity);
+}
+
+GeometryArena::Range GeometryArena::Allocate(
+    const std::vector<const void*>& streams, GLuint vertex_count,
+    const GLuint* index_data, GLuint index_count) {
+  CHECK_EQ(streams.size(), vertex_buffers.size());
+  Range range;
+  if (vertex_count == 0 || index_count == 0) {
+    return range;
+  }
+  range.vertex_count = vertex_count;
+  range.index_count = index_count;
+
+  std::lock_guard<std::mutex> lock(allocator_mutex);
+  uint64_t vertex_offset = vertices.Allocate(vertex_count);
+  if (vertex_offset == RangeAllocator::kInvalidOffset) {
+    GrowVertices(std::max<uint64_t>(vertices.GetCapacity() * 2,
+                                    vertices.GetCapacity() + vertex_count));
+    vertex_offset = vertices.Allocate(vertex_count);
+  }
+  uint64_t index_offset = indices.Allocate(index_count);
+  if (index_offset == RangeAllocator::kInvalidOffset) {
+    GrowIndices(std::max<uint64_t>(indices.GetCapacity() * 2,
+                                   indices.GetCapacity() + index_count));
+    index_offset = indices.Allocate(index_count);
+  }
+  range.base_vertex = vertex_offset;
+  range.first_index = index_offset;
+
+  for (size_t i = 0; i < vertex_buffers.size(); i++) {
+    glBindBuffer(GL_ARRAY_BUFFER, vertex_buffers[i]);
+    glBufferSubData(GL_ARRAY_BUFFER, vertex_offset * vertex_strides[i],
+                    (GLsizeiptr)vertex_count * vertex_strides[i], streams[i]);
+  }
+  glBindBuffer(GL_COPY_WRITE_BUFFER, index_buffer);
+  glBufferSubData(GL_COPY_WRITE_BUFFER, index_offset * sizeof(GLuint),
+                  (GLsizeiptr)index_count * sizeof(GLuint), index_data);
+  return range;
+}
+
+void GeometryArena::Free(const Range& range) {
+  std::lock_guard<std::mutex> lock(allocator_mutex);
+  vertices.Free(range.base_vertex, range.vertex_count);
+  indices.Free(range.first_index, range.index_count);
+}
+
+DrawElementsIndirectCommand GeometryArena::GetDrawCommand(const Range& range) {
+  return {range.index_count, 1, range.first_index, (GLint)range.base_vertex,
+          0};
+}
+
+GLuint GeometryArena::GetVertexArray() const { return vao; }
+
+GeometryArena::Layout GeometryArena::GetLayout() const { return layout; }
+
+void GeometryArena::GrowVertices(GLuint vertex_capacity) {
+  for (size_t i = 0; i < vertex_buffers.size(); i++) {
+    const GLsizeiptr stride = vertex_strides[i];
+    vertex_buffers[i] =
+        ReallocateBuffer(vertex_buffers[i], vertices.GetCapacity() * stride,
+                         vertex_capacity * stride);
+  }
+  vertices.Grow(vertex_capacity);
+  BindAttributes();
+}
+
+void GeometryArena::GrowIndices(GLuint index_capacity) {
+  index_buffer = ReallocateBuffer(
+      index_buffer, (GLsizeiptr)indices.GetCapacity() * sizeof(GLuint),
+      (GLsizeiptr)index_capacity * sizeof(GLuint));
+  indices.Grow(index_capacity);
+  glBindVertexArray(vao);
+  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, index_buffer);
+}
+
+void GeometryArena::BindAttributes() {
+  glBindVertexArray(vao);
+  const GLsizei stride = sizeof(Mesh::Vertex);
+  glBindBuffer(GL_ARRAY_BUFFER, vertex_buffers[0]);
+  glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, stride,
+                        (void*)offsetof(Mesh::Vertex, position));
+  glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, stride,
+                        (void*)offsetof(Mesh::Vertex, texCoord));
+  glVertexAttribPointer(2, 4, GL_FLOAT, GL_FALSE, stride,
+                        (void*)offsetof(Mesh::Vertex, colour));
+  glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, stride,
+                        (void*)offsetof(Mesh::Vertex, normal));
+  glVertexAttribPointer(4, 3, GL_FLOAT, GL_FALSE, stride,
+                        (void*)offsetof(Mesh::Vertex, tangent));
+  glVertexAttribPointer(5, 3, GL_FLOAT, GL_FALSE, stride,
+                        (void*)offsetof(Mesh::Vertex, bitangent));
+  if (layout == Layout::Skinned) {
+    glBindBuffer(GL_ARRAY_BUFFER, vertex_buffers[1]);
+    glVertexAttribPointer(6, 4, GL_FLOAT, GL_FALSE, sizeof(Skin::Vertex),
+                          (void*)offsetof(Skin::Vertex, weights));
+    glVertexAttribIPointer(7, 4, GL_UNSIGNED_SHORT, sizeof(Skin::Vertex),
+                           (void*)offsetof(Skin::Vertex, bone_indices));
+  }
+}
@@ -0,0 +1,77 @@
+
+#include "resources/material.h"
+
+#include "resources/uniform_buffer.h"
+#include "utility/status.h"
+
+// Binds the block named `name` of `program` to `binding`, if it has one.
+void BindBlock(Program& program, const std::string& name,
+               UniformBinding binding) {
+  const Program::UniformBlockInfo* block = program.GetUniformBlock(name);
+  if (block) {
+    program.SetUniformBlockBinding(block->index, (GLuint)binding);
+  }
+}
+
+absl::StatusOr<std::shared_ptr<Material>> Material::Load(
+    const Details& details) {
+  std::shared_ptr<Material> material(new Material());
+  ASSIGN_OR_RETURN((material->program), details.program.Get());
+
+  BindBlock(*material->program, "Frame", UniformBinding::Frame);
+  BindBlock(*material->program, "Material", UniformBinding::Material);
+  BindBlock(*material->program, "Object", UniformBinding::Object);
+  BindBlock(*material->program, "Bones", UniformBinding::Bones);
+  BindBlock(*material->program, "Shadow", UniformBinding::Shadow);
+
+  material->parameter_block = material->program->GetUniformBlock("Material");
+  if (material->parameter_block) {
+    material->parameters.resize(material->parameter_block->data_size);
+    glGenBuffers(1, &material->parameter_buffer);
+    glBindBuffer(GL_UNIFORM_BUFFER, material->parameter_buffer);
+    glBufferData(GL_UNIFORM_BUFFER, material->parameters.size(),
+                 material->parameters.data(), GL_DYNAMIC_DRAW);
+  }
+
+  material->program->Use();
+  const Program::UniformHandle<int> shadow_map =
+      material->program->GetUniform<int>("shadow_map");
+  material->program->SetUniform(shadow_map, (int)kShadowMapTextureUnit);
+  for (const TextureBinding& binding : details.textures) {
+    ASSIGN_OR_RETURN((std::shared_ptr<RenderableTexture> texture),
+                     binding.texture.Get());
+    const Program::UniformHandle<int> sampler =
+        material->program->GetUniform<int>(binding.uniform);
+    if (!sampler.IsValid()) {
+      return absl::InvalidArgumentError(STATUS_MESSAGE(
+          "Program has no sampler named \"" << binding.uniform << "\""));
+    }
+    material->program->SetUniform(sampler, (int)material->textures.size());
+    material->textures.push_back(std::move(texture));
+  }
+  return material;
+}
+
+Material::~Material() { glDeleteBuffers(1, &parameter_buffer); }
+
+void Material::Use(GLStateTracker& state) {
+  state.UseProgram(program->GetId());
+  if (parameter_buffer) {
+    if (parameters_dirty) {
+      glBindBuffer(GL_UNIFORM_BUFFER, parameter_buffer);
+      glBufferSubData(GL_UNIFORM_BUFFER, 0, parameters.size(),
+                      parameters.data());
+      state.CountCalls(2);
+      parameters_dirty = false;
+    }
+    state.BindUniformBuffer((GLuint)UniformBinding::Material,
+                            parameter_buffer);
+  }
+  for (unsigned int i = 0; i < textures.size(); i++) {
+    state.BindTexture2D(i, textures[i]->GetId());
+  }
+}
+
+const std::shared_ptr<Program>& Material::GetProgram() const {
+  return program;
+}
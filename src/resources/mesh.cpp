@@ -0,0 +1,25 @@
+
+#include "resources/mesh.h"
+
+std::shared_ptr<const MeshBVH> Mesh::GetBVH(
+    const MeshBVH::Settings& settings) const {
+  std::shared_ptr<const MeshBVH> current = std::atomic_load(&bvh);
+  if (current) {
+    return current;
+  }
+  std::shared_ptr<const MeshBVH> built(
+      new MeshBVH(MeshBVH::Build(*this, settings)));
+  // Keep the first BVH stored if another thread finished building first.
+  if (!std::atomic_compare_exchange_strong(&bvh, &current, built)) {
+    return current;
+  }
+  return built;
+}
+
+std::shared_ptr<const MeshBVH> Mesh::GetBuiltBVH() const {
+  return std::atomic_load(&bvh);
+}
+
+void Mesh::SetBVH(std::shared_ptr<const MeshBVH> new_bvh) {
+  std::atomic_store(&bvh, std::move(new_bvh));
+}
@@ -0,0 +1,425 @@
+
+#include "resources/mesh_bvh.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <thread>
+
+#include "resources/mesh.h"
+#include "utility/status.h"
+
+uint32_t GetTriangleCount(const Mesh& mesh) {
+  if (!mesh.triangles.empty()) {
+    return mesh.triangles.size();
+  } else if (!mesh.small_triangles.empty()) {
+    return mesh.small_triangles.size();
+  } else {
+    return mesh.vertices.size() / 3;
+  }
+}
+
+void GetTrianglePoints(const Mesh& mesh, uint32_t triangle,
+                       glm::vec3 (&points)[3]) {
+  for (int i = 0; i < 3; i++) {
+    uint32_t vertex;
+    if (!mesh.triangles.empty()) {
+      vertex = mesh.triangles[triangle].points[i];
+    } else if (!mesh.small_triangles.empty()) {
+      vertex = mesh.small_triangles[triangle].points[i];
+    } else {
+      vertex = triangle * 3 + i;
+    }
+    points[i] = mesh.vertices[vertex].position;
+  }
+}
+
+// The state shared by every thread building a hierarchy.
+struct BVHBuildContext {
+  const MeshBVH::Settings& settings;
+  const std::vector<AABB>& triangle_bounds;
+  const std::vector<glm::vec3>& centroids;
+  std::vector<uint32_t>& triangle_order;
+  // The number of threads that may still be started.
+  std::atomic<int> spare_threads;
+};
+
+// Builds the subtree over the triangles in [`begin`, `end`) of the triangle
+// order, appending its nodes to `nodes`. Reorders only that range of the
+// triangle order, so disjoint ranges can be built concurrently.
+void BuildBVHSubtree(BVHBuildContext& context, uint32_t begin, uint32_t end,
+                     std::vector<MeshBVH::Node>& nodes) {
+  const uint32_t node_index = nodes.size();
+  nodes.emplace_back();
+  AABB bounds;
+  AABB centroid_bounds;
+  for (uint32_t i = begin; i < end; i++) {
+    const uint32_t triangle = context.triangle_order[i];
+    bounds.Expand(context.triangle_bounds[triangle]);
+    centroid_bounds.Expand(context.centroids[triangle]);
+  }
+  nodes[node_index].bounds = bounds;
+  const uint32_t count = end - begin;
+  if (count <= std::max(1u, context.settings.max_leaf_triangles)) {
+    nodes[node_index].offset = begin;
+    nodes[node_index].triangle_count = count;
+    return;
+  }
+
+  // Find the split between bins with the lowest surface area heuristic: the
+  // area of each side weighted by the number of triangles on it.
+  const int bin_count = std::max(2, context.settings.bin_count);
+  struct Bin {
+    AABB bounds;
+    uint32_t count = 0;
+  };
+  std::vector<Bin> bins(bin_count);
+  std::vector<float> right_costs(bin_count);
+  float best_cost = std::numeric_limits<float>::infinity();
+  int best_axis = -1;
+  int best_split = 0;
+  for (int axis = 0; axis < 3; axis++) {
+    const float axis_min = centroid_bounds.min[axis];
+    const float axis_extent = centroid_bounds.max[axis] - axis_min;
+    if (!(axis_extent > 0)) {
+      continue;
+    }
+    const float scale = bin_count / axis_extent;
+    std::fill(bins.begin(), bins.end(), Bin());
+    for (uint32_t i = begin; i < end; i++) {
+      const uint32_t triangle = context.triangle_order[i];
+      const int bin = std::min(
+          bin_count - 1,
+          int((context.centroids[triangle][axis] - axis_min) * scale));
+      bins[bin].bounds.Expand(context.triangle_bounds[triangle]);
+      bins[bin].count++;
+    }
+    // `right_costs[split]` is the cost of the bins from `split` onwards.
+    AABB right;
+    uint32_t right_count = 0;
+    for (int split = bin_count - 1; split > 0; split--) {
+      right.Expand(bins[split].bounds);
+      right_count += bins[split].count;
+      right_costs[split] = right.GetSurfaceArea() * right_count;
+    }
+    AABB left;
+    uint32_t left_count = 0;
+    for (int split = 1; split < bin_count; split++) {
+      left.Expand(bins[split - 1].bounds);
+      left_count += bins[split - 1].count;
+      const float cost =
+          left.GetSurfaceArea() * left_count + right_costs[split];
+      if (left_count != 0 && left_count != count && cost < best_cost) {
+        best_cost = cost;
+        best_axis = axis;
+        best_split = split;
+      }
+    }
+  }
+
+  uint32_t middle;
+  if (best_axis >= 0) {
+    const float axis_min = centroid_bounds.min[best_axis];
+    const float scale =
+        bin_count / (centroid_bounds.max[best_axis] - axis_min);
+    middle = std::partition(
+                 context.triangle_order.begin() + begin,
+                 context.triangle_order.begin() + end,
+                 [&](uint32_t triangle) {
+                   const int bin = std::min(
+                       bin_count - 1,
+                       int((context.centroids[triangle][best_axis] -
+                            axis_min) *
+                           scale));
+                   return bin < best_split;
+                 }) -
+             context.triangle_order.begin();
+  } else {
+    // Every centroid is in the same place, so any split is as good as another.
+    middle = begin + count / 2;
+  }
+
+  bool parallel = false;
+  if (count >= context.settings.parallel_triangles) {
+    parallel = context.spare_threads.fetch_sub(1) > 0;
+    if (!parallel) {
+      context.spare_threads++;
+    }
+  }
+  // The second child is built separately, since its position depends on the
+  // size of the first child's subtree.
+  std::vector<MeshBVH::Node> second_nodes;
+  if (parallel) {
+    std::thread thread(BuildBVHSubtree, std::ref(context), middle, end,
+                       std::ref(second_nodes));
+    BuildBVHSubtree(context, begin, middle, nodes);
+    thread.join();
+    context.spare_threads++;
+  } else {
+    BuildBVHSubtree(context, begin, middle, nodes);
+    BuildBVHSubtree(context, middle, end, second_nodes);
+  }
+  nodes[node_index].offset = nodes.size() - node_index;
+  nodes[node_index].triangle_count = 0;
+  nodes.insert(nodes.end(), second_nodes.begin(), second_nodes.end());
+}
+
+MeshBVH MeshBVH::Build(const Mesh& mesh, const Settings& settings) {
+  const uint32_t triangle_count = GetTriangleCount(mesh);
+  MeshBVH bvh;
+  if (triangle_count == 0) {
+    return bvh;
+  }
+  std::vector<AABB> triangle_bounds(triangle_count);
+  std::vector<glm::vec3> centroids(triangle_count);
+  bvh.triangle_order.resize(triangle_count);
+  for (uint32_t triangle = 0; triangle < triangle_count; triangle++) {
+    glm::vec3 points[3];
+    GetTrianglePoints(mesh, triangle, points);
+    for (const glm::vec3& point : points) {
+      triangle_bounds[triangle].Expand(point);
+    }
+    centroids[triangle] = (points[0] + points[1] + points[2]) / 3.0f;
+    bvh.triangle_order[triangle] = triangle;
+  }
+
+  BVHBuildContext context{settings, triangle_bounds, centroids,
+                          bvh.triangle_order, settings.thread_count - 1};
+  bvh.nodes.reserve(2 * triangle_count /
+                        std::max(1u, settings.max_leaf_triangles));
+  BuildBVHSubtree(context, 0, triangle_count, bvh.nodes);
+  return bvh;
+}
+
+// Intersects `ray` with the triangle of `points`, setting the distance to the
+// hit and the barycentric coordinates of the second and third points.
+bool IntersectRayTriangle(const Ray& ray, const glm::vec3 (&points)[3],
+                          float max_distance, float& distance,
+                          glm::vec2& barycentric) {
+  const glm::vec3 edge1 = points[1] - points[0];
+  const glm::vec3 edge2 = points[2] - points[0];
+  const glm::vec3 p = glm::cross(ray.direction, edge2);
+  const float determinant = glm::dot(edge1, p);
+  if (determinant == 0) {
+    return false;
+  }
+  const float inverse_determinant = 1.0f / determinant;
+  const glm::vec3 t = ray.origin - points[0];
+  const float u = glm::dot(t, p) * inverse_determinant;
+  if (u < 0 || u > 1) {
+    return false;
+  }
+  const glm::vec3 q = glm::cross(t, edge1);
+  const float v = glm::dot(ray.direction, q) * inverse_determinant;
+  if (v < 0 || u + v > 1) {
+    return false;
+  }
+  const float hit_distance = glm::dot(edge2, q) * inverse_determinant;
+  if (hit_distance < 0 || hit_distance > max_distance) {
+    return false;
+  }
+  distance = hit_distance;
+  barycentric = glm::vec2(u, v);
+  return true;
+}
+
+bool MeshBVH::Raycast(const Mesh& mesh, const Ray& ray, float max_distance,
+                      RayHit& hit) const {
+  if (nodes.empty()) {
+    return false;
+  }
+  bool found = false;
+  float closest = max_distance;
+  float root_distance;
+  if (!IntersectRay(ray, nodes[0].bounds, closest, root_distance)) {
+    return false;
+  }
+  // Nodes are pushed with the distance the ray enters them, and skipped if a
+  // closer hit has been found since.
+  std::vector<std::pair<uint32_t, float>> stack{{0, root_distance}};
+  while (!stack.empty()) {
+    const auto [index, entry_distance] = stack.back();
+    stack.pop_back();
+    if (entry_distance > closest) {
+      continue;
+    }
+    const Node& node = nodes[index];
+    if (node.IsLeaf()) {
+      for (uint32_t i = node.offset; i < node.offset + node.triangle_count;
+           i++) {
+        glm::vec3 points[3];
+        GetTrianglePoints(mesh, triangle_order[i], points);
+        float distance;
+        glm::vec2 barycentric;
+        if (IntersectRayTriangle(ray, points, closest, distance,
+                                 barycentric)) {
+          found = true;
+          closest = distance;
+          hit.triangle = triangle_order[i];
+          hit.distance = distance;
+          hit.barycentric = barycentric;
+        }
+      }
+      continue;
+    }
+    const uint32_t first = index + 1;
+    const uint32_t second = index + node.offset;
+    float first_distance, second_distance;
+    const bool hit_first =
+        IntersectRay(ray, nodes[first].bounds, closest, first_distance);
+    const bool hit_second =
+        IntersectRay(ray, nodes[second].bounds, closest, second_distance);
+    // Push the farther child first, so the nearer one is visited first.
+    if (hit_first && hit_second && first_distance < second_distance) {
+      stack.push_back({second, second_distance});
+      stack.push_back({first, first_distance});
+    } else {
+      if (hit_first) {
+        stack.push_back({first, first_distance});
+      }
+      if (hit_second) {
+        stack.push_back({second, second_distance});
+      }
+    }
+  }
+  return found;
+}
+
+// Returns the point on the triangle of `points` closest to `point`.
+glm::vec3 ClosestPointOnTriangle(const glm::vec3& point,
+                                 const glm::vec3 (&points)[3]) {
+  const glm::vec3& a = points[0];
+  const glm::vec3& b = points[1];
+  const glm::vec3& c = points[2];
+  const glm::vec3 ab = b - a;
+  const glm::vec3 ac = c - a;
+  const glm::vec3 ap = point - a;
+  const float d1 = glm::dot(ab, ap);
+  const float d2 = glm::dot(ac, ap);
+  if (d1 <= 0 && d2 <= 0) {
+    return a;
+  }
+  const glm::vec3 bp = point - b;
+  const float d3 = glm::dot(ab, bp);
+  const float d4 = glm::dot(ac, bp);
+  if (d3 >= 0 && d4 <= d3) {
+    return b;
+  }
+  const float vc = d1 * d4 - d3 * d2;
+  if (vc <= 0 && d1 >= 0 && d3 <= 0) {
+    return a + ab * (d1 / (d1 - d3));
+  }
+  const glm::vec3 cp = point - c;
+  const float d5 = glm::dot(ab, cp);
+  const float d6 = glm::dot(ac, cp);
+  if (d6 >= 0 && d5 <= d6) {
+    return c;
+  }
+  const float vb = d5 * d2 - d1 * d6;
+  if (vb <= 0 && d2 >= 0 && d6 <= 0) {
+    return a + ac * (d2 / (d2 - d6));
+  }
+  const float va = d3 * d6 - d5 * d4;
+  if (va <= 0 && d4 - d3 >= 0 && d5 - d6 >= 0) {
+    return b + (c - b) * ((d4 - d3) / ((d4 - d3) + (d5 - d6)));
+  }
+  const float denominator = 1.0f / (va + vb + vc);
+  return a + ab * (vb * denominator) + ac * (vc * denominator);
+}
+
+bool MeshBVH::FindClosestPoint(const Mesh& mesh, const glm::vec3& point,
+                               ClosestPoint& result,
+                               float max_distance) const {
+  if (nodes.empty()) {
+    return false;
+  }
+  bool found = false;
+  float closest_squared = max_distance * max_distance;
+  std::vector<std::pair<uint32_t, float>> stack{
+      {0, nodes[0].bounds.DistanceSquared(point)}};
+  while (!stack.empty()) {
+    const auto [index, distance_squared] = stack.back();
+    stack.pop_back();
+    if (distance_squared > closest_squared) {
+      continue;
+    }
+    const Node& node = nodes[index];
+    if (node.IsLeaf()) {
+      for (uint32_t i = node.offset; i < node.offset + node.triangle_count;
+           i++) {
+        glm::vec3 points[3];
+        GetTrianglePoints(mesh, triangle_order[i], points);
+        const glm::vec3 triangle_point = ClosestPointOnTriangle(point, points);
+        const glm::vec3 offset = triangle_point - point;
+        const float triangle_distance_squared = glm::dot(offset, offset);
+        if (triangle_distance_squared <= closest_squared) {
+          found = true;
+          closest_squared = triangle_distance_squared;
+          result.triangle = triangle_order[i];
+          result.point = triangle_point;
+        }
+      }
+      continue;
+    }
+    const uint32_t first = index + 1;
+    const uint32_t second = index + node.offset;
+    const float first_distance = nodes[first].bounds.DistanceSquared(point);
+    const float second_distance = nodes[second].bounds.DistanceSquared(point);
+    if (first_distance < second_distance) {
+      stack.push_back({second, second_distance});
+      stack.push_back({first, first_distance});
+    } else {
+      stack.push_back({first, first_distance});
+      stack.push_back({second, second_distance});
+    }
+  }
+  if (found) {
+    result.distance = std::sqrt(closest_squared);
+  }
+  return found;
+}
+
+AABB MeshBVH::GetBounds() const {
+  return nodes.empty() ? AABB() : nodes[0].bounds;
+}
+
+absl::StatusOr<MeshBVH> MeshBVH::Create(std::vector<Node> nodes_,
+                                        std::vector<uint32_t> triangle_order_,
+                                        uint32_t triangle_count) {
+  if (triangle_order_.size() != triangle_count) {
+    return absl::InvalidArgumentError(STATUS_MESSAGE(
+        "BVH triangle order has the wrong length. Expected: "
+        << triangle_count << ", Actual: " << triangle_order_.size()));
+  }
+  std::vector<bool> seen(triangle_count, false);
+  for (uint32_t triangle : triangle_order_) {
+    if (triangle >= triangle_count || seen[triangle]) {
+      return absl::InvalidArgumentError(STATUS_MESSAGE(
+          "BVH triangle order is not a permutation. Triangle: " << triangle));
+    }
+    seen[triangle] = true;
+  }
+  if (nodes_.empty() != (triangle_count == 0)) {
+    return absl::InvalidArgumentError(
+        "BVH must have nodes exactly when the mesh has triangles.");
+  }
+  // Children always come after their parents, so checking every node's
+  // references rules out cycles as well as out of range indices.
+  for (uint32_t index = 0; index < nodes_.size(); index++) {
+    const Node& node = nodes_[index];
+    if (node.IsLeaf()) {
+      if (node.offset > triangle_count ||
+          node.triangle_count > triangle_count - node.offset) {
+        return absl::InvalidArgumentError(STATUS_MESSAGE(
+            "BVH leaf " << index << " refers to triangles out of range."));
+      }
+    } else if (node.offset < 2 || node.offset >= nodes_.size() - index) {
+      return absl::InvalidArgumentError(STATUS_MESSAGE(
+          "BVH node " << index << " has an invalid child offset."));
+    }
+  }
+  MeshBVH bvh;
+  bvh.nodes = std::move(nodes_);
+  bvh.triangle_order = std::move(triangle_order_);
+  return bvh;
+}
@@ -1,12 +1,15 @@
 
 #include "resources/mesh_formats/obj_mesh.h"
 
-#include <fstream>
+#include <glog/logging.h>
+
 #include <sstream>
 #include <variant>
 #include <vector>
 
+#include "resources/derived_cache.h"
 #include "resources/resource.h"
+#include "utility/blob.h"
 
 namespace std {
 
@@ -22,15 +25,40 @@ struct hash<std::tuple<int, int, int>> {
 
 }  // namespace std
 
-absl::StatusOr<std::shared_ptr<ObjModel>> ObjModel::Load(
-    const Details& details) {
-  std::ifstream file;
-  file.open(details.file);
-  if (!file.is_open()) {
-    return absl::NotFoundError(
-        STATUS_MESSAGE("Failed to read OBJ file \"" << details.file << "\""));
+// Version of the processed data ObjModel::Load stores in the derived data
+// cache. Bump whenever parsing or the cached layout changes.
+constexpr uint32_t kObjCacheVersion = 1;
+
+void WriteObjModel(const ObjModel& model, BlobWriter& writer) {
+  writer.Write<uint64_t>(model.meshes.size());
+  for (const auto& [name, mesh] : model.meshes) {
+    writer.WriteString(name);
+    writer.WriteVector(mesh->vertices);
+    writer.WriteVector(mesh->triangles);
+    writer.WriteVector(mesh->small_triangles);
+  }
+}
+
+std::shared_ptr<ObjModel> ReadObjModel(BlobReader& reader) {
+  std::shared_ptr<ObjModel> model(new ObjModel());
+  uint64_t mesh_count;
+  if (!reader.Read(mesh_count)) {
+    return nullptr;
   }
+  for (uint64_t i = 0; i < mesh_count; i++) {
+    std::string name;
+    std::shared_ptr<Mesh> mesh(new Mesh());
+    if (!reader.ReadString(name) || !reader.ReadVector(mesh->vertices) ||
+        !reader.ReadVector(mesh->triangles) ||
+        !reader.ReadVector(mesh->small_triangles)) {
+      return nullptr;
+    }
+    model->meshes.insert_or_assign(name, mesh);
+  }
+  return reader.IsDone() ? model : nullptr;
+}
 
+absl::StatusOr<std::shared_ptr<ObjModel>> ParseObjModel(std::istream& file) {
   std::shared_ptr<ObjModel> model(new ObjModel());
 
   std::vector<glm::vec3> position_pool;
@@ -218,7 +246,6 @@ absl::StatusOr<std::shared_ptr<ObjModel>> ObjModel::Load(
       glm::vec3 position;
       // Get the vec3 to store.
       if (!get_vec3(words_span, position)) {
-        file.close();
         return absl::FailedPreconditionError(
             STATUS_MESSAGE("Failed to read vec3 on line " << line_number));
       }
@@ -228,7 +255,6 @@ absl::StatusOr<std::shared_ptr<ObjModel>> ObjModel::Load(
       glm::vec2 tex_coord;
       // Get the vec2 to store.
       if (!get_vec2(words_span, tex_coord)) {
-        file.close();
         return absl::FailedPreconditionError(
             STATUS_MESSAGE("Failed to read vec2 on line " << line_number));
       }
@@ -238,7 +264,6 @@ absl::StatusOr<std::shared_ptr<ObjModel>> ObjModel::Load(
       glm::vec3 normal;
       // Get the vec3 to store.
       if (!get_vec3(words_span, normal)) {
-        file.close();
         return absl::FailedPreconditionError(
             STATUS_MESSAGE("Failed to read vec3 on line " << line_number));
       }
@@ -329,7 +354,43 @@ absl::StatusOr<std::shared_ptr<ObjModel>> ObjModel::Load(
   if (current_mesh) {
     finalize_current_mesh();
   }
-  file.close();
+  return model;
+}
+
+absl::StatusOr<std::shared_ptr<ObjModel>> ObjModel::Load(
+    const Details& details) {
+  std::string contents;
+  const absl::StatusOr<uint64_t> source_hash =
+      DerivedDataCache::HashFile(details.file, contents);
+  if (!source_hash.ok()) {
+    return absl::NotFoundError(
+        STATUS_MESSAGE("Failed to read OBJ file \"" << details.file << "\""));
+  }
+
+  const DerivedDataCache::Key cache_key{"obj", kObjCacheVersion, *source_hash};
+  const absl::StatusOr<std::vector<unsigned char>> cached_data =
+      DerivedDataCache::Get().Read(cache_key);
+  if (cached_data.ok()) {
+    BlobReader reader(*cached_data);
+    std::shared_ptr<ObjModel> model = ReadObjModel(reader);
+    if (model) {
+      return model;
+    }
+    LOG(WARNING) << "Discarding malformed cache entry for \"" << details.file
+                 << "\"";
+  }
+
+  std::istringstream file(contents);
+  ASSIGN_OR_RETURN((std::shared_ptr<ObjModel> model), ParseObjModel(file));
+
+  BlobWriter writer;
+  WriteObjModel(*model, writer);
+  const absl::Status write_status =
+      DerivedDataCache::Get().Write(cache_key, writer.data);
+  if (!write_status.ok()) {
+    LOG(WARNING) << "Failed to cache \"" << details.file
+                 << "\": " << write_status;
+  }
   return model;
 }
 
@@ -0,0 +1,174 @@
+
+#include "resources/prefab.h"
+
+#include <algorithm>
+#include <thread>
+#include <utility>
+
+#include "resources/scene.h"
+#include "utility/status.h"
+
+absl::StatusOr<std::shared_ptr<Prefab>> Prefab::Load(const Details& details) {
+  ASSIGN_OR_RETURN((const std::shared_ptr<Node> root),
+                   SceneReader::Load(details.file));
+  return FromTree(*root);
+}
+
+absl::StatusOr<std::shared_ptr<Prefab>> Prefab::FromTree(const Node& root) {
+  std::shared_ptr<Prefab> prefab(new Prefab());
+  // Nodes are added in pre-order, so parents always come before children.
+  std::vector<std::pair<const Node*, uint32_t>> stack = {{&root, kNoParent}};
+  while (!stack.empty()) {
+    const auto [node, parent] = stack.back();
+    stack.pop_back();
+    const SceneNodeTypes::TypeInfo* type = SceneNodeTypes::Get().Find(*node);
+    if (!type) {
+      return absl::FailedPreconditionError(
+          STATUS_MESSAGE("Node \"" << node->name << "\" of type "
+                                   << typeid(*node).name()
+                                   << " is not a registered scene node type"));
+    }
+
+    NodeData data;
+    data.parent = parent;
+    data.name = node->name;
+    data.spawn = type->spawn;
+    data.is_transform = type->is_transform;
+    if (type->is_transform) {
+      const Transform& transform = static_cast<const Transform&>(*node);
+      data.position = transform.GetPosition();
+      data.rotation = transform.GetRotation();
+      data.scale = transform.GetScale();
+    }
+    if (type->write_fields && type->read_fields) {
+      std::vector<unsigned char> fields;
+      SceneFieldWriter writer(fields);
+      RETURN_IF_ERROR(type->write_fields(*node, writer));
+      data.initialize = [type, fields = std::move(fields)](Node& instance) {
+        SceneFieldReader reader(fields.data(), fields.size());
+        const absl::Status status = type->read_fields(instance, reader);
+        LOG_IF(ERROR, !status.ok()) << "Failed to read fields of prefab node \""
+                                    << instance.name << "\": " << status;
+      };
+    }
+
+    const uint32_t index = prefab->nodes.size();
+    prefab->nodes.push_back(std::move(data));
+    const Node::ChildList& children = node->GetChildren();
+    for (auto it = children.rbegin(); it != children.rend(); ++it) {
+      stack.push_back({it->get(), index});
+    }
+  }
+  return prefab;
+}
+
+void Prefab::SetTransform(uint32_t index, const glm::vec3& position,
+                          const glm::quat& rotation, const glm::vec3& scale) {
+  CHECK(index < nodes.size());
+  NodeData& data = nodes[index];
+  CHECK(data.is_transform) << "Prefab node " << index
+                           << " is not a Transform.";
+  data.position = position;
+  data.rotation = rotation;
+  data.scale = scale;
+}
+
+std::shared_ptr<Node> Prefab::Instantiate(
+    const std::shared_ptr<Node>& parent) const {
+  std::vector<std::shared_ptr<Node>> instance;
+  BuildInstance(instance);
+  InitializeInstance(instance);
+  std::shared_ptr<Node> root = std::move(instance[0]);
+  if (parent) {
+    root->AttachTo(parent);
+  }
+  return root;
+}
+
+std::vector<std::shared_ptr<Node>> Prefab::Instantiate(
+    int count, const std::shared_ptr<Node>& parent, int thread_count) const {
+  // Instances are independent, so they are split into contiguous ranges and
+  // built in parallel. The node pools are locked when spawning, the same as
+  // when reading scenes.
+  std::vector<std::vector<std::shared_ptr<Node>>> instances(count);
+  thread_count = std::max(1, std::min(thread_count, count));
+  const int instances_per_thread = (count + thread_count - 1) / thread_count;
+  const auto build_range = [this, &instances](int begin, int end) {
+    for (int i = begin; i < end; i++) {
+      BuildInstance(instances[i]);
+    }
+  };
+  std::vector<std::thread> threads;
+  for (int begin = instances_per_thread; begin < count;
+       begin += instances_per_thread) {
+    threads.emplace_back(build_range, begin,
+                         std::min(count, begin + instances_per_thread));
+  }
+  build_range(0, std::min(count, instances_per_thread));
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+
+  std::vector<std::shared_ptr<Node>> roots;
+  roots.reserve(count);
+  for (const std::vector<std::shared_ptr<Node>>& instance : instances) {
+    InitializeInstance(instance);
+    roots.push_back(instance[0]);
+  }
+  if (!parent) {
+    return roots;
+  }
+
+  const std::shared_ptr<World> world = parent->GetWorld();
+  if (world) {
+    world->BeginBatch();
+  }
+  for (const std::shared_ptr<Node>& root : roots) {
+    root->AttachTo(parent);
+  }
+  if (world) {
+    world->EndBatch();
+  }
+  return roots;
+}
+
+void Prefab::BuildInstance(
+    std::vector<std::shared_ptr<Node>>& instance) const {
+  CHECK(!nodes.empty()) << "Cannot instantiate an empty prefab.";
+
+  instance.reserve(nodes.size());
+  for (const NodeData& data : nodes) {
+    instance.push_back(data.spawn());
+    instance.back()->name = data.name;
+  }
+
+  // The nodes are new, so their cached matrices are already invalid and the
+  // transforms can be written without going through the setters.
+  for (uint32_t i = 0; i < nodes.size(); i++) {
+    const NodeData& data = nodes[i];
+    if (!data.is_transform) {
+      continue;
+    }
+    Transform& transform = static_cast<Transform&>(*instance[i]);
+    transform.position = transform.previous_position = data.position;
+    transform.rotation = transform.previous_rotation = data.rotation;
+    transform.scale = transform.previous_scale = data.scale;
+  }
+
+  // Parents come before their children, so children are appended in order.
+  // None of the nodes are in a world yet, so nothing needs to be notified.
+  for (uint32_t i = 1; i < nodes.size(); i++) {
+    const std::shared_ptr<Node>& parent = instance[nodes[i].parent];
+    instance[i]->parent = parent;
+    parent->children.push_back(instance[i]);
+  }
+}
+
+void Prefab::InitializeInstance(
+    const std::vector<std::shared_ptr<Node>>& instance) const {
+  for (uint32_t i = 0; i < nodes.size(); i++) {
+    if (nodes[i].initialize) {
+      nodes[i].initialize(*instance[i]);
+    }
+  }
+}
@@ -1,7 +1,10 @@
 
 #include "resources/renderable_mesh.h"
 
+#include <glog/logging.h>
+
 #include <memory>
+#include <numeric>
 
 #include "resources/resource.h"
 #include "utility/status.h"
@@ -10,85 +13,72 @@ absl::StatusOr<std::shared_ptr<RenderableMesh>> RenderableMesh::Load(
     const Details& details) {
   ASSIGN_OR_RETURN((const std::shared_ptr<Mesh> source_mesh),
                    details.mesh.Get());
-
-  if (source_mesh->triangles.size() > 0 &&
-      source_mesh->small_triangles.size() > 0) {
-    return absl::FailedPreconditionError(
-        "Source mesh contains both large- and small-indexed triangles.");
-  }
   std::shared_ptr<RenderableMesh> new_mesh(new RenderableMesh());
-  new_mesh->vertex_attribute_count = 6;
-  if (source_mesh->triangles.size() == 0 &&
-      source_mesh->small_triangles.size() == 0) {
-    new_mesh->indexing = Indexing::None;
-    new_mesh->elements = source_mesh->vertices.size();
-    new_mesh->buffers.resize(1);
-  } else {
-    new_mesh->indexing =
-        source_mesh->triangles.size() > 0 ? Indexing::Large : Indexing::Small;
-    new_mesh->elements = (new_mesh->indexing == Indexing::Large
-                              ? source_mesh->triangles.size()
-                              : source_mesh->small_triangles.size()) *
-                         3;
-    new_mesh->buffers.resize(2);
+  if (details.upload) {
+    ASSIGN_OR_RETURN((const std::vector<GLuint> indices),
+                     CollectIndices(*source_mesh));
+    new_mesh->arena = &GeometryArena::Get(GeometryArena::Layout::Static);
+    new_mesh->range = new_mesh->arena->Allocate(
+        {source_mesh->vertices.data()}, source_mesh->vertices.size(),
+        indices.data(), indices.size());
   }
-
-  glGenVertexArrays(1, &new_mesh->vao);
-  glBindVertexArray(new_mesh->vao);
-  glGenBuffers(new_mesh->buffers.size(), new_mesh->buffers.data());
-  glBindBuffer(GL_ARRAY_BUFFER, new_mesh->buffers[0]);
-  glBufferData(GL_ARRAY_BUFFER,
-               sizeof(Mesh::Vertex) * source_mesh->vertices.size(),
-               source_mesh->vertices.data(), GL_STATIC_DRAW);
-
-  glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Mesh::Vertex),
-                        (void*)offsetof(Mesh::Vertex, position));
-  glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(Mesh::Vertex),
-                        (void*)offsetof(Mesh::Vertex, texCoord));
-  glVertexAttribPointer(2, 4, GL_FLOAT, GL_FALSE, sizeof(Mesh::Vertex),
-                        (void*)offsetof(Mesh::Vertex, colour));
-  glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, sizeof(Mesh::Vertex),
-                        (void*)offsetof(Mesh::Vertex, normal));
-  glVertexAttribPointer(4, 3, GL_FLOAT, GL_FALSE, sizeof(Mesh::Vertex),
-                        (void*)offsetof(Mesh::Vertex, tangent));
-  glVertexAttribPointer(5, 3, GL_FLOAT, GL_FALSE, sizeof(Mesh::Vertex),
-                        (void*)offsetof(Mesh::Vertex, bitangent));
-
-  if (new_mesh->indexing != Indexing::None) {
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, new_mesh->buffers[1]);
-    if (new_mesh->indexing == Indexing::Small) {
-      glBufferData(
-          GL_ELEMENT_ARRAY_BUFFER,
-          sizeof(Mesh::SmallTriangle) * source_mesh->small_triangles.size(),
-          source_mesh->small_triangles.data(), GL_STATIC_DRAW);
-    } else {
-      glBufferData(GL_ELEMENT_ARRAY_BUFFER,
-                   sizeof(Mesh::Triangle) * source_mesh->triangles.size(),
-                   source_mesh->triangles.data(), GL_STATIC_DRAW);
+  // Uploaded meshes only need the source for the software renderer, so it is
+  // otherwise released along with the resource's other users.
+  if (!details.upload || details.keep_source) {
+    new_mesh->source = source_mesh;
+  }
+  const std::shared_ptr<const MeshBVH> bvh = source_mesh->GetBuiltBVH();
+  if (bvh) {
+    new_mesh->bounds = bvh->GetBounds();
+  } else {
+    for (const Mesh::Vertex& vertex : source_mesh->vertices) {
+      new_mesh->bounds.Expand(vertex.position);
     }
   }
   return new_mesh;
 }
 
 RenderableMesh::~RenderableMesh() {
-  glDeleteVertexArrays(1, &vao);
-  glDeleteBuffers(buffers.size(), buffers.data());
+  if (arena) {
+    arena->Free(range);
+  }
 }
 
 void RenderableMesh::Draw() {
-  glBindVertexArray(vao);
-  for (unsigned int i = 0; i < vertex_attribute_count; i++) {
-    glEnableVertexAttribArray(i);
+  CHECK(arena) << "Only uploaded meshes can be drawn with GL.";
+  glBindVertexArray(arena->GetVertexArray());
+  glDrawElementsBaseVertex(GL_TRIANGLES, range.index_count, GL_UNSIGNED_INT,
+                           (void*)(sizeof(GLuint) * range.first_index),
+                           range.base_vertex);
+}
+
+GeometryArena& RenderableMesh::GetArena() const { return *arena; }
+
+DrawElementsIndirectCommand RenderableMesh::GetDrawCommand() const {
+  return GeometryArena::GetDrawCommand(range);
+}
+
+absl::StatusOr<std::vector<GLuint>> RenderableMesh::CollectIndices(
+    const Mesh& mesh) {
+  if (mesh.triangles.size() > 0 && mesh.small_triangles.size() > 0) {
+    return absl::FailedPreconditionError(
+        "Source mesh contains both large- and small-indexed triangles.");
   }
-  if (indexing == Indexing::None) {
-    glDrawArrays(GL_TRIANGLES, 0, elements);
+  std::vector<GLuint> indices;
+  if (mesh.triangles.size() > 0) {
+    indices.reserve(mesh.triangles.size() * 3);
+    for (const Mesh::Triangle& triangle : mesh.triangles) {
+      indices.insert(indices.end(), triangle.points, triangle.points + 3);
+    }
+  } else if (mesh.small_triangles.size() > 0) {
+    indices.reserve(mesh.small_triangles.size() * 3);
+    for (const Mesh::SmallTriangle& triangle : mesh.small_triangles) {
+      indices.insert(indices.end(), triangle.points, triangle.points + 3);
+    }
   } else {
-    glDrawElements(
-        GL_TRIANGLES, elements,
-        indexing == Indexing::Small ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT,
-        (void*)0);
-  }
-  for (unsigned int i = 0; i < vertex_attribute_count; i++) {
-    glDisableVertexAttribArray(i);
+    // Unindexed meshes draw their vertices in order.
+    indices.resize(mesh.vertices.size());
+    std::iota(indices.begin(), indices.end(), 0);
   }
+  return indices;
 }
@@ -0,0 +1,475 @@
+
+#include "resources/scene.h"
+
+#include <absl/container/flat_hash_map.h>
+#include <glog/logging.h>
+
+#include <algorithm>
+#include <fstream>
+#include <thread>
+
+#include "nodes/camera.h"
+#include "nodes/light.h"
+#include "resources/transit/transit.h"
+#include "utility/json.h"
+
+// The parent index of the root record.
+constexpr uint32_t kNoParent = ~0u;
+
+// Every node of a scene has one of these in the binary data, in pre-order, so
+// the parent of a node always comes before it and every subtree is contiguous.
+struct SceneNodeRecord {
+  uint32_t parent;
+  // The index of the node's type in the "types" of the JSON.
+  uint32_t type;
+  // The number of nodes in the subtree of this node, including itself.
+  uint32_t subtree_size;
+  // The name and fields of the node, as offsets into the bytes following the
+  // records.
+  uint32_t name_offset;
+  uint32_t name_length;
+  uint32_t fields_offset;
+  uint32_t fields_length;
+  // The local transform of the node. Ignored if it is not a Transform.
+  glm::vec3 position;
+  glm::quat rotation;
+  glm::vec3 scale;
+};
+
+static_assert(sizeof(SceneNodeRecord) == 68,
+              "SceneNodeRecord must not contain padding.");
+
+SceneNodeRecord SwapRecordBytes(const SceneNodeRecord& record) {
+  return {htob(record.parent),        htob(record.type),
+          htob(record.subtree_size),  htob(record.name_offset),
+          htob(record.name_length),   htob(record.fields_offset),
+          htob(record.fields_length), htob(record.position),
+          htob(record.rotation),      htob(record.scale)};
+}
+
+void SceneFieldWriter::WriteString(const std::string& value) {
+  Write<uint32_t>(value.size());
+  data.insert(data.end(), value.begin(), value.end());
+}
+
+absl::StatusOr<std::string> SceneFieldReader::ReadString() {
+  ASSIGN_OR_RETURN((const uint32_t length), Read<uint32_t>());
+  RETURN_IF_ERROR(Require(length));
+  std::string value((const char*)data, length);
+  data += length;
+  remaining -= length;
+  return value;
+}
+
+absl::Status SceneFieldReader::Require(size_t length) const {
+  if (length > remaining) {
+    return absl::OutOfRangeError(STATUS_MESSAGE(
+        "Node fields are too short. Expected " << length
+                                               << " more bytes, but only "
+                                               << remaining << " remain"));
+  }
+  return absl::OkStatus();
+}
+
+absl::Status WriteCameraFields(const Camera& camera,
+                               SceneFieldWriter& writer) {
+  writer.Write<uint8_t>(camera.render);
+  writer.Write<uint8_t>(camera.clear_flags);
+  writer.Write(camera.viewport[0]);
+  writer.Write(camera.viewport[1]);
+  writer.Write<uint32_t>(camera.sort_order);
+  writer.Write(camera.fov);
+  writer.Write(camera.size);
+  writer.Write(camera.near);
+  writer.Write(camera.far);
+  writer.Write<uint8_t>((uint8_t)camera.projection_type);
+  return absl::OkStatus();
+}
+
+absl::Status ReadCameraFields(Camera& camera, SceneFieldReader& reader) {
+  ASSIGN_OR_RETURN((const uint8_t render), reader.Read<uint8_t>());
+  ASSIGN_OR_RETURN((camera.clear_flags), reader.Read<uint8_t>());
+  ASSIGN_OR_RETURN((camera.viewport[0]), reader.Read<glm::vec2>());
+  ASSIGN_OR_RETURN((camera.viewport[1]), reader.Read<glm::vec2>());
+  ASSIGN_OR_RETURN((const uint32_t sort_order), reader.Read<uint32_t>());
+  ASSIGN_OR_RETURN((camera.fov), reader.Read<float>());
+  ASSIGN_OR_RETURN((camera.size), reader.Read<float>());
+  ASSIGN_OR_RETURN((camera.near), reader.Read<float>());
+  ASSIGN_OR_RETURN((camera.far), reader.Read<float>());
+  ASSIGN_OR_RETURN((const uint8_t projection_type), reader.Read<uint8_t>());
+  if (projection_type > (uint8_t)Camera::Projection::Orthographic) {
+    return absl::InvalidArgumentError(STATUS_MESSAGE(
+        "Unknown camera projection type " << (int)projection_type));
+  }
+  camera.render = render != 0;
+  camera.sort_order = (int)sort_order;
+  camera.projection_type = (Camera::Projection)projection_type;
+  return absl::OkStatus();
+}
+
+absl::Status WriteDirectionalLightFields(const DirectionalLight& light,
+                                         SceneFieldWriter& writer) {
+  writer.Write(light.colour);
+  writer.Write(light.intensity);
+  writer.Write<uint8_t>(light.cast_shadows);
+  writer.Write<uint32_t>(light.cascade_count);
+  writer.Write<uint32_t>(light.shadow_resolution);
+  writer.Write(light.shadow_distance);
+  writer.Write(light.cascade_split_lambda);
+  writer.Write(light.shadow_caster_distance);
+  writer.Write(light.depth_bias);
+  writer.Write(light.slope_bias);
+  return absl::OkStatus();
+}
+
+absl::Status ReadDirectionalLightFields(DirectionalLight& light,
+                                        SceneFieldReader& reader) {
+  ASSIGN_OR_RETURN((light.colour), reader.Read<glm::vec3>());
+  ASSIGN_OR_RETURN((light.intensity), reader.Read<float>());
+  ASSIGN_OR_RETURN((const uint8_t cast_shadows), reader.Read<uint8_t>());
+  ASSIGN_OR_RETURN((const uint32_t cascade_count), reader.Read<uint32_t>());
+  ASSIGN_OR_RETURN((const uint32_t shadow_resolution),
+                   reader.Read<uint32_t>());
+  ASSIGN_OR_RETURN((light.shadow_distance), reader.Read<float>());
+  ASSIGN_OR_RETURN((light.cascade_split_lambda), reader.Read<float>());
+  ASSIGN_OR_RETURN((light.shadow_caster_distance), reader.Read<float>());
+  ASSIGN_OR_RETURN((light.depth_bias), reader.Read<float>());
+  ASSIGN_OR_RETURN((light.slope_bias), reader.Read<float>());
+  light.cast_shadows = cast_shadows != 0;
+  light.cascade_count = (int)cascade_count;
+  light.shadow_resolution = (int)shadow_resolution;
+  return absl::OkStatus();
+}
+
+SceneNodeTypes::SceneNodeTypes() {
+  Register<Node>("Node");
+  Register<Transform>("Transform");
+  Register<Camera>("Camera", WriteCameraFields, ReadCameraFields);
+  Register<DirectionalLight>("DirectionalLight", WriteDirectionalLightFields,
+                             ReadDirectionalLightFields);
+}
+
+SceneNodeTypes& SceneNodeTypes::Get() {
+  static SceneNodeTypes* types = new SceneNodeTypes();
+  return *types;
+}
+
+const SceneNodeTypes::TypeInfo* SceneNodeTypes::Find(
+    const std::string& name) const {
+  const auto it = types_by_name.find(name);
+  return it == types_by_name.end() ? nullptr : it->second;
+}
+
+const SceneNodeTypes::TypeInfo* SceneNodeTypes::Find(const Node& node) const {
+  const auto it = types_by_type.find(std::type_index(typeid(node)));
+  return it == types_by_type.end() ? nullptr : it->second;
+}
+
+void SceneNodeTypes::Add(std::type_index type, std::unique_ptr<TypeInfo> info) {
+  CHECK(types_by_name.try_emplace(info->name, info.get()).second)
+      << "Scene node type \"" << info->name << "\" is already registered.";
+  CHECK(types_by_type.try_emplace(type, info.get()).second)
+      << "Scene node type \"" << info->name
+      << "\" is already registered under another name.";
+  types.push_back(std::move(info));
+}
+
+// Collects the tree of `root` in pre-order into `nodes`, along with the index
+// of each node's parent into `parents`.
+void CollectSceneNodes(const Node& root, std::vector<const Node*>& nodes,
+                       std::vector<uint32_t>& parents) {
+  std::vector<std::pair<const Node*, uint32_t>> stack = {{&root, kNoParent}};
+  while (!stack.empty()) {
+    const auto [node, parent] = stack.back();
+    stack.pop_back();
+    const uint32_t index = nodes.size();
+    nodes.push_back(node);
+    parents.push_back(parent);
+    const Node::ChildList& children = node->GetChildren();
+    for (auto it = children.rbegin(); it != children.rend(); ++it) {
+      stack.push_back({it->get(), index});
+    }
+  }
+}
+
+absl::Status SceneWriter::Write(std::ostream& stream,
+                                const std::shared_ptr<Node>& root) {
+  CHECK(root.get());
+  std::vector<const Node*> nodes;
+  std::vector<uint32_t> parents;
+  CollectSceneNodes(*root, nodes, parents);
+
+  std::vector<const SceneNodeTypes::TypeInfo*> node_types;
+  node_types.reserve(nodes.size());
+  absl::flat_hash_map<const SceneNodeTypes::TypeInfo*, uint32_t> type_indices;
+  json::json type_names = json::json::array();
+  for (const Node* node : nodes) {
+    const SceneNodeTypes::TypeInfo* type = SceneNodeTypes::Get().Find(*node);
+    if (!type) {
+      return absl::FailedPreconditionError(
+          STATUS_MESSAGE("Node \"" << node->name << "\" of type "
+                                   << typeid(*node).name()
+                                   << " is not a registered scene node type"));
+    }
+    if (type_indices.try_emplace(type, type_names.size()).second) {
+      type_names.push_back(type->name);
+    }
+    node_types.push_back(type);
+  }
+
+  std::vector<SceneNodeRecord> records(nodes.size());
+  std::vector<unsigned char> strings;
+  SceneFieldWriter writer(strings);
+  for (uint32_t i = 0; i < nodes.size(); i++) {
+    const Node& node = *nodes[i];
+    SceneNodeRecord& record = records[i];
+    record.parent = parents[i];
+    record.type = type_indices[node_types[i]];
+    record.subtree_size = 1;
+    record.name_offset = strings.size();
+    record.name_length = node.name.size();
+    strings.insert(strings.end(), node.name.begin(), node.name.end());
+    record.fields_offset = strings.size();
+    if (node_types[i]->write_fields) {
+      const absl::Status status = node_types[i]->write_fields(node, writer);
+      if (!status.ok()) {
+        return absl::Status(
+            status.code(), STATUS_MESSAGE("Failed to write fields of node \""
+                                          << node.name
+                                          << "\": " << status.message()));
+      }
+    }
+    record.fields_length = strings.size() - record.fields_offset;
+    if (node_types[i]->is_transform) {
+      const Transform& transform = static_cast<const Transform&>(node);
+      record.position = transform.GetPosition();
+      record.rotation = transform.GetRotation();
+      record.scale = transform.GetScale();
+    } else {
+      record.position = glm::vec3(0, 0, 0);
+      record.rotation = glm::quat(1, 0, 0, 0);
+      record.scale = glm::vec3(1, 1, 1);
+    }
+  }
+  // Children come after their parents, so each subtree is complete by the
+  // time it is added to its parent.
+  for (uint32_t i = nodes.size() - 1; i > 0; i--) {
+    records[records[i].parent].subtree_size += records[i].subtree_size;
+  }
+  for (SceneNodeRecord& record : records) {
+    record = SwapRecordBytes(record);
+  }
+
+  json::json json_data = {{"types", std::move(type_names)},
+                          {"node_count", nodes.size()}};
+  const std::string json_string = json_data.dump();
+  const size_t data_length = records.size() * sizeof(SceneNodeRecord) +
+                             strings.size();
+  if (data_length > ~0u) {
+    return absl::OutOfRangeError(
+        STATUS_MESSAGE("Scene data is too large: " << data_length << " bytes"));
+  }
+
+  transit::TransitHeader header = {{'T', 'R', 'S', 'T'},
+                                   {'S', 'C', 'N', 'E'},
+                                   {1, 0},
+                                   htob((uint32_t)json_string.size()),
+                                   htob((uint32_t)data_length)};
+  stream.write((const char*)&header, sizeof(header));
+  stream.write(json_string.data(), json_string.size());
+  stream.write((const char*)records.data(),
+               records.size() * sizeof(SceneNodeRecord));
+  stream.write((const char*)strings.data(), strings.size());
+  if (stream.bad()) {
+    return absl::UnknownError("Failed to write scene to stream.");
+  }
+  return absl::OkStatus();
+}
+
+// Checks that `records` form a single tree in pre-order, and that their
+// types, names and fields are in range.
+absl::Status ValidateRecords(const std::vector<SceneNodeRecord>& records,
+                             uint32_t type_count, size_t strings_length) {
+  // The nodes whose subtrees contain the current node, innermost last. In
+  // pre-order, a node's parent must be the innermost of these.
+  std::vector<uint32_t> ancestors;
+  for (uint32_t i = 0; i < records.size(); i++) {
+    const SceneNodeRecord& record = records[i];
+    while (!ancestors.empty() &&
+           i >= ancestors.back() + records[ancestors.back()].subtree_size) {
+      ancestors.pop_back();
+    }
+    if (record.parent !=
+        (ancestors.empty() ? kNoParent : ancestors.back())) {
+      return absl::InvalidArgumentError(STATUS_MESSAGE(
+          "Node " << i << " has invalid parent " << record.parent));
+    }
+    const uint32_t end = i + record.subtree_size;
+    if (record.subtree_size == 0 || end < i || end > records.size() ||
+        (i == 0 && end != records.size()) ||
+        (i > 0 && end > record.parent +
+                            records[record.parent].subtree_size)) {
+      return absl::InvalidArgumentError(STATUS_MESSAGE(
+          "Node " << i << " has invalid subtree size "
+                  << record.subtree_size));
+    }
+    ancestors.push_back(i);
+    if (record.type >= type_count) {
+      return absl::InvalidArgumentError(STATUS_MESSAGE(
+          "Node " << i << " has invalid type " << record.type));
+    }
+    if ((uint64_t)record.name_offset + record.name_length > strings_length ||
+        (uint64_t)record.fields_offset + record.fields_length >
+            strings_length) {
+      return absl::InvalidArgumentError(STATUS_MESSAGE(
+          "Node " << i << " has a name or fields outside of the data"));
+    }
+  }
+  return absl::OkStatus();
+}
+
+absl::StatusOr<std::shared_ptr<Node>> SceneReader::Read(std::istream& stream,
+                                                        int thread_count) {
+  ASSIGN_OR_RETURN((const transit::TransitHeader& header),
+                   transit::ReadHeader(stream));
+  RETURN_IF_ERROR((transit::VerifyHeader(header, "SCNE", 1, 0)));
+  ASSIGN_OR_RETURN((const json::json& json_data),
+                   transit::ReadJson(stream, header.json_length));
+  ASSIGN_OR_RETURN((const json::json* type_names),
+                   json::GetRequiredArray(json_data, "types"));
+  ASSIGN_OR_RETURN((const unsigned int node_count),
+                   json::GetRequiredUint(json_data, "node_count"));
+  if (node_count == 0) {
+    return absl::InvalidArgumentError("Scene has no nodes");
+  }
+  if ((uint64_t)node_count * sizeof(SceneNodeRecord) > header.data_length) {
+    return absl::InvalidArgumentError(
+        STATUS_MESSAGE("Scene data is too short for " << node_count
+                                                      << " nodes"));
+  }
+
+  std::vector<const SceneNodeTypes::TypeInfo*> types;
+  types.reserve(type_names->size());
+  for (unsigned int i = 0; i < type_names->size(); i++) {
+    ASSIGN_OR_RETURN((const std::string& type_name),
+                     json::GetRequiredString(*type_names, i));
+    const SceneNodeTypes::TypeInfo* type =
+        SceneNodeTypes::Get().Find(type_name);
+    if (!type) {
+      return absl::NotFoundError(STATUS_MESSAGE(
+          "Scene node type \"" << type_name << "\" is not registered"));
+    }
+    types.push_back(type);
+  }
+
+  // The records are read straight into place, and the names and fields are
+  // read into a single buffer that nodes refer into.
+  const size_t records_length = node_count * sizeof(SceneNodeRecord);
+  std::vector<SceneNodeRecord> records(node_count);
+  stream.read((char*)records.data(), records_length);
+  if (stream.gcount() != (std::streamsize)records_length) {
+    return absl::InvalidArgumentError("Failed to read scene node records");
+  }
+  ASSIGN_OR_RETURN(
+      (const std::vector<unsigned char>& strings),
+      transit::ReadData(stream, header.data_length - records_length));
+  for (SceneNodeRecord& record : records) {
+    record = SwapRecordBytes(record);
+  }
+  RETURN_IF_ERROR(ValidateRecords(records, types.size(), strings.size()));
+
+  std::vector<const SceneNodeTypes::TypeInfo*> record_types;
+  record_types.reserve(node_count);
+  for (const SceneNodeRecord& record : records) {
+    record_types.push_back(types[record.type]);
+  }
+
+  // The subtrees of the root are independent, so they are split into
+  // contiguous ranges of roughly equal size and built in parallel.
+  std::vector<std::shared_ptr<Node>> nodes(node_count);
+  BuildNodes(records, record_types, strings.data(), 0, 1, nodes);
+  thread_count = std::max(1, std::min<int>(thread_count, node_count - 1));
+  const uint32_t target_size = (node_count - 1) / thread_count + 1;
+  std::vector<std::thread> threads;
+  uint32_t begin = 1;
+  while (begin < node_count) {
+    uint32_t end = begin;
+    while (end < node_count && end - begin < target_size) {
+      end += records[end].subtree_size;
+    }
+    if (end == node_count || threads.size() + 1 == thread_count) {
+      BuildNodes(records, record_types, strings.data(), begin, node_count,
+                 nodes);
+      break;
+    }
+    threads.emplace_back(BuildNodes, std::cref(records),
+                         std::cref(record_types), strings.data(), begin, end,
+                         std::ref(nodes));
+    begin = end;
+  }
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+
+  const std::shared_ptr<Node>& root = nodes[0];
+  for (uint32_t i = 1; i < node_count; i += records[i].subtree_size) {
+    nodes[i]->parent = root;
+    root->children.push_back(nodes[i]);
+  }
+
+  for (uint32_t i = 0; i < node_count; i++) {
+    const SceneNodeRecord& record = records[i];
+    if (!record_types[i]->read_fields) {
+      continue;
+    }
+    SceneFieldReader reader(strings.data() + record.fields_offset,
+                            record.fields_length);
+    const absl::Status status = record_types[i]->read_fields(*nodes[i], reader);
+    if (!status.ok()) {
+      return absl::Status(
+          status.code(), STATUS_MESSAGE("Failed to read fields of node "
+                                        << i << ": " << status.message()));
+    }
+  }
+  return root;
+}
+
+absl::StatusOr<std::shared_ptr<Node>> SceneReader::Load(const std::string& file,
+                                                        int thread_count) {
+  std::ifstream stream(file, std::ios_base::binary | std::ios_base::in);
+  if (!stream.is_open()) {
+    return absl::FailedPreconditionError(
+        STATUS_MESSAGE("Failed to open file \"" << file << "\""));
+  }
+  return Read(stream, thread_count);
+}
+
+void SceneReader::BuildNodes(
+    const std::vector<SceneNodeRecord>& records,
+    const std::vector<const SceneNodeTypes::TypeInfo*>& record_types,
+    const unsigned char* strings, uint32_t begin, uint32_t end,
+    std::vector<std::shared_ptr<Node>>& nodes) {
+  for (uint32_t i = begin; i < end; i++) {
+    const SceneNodeRecord& record = records[i];
+    const SceneNodeTypes::TypeInfo* type = record_types[i];
+    nodes[i] = type->spawn();
+    Node& node = *nodes[i];
+    node.name.assign((const char*)strings + record.name_offset,
+                     record.name_length);
+
+    // The node is new, so it has no cached matrices to invalidate.
+    if (type->is_transform) {
+      Transform& transform = static_cast<Transform&>(node);
+      transform.position = transform.previous_position = record.position;
+      transform.rotation = transform.previous_rotation = record.rotation;
+      transform.scale = transform.previous_scale = record.scale;
+    }
+
+    // Records are in pre-order, so children are appended in order.
+    if (record.parent != kNoParent && record.parent >= begin) {
+      const std::shared_ptr<Node>& parent = nodes[record.parent];
+      node.parent = parent;
+      parent->children.push_back(nodes[i]);
+    }
+  }
+}
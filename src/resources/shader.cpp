@@ -9,7 +9,9 @@
 #include <optional>
 #include <sstream>
 
+#include "resources/derived_cache.h"
 #include "resources/resource.h"
+#include "utility/blob.h"
 
 absl::StatusOr<std::string> getShaderCode(const Shader::Details& details) {
   if (!details.read_file) {
@@ -41,29 +43,111 @@ GLuint getGLShaderType(const Shader::Type type) {
 
 absl::StatusOr<std::shared_ptr<Shader>> Shader::Load(const Details& details) {
   std::shared_ptr<Shader> shader(new Shader());
-  ASSIGN_OR_RETURN((const std::string& shader_code), getShaderCode(details));
+  ASSIGN_OR_RETURN((shader->source), getShaderCode(details));
+  shader->type = details.type;
+  return shader;
+}
 
-  const char* shader_source = shader_code.c_str();
+Shader::~Shader() { glDeleteShader(id); }
+
+absl::Status Shader::Compile() {
+  if (id) {
+    return absl::OkStatus();
+  }
+  const char* shader_source = source.c_str();
 
-  shader->id = glCreateShader(getGLShaderType(details.type));
-  glShaderSource(shader->id, 1, &shader_source, NULL);
-  glCompileShader(shader->id);
+  id = glCreateShader(getGLShaderType(type));
+  glShaderSource(id, 1, &shader_source, NULL);
+  glCompileShader(id);
   GLint success;
-  glGetShaderiv(shader->id, GL_COMPILE_STATUS, &success);
+  glGetShaderiv(id, GL_COMPILE_STATUS, &success);
   if (!success) {
     GLint info_length;
-    glGetShaderiv(shader->id, GL_INFO_LOG_LENGTH, &info_length);
+    glGetShaderiv(id, GL_INFO_LOG_LENGTH, &info_length);
     std::string log;
     log.resize(info_length + 1);
     log.back() = 0;
-    glGetShaderInfoLog(shader->id, info_length, NULL, log.data());
+    glGetShaderInfoLog(id, info_length, NULL, log.data());
+    glDeleteShader(id);
+    id = 0;
     return absl::InvalidArgumentError(
         STATUS_MESSAGE("Failed to compile shader: " << log));
   }
-  return shader;
+  return absl::OkStatus();
 }
 
-Shader::~Shader() { glDeleteShader(id); }
+// Version of the data Program::Load stores in the derived data cache.
+constexpr uint32_t kProgramCacheVersion = 1;
+
+bool SupportsProgramBinaries() {
+  if (!GLEW_ARB_get_program_binary) {
+    return false;
+  }
+  GLint format_count = 0;
+  glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &format_count);
+  return format_count > 0;
+}
+
+// Hashes the identity of the driver, since program binaries are only valid
+// for the driver that produced them.
+uint64_t HashDriver() {
+  uint64_t hash = DerivedDataCache::kHashSeed;
+  for (const GLenum name : {GL_VENDOR, GL_RENDERER, GL_VERSION}) {
+    const char* value = (const char*)glGetString(name);
+    hash = DerivedDataCache::Hash(value ? value : "", hash);
+  }
+  return hash;
+}
+
+// Tries to create a program from a cached binary. Returns 0 on failure.
+GLuint LoadCachedProgram(const DerivedDataCache::Key& cache_key) {
+  const absl::StatusOr<std::vector<unsigned char>> cached_data =
+      DerivedDataCache::Get().Read(cache_key);
+  if (!cached_data.ok()) {
+    return 0;
+  }
+  BlobReader reader(*cached_data);
+  GLenum binary_format;
+  std::vector<unsigned char> binary;
+  if (!reader.Read(binary_format) || !reader.ReadVector(binary) ||
+      !reader.IsDone()) {
+    return 0;
+  }
+  const GLuint id = glCreateProgram();
+  glProgramBinary(id, binary_format, binary.data(), binary.size());
+  // The driver may reject binaries from an older build of itself, in which
+  // case we fall back to compiling.
+  GLint success;
+  glGetProgramiv(id, GL_LINK_STATUS, &success);
+  if (!success) {
+    glDeleteProgram(id);
+    return 0;
+  }
+  return id;
+}
+
+void StoreCachedProgram(const DerivedDataCache::Key& cache_key, GLuint id) {
+  GLint binary_length = 0;
+  glGetProgramiv(id, GL_PROGRAM_BINARY_LENGTH, &binary_length);
+  if (binary_length <= 0) {
+    return;
+  }
+  GLenum binary_format;
+  std::vector<unsigned char> binary;
+  binary.resize(binary_length);
+  glGetProgramBinary(id, binary_length, &binary_length, &binary_format,
+                     binary.data());
+  binary.resize(binary_length);
+
+  BlobWriter writer;
+  writer.Write(binary_format);
+  writer.WriteVector(binary);
+  const absl::Status write_status =
+      DerivedDataCache::Get().Write(cache_key, writer.data);
+  if (!write_status.ok()) {
+    LOG(WARNING) << "Failed to cache program binary: " << write_status;
+  }
+}
 
 absl::StatusOr<std::shared_ptr<Program>> Program::Load(const Details& details) {
   std::vector<std::shared_ptr<Shader>> shaders;
@@ -80,10 +164,36 @@ absl::StatusOr<std::shared_ptr<Program>> Program::Load(const Details& details) {
     ASSIGN_OR_RETURN((shaders.back()), fragment_shader_handle.Get());
   }
   std::shared_ptr<Program> program(new Program());
+
+  const bool use_cache =
+      DerivedDataCache::Get().IsEnabled() && SupportsProgramBinaries();
+  DerivedDataCache::Key cache_key;
+  if (use_cache) {
+    uint64_t source_hash = HashDriver();
+    for (const std::shared_ptr<Shader>& shader : shaders) {
+      source_hash = DerivedDataCache::Hash(&shader->type, sizeof(Shader::Type),
+                                           source_hash);
+      source_hash = DerivedDataCache::Hash(shader->source, source_hash);
+    }
+    cache_key = {"program", kProgramCacheVersion, source_hash};
+    program->id = LoadCachedProgram(cache_key);
+    if (program->id) {
+      program->Introspect();
+      return program;
+    }
+  }
+
+  for (const std::shared_ptr<Shader>& shader : shaders) {
+    RETURN_IF_ERROR(shader->Compile());
+  }
   program->id = glCreateProgram();
   for (const std::shared_ptr<Shader>& shader : shaders) {
     glAttachShader(program->id, shader->id);
   }
+  if (use_cache) {
+    glProgramParameteri(program->id, GL_PROGRAM_BINARY_RETRIEVABLE_HINT,
+                        GL_TRUE);
+  }
   glLinkProgram(program->id);
 
   GLint success;
@@ -103,6 +213,10 @@ absl::StatusOr<std::shared_ptr<Program>> Program::Load(const Details& details) {
     glDetachShader(program->id, shader->id);
   }
 
+  if (use_cache) {
+    StoreCachedProgram(cache_key, program->id);
+  }
+  program->Introspect();
   return program;
 }
 
@@ -110,14 +224,217 @@ Program::~Program() { glDeleteProgram(id); }
 
 void Program::Use() { glUseProgram(id); }
 
+GLuint Program::GetId() const { return id; }
+
 GLuint Program::GetUniformLocation(const std::string& name) const {
-  return glGetUniformLocation(id, name.c_str());
+  const auto index_it = uniform_indices.find(name);
+  if (index_it == uniform_indices.end()) {
+    return -1;
+  }
+  return uniforms[index_it->second].location;
 }
 
 GLuint Program::GetUniformBlockIndex(const std::string& name) const {
-  return glGetUniformBlockIndex(id, name.c_str());
+  const auto index_it = uniform_block_indices.find(name);
+  if (index_it == uniform_block_indices.end()) {
+    return GL_INVALID_INDEX;
+  }
+  return index_it->second;
+}
+
+const Program::UniformBlockInfo* Program::GetUniformBlock(
+    const std::string& name) const {
+  const auto index_it = uniform_block_indices.find(name);
+  if (index_it == uniform_block_indices.end()) {
+    return nullptr;
+  }
+  return &uniform_blocks[index_it->second];
 }
 
 void Program::SetUniformBlockBinding(GLuint block_index, GLuint block_binding) {
+  if (block_index < uniform_block_bindings.size()) {
+    if (uniform_block_bindings[block_index] == (GLint)block_binding) {
+      return;
+    }
+    uniform_block_bindings[block_index] = block_binding;
+  }
   glUniformBlockBinding(id, block_index, block_binding);
 }
+
+bool IsSamplerType(GLenum type) {
+  switch (type) {
+    case GL_SAMPLER_1D:
+    case GL_SAMPLER_2D:
+    case GL_SAMPLER_3D:
+    case GL_SAMPLER_CUBE:
+    case GL_SAMPLER_1D_SHADOW:
+    case GL_SAMPLER_2D_SHADOW:
+    case GL_SAMPLER_1D_ARRAY:
+    case GL_SAMPLER_2D_ARRAY:
+    case GL_SAMPLER_2D_ARRAY_SHADOW:
+    case GL_SAMPLER_CUBE_SHADOW:
+    case GL_SAMPLER_BUFFER:
+    case GL_INT_SAMPLER_2D:
+    case GL_UNSIGNED_INT_SAMPLER_2D:
+      return true;
+    default:
+      return false;
+  }
+}
+
+// Returns the size in bytes of a single value of uniform `type`, or 0 if
+// values of the type are not shadowed.
+unsigned int GetShadowSize(GLenum type) {
+  switch (type) {
+    case GL_FLOAT:
+    case GL_INT:
+    case GL_UNSIGNED_INT:
+    case GL_BOOL:
+      return 4;
+    case GL_FLOAT_VEC2:
+      return sizeof(glm::vec2);
+    case GL_FLOAT_VEC3:
+      return sizeof(glm::vec3);
+    case GL_FLOAT_VEC4:
+      return sizeof(glm::vec4);
+    case GL_FLOAT_MAT4:
+      return sizeof(glm::mat4);
+    default:
+      // Samplers are set through integers.
+      return IsSamplerType(type) ? 4 : 0;
+  }
+}
+
+void Program::Introspect() {
+  GLint block_count = 0;
+  GLint max_name_length = 0;
+  glGetProgramiv(id, GL_ACTIVE_UNIFORM_BLOCKS, &block_count);
+  glGetProgramiv(id, GL_ACTIVE_UNIFORM_BLOCK_MAX_NAME_LENGTH, &max_name_length);
+  std::string name_buffer;
+  name_buffer.resize(max_name_length + 1);
+  uniform_blocks.reserve(block_count);
+  uniform_block_bindings.reserve(block_count);
+  for (GLint i = 0; i < block_count; i++) {
+    GLsizei name_length = 0;
+    glGetActiveUniformBlockName(id, i, name_buffer.size(), &name_length,
+                                name_buffer.data());
+    uniform_block_indices.insert(
+        std::make_pair(std::string(name_buffer.data(), name_length), i));
+    UniformBlockInfo& block = uniform_blocks.emplace_back();
+    block.index = i;
+    glGetActiveUniformBlockiv(id, i, GL_UNIFORM_BLOCK_DATA_SIZE,
+                              &block.data_size);
+    GLint binding = 0;
+    glGetActiveUniformBlockiv(id, i, GL_UNIFORM_BLOCK_BINDING, &binding);
+    uniform_block_bindings.push_back(binding);
+  }
+
+  GLint uniform_count = 0;
+  glGetProgramiv(id, GL_ACTIVE_UNIFORMS, &uniform_count);
+  glGetProgramiv(id, GL_ACTIVE_UNIFORM_MAX_LENGTH, &max_name_length);
+  name_buffer.resize(max_name_length + 1);
+  for (GLint i = 0; i < uniform_count; i++) {
+    GLsizei name_length = 0;
+    GLint size;
+    GLenum type;
+    glGetActiveUniform(id, i, name_buffer.size(), &name_length, &size, &type,
+                       name_buffer.data());
+    std::string name(name_buffer.data(), name_length);
+    // Arrays are reported as "name[0]", but are usually referred to as "name".
+    std::string array_name;
+    if (name.size() > 3 && name.compare(name.size() - 3, 3, "[0]") == 0) {
+      array_name = name.substr(0, name.size() - 3);
+    }
+
+    const GLuint uniform_index = i;
+    GLint block_index = -1;
+    glGetActiveUniformsiv(id, 1, &uniform_index, GL_UNIFORM_BLOCK_INDEX,
+                          &block_index);
+    if (block_index >= 0) {
+      // Uniforms inside uniform blocks have no location, only an offset.
+      GLint offset = 0;
+      glGetActiveUniformsiv(id, 1, &uniform_index, GL_UNIFORM_OFFSET, &offset);
+      UniformBlockInfo& block = uniform_blocks[block_index];
+      if (!array_name.empty()) {
+        block.member_offsets.insert(std::make_pair(array_name, offset));
+      }
+      block.member_offsets.insert(std::make_pair(std::move(name), offset));
+      continue;
+    }
+
+    const GLint location = glGetUniformLocation(id, name.c_str());
+    if (location < 0) {
+      continue;
+    }
+    int shadow_offset = -1;
+    const unsigned int shadow_size = GetShadowSize(type);
+    if (size == 1 && shadow_size > 0) {
+      shadow_offset = shadow_values.size();
+      shadow_values.resize(shadow_values.size() + shadow_size);
+    }
+    const int index = uniforms.size();
+    uniforms.push_back({location, type, size, shadow_offset, false});
+    if (!array_name.empty()) {
+      uniform_indices.insert(std::make_pair(array_name, index));
+    }
+    uniform_indices.insert(std::make_pair(std::move(name), index));
+  }
+}
+
+bool Program::UpdateShadow(int index, const void* value, size_t size) {
+  UniformInfo& info = uniforms[index];
+  if (info.shadow_offset < 0) {
+    return true;
+  }
+  unsigned char* shadow = shadow_values.data() + info.shadow_offset;
+  if (info.shadow_valid && memcmp(shadow, value, size) == 0) {
+    return false;
+  }
+  memcpy(shadow, value, size);
+  info.shadow_valid = true;
+  return true;
+}
+
+bool Program::MatchesType(GLenum type, const float*) {
+  return type == GL_FLOAT;
+}
+bool Program::MatchesType(GLenum type, const int*) {
+  return type == GL_INT || type == GL_BOOL || IsSamplerType(type);
+}
+bool Program::MatchesType(GLenum type, const unsigned int*) {
+  return type == GL_UNSIGNED_INT;
+}
+bool Program::MatchesType(GLenum type, const glm::vec2*) {
+  return type == GL_FLOAT_VEC2;
+}
+bool Program::MatchesType(GLenum type, const glm::vec3*) {
+  return type == GL_FLOAT_VEC3;
+}
+bool Program::MatchesType(GLenum type, const glm::vec4*) {
+  return type == GL_FLOAT_VEC4;
+}
+bool Program::MatchesType(GLenum type, const glm::mat4*) {
+  return type == GL_FLOAT_MAT4;
+}
+
+void Program::Upload(GLint location, float value) {
+  glUniform1f(location, value);
+}
+void Program::Upload(GLint location, int value) {
+  glUniform1i(location, value);
+}
+void Program::Upload(GLint location, unsigned int value) {
+  glUniform1ui(location, value);
+}
+void Program::Upload(GLint location, const glm::vec2& value) {
+  glUniform2fv(location, 1, &value[0]);
+}
+void Program::Upload(GLint location, const glm::vec3& value) {
+  glUniform3fv(location, 1, &value[0]);
+}
+void Program::Upload(GLint location, const glm::vec4& value) {
+  glUniform4fv(location, 1, &value[0]);
+}
+void Program::Upload(GLint location, const glm::mat4& value) {
+  glUniformMatrix4fv(location, 1, false, &value[0][0]);
+}
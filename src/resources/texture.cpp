@@ -109,6 +109,27 @@ Texture::pixel_grey_32* Texture::GetDataAsGrey32() const {
   return data_grey_32;
 }
 
+void* Texture::GetData() const { return data_rgba_8; }
+
+size_t Texture::GetDataSize() const {
+  unsigned int channels;
+  switch (pixel_type) {
+    case PixelType::RGBA:
+      channels = 4;
+      break;
+    case PixelType::RGB:
+      channels = 3;
+      break;
+    case PixelType::Grey:
+      channels = 1;
+      break;
+    default:
+      CHECK(false);
+      return 0;
+  }
+  return (size_t)width * height * channels * (bit_depth / 8);
+}
+
 uint32_t Texture::GetWidth() const { return width; }
 
 uint32_t Texture::GetHeight() const { return height; }
@@ -225,5 +246,7 @@ void RenderableTexture::Use(unsigned int texture_unit) {
   glBindTexture(GL_TEXTURE_2D, id);
 }
 
+GLuint RenderableTexture::GetId() const { return id; }
+
 uint32_t RenderableTexture::GetWidth() const { return width; }
 uint32_t RenderableTexture::GetHeight() const { return height; }
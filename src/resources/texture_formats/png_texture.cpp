@@ -4,8 +4,13 @@
 #include <glog/logging.h>
 #include <png.h>
 
+#include <cstring>
 #include <fstream>
+#include <sstream>
+#include <vector>
 
+#include "resources/derived_cache.h"
+#include "utility/blob.h"
 #include "utility/hton.h"
 #include "utility/scope_cleanup.h"
 
@@ -14,19 +19,67 @@ void ReadPngFile(png_structp png_ptr, png_bytep out_bytes,
   png_voidp io_ptr = png_get_io_ptr(png_ptr);
   CHECK(io_ptr);
 
-  std::ifstream& file = *static_cast<std::ifstream*>(io_ptr);
+  std::istream& file = *static_cast<std::istream*>(io_ptr);
   file.read((char*)out_bytes, bytes_to_read);
   CHECK_EQ(bytes_to_read, file.gcount());
 }
 
-absl::StatusOr<std::shared_ptr<Texture>> PngTexture::Load(
-    const Details& details) {
-  std::ifstream file(details.file, std::ios::in | std::ios::binary);
-  if (!file.is_open()) {
-    return absl::NotFoundError(
-        STATUS_MESSAGE("Failed to open file \"" << details.file << "\""));
+void WritePngFile(png_structp png_ptr, png_bytep bytes,
+                  png_size_t bytes_to_write) {
+  png_voidp io_ptr = png_get_io_ptr(png_ptr);
+  CHECK(io_ptr);
+
+  std::ostream& file = *static_cast<std::ostream*>(io_ptr);
+  file.write((const char*)bytes, bytes_to_write);
+}
+
+void FlushPngFile(png_structp png_ptr) {
+  png_voidp io_ptr = png_get_io_ptr(png_ptr);
+  CHECK(io_ptr);
+
+  static_cast<std::ostream*>(io_ptr)->flush();
+}
+
+// Version of the processed data PngTexture::Load stores in the derived data
+// cache. Bump whenever decoding or the cached layout changes.
+constexpr uint32_t kPngCacheVersion = 1;
+
+std::shared_ptr<Texture> ReadCachedTexture(
+    const std::vector<unsigned char>& data) {
+  BlobReader reader(data);
+  Texture::PixelType pixel_type;
+  uint32_t bit_depth, width, height;
+  if (!reader.Read(pixel_type) || !reader.Read(bit_depth) ||
+      !reader.Read(width) || !reader.Read(height)) {
+    return nullptr;
+  }
+  if ((pixel_type != Texture::PixelType::RGBA &&
+       pixel_type != Texture::PixelType::RGB &&
+       pixel_type != Texture::PixelType::Grey) ||
+      (bit_depth != 8 && bit_depth != 16)) {
+    return nullptr;
+  }
+  std::shared_ptr<Texture> texture(
+      new Texture(pixel_type, bit_depth, width, height));
+  if (!reader.ReadBytes(texture->GetData(), texture->GetDataSize()) ||
+      !reader.IsDone()) {
+    return nullptr;
   }
+  return texture;
+}
+
+std::vector<unsigned char> WriteCachedTexture(const Texture& texture) {
+  BlobWriter writer;
+  writer.Write(texture.GetPixelType());
+  writer.Write<uint32_t>(texture.GetBitDepth());
+  writer.Write(texture.GetWidth());
+  writer.Write(texture.GetHeight());
+  writer.WriteBytes(texture.GetData(), texture.GetDataSize());
+  return writer.data;
+}
 
+absl::StatusOr<std::shared_ptr<Texture>> DecodePng(
+    std::istream& file, const PngTexture::Details& details) {
   png_byte header[8];
   file.read((char*)header, 8);
   if (file.bad()) {
@@ -189,3 +242,127 @@ absl::StatusOr<std::shared_ptr<Texture>> PngTexture::Load(
           STATUS_MESSAGE("Unable to process PNG colour type " << colour_type));
   }
 }
+
+absl::StatusOr<std::shared_ptr<Texture>> PngTexture::Load(
+    const Details& details) {
+  std::string contents;
+  const absl::StatusOr<uint64_t> source_hash =
+      DerivedDataCache::HashFile(details.file, contents);
+  if (!source_hash.ok()) {
+    return absl::NotFoundError(
+        STATUS_MESSAGE("Failed to open file \"" << details.file << "\""));
+  }
+
+  const DerivedDataCache::Key cache_key{"png", kPngCacheVersion, *source_hash};
+  const absl::StatusOr<std::vector<unsigned char>> cached_data =
+      DerivedDataCache::Get().Read(cache_key);
+  if (cached_data.ok()) {
+    std::shared_ptr<Texture> texture = ReadCachedTexture(*cached_data);
+    if (texture) {
+      return texture;
+    }
+    LOG(WARNING) << "Discarding malformed cache entry for \"" << details.file
+                 << "\"";
+  }
+
+  std::istringstream file(contents, std::ios::in | std::ios::binary);
+  ASSIGN_OR_RETURN((std::shared_ptr<Texture> texture),
+                   DecodePng(file, details));
+
+  const absl::Status write_status =
+      DerivedDataCache::Get().Write(cache_key, WriteCachedTexture(*texture));
+  if (!write_status.ok()) {
+    LOG(WARNING) << "Failed to cache \"" << details.file
+                 << "\": " << write_status;
+  }
+  return texture;
+}
+
+absl::Status PngTexture::Save(const Texture& texture, const std::string& file) {
+  int colour_type;
+  unsigned int channels;
+  switch (texture.GetPixelType()) {
+    case Texture::PixelType::RGBA:
+      colour_type = PNG_COLOR_TYPE_RGBA;
+      channels = 4;
+      break;
+    case Texture::PixelType::RGB:
+      colour_type = PNG_COLOR_TYPE_RGB;
+      channels = 3;
+      break;
+    case Texture::PixelType::Grey:
+    default:
+      colour_type = PNG_COLOR_TYPE_GRAY;
+      channels = 1;
+      break;
+  }
+  const unsigned int bit_depth = texture.GetBitDepth();
+  if (bit_depth != 8 && bit_depth != 16) {
+    return absl::FailedPreconditionError(STATUS_MESSAGE(
+        "Invalid bit depth: " << bit_depth << ". Must be 8 or 16."));
+  }
+
+  std::ofstream output(file, std::ios::out | std::ios::binary);
+  if (!output) {
+    return absl::InternalError(
+        STATUS_MESSAGE("Failed to open file \"" << file << "\""));
+  }
+
+  png_structp png_ptr =
+      png_create_write_struct(PNG_LIBPNG_VER_STRING, NULL, NULL, NULL);
+  if (!png_ptr) {
+    return absl::InternalError("Failed to initialize libpng");
+  }
+
+  png_infop info_ptr = png_create_info_struct(png_ptr);
+  if (!info_ptr) {
+    png_destroy_write_struct(&png_ptr, NULL);
+    return absl::InternalError("Failed to create info struct for libpng");
+  }
+
+  const ScopeCleanup cleanup_png([&png_ptr, &info_ptr]() {
+    png_destroy_write_struct(&png_ptr, &info_ptr);
+  });
+
+  const uint32_t width = texture.GetWidth();
+  const uint32_t height = texture.GetHeight();
+  const size_t row_bytes = (size_t)width * channels * (bit_depth / 8);
+  std::vector<png_byte> row_data(row_bytes);
+
+  if (setjmp(png_jmpbuf(png_ptr))) {
+    return absl::InternalError("libpng failure.");
+  }
+
+  png_set_write_fn(png_ptr, &output, WritePngFile, FlushPngFile);
+  png_set_IHDR(png_ptr, info_ptr, width, height, bit_depth, colour_type,
+               PNG_INTERLACE_NONE, PNG_COMPRESSION_TYPE_DEFAULT,
+               PNG_FILTER_TYPE_DEFAULT);
+  png_write_info(png_ptr, info_ptr);
+
+  // Texture data is in channel order, with 16-bit channels in native order,
+  // while PNG stores 16-bit channels big endian.
+  const unsigned char* const data =
+      static_cast<const unsigned char*>(texture.GetData());
+  for (uint32_t row = 0; row < height; ++row) {
+    const unsigned char* const source = data + row * row_bytes;
+    if (bit_depth == 8) {
+      png_write_row(png_ptr, source);
+      continue;
+    }
+    for (size_t channel = 0; channel < row_bytes / 2; ++channel) {
+      uint16_t value;
+      memcpy(&value, source + channel * 2, sizeof(value));
+      row_data[channel * 2] = value >> 8;
+      row_data[channel * 2 + 1] = value & 0xFF;
+    }
+    png_write_row(png_ptr, row_data.data());
+  }
+  png_write_end(png_ptr, NULL);
+
+  output.close();
+  if (!output) {
+    return absl::InternalError(
+        STATUS_MESSAGE("Failed to write file \"" << file << "\""));
+  }
+  return absl::OkStatus();
+}
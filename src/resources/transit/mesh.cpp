@@ -10,6 +10,35 @@
 
 namespace transit {
 
+// The size of a BVH node in a file.
+constexpr unsigned int kBVHNodeSize = 6 * sizeof(float) + 2 * sizeof(uint32_t);
+
+// Reads a BVH of `node_count` nodes over `triangle_count` triangles from
+// `data`.
+absl::StatusOr<MeshBVH> ReadBVH(const unsigned char* data,
+                                unsigned int node_count,
+                                unsigned int triangle_count) {
+  std::vector<MeshBVH::Node> nodes(node_count);
+  for (MeshBVH::Node& node : nodes) {
+    glm::vec3 bounds[2];
+    memcpy(bounds, data, sizeof(bounds));
+    node.bounds = AABB(btoh(bounds[0]), btoh(bounds[1]));
+    memcpy(&node.offset, data + sizeof(bounds), sizeof(uint32_t));
+    node.offset = btoh(node.offset);
+    memcpy(&node.triangle_count, data + sizeof(bounds) + sizeof(uint32_t),
+           sizeof(uint32_t));
+    node.triangle_count = btoh(node.triangle_count);
+    data += kBVHNodeSize;
+  }
+  std::vector<uint32_t> triangle_order(triangle_count);
+  memcpy(triangle_order.data(), data, triangle_count * sizeof(uint32_t));
+  for (uint32_t& triangle : triangle_order) {
+    triangle = btoh(triangle);
+  }
+  return MeshBVH::Create(std::move(nodes), std::move(triangle_order),
+                         triangle_count);
+}
+
 template <>
 absl::StatusOr<std::shared_ptr<Mesh>> Load(const TransitDetails& details) {
   std::ifstream file(details.file, std::ios_base::binary | std::ios_base::in);
@@ -19,7 +48,9 @@ absl::StatusOr<std::shared_ptr<Mesh>> Load(const TransitDetails& details) {
   }
 
   ASSIGN_OR_RETURN((const TransitHeader& header), ReadHeader(file));
-  RETURN_IF_ERROR((VerifyHeader(header, "MESH", 1, 0)));
+  // Version 1.1 may store a BVH after the triangles.
+  const bool may_have_bvh = header.version[1] == 1;
+  RETURN_IF_ERROR((VerifyHeader(header, "MESH", 1, may_have_bvh ? 1 : 0)));
   ASSIGN_OR_RETURN((const nlohmann::json& json_data),
                    ReadJson(file, header.json_length));
   ASSIGN_OR_RETURN((const std::vector<unsigned char>& data),
@@ -36,12 +67,27 @@ absl::StatusOr<std::shared_ptr<Mesh>> Load(const TransitDetails& details) {
   bool indexing_mode_is_big = indexing_mode_str == "big";
   ASSIGN_OR_RETURN((const unsigned int triangles),
                    json::GetRequiredUint(json_data, "triangles"));
+  unsigned int bvh_nodes = 0;
+  if (may_have_bvh && json_data.contains("bvhNodes")) {
+    ASSIGN_OR_RETURN((bvh_nodes),
+                     json::GetRequiredUint(json_data, "bvhNodes"));
+  }
 
-  unsigned int expected_data_size =
+  const unsigned int mesh_data_size =
       sizeof(Mesh::Vertex) * vertices_count +
       (indexing_mode_is_big ? sizeof(Mesh::Triangle)
                             : sizeof(Mesh::SmallTriangle)) *
           triangles;
+  // Meshes without triangles use every three vertices as a triangle.
+  const unsigned int bvh_triangles =
+      triangles == 0 ? vertices_count / 3 : triangles;
+  // Every BVH node has its bounds followed by its offset and triangle count,
+  // and the triangle order follows the nodes.
+  const uint64_t bvh_data_size =
+      bvh_nodes == 0 ? 0
+                     : uint64_t(bvh_nodes) * kBVHNodeSize +
+                           uint64_t(bvh_triangles) * sizeof(uint32_t);
+  uint64_t expected_data_size = mesh_data_size + bvh_data_size;
   if (header.data_length != expected_data_size) {
     return absl::FailedPreconditionError(STATUS_MESSAGE(
         "Recieved data size does not match expected data size. Expected: "
@@ -85,6 +131,12 @@ absl::StatusOr<std::shared_ptr<Mesh>> Load(const TransitDetails& details) {
       new_triangle.points[2] = btoh(new_triangle.points[2]);
     }
   }
+  if (bvh_nodes != 0) {
+    ASSIGN_OR_RETURN(
+        (MeshBVH bvh),
+        ReadBVH(data.data() + mesh_data_size, bvh_nodes, bvh_triangles));
+    mesh->SetBVH(std::make_shared<const MeshBVH>(std::move(bvh)));
+  }
   return mesh;
 }
 
@@ -0,0 +1,94 @@
+
+#include "resources/uniform_buffer.h"
+
+#include <glog/logging.h>
+
+#include <algorithm>
+#include <cstring>
+
+UniformRingBuffer::UniformRingBuffer(GLsizeiptr frame_size_) {
+  glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &offset_alignment);
+  Create(frame_size_);
+}
+
+UniformRingBuffer::~UniformRingBuffer() { Destroy(); }
+
+void UniformRingBuffer::Create(GLsizeiptr frame_size_) {
+  // Round the segment size up so every segment starts aligned.
+  frame_size = (frame_size_ + offset_alignment - 1) / offset_alignment *
+               offset_alignment;
+  const GLsizeiptr total_size = frame_size * kFramesInFlight;
+  glGenBuffers(1, &id);
+  glBindBuffer(GL_UNIFORM_BUFFER, id);
+  if (GLEW_ARB_buffer_storage) {
+    const GLbitfield flags =
+        GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+    glBufferStorage(GL_UNIFORM_BUFFER, total_size, nullptr, flags);
+    mapped = (unsigned char*)glMapBufferRange(GL_UNIFORM_BUFFER, 0, total_size,
+                                              flags);
+  } else {
+    glBufferData(GL_UNIFORM_BUFFER, total_size, nullptr, GL_STREAM_DRAW);
+    mapped = nullptr;
+  }
+}
+
+void UniformRingBuffer::Destroy() {
+  for (GLsync& fence : fences) {
+    if (fence) {
+      glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, GL_TIMEOUT_IGNORED);
+      glDeleteSync(fence);
+      fence = nullptr;
+    }
+  }
+  if (mapped) {
+    glBindBuffer(GL_UNIFORM_BUFFER, id);
+    glUnmapBuffer(GL_UNIFORM_BUFFER);
+    mapped = nullptr;
+  }
+  glDeleteBuffers(1, &id);
+  id = 0;
+}
+
+void UniformRingBuffer::BeginFrame() {
+  if (overflowed) {
+    LOG(WARNING) << "Uniform ring buffer overflowed; growing to "
+                 << frame_size * 2 << " bytes per frame";
+    Destroy();
+    Create(frame_size * 2);
+    overflowed = false;
+  }
+  frame = (frame + 1) % kFramesInFlight;
+  frame_offset = 0;
+  GLsync& fence = fences[frame];
+  if (fence) {
+    glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, GL_TIMEOUT_IGNORED);
+    glDeleteSync(fence);
+    fence = nullptr;
+  }
+}
+
+void UniformRingBuffer::EndFrame() {
+  fences[frame] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+bool UniformRingBuffer::Push(GLStateTracker& state, UniformBinding binding,
+                             const void* data, GLsizeiptr size,
+                             GLsizeiptr bound_size) {
+  bound_size = std::max(size, bound_size);
+  if (frame_offset + bound_size > frame_size) {
+    overflowed = true;
+    return false;
+  }
+  const GLintptr offset = frame * frame_size + frame_offset;
+  if (mapped) {
+    memcpy(mapped + offset, data, size);
+  } else {
+    glBindBuffer(GL_UNIFORM_BUFFER, id);
+    glBufferSubData(GL_UNIFORM_BUFFER, offset, size, data);
+    state.CountCalls(2);
+  }
+  state.BindUniformBufferRange((GLuint)binding, id, offset, bound_size);
+  frame_offset += (bound_size + offset_alignment - 1) / offset_alignment *
+                  offset_alignment;
+  return true;
+}
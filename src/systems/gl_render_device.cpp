@@ -0,0 +1,396 @@
+
+#include "systems/gl_render_device.h"
+
+#include <glog/logging.h>
+
+#include <cstring>
+#include <memory>
+
+#include "resources/shader.h"
+#include "utility/status.h"
+
+// Writes only depth, for meshes in the Static layout. Each draw reads its
+// object from the "Object" array, which holds kMaxBatchObjects elements.
+#define STATIC_DEPTH_SHADER                                            \
+  "#version 330 core\n"                                                \
+  "layout(location = 0) in vec3 position;\n"                           \
+  "layout(location = 8) in uint object_index;\n"                       \
+  "struct ObjectData {\n"                                              \
+  "  mat4 model;\n"                                                    \
+  "  mat4 MVP;\n"                                                      \
+  "};\n"                                                               \
+  "layout(std140) uniform Object {\n"                                  \
+  "  ObjectData objects[128];\n"                                       \
+  "};\n"                                                               \
+  "void main() {\n"                                                    \
+  "  gl_Position = objects[object_index].MVP * vec4(position, 1.0);\n" \
+  "}\n"
+// Writes only depth, for meshes in the Skinned layout posed by the "Bones"
+// block.
+#define SKINNED_DEPTH_SHADER                                            \
+  "#version 330 core\n"                                                 \
+  "layout(location = 0) in vec3 position;\n"                            \
+  "layout(location = 6) in vec4 bone_weights;\n"                        \
+  "layout(location = 7) in ivec4 bones;\n"                              \
+  "layout(location = 8) in uint object_index;\n"                        \
+  "struct ObjectData {\n"                                               \
+  "  mat4 model;\n"                                                     \
+  "  mat4 MVP;\n"                                                       \
+  "};\n"                                                                \
+  "layout(std140) uniform Object {\n"                                   \
+  "  ObjectData objects[128];\n"                                        \
+  "};\n"                                                                \
+  "layout(std140) uniform Bones {\n"                                    \
+  "  mat4 pose_data[256];\n"                                            \
+  "};\n"                                                                \
+  "void main() {\n"                                                     \
+  "  vec4 point = vec4(position, 1.0);\n"                               \
+  "  vec4 posed = (pose_data[bones.x] * point) * bone_weights.x\n"      \
+  "    + (pose_data[bones.y] * point) * bone_weights.y\n"               \
+  "    + (pose_data[bones.z] * point) * bone_weights.z\n"               \
+  "    + (pose_data[bones.w] * point) * bone_weights.w;\n"              \
+  "  gl_Position = objects[object_index].MVP * vec4(posed.xyz, 1.0);\n" \
+  "}\n"
+
+// Links a material from the vertex shader `source` alone, so it only writes
+// depth.
+std::shared_ptr<Material> CreateDepthMaterial(const char* source) {
+  ASSIGN_CHECKED((std::shared_ptr<Shader> shader),
+                 Shader::Load({source, false, Shader::Type::Vertex}));
+  ASSIGN_CHECKED((std::shared_ptr<Program> program),
+                 Program::Load({{shader}, {}}));
+  ASSIGN_CHECKED((std::shared_ptr<Material> material),
+                 Material::Load({program, {}}));
+  return material;
+}
+
+GLRenderDevice::GLRenderDevice(GLFWwindow* window_, int swap_interval,
+                               GLsizeiptr object_uniform_capacity)
+    : window(window_), clear_colour(0.f, 0.f, 0.f, 0.f) {
+  CHECK(window) << "GLRenderDevice requires a window.";
+  glEnable(GL_CULL_FACE);
+  glEnable(GL_DEPTH_TEST);
+  glClearColor(clear_colour.x, clear_colour.y, clear_colour.z,
+               clear_colour.w);
+  glfwSwapInterval(swap_interval);
+
+  uniform_ring.reset(new UniformRingBuffer(object_uniform_capacity));
+  glGenBuffers(1, &indirect_buffer);
+  // Indirect draws may only use a nonzero base instance with ARB_base_instance.
+  if (GLEW_ARB_base_instance) {
+    max_batch_objects = kMaxBatchObjects;
+  }
+  queued_objects.reserve(max_batch_objects);
+
+  depth_materials[(int)GeometryArena::Layout::Static] =
+      CreateDepthMaterial(STATIC_DEPTH_SHADER);
+  depth_materials[(int)GeometryArena::Layout::Skinned] =
+      CreateDepthMaterial(SKINNED_DEPTH_SHADER);
+}
+
+GLRenderDevice::~GLRenderDevice() {
+  for (DepthTarget& target : depth_targets) {
+    DeleteDepthTarget(target);
+  }
+  glDeleteBuffers(1, &indirect_buffer);
+}
+
+glm::ivec2 GLRenderDevice::GetSurfaceSize() {
+  int width, height;
+  glfwGetWindowSize(window, &width, &height);
+  return glm::ivec2(width, height);
+}
+
+void GLRenderDevice::BeginFrame() {
+  // Anything outside of rendering, such as loading resources, may have
+  // changed the bindings since the last frame.
+  gl_state.Invalidate();
+  uniform_ring->BeginFrame();
+  failed_bindings = 0;
+  queued_objects.clear();
+  BindFramebuffer(0);
+  drawing_depth = false;
+}
+
+void GLRenderDevice::Submit(const RenderCommandBuffer& commands) {
+  commands.ForEach(
+      [this, &commands](const auto& command) { Execute(command, commands); });
+  FlushDraws();
+  commands_executed += commands.GetCommandCount();
+}
+
+void GLRenderDevice::EndFrame() {
+  uniform_ring->EndFrame();
+  gl_state.CountCalls();
+  gl_state.EndFrame();
+#ifdef SHEEP_PROFILER
+  gpu_timer.Collect();
+#endif
+  glfwSwapBuffers(window);
+
+  const GLStateTracker::Stats& gl_stats = gl_state.GetFrameStats();
+  frame_stats.commands = commands_executed;
+  frame_stats.draws = draws_executed;
+  frame_stats.calls = gl_stats.calls;
+  frame_stats.skipped_calls = gl_stats.skipped_calls;
+  commands_executed = 0;
+  draws_executed = 0;
+}
+
+const RenderDevice::Stats& GLRenderDevice::GetFrameStats() const {
+  return frame_stats;
+}
+
+GLStateTracker& GLRenderDevice::GetGLState() { return gl_state; }
+
+void GLRenderDevice::Execute(const RenderCommandBuffer::SetViewport& command,
+                             const RenderCommandBuffer& commands) {
+  FlushDraws();
+  glViewport(command.x, command.y, command.width, command.height);
+  gl_state.CountCalls();
+}
+
+void GLRenderDevice::Execute(const RenderCommandBuffer::Clear& command,
+                             const RenderCommandBuffer& commands) {
+  FlushDraws();
+  if (command.clear_colour && command.colour != clear_colour) {
+    clear_colour = command.colour;
+    glClearColor(clear_colour.x, clear_colour.y, clear_colour.z,
+                 clear_colour.w);
+    gl_state.CountCalls();
+  }
+  glClear((GL_COLOR_BUFFER_BIT * command.clear_colour) |
+          (GL_DEPTH_BUFFER_BIT * command.clear_depth));
+  gl_state.CountCalls();
+}
+
+void GLRenderDevice::Execute(const RenderCommandBuffer::SetUniforms& command,
+                             const RenderCommandBuffer& commands) {
+  if (command.binding == UniformBinding::Object) {
+    DCHECK_EQ(command.size, sizeof(ObjectUniforms));
+    // Queued draws keep reading their own objects, so only a full batch has to
+    // be flushed.
+    if (queued_objects.size() == max_batch_objects) {
+      FlushDraws();
+      queued_objects.clear();
+    }
+    queued_objects.emplace_back();
+    memcpy(&queued_objects.back(),
+           commands.GetUniformData(command.data_offset),
+           sizeof(ObjectUniforms));
+    return;
+  }
+  // Queued draws read the previous uniforms.
+  FlushDraws();
+  const unsigned int binding_bit = 1u << (GLuint)command.binding;
+  if (uniform_ring->Push(gl_state, command.binding,
+                         commands.GetUniformData(command.data_offset),
+                         command.size)) {
+    failed_bindings &= ~binding_bit;
+  } else {
+    failed_bindings |= binding_bit;
+  }
+}
+
+void GLRenderDevice::Execute(const RenderCommandBuffer::Draw& command,
+                             const RenderCommandBuffer& commands) {
+  if (failed_bindings || queued_objects.empty()) {
+    return;
+  }
+  Material* const material =
+      drawing_depth ? depth_materials[(int)command.arena->GetLayout()].get()
+                    : command.material;
+  if (material != queued_material || command.arena != queued_arena) {
+    FlushDraws();
+    queued_material = material;
+    queued_arena = command.arena;
+  }
+  queued_draws.push_back(command.command);
+  queued_draws.back().base_instance = (GLuint)queued_objects.size() - 1;
+  draws_executed++;
+}
+
+void GLRenderDevice::Execute(const RenderCommandBuffer::BeginPass& command,
+                             const RenderCommandBuffer& commands) {
+#ifdef SHEEP_PROFILER
+  FlushDraws();
+  gpu_timer.Begin(command.name);
+#endif
+}
+
+void GLRenderDevice::Execute(const RenderCommandBuffer::EndPass& command,
+                             const RenderCommandBuffer& commands) {
+#ifdef SHEEP_PROFILER
+  FlushDraws();
+  gpu_timer.End();
+#endif
+}
+
+void GLRenderDevice::Execute(
+    const RenderCommandBuffer::SetRenderTarget& command,
+    const RenderCommandBuffer& commands) {
+  FlushDraws();
+  if (command.target == RenderCommandBuffer::kSurface) {
+    BindFramebuffer(0);
+    drawing_depth = false;
+    return;
+  }
+  DCHECK_GE(command.target, 0);
+  DCHECK(command.layer >= 0 && command.layer < command.layers);
+  if ((size_t)command.target >= depth_targets.size()) {
+    depth_targets.resize(command.target + 1);
+  }
+  DepthTarget& target = depth_targets[command.target];
+  if (target.width != command.width || target.height != command.height ||
+      target.framebuffers.size() != (size_t)command.layers) {
+    ResizeDepthTarget(target, command.width, command.height, command.layers);
+  }
+  BindFramebuffer(target.framebuffers[command.layer]);
+  drawing_depth = true;
+}
+
+void GLRenderDevice::Execute(const RenderCommandBuffer::SetDepthBias& command,
+                             const RenderCommandBuffer& commands) {
+  const glm::vec2 bias(command.constant, command.slope);
+  if (bias == depth_bias) {
+    return;
+  }
+  FlushDraws();
+  if (bias == glm::vec2(0.f)) {
+    glDisable(GL_POLYGON_OFFSET_FILL);
+    gl_state.CountCalls();
+  } else {
+    if (depth_bias == glm::vec2(0.f)) {
+      glEnable(GL_POLYGON_OFFSET_FILL);
+      gl_state.CountCalls();
+    }
+    glPolygonOffset(command.slope, command.constant);
+    gl_state.CountCalls();
+  }
+  depth_bias = bias;
+}
+
+void GLRenderDevice::Execute(
+    const RenderCommandBuffer::BindTargetTexture& command,
+    const RenderCommandBuffer& commands) {
+  FlushDraws();
+  DCHECK(command.target >= 0 &&
+         (size_t)command.target < depth_targets.size());
+  gl_state.BindTexture(command.unit, GL_TEXTURE_2D_ARRAY,
+                       depth_targets[command.target].texture);
+}
+
+void GLRenderDevice::ResizeDepthTarget(DepthTarget& target, int width,
+                                       int height, int layers) {
+  DeleteDepthTarget(target);
+  target.width = width;
+  target.height = height;
+
+  glGenTextures(1, &target.texture);
+  glBindTexture(GL_TEXTURE_2D_ARRAY, target.texture);
+  glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_DEPTH_COMPONENT32F, width, height,
+               layers, 0, GL_DEPTH_COMPONENT, GL_FLOAT, nullptr);
+  // Linear filtering of a comparison sampler blends the results of the four
+  // nearest depth tests, softening shadow edges for free.
+  glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
+  glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
+  // Anything outside the map is unshadowed.
+  const float border[4] = {1.f, 1.f, 1.f, 1.f};
+  glTexParameterfv(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_BORDER_COLOR, border);
+  glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_COMPARE_MODE,
+                  GL_COMPARE_REF_TO_TEXTURE);
+  glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
+  gl_state.CountCalls(10);
+
+  target.framebuffers.resize(layers);
+  glGenFramebuffers(layers, target.framebuffers.data());
+  gl_state.CountCalls();
+  for (int layer = 0; layer < layers; layer++) {
+    BindFramebuffer(target.framebuffers[layer]);
+    glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT,
+                              target.texture, 0, layer);
+    glDrawBuffer(GL_NONE);
+    glReadBuffer(GL_NONE);
+    gl_state.CountCalls(3);
+    LOG_IF(ERROR, glCheckFramebufferStatus(GL_FRAMEBUFFER) !=
+                      GL_FRAMEBUFFER_COMPLETE)
+        << "Depth target layer " << layer << " is incomplete.";
+  }
+  // The texture was bound to whichever unit was active.
+  gl_state.Invalidate();
+}
+
+void GLRenderDevice::DeleteDepthTarget(DepthTarget& target) {
+  for (GLuint framebuffer : target.framebuffers) {
+    if (framebuffer == bound_framebuffer) {
+      BindFramebuffer(0);
+    }
+  }
+  glDeleteFramebuffers(target.framebuffers.size(), target.framebuffers.data());
+  glDeleteTextures(1, &target.texture);
+  target.framebuffers.clear();
+  target.texture = 0;
+}
+
+void GLRenderDevice::BindFramebuffer(GLuint framebuffer) {
+  if (bound_framebuffer == framebuffer) {
+    return;
+  }
+  glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+  gl_state.CountCalls();
+  bound_framebuffer = framebuffer;
+}
+
+void GLRenderDevice::FlushDraws() {
+  if (queued_draws.empty()) {
+    return;
+  }
+  // Programs declare the whole array, so the whole block is bound. If it does
+  // not fit, the batch is skipped rather than reading stale objects.
+  const bool objects_pushed = uniform_ring->Push(
+      gl_state, UniformBinding::Object, queued_objects.data(),
+      sizeof(ObjectUniforms) * queued_objects.size(),
+      sizeof(ObjectUniforms) * kMaxBatchObjects);
+  // Later draws still read the last object, so it starts the next batch.
+  queued_objects.front() = queued_objects.back();
+  queued_objects.resize(1);
+  if (!objects_pushed) {
+    queued_draws.clear();
+    queued_material = nullptr;
+    queued_arena = nullptr;
+    return;
+  }
+  queued_material->Use(gl_state);
+  gl_state.BindVertexArray(queued_arena->GetVertexArray());
+  if (GLEW_ARB_multi_draw_indirect && GLEW_ARB_base_instance) {
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, indirect_buffer);
+    glBufferData(GL_DRAW_INDIRECT_BUFFER,
+                 sizeof(DrawElementsIndirectCommand) * queued_draws.size(),
+                 queued_draws.data(), GL_STREAM_DRAW);
+    glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, nullptr,
+                                queued_draws.size(), 0);
+    gl_state.CountCalls(2);
+    gl_state.CountDraw();
+  } else {
+    for (const DrawElementsIndirectCommand& command : queued_draws) {
+      if (GLEW_ARB_base_instance) {
+        glDrawElementsInstancedBaseVertexBaseInstance(
+            GL_TRIANGLES, command.count, GL_UNSIGNED_INT,
+            (void*)(sizeof(GLuint) * command.first_index), 1,
+            command.base_vertex, command.base_instance);
+      } else {
+        // Batches only hold one object, at index 0.
+        glDrawElementsBaseVertex(
+            GL_TRIANGLES, command.count, GL_UNSIGNED_INT,
+            (void*)(sizeof(GLuint) * command.first_index),
+            command.base_vertex);
+      }
+      gl_state.CountDraw();
+    }
+  }
+  queued_draws.clear();
+  queued_material = nullptr;
+  queued_arena = nullptr;
+}
@@ -0,0 +1,95 @@
+
+#include "systems/gl_state_tracker.h"
+
+void GLStateTracker::BindVertexArray(GLuint vao_) {
+  if (vao == vao_) {
+    current_stats.skipped_calls++;
+    return;
+  }
+  vao = vao_;
+  glBindVertexArray(vao);
+  current_stats.calls++;
+}
+
+void GLStateTracker::UseProgram(GLuint program_) {
+  if (program == program_) {
+    current_stats.skipped_calls++;
+    return;
+  }
+  program = program_;
+  glUseProgram(program);
+  current_stats.calls++;
+}
+
+void GLStateTracker::BindUniformBuffer(GLuint binding, GLuint buffer) {
+  BindUniformBufferRange(binding, buffer, 0, -1);
+}
+
+void GLStateTracker::BindUniformBufferRange(GLuint binding, GLuint buffer,
+                                            GLintptr offset,
+                                            GLsizeiptr size) {
+  if (binding >= uniform_buffers.size()) {
+    uniform_buffers.resize(binding + 1);
+  }
+  BufferRange& range = uniform_buffers[binding];
+  if (range.buffer == buffer && range.offset == offset &&
+      range.size == size) {
+    current_stats.skipped_calls++;
+    return;
+  }
+  range = {buffer, offset, size};
+  if (size < 0) {
+    glBindBufferBase(GL_UNIFORM_BUFFER, binding, buffer);
+  } else {
+    glBindBufferRange(GL_UNIFORM_BUFFER, binding, buffer, offset, size);
+  }
+  current_stats.calls++;
+}
+
+void GLStateTracker::BindTexture2D(GLuint unit, GLuint texture) {
+  BindTexture(unit, GL_TEXTURE_2D, texture);
+}
+
+void GLStateTracker::BindTexture(GLuint unit, GLenum target, GLuint texture) {
+  if (unit >= textures.size()) {
+    textures.resize(unit + 1, kUnknown);
+  }
+  if (textures[unit] == texture) {
+    current_stats.skipped_calls++;
+    return;
+  }
+  if (active_texture_unit != unit) {
+    active_texture_unit = unit;
+    glActiveTexture(GL_TEXTURE0 + unit);
+    current_stats.calls++;
+  }
+  textures[unit] = texture;
+  glBindTexture(target, texture);
+  current_stats.calls++;
+}
+
+void GLStateTracker::CountCalls(unsigned int count) {
+  current_stats.calls += count;
+}
+
+void GLStateTracker::CountDraw() {
+  current_stats.calls++;
+  current_stats.draws++;
+}
+
+void GLStateTracker::Invalidate() {
+  vao = kUnknown;
+  program = kUnknown;
+  active_texture_unit = kUnknown;
+  uniform_buffers.clear();
+  textures.clear();
+}
+
+void GLStateTracker::EndFrame() {
+  frame_stats = current_stats;
+  current_stats = Stats();
+}
+
+const GLStateTracker::Stats& GLStateTracker::GetFrameStats() const {
+  return frame_stats;
+}
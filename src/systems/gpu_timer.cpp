@@ -0,0 +1,70 @@
+
+#include "systems/gpu_timer.h"
+
+#include "utility/profiler.h"
+
+GpuTimer::~GpuTimer() {
+  for (const Scope& scope : pending) {
+    free_queries.push_back(scope.start_query);
+    free_queries.push_back(scope.end_query);
+  }
+  glDeleteQueries(free_queries.size(), free_queries.data());
+}
+
+void GpuTimer::Begin(const char* name) {
+  if (!Profiler::Get().IsEnabled() || !GLEW_ARB_timer_query) {
+    return;
+  }
+  Scope scope = {name, AcquireQuery(), AcquireQuery()};
+  glQueryCounter(scope.start_query, GL_TIMESTAMP);
+  pending.push_back(scope);
+  is_open = true;
+}
+
+void GpuTimer::End() {
+  if (!is_open) {
+    return;
+  }
+  glQueryCounter(pending.back().end_query, GL_TIMESTAMP);
+  is_open = false;
+}
+
+void GpuTimer::Collect() {
+  if (pending.empty()) {
+    return;
+  }
+  // GPU timestamps are on their own clock, so find its offset from the
+  // profiler's clock.
+  GLint64 gpu_now;
+  glGetInteger64v(GL_TIMESTAMP, &gpu_now);
+  const int64_t offset = (int64_t)Profiler::Now() - gpu_now;
+
+  // Queries finish in order, so stop at the first unfinished scope.
+  while (pending.size() > (is_open ? 1 : 0)) {
+    const Scope& scope = pending.front();
+    GLint available = 0;
+    glGetQueryObjectiv(scope.end_query, GL_QUERY_RESULT_AVAILABLE, &available);
+    if (!available) {
+      break;
+    }
+    GLuint64 start, end;
+    glGetQueryObjectui64v(scope.start_query, GL_QUERY_RESULT, &start);
+    glGetQueryObjectui64v(scope.end_query, GL_QUERY_RESULT, &end);
+    Profiler::Get().RecordOnTrack(
+        "GPU", {scope.name, start + offset, end + offset});
+    free_queries.push_back(scope.start_query);
+    free_queries.push_back(scope.end_query);
+    pending.pop_front();
+  }
+}
+
+GLuint GpuTimer::AcquireQuery() {
+  if (free_queries.empty()) {
+    GLuint query;
+    glGenQueries(1, &query);
+    return query;
+  }
+  const GLuint query = free_queries.back();
+  free_queries.pop_back();
+  return query;
+}
@@ -3,17 +3,23 @@
 
 #include <glog/logging.h>
 
+#include "engine.h"
+
 #define GLFW_KEY_SIZE (GLFW_KEY_LAST + 1)
 
 InputSuperSystem::InputSuperSystem(GLFWwindow* window_) : window(window_) {}
 
 void InputSuperSystem::SetMouseLock(bool lock) {
+  if (!window) {
+    return;
+  }
   glfwSetInputMode(window, GLFW_CURSOR,
                    lock ? GLFW_CURSOR_DISABLED : GLFW_CURSOR_NORMAL);
 }
 
 bool InputSuperSystem::IsMouseLocked() const {
-  return glfwGetInputMode(window, GLFW_CURSOR) == GLFW_CURSOR_DISABLED;
+  return window &&
+         glfwGetInputMode(window, GLFW_CURSOR) == GLFW_CURSOR_DISABLED;
 }
 
 InputSuperSystem::ButtonDefinition InputSuperSystem::ButtonDefinition::Key(
@@ -332,6 +338,12 @@ glm::vec2 InputSuperSystem::GetMousePosition() const { return mouse_position; }
 bool InputSuperSystem::IsMouseInWindow() const { return is_mouse_in_window; }
 
 void InputSuperSystem::Init() {
+  if (!window && GetEngine()->GetPlatform()) {
+    window = GetEngine()->GetPlatform()->GetWindow();
+  }
+  if (!window) {
+    return;
+  }
   glfwSetWindowUserPointer(window, this);
   glfwSetKeyCallback(window, InputSuperSystem::KeyCallback);
   glfwSetMouseButtonCallback(window, InputSuperSystem::MouseButtonCallback);
@@ -352,6 +364,17 @@ void InputSuperSystem::LateUpdate(float delta_seconds) {
       watch.is_released = false;
     }
   }
+
+  // Deliver the events received at the end of this frame, the same point
+  // window events arrive at.
+  if (is_replaying) {
+    const uint64_t frame = GetEngine()->GetFrameCount();
+    while (replay_index < replay_events.size() &&
+           replay_events[replay_index].frame <= frame) {
+      ApplyEvent(replay_events[replay_index++].event);
+    }
+    is_replaying = replay_index < replay_events.size();
+  }
 }
 
 InputSuperSystem::KeyWatch* InputSuperSystem::GetWatch(unsigned int key,
@@ -429,66 +452,105 @@ void InputSuperSystem::DecrementWatchUse(unsigned int key, int modifiers) {
   throw "No such button watch.";
 }
 
+void InputSuperSystem::StartRecording() {
+  is_recording = true;
+  recorded_events.clear();
+}
+
+std::vector<InputSuperSystem::RecordedInputEvent>
+InputSuperSystem::StopRecording() {
+  is_recording = false;
+  return std::move(recorded_events);
+}
+
+void InputSuperSystem::Replay(std::vector<RecordedInputEvent> events) {
+  is_replaying = true;
+  replay_events = std::move(events);
+  replay_index = 0;
+}
+
+void InputSuperSystem::ReceiveEvent(const InputEvent& event) {
+  if (is_replaying) {
+    return;
+  }
+  if (is_recording) {
+    recorded_events.push_back({GetEngine()->GetFrameCount(), event});
+  }
+  ApplyEvent(event);
+}
+
+void InputSuperSystem::ApplyEvent(const InputEvent& event) {
+  switch (event.type) {
+    case InputEvent::Type::Key:
+    case InputEvent::Type::MouseButton: {
+      const unsigned int key =
+          event.key +
+          int(event.type == InputEvent::Type::MouseButton) * GLFW_KEY_SIZE;
+      KeyWatch* watch = GetWatch(key, event.modifiers);
+      if (!watch) {
+        return;
+      }
+      if (event.action == GLFW_PRESS) {
+        watch->is_pressed = true;
+        watch->is_down = true;
+      } else if (event.action == GLFW_RELEASE) {
+        watch->is_down = false;
+        watch->is_released = true;
+      }
+      break;
+    }
+    case InputEvent::Type::MouseMove:
+      mouse_move += event.value - mouse_position;
+      mouse_position = event.value;
+      break;
+    case InputEvent::Type::MouseEnter:
+      is_mouse_in_window = event.action;
+      if (event.action) {
+        mouse_position = event.value;
+      }
+      break;
+    case InputEvent::Type::Scroll:
+      scroll += event.value;
+      break;
+  }
+}
+
 void InputSuperSystem::KeyCallback(GLFWwindow* window, int key, int scancode,
                                    int action, int mods) {
   InputSuperSystem* input =
       static_cast<InputSuperSystem*>(glfwGetWindowUserPointer(window));
-  KeyWatch* watch = input->GetWatch(key, mods);
-  if (!watch) {
-    return;
-  }
-  if (action == GLFW_PRESS) {
-    watch->is_pressed = true;
-    watch->is_down = true;
-  } else if(action == GLFW_RELEASE) {
-    watch->is_down = false;
-    watch->is_released = true;
-  }
+  input->ReceiveEvent(
+      {InputEvent::Type::Key, key, action, mods, glm::vec2(0, 0)});
 }
 
 void InputSuperSystem::MouseButtonCallback(GLFWwindow* window, int button,
                                            int action, int mods) {
   InputSuperSystem* input =
       static_cast<InputSuperSystem*>(glfwGetWindowUserPointer(window));
-  KeyWatch* watch = input->GetWatch(button + GLFW_KEY_SIZE, mods);
-  if (!watch) {
-    return;
-  }
-  if (action == GLFW_PRESS) {
-    watch->is_pressed = true;
-    watch->is_down = true;
-  } else if(action == GLFW_RELEASE) {
-    watch->is_down = false;
-    watch->is_released = true;
-  }
+  input->ReceiveEvent(
+      {InputEvent::Type::MouseButton, button, action, mods, glm::vec2(0, 0)});
 }
 
 void InputSuperSystem::MouseMoveCallback(GLFWwindow* window, double x,
                                          double y) {
   InputSuperSystem* input =
       static_cast<InputSuperSystem*>(glfwGetWindowUserPointer(window));
-
-  input->mouse_move += glm::vec2(x, y) - input->mouse_position;
-  input->mouse_position = glm::vec2(x, y);
+  input->ReceiveEvent({InputEvent::Type::MouseMove, 0, 0, 0, glm::vec2(x, y)});
 }
 
 void InputSuperSystem::MouseEnterCallback(GLFWwindow* window, int entered) {
   InputSuperSystem* input =
       static_cast<InputSuperSystem*>(glfwGetWindowUserPointer(window));
-
+  double x = 0, y = 0;
   if (entered) {
-    input->is_mouse_in_window = true;
-    double x, y;
     glfwGetCursorPos(window, &x, &y);
-    input->mouse_position = glm::vec2(x, y);
-  } else {
-    input->is_mouse_in_window = false;
   }
+  input->ReceiveEvent(
+      {InputEvent::Type::MouseEnter, 0, entered, 0, glm::vec2(x, y)});
 }
 
 void InputSuperSystem::ScrollCallback(GLFWwindow* window, double x, double y) {
   InputSuperSystem* input =
       static_cast<InputSuperSystem*>(glfwGetWindowUserPointer(window));
-
-  input->scroll += glm::vec2(x, y);
+  input->ReceiveEvent({InputEvent::Type::Scroll, 0, 0, 0, glm::vec2(x, y)});
 }
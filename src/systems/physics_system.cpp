@@ -0,0 +1,638 @@
+
+#include "systems/physics_system.h"
+
+#include <glog/logging.h>
+
+#include <algorithm>
+#include <cmath>
+
+#include "engine.h"
+#include "nodes/node_type_tag.h"
+#include "utility/disjoint_set.h"
+#include "utility/parallel.h"
+#include "utility/profiler.h"
+#include "world.h"
+
+// The number of bodies or pairs handed to a thread at a time.
+constexpr size_t kRangeSize = 256;
+
+glm::vec3 GetInverseInertia(const CollisionShape& shape, float mass) {
+  if (mass <= 0) {
+    return glm::vec3(0);
+  }
+  const glm::vec3 inertia = shape.GetInertia(mass);
+  return glm::vec3(inertia.x > 0 ? 1 / inertia.x : 0,
+                   inertia.y > 0 ? 1 / inertia.y : 0,
+                   inertia.z > 0 ? 1 / inertia.z : 0);
+}
+
+glm::mat3 GetWorldInverseInertia(const glm::vec3& inverse_inertia,
+                                 const glm::quat& rotation) {
+  const glm::mat3 axes = glm::mat3_cast(rotation);
+  return axes * glm::mat3(glm::vec3(inverse_inertia.x, 0, 0),
+                          glm::vec3(0, inverse_inertia.y, 0),
+                          glm::vec3(0, 0, inverse_inertia.z)) *
+         glm::transpose(axes);
+}
+
+// Finds two directions perpendicular to `normal` and each other.
+void GetTangents(const glm::vec3& normal, glm::vec3& tangent,
+                 glm::vec3& bitangent) {
+  tangent = std::abs(normal.x) > 0.57735f
+                ? glm::vec3(normal.y, -normal.x, 0)
+                : glm::vec3(0, normal.z, -normal.y);
+  tangent = glm::normalize(tangent);
+  bitangent = glm::cross(normal, tangent);
+}
+
+// Returns the effective mass of a contact pushing two bodies along
+// `direction`, where the contact is at `offset_a` and `offset_b` from their
+// centers.
+float GetEffectiveMass(float inverse_mass_a, const glm::mat3& inverse_inertia_a,
+                       const glm::vec3& offset_a, float inverse_mass_b,
+                       const glm::mat3& inverse_inertia_b,
+                       const glm::vec3& offset_b, const glm::vec3& direction) {
+  const glm::vec3 angular_a = glm::cross(offset_a, direction);
+  const glm::vec3 angular_b = glm::cross(offset_b, direction);
+  const float inverse_effective_mass =
+      inverse_mass_a + inverse_mass_b +
+      glm::dot(angular_a, inverse_inertia_a * angular_a) +
+      glm::dot(angular_b, inverse_inertia_b * angular_b);
+  return inverse_effective_mass > 0 ? 1 / inverse_effective_mass : 0;
+}
+
+uint32_t PhysicsSystem::Bodies::Add() {
+  nodes.push_back(nullptr);
+  positions.emplace_back(0);
+  rotations.emplace_back(1, 0, 0, 0);
+  written_positions.emplace_back(0);
+  written_rotations.emplace_back(1, 0, 0, 0);
+  linear_velocities.emplace_back(0);
+  angular_velocities.emplace_back(0);
+  inverse_masses.push_back(0);
+  inverse_inertias.emplace_back(0);
+  world_inverse_inertias.emplace_back(0);
+  shapes.emplace_back();
+  frictions.push_back(0);
+  restitutions.push_back(0);
+  bounds.emplace_back();
+  return nodes.size() - 1;
+}
+
+// Removes the element at `index` of `values` by moving the last element into
+// its place.
+template <typename T>
+void SwapRemoveElement(std::vector<T>& values, uint32_t index) {
+  values[index] = std::move(values.back());
+  values.pop_back();
+}
+
+void PhysicsSystem::Bodies::SwapRemove(uint32_t index) {
+  SwapRemoveElement(nodes, index);
+  SwapRemoveElement(positions, index);
+  SwapRemoveElement(rotations, index);
+  SwapRemoveElement(written_positions, index);
+  SwapRemoveElement(written_rotations, index);
+  SwapRemoveElement(linear_velocities, index);
+  SwapRemoveElement(angular_velocities, index);
+  SwapRemoveElement(inverse_masses, index);
+  SwapRemoveElement(inverse_inertias, index);
+  SwapRemoveElement(world_inverse_inertias, index);
+  SwapRemoveElement(shapes, index);
+  SwapRemoveElement(frictions, index);
+  SwapRemoveElement(restitutions, index);
+  SwapRemoveElement(bounds, index);
+}
+
+PhysicsSystem::~PhysicsSystem() {
+  while (bodies.size()) {
+    RemoveBody(bodies.size() - 1);
+  }
+}
+
+void PhysicsSystem::Step(float delta_seconds, int thread_count) {
+  PROFILE_SCOPE("PhysicsStep");
+  if (delta_seconds <= 0) {
+    return;
+  }
+  thread_count = std::max(thread_count, 1);
+  if (!pool || pool->GetThreadCount() != thread_count) {
+    pool.reset(new WorkerPool(thread_count));
+  }
+  ReadTransforms();
+  IntegrateVelocities(delta_seconds);
+  FindPairs();
+  FindContacts(delta_seconds);
+  BuildIslands();
+  pool->ForEachIndex(island_order.size(), [&](size_t index) {
+    SolveIsland(island_order[index], delta_seconds);
+  });
+  IntegratePositions(delta_seconds);
+  WriteTransforms();
+
+  stats.body_count = bodies.size();
+  stats.pair_count = pairs.size();
+  stats.contact_count = contacts.size();
+  stats.island_count = island_order.size();
+
+  previous_contacts.swap(contacts);
+  previous_contact_indices.clear();
+  for (uint32_t i = 0; i < previous_contacts.size(); i++) {
+    const Contact& contact = previous_contacts[i];
+    previous_contact_indices[(uint64_t(contact.body_a) << 32) |
+                             contact.body_b] = i;
+  }
+}
+
+void PhysicsSystem::NotifyOfNodeTreeAttachment(
+    const std::vector<std::shared_ptr<Node>>& nodes) {
+  const NodeTypeMask tag = GetNodeTypeTag<RigidBody>();
+  for (const std::shared_ptr<Node>& node : nodes) {
+    if (node->GetTypeMask() & tag) {
+      RigidBody* body = static_cast<RigidBody*>(node.get());
+      CHECK(!body->system || body->system == this)
+          << "Node " << node->name << " is simulated by another system.";
+      if (!body->system) {
+        AddBody(body);
+      }
+    }
+  }
+}
+
+void PhysicsSystem::NotifyOfNodeTreeDetachment(
+    const std::vector<std::shared_ptr<Node>>& nodes) {
+  const NodeTypeMask tag = GetNodeTypeTag<RigidBody>();
+  for (const std::shared_ptr<Node>& node : nodes) {
+    if (node->GetTypeMask() & tag) {
+      RigidBody* body = static_cast<RigidBody*>(node.get());
+      if (body->system == this) {
+        RemoveBody(body->body_index);
+      }
+    }
+  }
+}
+
+void PhysicsSystem::AddBody(RigidBody* body) {
+  const uint32_t index = bodies.Add();
+  bodies.nodes[index] = body;
+  bodies.positions[index] = body->GetGlobalPosition();
+  bodies.rotations[index] = body->GetGlobalRotation();
+  bodies.written_positions[index] = body->GetPosition();
+  bodies.written_rotations[index] = body->GetRotation();
+  bodies.linear_velocities[index] = body->linear_velocity;
+  bodies.angular_velocities[index] = body->angular_velocity;
+  body->system = this;
+  body->body_index = index;
+  ReadBodyProperties(index);
+  ForgetBodyIndices();
+}
+
+void PhysicsSystem::RemoveBody(uint32_t index) {
+  RigidBody* body = bodies.nodes[index];
+  body->linear_velocity = bodies.linear_velocities[index];
+  body->angular_velocity = bodies.angular_velocities[index];
+  body->system = nullptr;
+  bodies.SwapRemove(index);
+  if (index < bodies.size()) {
+    bodies.nodes[index]->body_index = index;
+  }
+  ForgetBodyIndices();
+}
+
+void PhysicsSystem::ForgetBodyIndices() {
+  sweep_order.clear();
+  previous_contacts.clear();
+  previous_contact_indices.clear();
+}
+
+void PhysicsSystem::ReadBodyProperties(uint32_t index) {
+  const RigidBody* body = bodies.nodes[index];
+  bodies.shapes[index] = body->shape;
+  bodies.inverse_masses[index] = body->mass > 0 ? 1 / body->mass : 0;
+  bodies.inverse_inertias[index] = GetInverseInertia(body->shape, body->mass);
+  bodies.frictions[index] = body->friction;
+  bodies.restitutions[index] = body->restitution;
+}
+
+void PhysicsSystem::ReadTransforms() {
+  for (uint32_t i = 0; i < bodies.size(); i++) {
+    RigidBody* body = bodies.nodes[i];
+    if (body->GetPosition() != bodies.written_positions[i] ||
+        body->GetRotation() != bodies.written_rotations[i]) {
+      bodies.positions[i] = body->GetGlobalPosition();
+      bodies.rotations[i] = body->GetGlobalRotation();
+      bodies.written_positions[i] = body->GetPosition();
+      bodies.written_rotations[i] = body->GetRotation();
+    }
+  }
+}
+
+void PhysicsSystem::IntegrateVelocities(float delta_seconds) {
+  const float linear_damping =
+      1 / (1 + delta_seconds * settings.linear_damping);
+  const float angular_damping =
+      1 / (1 + delta_seconds * settings.angular_damping);
+  const size_t range_count = (bodies.size() + kRangeSize - 1) / kRangeSize;
+  pool->ForEachIndex(range_count, [&](size_t range) {
+    const size_t end = std::min(bodies.size(), (range + 1) * kRangeSize);
+    for (size_t i = range * kRangeSize; i < end; i++) {
+      glm::vec3& linear_velocity = bodies.linear_velocities[i];
+      if (bodies.inverse_masses[i] > 0) {
+        linear_velocity =
+            (linear_velocity + settings.gravity * delta_seconds) *
+            linear_damping;
+        bodies.angular_velocities[i] *= angular_damping;
+      }
+      bodies.world_inverse_inertias[i] = GetWorldInverseInertia(
+          bodies.inverse_inertias[i], bodies.rotations[i]);
+      // Cover everywhere the body may move this step, so contacts are found
+      // before bodies pass through each other.
+      AABB& bounds = bodies.bounds[i];
+      bounds = bodies.shapes[i].GetBounds(bodies.positions[i],
+                                          bodies.rotations[i]);
+      const glm::vec3 motion = linear_velocity * delta_seconds;
+      bounds.min += glm::min(motion, glm::vec3(0)) - settings.contact_margin;
+      bounds.max += glm::max(motion, glm::vec3(0)) + settings.contact_margin;
+    }
+  });
+}
+
+void PhysicsSystem::FindPairs() {
+  pairs.clear();
+  if (bodies.size() < 2) {
+    return;
+  }
+  // Sweep along the axis the bodies are most spread along, which has the
+  // fewest overlapping bounds.
+  glm::vec3 sum(0);
+  glm::vec3 sum_squared(0);
+  for (const AABB& bounds : bodies.bounds) {
+    const glm::vec3 center = bounds.GetCenter();
+    sum += center;
+    sum_squared += center * center;
+  }
+  const glm::vec3 variance =
+      sum_squared - sum * sum / static_cast<float>(bodies.size());
+  int axis = 0;
+  if (variance[1] > variance[axis]) {
+    axis = 1;
+  }
+  if (variance[2] > variance[axis]) {
+    axis = 2;
+  }
+
+  const std::vector<AABB>& bounds = bodies.bounds;
+  const auto is_before = [&bounds, axis](uint32_t a, uint32_t b) {
+    return bounds[a].min[axis] < bounds[b].min[axis];
+  };
+  if (axis != sweep_axis || sweep_order.size() != bodies.size()) {
+    sweep_axis = axis;
+    sweep_order.resize(bodies.size());
+    for (uint32_t i = 0; i < sweep_order.size(); i++) {
+      sweep_order[i] = i;
+    }
+    std::sort(sweep_order.begin(), sweep_order.end(), is_before);
+  } else {
+    // The order from the last step is nearly sorted, which insertion sort
+    // handles in close to linear time.
+    for (size_t i = 1; i < sweep_order.size(); i++) {
+      const uint32_t body = sweep_order[i];
+      size_t j = i;
+      for (; j > 0 && is_before(body, sweep_order[j - 1]); j--) {
+        sweep_order[j] = sweep_order[j - 1];
+      }
+      sweep_order[j] = body;
+    }
+  }
+
+  for (size_t i = 0; i < sweep_order.size(); i++) {
+    const uint32_t a = sweep_order[i];
+    const AABB& bounds_a = bounds[a];
+    for (size_t j = i + 1; j < sweep_order.size(); j++) {
+      const uint32_t b = sweep_order[j];
+      if (bounds[b].min[axis] > bounds_a.max[axis]) {
+        break;
+      }
+      if ((bodies.inverse_masses[a] > 0 || bodies.inverse_masses[b] > 0) &&
+          bounds_a.Intersects(bounds[b])) {
+        pairs.emplace_back(std::min(a, b), std::max(a, b));
+      }
+    }
+  }
+}
+
+void PhysicsSystem::FindContacts(float delta_seconds) {
+  const size_t range_count = (pairs.size() + kRangeSize - 1) / kRangeSize;
+  if (range_contacts.size() < range_count) {
+    range_contacts.resize(range_count);
+  }
+  pool->ForEachIndex(range_count, [&](size_t range) {
+    std::vector<Contact>& found = range_contacts[range];
+    found.clear();
+    const size_t end = std::min(pairs.size(), (range + 1) * kRangeSize);
+    Contact contact;
+    for (size_t i = range * kRangeSize; i < end; i++) {
+      const uint32_t a = pairs[i].first;
+      const uint32_t b = pairs[i].second;
+      // Bodies approaching quickly need contacts from further away, or they
+      // would pass through each other within the step.
+      const float margin =
+          settings.contact_margin +
+          glm::length(bodies.linear_velocities[b] -
+                      bodies.linear_velocities[a]) *
+              delta_seconds;
+      if (!Collide({bodies.shapes[a], bodies.positions[a], bodies.rotations[a]},
+                   {bodies.shapes[b], bodies.positions[b], bodies.rotations[b]},
+                   margin, contact.manifold)) {
+        continue;
+      }
+      contact.body_a = a;
+      contact.body_b = b;
+      contact.friction = std::sqrt(bodies.frictions[a] * bodies.frictions[b]);
+      contact.restitution =
+          std::max(bodies.restitutions[a], bodies.restitutions[b]);
+      FindPreviousImpulses(contact);
+      found.push_back(contact);
+    }
+  });
+  contacts.clear();
+  for (size_t range = 0; range < range_count; range++) {
+    contacts.insert(contacts.end(), range_contacts[range].begin(),
+                    range_contacts[range].end());
+  }
+}
+
+void PhysicsSystem::FindPreviousImpulses(Contact& contact) const {
+  // Points are matched to the nearest point of the same pair in the last
+  // step, as long as it has not moved too far to be the same point.
+  constexpr float kMaxMatchDistanceSquared = 0.05f * 0.05f;
+  const auto it = previous_contact_indices.find(
+      (uint64_t(contact.body_a) << 32) | contact.body_b);
+  for (int i = 0; i < contact.manifold.point_count; i++) {
+    Contact::PointState& state = contact.states[i];
+    state.normal_impulse = 0;
+    state.tangent_impulses[0] = 0;
+    state.tangent_impulses[1] = 0;
+    if (it == previous_contact_indices.end()) {
+      continue;
+    }
+    const Contact& previous = previous_contacts[it->second];
+    float best_distance = kMaxMatchDistanceSquared;
+    for (int j = 0; j < previous.manifold.point_count; j++) {
+      const glm::vec3 offset = previous.manifold.points[j].position -
+                               contact.manifold.points[i].position;
+      const float distance = glm::dot(offset, offset);
+      if (distance < best_distance) {
+        best_distance = distance;
+        state.normal_impulse = previous.states[j].normal_impulse;
+        state.tangent_impulses[0] = previous.states[j].tangent_impulses[0];
+        state.tangent_impulses[1] = previous.states[j].tangent_impulses[1];
+      }
+    }
+  }
+}
+
+void PhysicsSystem::BuildIslands() {
+  // Bodies without mass are never moved by contacts, so they do not join the
+  // islands of the bodies touching them.
+  DisjointSet islands(bodies.size());
+  for (const Contact& contact : contacts) {
+    if (bodies.inverse_masses[contact.body_a] > 0 &&
+        bodies.inverse_masses[contact.body_b] > 0) {
+      islands.Union(contact.body_a, contact.body_b);
+    }
+  }
+
+  std::vector<uint32_t> root_islands(bodies.size(), ~0U);
+  std::vector<uint32_t> contact_islands(contacts.size());
+  island_offsets.clear();
+  for (size_t i = 0; i < contacts.size(); i++) {
+    const uint32_t body = bodies.inverse_masses[contacts[i].body_a] > 0
+                              ? contacts[i].body_a
+                              : contacts[i].body_b;
+    uint32_t& island = root_islands[islands.Find(body)];
+    if (island == ~0U) {
+      island = island_offsets.size();
+      island_offsets.push_back(0);
+    }
+    contact_islands[i] = island;
+    island_offsets[island]++;
+  }
+
+  island_order.resize(island_offsets.size());
+  for (uint32_t i = 0; i < island_order.size(); i++) {
+    island_order[i] = i;
+  }
+  std::sort(island_order.begin(), island_order.end(),
+            [this](uint32_t a, uint32_t b) {
+              return island_offsets[a] > island_offsets[b];
+            });
+
+  // Turn the counts into offsets, then place each contact in its island.
+  uint32_t offset = 0;
+  for (uint32_t& island_offset : island_offsets) {
+    const uint32_t count = island_offset;
+    island_offset = offset;
+    offset += count;
+  }
+  island_offsets.push_back(offset);
+  island_contacts.resize(contacts.size());
+  std::vector<uint32_t> next(island_offsets.begin(), island_offsets.end() - 1);
+  for (uint32_t i = 0; i < contacts.size(); i++) {
+    island_contacts[next[contact_islands[i]]++] = i;
+  }
+}
+
+void PhysicsSystem::SolveIsland(size_t island, float delta_seconds) {
+  const uint32_t* const begin = island_contacts.data() + island_offsets[island];
+  const uint32_t* const end =
+      island_contacts.data() + island_offsets[island + 1];
+
+  // Pushes body b of `contact` by `impulse` at the point of `state`, and body a
+  // by the opposite. Bodies without mass are only read, since they may be
+  // shared with islands solving on other threads.
+  const auto apply_impulse = [this](const Contact& contact,
+                                    const Contact::PointState& state,
+                                    const glm::vec3& impulse) {
+    const uint32_t a = contact.body_a;
+    const uint32_t b = contact.body_b;
+    if (bodies.inverse_masses[a] > 0) {
+      bodies.linear_velocities[a] -= impulse * bodies.inverse_masses[a];
+      bodies.angular_velocities[a] -= bodies.world_inverse_inertias[a] *
+                                      glm::cross(state.offset_a, impulse);
+    }
+    if (bodies.inverse_masses[b] > 0) {
+      bodies.linear_velocities[b] += impulse * bodies.inverse_masses[b];
+      bodies.angular_velocities[b] += bodies.world_inverse_inertias[b] *
+                                      glm::cross(state.offset_b, impulse);
+    }
+  };
+  const auto relative_velocity = [this](const Contact& contact,
+                                        const Contact::PointState& state) {
+    const uint32_t a = contact.body_a;
+    const uint32_t b = contact.body_b;
+    return bodies.linear_velocities[b] +
+           glm::cross(bodies.angular_velocities[b], state.offset_b) -
+           bodies.linear_velocities[a] -
+           glm::cross(bodies.angular_velocities[a], state.offset_a);
+  };
+
+  for (const uint32_t* it = begin; it != end; ++it) {
+    Contact& contact = contacts[*it];
+    const uint32_t a = contact.body_a;
+    const uint32_t b = contact.body_b;
+    const float inverse_mass_a = bodies.inverse_masses[a];
+    const float inverse_mass_b = bodies.inverse_masses[b];
+    const glm::mat3& inverse_inertia_a = bodies.world_inverse_inertias[a];
+    const glm::mat3& inverse_inertia_b = bodies.world_inverse_inertias[b];
+    for (int i = 0; i < contact.manifold.point_count; i++) {
+      const ContactPoint& point = contact.manifold.points[i];
+      Contact::PointState& state = contact.states[i];
+      state.offset_a = point.position - bodies.positions[a];
+      state.offset_b = point.position - bodies.positions[b];
+      GetTangents(point.normal, state.tangents[0], state.tangents[1]);
+      state.normal_mass = GetEffectiveMass(
+          inverse_mass_a, inverse_inertia_a, state.offset_a, inverse_mass_b,
+          inverse_inertia_b, state.offset_b, point.normal);
+      for (int t = 0; t < 2; t++) {
+        state.tangent_masses[t] = GetEffectiveMass(
+            inverse_mass_a, inverse_inertia_a, state.offset_a, inverse_mass_b,
+            inverse_inertia_b, state.offset_b, state.tangents[t]);
+      }
+
+      if (point.depth > 0) {
+        // Push overlapping bodies apart over the next few steps.
+        state.target_velocity =
+            settings.position_correction / delta_seconds *
+            std::max(point.depth - settings.penetration_slop, 0.f);
+      } else {
+        // Bodies that are apart may keep approaching until they touch.
+        state.target_velocity = point.depth / delta_seconds;
+      }
+      // Bounce bodies that will touch during this step.
+      const float normal_velocity =
+          glm::dot(relative_velocity(contact, state), point.normal);
+      if (normal_velocity < -settings.restitution_threshold &&
+          point.depth - normal_velocity * delta_seconds > 0) {
+        state.target_velocity = std::max(
+            state.target_velocity, -contact.restitution * normal_velocity);
+      }
+    }
+  }
+
+  // Start from the impulses of the last step, which are usually close to the
+  // solution for resting bodies.
+  for (const uint32_t* it = begin; it != end; ++it) {
+    const Contact& contact = contacts[*it];
+    for (int i = 0; i < contact.manifold.point_count; i++) {
+      const Contact::PointState& state = contact.states[i];
+      apply_impulse(contact, state,
+                    contact.manifold.points[i].normal * state.normal_impulse +
+                        state.tangents[0] * state.tangent_impulses[0] +
+                        state.tangents[1] * state.tangent_impulses[1]);
+    }
+  }
+
+  // Solve each contact in turn, repeatedly, so the impulses converge on ones
+  // satisfying every contact at once.
+  for (int iteration = 0; iteration < settings.iterations; iteration++) {
+    for (const uint32_t* it = begin; it != end; ++it) {
+      Contact& contact = contacts[*it];
+      for (int i = 0; i < contact.manifold.point_count; i++) {
+        const ContactPoint& point = contact.manifold.points[i];
+        Contact::PointState& state = contact.states[i];
+
+        const float normal_velocity =
+            glm::dot(relative_velocity(contact, state), point.normal);
+        const float previous_impulse = state.normal_impulse;
+        state.normal_impulse =
+            std::max(previous_impulse +
+                         state.normal_mass *
+                             (state.target_velocity - normal_velocity),
+                     0.f);
+        apply_impulse(contact, state,
+                      point.normal * (state.normal_impulse - previous_impulse));
+
+        const float max_friction = contact.friction * state.normal_impulse;
+        for (int t = 0; t < 2; t++) {
+          const float tangent_velocity =
+              glm::dot(relative_velocity(contact, state), state.tangents[t]);
+          const float previous = state.tangent_impulses[t];
+          state.tangent_impulses[t] = glm::clamp(
+              previous - state.tangent_masses[t] * tangent_velocity,
+              -max_friction, max_friction);
+          apply_impulse(contact, state,
+                        state.tangents[t] *
+                            (state.tangent_impulses[t] - previous));
+        }
+      }
+    }
+  }
+}
+
+void PhysicsSystem::IntegratePositions(float delta_seconds) {
+  const size_t range_count = (bodies.size() + kRangeSize - 1) / kRangeSize;
+  pool->ForEachIndex(range_count, [&](size_t range) {
+    const size_t end = std::min(bodies.size(), (range + 1) * kRangeSize);
+    for (size_t i = range * kRangeSize; i < end; i++) {
+      bodies.positions[i] += bodies.linear_velocities[i] * delta_seconds;
+      const glm::vec3& angular_velocity = bodies.angular_velocities[i];
+      glm::quat& rotation = bodies.rotations[i];
+      rotation = glm::normalize(
+          rotation + glm::quat(0, angular_velocity.x, angular_velocity.y,
+                               angular_velocity.z) *
+                         rotation * (0.5f * delta_seconds));
+    }
+  });
+}
+
+void PhysicsSystem::WriteTransforms() {
+  for (uint32_t i = 0; i < bodies.size(); i++) {
+    if (bodies.linear_velocities[i] == glm::vec3(0) &&
+        bodies.angular_velocities[i] == glm::vec3(0)) {
+      continue;
+    }
+    RigidBody* body = bodies.nodes[i];
+    body->SetGlobalPose(bodies.positions[i], bodies.rotations[i]);
+    bodies.written_positions[i] = body->GetPosition();
+    bodies.written_rotations[i] = body->GetRotation();
+  }
+}
+
+void PhysicsSuperSystem::Init() {
+  if (addition_mode == PhysicsSystemAddition::InitWorlds) {
+    for (const std::shared_ptr<World>& world : GetEngine()->GetWorlds()) {
+      if (!world->GetSystem<PhysicsSystem>()) {
+        world->AddSystem(std::shared_ptr<PhysicsSystem>(new PhysicsSystem()));
+      }
+    }
+  }
+}
+
+void PhysicsSuperSystem::FixedUpdate(float delta_seconds) {
+  for (const std::shared_ptr<PhysicsSystem>& physics_system :
+       physics_systems) {
+    physics_system->Step(delta_seconds, thread_count);
+  }
+}
+
+void PhysicsSuperSystem::NotifyOfWorldInitialization(
+    const std::shared_ptr<World>& world) {
+  if (addition_mode == PhysicsSystemAddition::AllWorlds) {
+    if (!world->GetSystem<PhysicsSystem>()) {
+      world->AddSystem(std::shared_ptr<PhysicsSystem>(new PhysicsSystem()));
+    }
+  }
+}
+
+void PhysicsSuperSystem::NotifyOfSystemAddition(
+    const std::shared_ptr<World>& world,
+    const std::shared_ptr<System>& system) {
+  physics_systems.AddSystem(system);
+}
+
+void PhysicsSuperSystem::NotifyOfSystemRemoval(
+    const std::shared_ptr<World>& world,
+    const std::shared_ptr<System>& system) {
+  physics_systems.RemoveSystem(system);
+}
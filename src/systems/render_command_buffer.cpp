@@ -0,0 +1,44 @@
+
+#include "systems/render_command_buffer.h"
+
+#include <glog/logging.h>
+
+#include <utility>
+
+void RenderCommandBuffer::RecordUniforms(UniformBinding binding,
+                                         const void* data, size_t size) {
+  const size_t offset = uniform_data.size();
+  uniform_data.resize(offset + size);
+  memcpy(&uniform_data[offset], data, size);
+  Record(SetUniforms{binding, (uint32_t)offset, (uint32_t)size});
+}
+
+void RenderCommandBuffer::Retain(std::shared_ptr<const void> resource) {
+  retained.push_back(std::move(resource));
+}
+
+void RenderCommandBuffer::Reset() {
+  commands.clear();
+  uniform_data.clear();
+  retained.clear();
+  command_count = 0;
+}
+
+const unsigned char* RenderCommandBuffer::GetUniformData(
+    uint32_t offset) const {
+  DCHECK_LE(offset, uniform_data.size());
+  return uniform_data.data() + offset;
+}
+
+void RenderCommandBuffer::Append(CommandType type, const void* data,
+                                 size_t size) {
+  constexpr size_t header_size =
+      (sizeof(Header) + kAlignment - 1) / kAlignment * kAlignment;
+  const size_t offset = commands.size();
+  commands.resize(offset + header_size +
+                  (size + kAlignment - 1) / kAlignment * kAlignment);
+  const Header header{type, (uint32_t)size};
+  memcpy(&commands[offset], &header, sizeof(Header));
+  memcpy(&commands[offset + header_size], data, size);
+  command_count++;
+}
@@ -0,0 +1,86 @@
+
+#include "systems/render_device.h"
+
+#include <type_traits>
+#include <utility>
+
+NullRenderDevice::NullRenderDevice(glm::ivec2 surface_size_)
+    : surface_size(surface_size_) {}
+
+glm::ivec2 NullRenderDevice::GetSurfaceSize() { return surface_size; }
+
+void NullRenderDevice::BeginFrame() {}
+
+void NullRenderDevice::Submit(const RenderCommandBuffer& commands) {
+  current_stats.commands += commands.GetCommandCount();
+  commands.ForEach([this](const auto& command) {
+    using Command = std::decay_t<decltype(command)>;
+    if constexpr (std::is_same<Command, RenderCommandBuffer::Draw>::value) {
+      current_stats.draws++;
+    }
+  });
+}
+
+void NullRenderDevice::EndFrame() {
+  frame_stats = current_stats;
+  current_stats = Stats();
+}
+
+const RenderDevice::Stats& NullRenderDevice::GetFrameStats() const {
+  return frame_stats;
+}
+
+CaptureRenderDevice::CaptureRenderDevice(std::unique_ptr<RenderDevice> target_,
+                                         glm::ivec2 surface_size_)
+    : target(std::move(target_)),
+      surface_size(surface_size_),
+      counter(surface_size_) {}
+
+glm::ivec2 CaptureRenderDevice::GetSurfaceSize() {
+  return target ? target->GetSurfaceSize() : surface_size;
+}
+
+void CaptureRenderDevice::BeginFrame() {
+  current_frame.submissions.clear();
+  (target ? *target : counter).BeginFrame();
+}
+
+void CaptureRenderDevice::Submit(const RenderCommandBuffer& commands) {
+  if (capturing) {
+    current_frame.submissions.push_back(commands);
+  }
+  (target ? *target : counter).Submit(commands);
+}
+
+void CaptureRenderDevice::EndFrame() {
+  (target ? *target : counter).EndFrame();
+  if (!capturing) {
+    return;
+  }
+  if (max_frames && frames.size() >= max_frames) {
+    frames.erase(frames.begin(), frames.end() - (max_frames - 1));
+  }
+  frames.push_back(std::move(current_frame));
+  current_frame = Frame();
+}
+
+void CaptureRenderDevice::Flush() { (target ? *target : counter).Flush(); }
+
+const RenderDevice::Stats& CaptureRenderDevice::GetFrameStats() const {
+  return target ? target->GetFrameStats() : counter.GetFrameStats();
+}
+
+const std::vector<CaptureRenderDevice::Frame>& CaptureRenderDevice::GetFrames()
+    const {
+  return frames;
+}
+
+void CaptureRenderDevice::ClearFrames() { frames.clear(); }
+
+void CaptureRenderDevice::Replay(const Frame& frame, RenderDevice& device) {
+  device.BeginFrame();
+  for (const RenderCommandBuffer& commands : frame.submissions) {
+    device.Submit(commands);
+  }
+  device.EndFrame();
+}
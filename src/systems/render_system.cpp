@@ -2,35 +2,60 @@
 #include "systems/render_system.h"
 
 #include <GL/glew.h>
+#include <glog/logging.h>
 
 #include <algorithm>
+#include <cmath>
+#include <glm/gtc/matrix_transform.hpp>
+#include <utility>
 
 #include "engine.h"
-#include "nodes/utility.h"
+#include "systems/gl_render_device.h"
+#include "systems/threaded_render_device.h"
+#include "utility/profiler.h"
 
-void RenderSystem::NotifyOfNodeAttachment(
-    const std::shared_ptr<Node>& new_node) {
-  const std::vector<std::shared_ptr<Node>> nodes =
-      CollectPreOrderNodes(new_node);
+void RenderSystem::NotifyOfNodeTreeAttachment(
+    const std::vector<std::shared_ptr<Node>>& nodes) {
   renderables.Add(nodes);
   cameras.Add(nodes);
+  lights.Add(nodes);
 }
 
-void RenderSystem::NotifyOfNodeDetachment(
-    const std::shared_ptr<Node>& new_node) {
-  const std::vector<std::shared_ptr<Node>> nodes =
-      CollectPreOrderNodes(new_node);
+void RenderSystem::NotifyOfNodeTreeDetachment(
+    const std::vector<std::shared_ptr<Node>>& nodes) {
   renderables.Remove(nodes);
   cameras.Remove(nodes);
+  lights.Remove(nodes);
 }
 
 RenderSuperSystem::RenderSuperSystem(GLFWwindow* window_) : window(window_) {}
 
+RenderSuperSystem::RenderSuperSystem(std::unique_ptr<RenderDevice> device_)
+    : device(std::move(device_)) {
+  CHECK(device) << "RenderSuperSystem requires a device.";
+}
+
 void RenderSuperSystem::Init() {
-  glEnable(GL_CULL_FACE);
-  glEnable(GL_DEPTH_TEST);
-  glClearColor(0.f, 0.f, 0.4f, 0.f);
-  // glfwSwapInterval(0);
+  if (!device) {
+    if (!window && GetEngine()->GetPlatform()) {
+      window = GetEngine()->GetPlatform()->GetWindow();
+    }
+    CHECK(window) << "RenderSuperSystem requires a window.";
+    device.reset(
+        new GLRenderDevice(window, swap_interval, object_uniform_capacity));
+    if (render_thread) {
+      GLFWwindow* const context_window = window;
+      device.reset(new ThreadedRenderDevice(
+          std::move(device),
+          {[context_window]() { glfwMakeContextCurrent(context_window); },
+           []() { glfwMakeContextCurrent(nullptr); }},
+          max_frames_in_flight));
+    }
+  } else if (render_thread) {
+    device.reset(new ThreadedRenderDevice(std::move(device),
+                                          ThreadedRenderDevice::ContextHooks(),
+                                          max_frames_in_flight));
+  }
 
   if (addition_mode == RenderSystemAddition::InitWorlds) {
     for (const std::shared_ptr<World>& world : GetEngine()->GetWorlds()) {
@@ -52,40 +77,158 @@ void RenderSuperSystem::LateUpdate(float delta_seconds) {
     }
   }
 
-  std::sort(ordered_cameras.begin(), ordered_cameras.end(),
-            [](const std::pair<std::shared_ptr<RenderSystem>,
-                               std::shared_ptr<Camera>>& a,
-               const std::pair<std::shared_ptr<RenderSystem>,
-                               std::shared_ptr<Camera>>& b) {
-              return a.second->sort_order - b.second->sort_order;
-            });
+  std::stable_sort(
+      ordered_cameras.begin(), ordered_cameras.end(),
+      [](const std::pair<std::shared_ptr<RenderSystem>,
+                         std::shared_ptr<Camera>>& a,
+         const std::pair<std::shared_ptr<RenderSystem>,
+                         std::shared_ptr<Camera>>& b) {
+        return a.second->sort_order < b.second->sort_order;
+      });
 
-  int width, height;
-  glfwGetWindowSize(window, &width, &height);
+  const glm::ivec2 size = device->GetSurfaceSize();
+  const std::shared_ptr<RenderSuperSystem> self =
+      std::static_pointer_cast<RenderSuperSystem>(this->shared_from_this());
 
   for (const auto& [render_system, camera] : ordered_cameras) {
-    int x1 = (int)ceil(width * camera->viewport[0].x),
-        y1 = (int)ceil(height * camera->viewport[0].y),
-        x2 = (int)ceil(width * camera->viewport[1].x),
-        y2 = (int)ceil(height * camera->viewport[1].y);
-
-    glViewport(x1, y1, x2 - x1, y2 - y1);
-
-    bool clear_depth = bool(camera->clear_flags & (Camera::ClearFlags::Depth));
-    bool clear_colour =
-        bool(camera->clear_flags & (Camera::ClearFlags::Colour));
-    glClear((GL_COLOR_BUFFER_BIT * clear_colour) |
-            (GL_DEPTH_BUFFER_BIT * clear_depth));
-    const glm::mat4 pv =
-        camera->GetProjectionView((float)(x2 - x1) / (float)(y2 - y1));
+    PROFILE_SCOPE("Camera pass");
+    int x1 = (int)ceil(size.x * camera->viewport[0].x),
+        y1 = (int)ceil(size.y * camera->viewport[0].y),
+        x2 = (int)ceil(size.x * camera->viewport[1].x),
+        y2 = (int)ceil(size.y * camera->viewport[1].y);
+    if (x2 <= x1 || y2 <= y1) {
+      continue;
+    }
+    const float aspect = (float)(x2 - x1) / (float)(y2 - y1);
+
+    ShadowUniforms shadow_uniforms = {};
+    if (!render_system->lights.empty()) {
+      const DirectionalLight& light = **render_system->lights.begin();
+      shadow_uniforms.light_direction = glm::vec4(light.GetDirection(), 0.f);
+      shadow_uniforms.light_colour =
+          glm::vec4(light.colour * light.intensity, 0.f);
+      if (shadows && light.cast_shadows) {
+        RecordShadowPasses(self, render_system, *camera, aspect, light,
+                           shadow_uniforms);
+      }
+    }
+
+    commands.Record(RenderCommandBuffer::BeginPass{"Camera pass"});
+    commands.Record(RenderCommandBuffer::SetViewport{x1, y1, x2 - x1, y2 - y1});
+    commands.Record(RenderCommandBuffer::Clear{
+        clear_colour,
+        bool(camera->clear_flags & (Camera::ClearFlags::Colour)),
+        bool(camera->clear_flags & (Camera::ClearFlags::Depth))});
+
+    FrameUniforms frame_uniforms;
+    frame_uniforms.view = camera->GetViewMatrix();
+    frame_uniforms.projection = camera->GetProjectionMatrix(aspect);
+    frame_uniforms.projection_view =
+        frame_uniforms.projection * frame_uniforms.view;
+    frame_uniforms.camera_position = camera->GetInterpolatedGlobalMatrix()[3];
+    commands.RecordUniforms(UniformBinding::Frame, frame_uniforms);
+    commands.RecordUniforms(UniformBinding::Shadow, shadow_uniforms);
+    if (shadow_uniforms.light_direction.w > 0) {
+      commands.Record(RenderCommandBuffer::BindTargetTexture{
+          kShadowMapTextureUnit, kShadowTarget});
+    }
+
+    const glm::mat4& pv = frame_uniforms.projection_view;
     for (const std::shared_ptr<Renderable>& renderable :
          render_system->renderables) {
-      renderable->Render(
-          std::static_pointer_cast<RenderSuperSystem>(this->shared_from_this()),
-          render_system, pv);
+      renderable->Render(self, render_system, pv);
     }
+    commands.Record(RenderCommandBuffer::EndPass{});
+  }
+
+  {
+    PROFILE_SCOPE("Submit");
+    device->BeginFrame();
+    device->Submit(commands);
+    // Devices copy or execute the buffer in Submit, so it can be reset now.
+    // Doing so before EndFrame hands the frame to a render thread means the
+    // device's copy always holds the last references to the frame's resources,
+    // which are then released where the context is current.
+    commands.Reset();
+    retained_material = nullptr;
+    retained_mesh = nullptr;
+    device->EndFrame();
   }
-  glfwSwapBuffers(window);
+}
+
+void RenderSuperSystem::RecordShadowPasses(
+    const std::shared_ptr<RenderSuperSystem>& self,
+    const std::shared_ptr<RenderSystem>& render_system, const Camera& camera,
+    float aspect, const DirectionalLight& light,
+    ShadowUniforms& shadow_uniforms) {
+  PROFILE_SCOPE("Shadow pass");
+  const std::vector<ShadowCascade> cascades =
+      light.ComputeCascades(camera, aspect);
+  if (cascades.empty()) {
+    return;
+  }
+  // Maps clip space to the [0, 1] range the shadow map is sampled in.
+  const glm::mat4 clip_to_texture =
+      glm::scale(glm::translate(glm::mat4(1.f), glm::vec3(0.5f)),
+                 glm::vec3(0.5f));
+  const int32_t resolution = light.shadow_resolution;
+
+  commands.Record(RenderCommandBuffer::BeginPass{"Shadow pass"});
+  commands.Record(
+      RenderCommandBuffer::SetDepthBias{light.depth_bias, light.slope_bias});
+  for (size_t i = 0; i < cascades.size(); i++) {
+    commands.Record(RenderCommandBuffer::SetRenderTarget{
+        kShadowTarget, (int32_t)i, resolution, resolution,
+        (int32_t)cascades.size()});
+    commands.Record(
+        RenderCommandBuffer::SetViewport{0, 0, resolution, resolution});
+    commands.Record(RenderCommandBuffer::Clear{clear_colour, false, true});
+    // Depth-only draws read nothing but the object uniforms, so no frame
+    // uniforms are needed.
+    for (const std::shared_ptr<Renderable>& renderable :
+         render_system->renderables) {
+      renderable->Render(self, render_system, cascades[i].projection_view);
+    }
+    shadow_uniforms.cascade_matrices[i] =
+        clip_to_texture * cascades[i].projection_view;
+    shadow_uniforms.cascade_splits[i] = cascades[i].split_distance;
+  }
+  commands.Record(RenderCommandBuffer::SetDepthBias{0.f, 0.f});
+  commands.Record(RenderCommandBuffer::SetRenderTarget{
+      RenderCommandBuffer::kSurface, 0, 0, 0, 0});
+  commands.Record(RenderCommandBuffer::EndPass{});
+  shadow_uniforms.light_direction.w = (float)cascades.size();
+}
+
+void RenderSuperSystem::Shutdown() {
+  // Return the context to the engine's thread so resources can be released.
+  device->Flush();
+}
+
+void RenderSuperSystem::BindObjectUniforms(const ObjectUniforms& uniforms) {
+  commands.RecordUniforms(UniformBinding::Object, uniforms);
+}
+
+void RenderSuperSystem::BindUniforms(UniformBinding binding, const void* data,
+                                     size_t size) {
+  commands.RecordUniforms(binding, data, size);
+}
+
+void RenderSuperSystem::QueueDraw(
+    const std::shared_ptr<Material>& material,
+    const std::shared_ptr<const RenderableMesh>& mesh) {
+  if (material.get() != retained_material) {
+    commands.Retain(material);
+    retained_material = material.get();
+  }
+  // Destroying the mesh frees its range of the arena, which could then be
+  // overwritten before the draw is executed.
+  if (mesh.get() != retained_mesh) {
+    commands.Retain(mesh);
+    retained_mesh = mesh.get();
+  }
+  commands.Record(RenderCommandBuffer::Draw{
+      material.get(), &mesh->GetArena(), mesh->GetDrawCommand()});
 }
 
 void RenderSuperSystem::NotifyOfWorldInitialization(
@@ -106,5 +249,11 @@ void RenderSuperSystem::NotifyOfSystemAddition(
 void RenderSuperSystem::NotifyOfSystemRemoval(
     const std::shared_ptr<World>& world,
     const std::shared_ptr<System>& system) {
-  render_systems.AddSystem(system);
+  render_systems.RemoveSystem(system);
+}
+
+RenderDevice* RenderSuperSystem::GetDevice() { return device.get(); }
+
+const RenderDevice::Stats& RenderSuperSystem::GetFrameStats() const {
+  return device->GetFrameStats();
 }
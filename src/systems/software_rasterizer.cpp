@@ -0,0 +1,478 @@
+
+#include "systems/software_rasterizer.h"
+
+#include <glog/logging.h>
+
+#include <algorithm>
+#include <cmath>
+
+#include "utility/parallel.h"
+#include "utility/profiler.h"
+
+// The bits of fraction in fixed point pixel positions.
+constexpr int kSubpixelBits = 8;
+constexpr int64_t kSubpixelScale = 1 << kSubpixelBits;
+// Tiles are covered in square blocks, so blocks outside a triangle can be
+// skipped and blocks inside it filled without testing each pixel.
+constexpr int kBlockSize = 8;
+
+uint32_t PackColour(const glm::vec4& colour) {
+  const glm::vec4 scaled =
+      glm::clamp(colour, glm::vec4(0), glm::vec4(1)) * 255.f + 0.5f;
+  return (uint32_t)scaled.x | ((uint32_t)scaled.y << 8) |
+         ((uint32_t)scaled.z << 16) | ((uint32_t)scaled.w << 24);
+}
+
+// Returns the texel at (`x`, `y`) of `texture` as normalized floats.
+glm::vec4 FetchTexel(const Texture& texture, uint32_t x, uint32_t y) {
+  const size_t index = (size_t)y * texture.GetWidth() + x;
+  const float scale = 1.f / (float)((1ull << texture.GetBitDepth()) - 1);
+  glm::vec4 texel;
+  switch (texture.GetPixelType()) {
+    case Texture::PixelType::RGBA:
+      switch (texture.GetBitDepth()) {
+        case 8:
+          texel = glm::vec4(texture.GetDataAsRGBA8()[index]);
+          break;
+        case 16:
+          texel = glm::vec4(texture.GetDataAsRGBA16()[index]);
+          break;
+        default:
+          texel = glm::vec4(texture.GetDataAsRGBA32()[index]);
+          break;
+      }
+      return texel * scale;
+    case Texture::PixelType::RGB:
+      switch (texture.GetBitDepth()) {
+        case 8:
+          texel = glm::vec4(glm::vec3(texture.GetDataAsRGB8()[index]), 1);
+          break;
+        case 16:
+          texel = glm::vec4(glm::vec3(texture.GetDataAsRGB16()[index]), 1);
+          break;
+        default:
+          texel = glm::vec4(glm::vec3(texture.GetDataAsRGB32()[index]), 1);
+          break;
+      }
+      return glm::vec4(glm::vec3(texel) * scale, 1);
+    case Texture::PixelType::Grey:
+    default:
+      switch (texture.GetBitDepth()) {
+        case 8:
+          texel = glm::vec4((float)texture.GetDataAsGrey8()[index]);
+          break;
+        case 16:
+          texel = glm::vec4((float)texture.GetDataAsGrey16()[index]);
+          break;
+        default:
+          texel = glm::vec4((float)texture.GetDataAsGrey32()[index]);
+          break;
+      }
+      return glm::vec4(glm::vec3(texel) * scale, 1);
+  }
+}
+
+// Wraps `coordinate` into [0, `size`).
+uint32_t Repeat(int64_t coordinate, uint32_t size) {
+  const int64_t wrapped = coordinate % (int64_t)size;
+  return (uint32_t)(wrapped < 0 ? wrapped + size : wrapped);
+}
+
+// Samples `texture` at `uv`, repeating outside [0, 1].
+glm::vec4 SampleTexture(const Texture& texture, const glm::vec2& uv,
+                        bool linear_filter) {
+  const uint32_t width = texture.GetWidth();
+  const uint32_t height = texture.GetHeight();
+  if (width == 0 || height == 0) {
+    return glm::vec4(1);
+  }
+  const glm::vec2 position = uv * glm::vec2(width, height);
+  if (!linear_filter) {
+    return FetchTexel(texture, Repeat((int64_t)std::floor(position.x), width),
+                      Repeat((int64_t)std::floor(position.y), height));
+  }
+  const glm::vec2 centered = position - 0.5f;
+  const glm::vec2 floored = glm::floor(centered);
+  const glm::vec2 fraction = centered - floored;
+  const uint32_t x0 = Repeat((int64_t)floored.x, width);
+  const uint32_t x1 = Repeat((int64_t)floored.x + 1, width);
+  const uint32_t y0 = Repeat((int64_t)floored.y, height);
+  const uint32_t y1 = Repeat((int64_t)floored.y + 1, height);
+  return glm::mix(glm::mix(FetchTexel(texture, x0, y0),
+                           FetchTexel(texture, x1, y0), fraction.x),
+                  glm::mix(FetchTexel(texture, x0, y1),
+                           FetchTexel(texture, x1, y1), fraction.x),
+                  fraction.y);
+}
+
+// Returns the distances of `position` inside each plane of the view frustum.
+void GetPlaneDistances(const glm::vec4& position, float (&distances)[6]) {
+  distances[0] = position.w + position.x;
+  distances[1] = position.w - position.x;
+  distances[2] = position.w + position.y;
+  distances[3] = position.w - position.y;
+  distances[4] = position.w + position.z;
+  distances[5] = position.w - position.z;
+}
+
+// Rounds `value` down to a multiple of `kSubpixelScale`, then divides by it.
+int FloorToPixel(int64_t value) {
+  return (int)(value >= 0 ? value / kSubpixelScale
+                          : -((-value + kSubpixelScale - 1) / kSubpixelScale));
+}
+
+SoftwareRasterizer::SoftwareRasterizer(uint32_t width, uint32_t height) {
+  Resize(width, height);
+}
+
+void SoftwareRasterizer::Resize(uint32_t width_, uint32_t height_) {
+  width = width_;
+  height = height_;
+  SetViewport(0, 0, width, height);
+  tile_columns = (width + kTileSize - 1) / kTileSize;
+  tile_rows = (height + kTileSize - 1) / kTileSize;
+  colours.assign((size_t)width * height, 0);
+  depths.assign((size_t)width * height, 1.f);
+  materials.clear();
+  triangles.clear();
+  tile_triangles.assign((size_t)tile_columns * tile_rows, {});
+}
+
+void SoftwareRasterizer::SetViewport(int x, int y, int viewport_width,
+                                     int viewport_height) {
+  viewport[0] = x;
+  viewport[1] = y;
+  viewport[2] = viewport_width;
+  viewport[3] = viewport_height;
+}
+
+void SoftwareRasterizer::Clear(const glm::vec4& colour, bool clear_colour,
+                               bool clear_depth) {
+  DCHECK(triangles.empty()) << "Queued triangles must be flushed first.";
+  if (clear_colour) {
+    std::fill(colours.begin(), colours.end(), PackColour(colour));
+  }
+  if (clear_depth) {
+    std::fill(depths.begin(), depths.end(), 1.f);
+  }
+}
+
+void SoftwareRasterizer::DrawMesh(const Mesh& mesh, const glm::mat4& model,
+                                  const glm::mat4& model_view_projection,
+                                  const SoftwareMaterial& material) {
+  const uint32_t material_index = materials.size();
+  materials.push_back(material);
+
+  const glm::mat3 normal_matrix =
+      glm::transpose(glm::inverse(glm::mat3(model)));
+  clip_vertices.resize(mesh.vertices.size());
+  for (size_t i = 0; i < mesh.vertices.size(); i++) {
+    const Mesh::Vertex& vertex = mesh.vertices[i];
+    clip_vertices[i] = {model_view_projection * glm::vec4(vertex.position, 1),
+                        {vertex.texCoord, normal_matrix * vertex.normal}};
+  }
+
+  const auto queue = [&](uint32_t a, uint32_t b, uint32_t c) {
+    if (a >= clip_vertices.size() || b >= clip_vertices.size() ||
+        c >= clip_vertices.size()) {
+      return;
+    }
+    const ClipVertex triangle[3] = {clip_vertices[a], clip_vertices[b],
+                                    clip_vertices[c]};
+    QueueClipped(triangle, material_index);
+  };
+  if (!mesh.triangles.empty()) {
+    for (const Mesh::Triangle& triangle : mesh.triangles) {
+      queue(triangle.points[0], triangle.points[1], triangle.points[2]);
+    }
+  } else if (!mesh.small_triangles.empty()) {
+    for (const Mesh::SmallTriangle& triangle : mesh.small_triangles) {
+      queue(triangle.points[0], triangle.points[1], triangle.points[2]);
+    }
+  } else {
+    // Unindexed meshes draw their vertices in order.
+    for (uint32_t i = 0; i + 2 < clip_vertices.size(); i += 3) {
+      queue(i, i + 1, i + 2);
+    }
+  }
+}
+
+void SoftwareRasterizer::QueueClipped(const ClipVertex (&triangle)[3],
+                                      uint32_t material) {
+  float distances[3][6];
+  bool inside = true;
+  for (int i = 0; i < 3; i++) {
+    GetPlaneDistances(triangle[i].position, distances[i]);
+  }
+  for (int plane = 0; plane < 6; plane++) {
+    const int outside_count = (distances[0][plane] < 0) +
+                              (distances[1][plane] < 0) +
+                              (distances[2][plane] < 0);
+    if (outside_count == 3) {
+      return;
+    }
+    inside &= outside_count == 0;
+  }
+  if (inside) {
+    QueueTriangle(triangle[0], triangle[1], triangle[2], material);
+    return;
+  }
+
+  // Each plane adds at most one vertex to the polygon.
+  constexpr int kMaxVertices = 9;
+  ClipVertex polygons[2][kMaxVertices];
+  int vertex_count = 3;
+  std::copy(triangle, triangle + 3, polygons[0]);
+  for (int plane = 0; plane < 6 && vertex_count >= 3; plane++) {
+    const ClipVertex* const input = polygons[plane % 2];
+    ClipVertex* const output = polygons[(plane + 1) % 2];
+    int output_count = 0;
+    for (int i = 0; i < vertex_count; i++) {
+      const ClipVertex& current = input[i];
+      const ClipVertex& next = input[(i + 1) % vertex_count];
+      float current_distances[6];
+      float next_distances[6];
+      GetPlaneDistances(current.position, current_distances);
+      GetPlaneDistances(next.position, next_distances);
+      const float current_distance = current_distances[plane];
+      const float next_distance = next_distances[plane];
+      if (current_distance >= 0) {
+        output[output_count++] = current;
+      }
+      if ((current_distance >= 0) != (next_distance >= 0)) {
+        const float t = current_distance / (current_distance - next_distance);
+        output[output_count++] = {
+            glm::mix(current.position, next.position, t),
+            {glm::mix(current.varyings.uv, next.varyings.uv, t),
+             glm::mix(current.varyings.normal, next.varyings.normal, t)}};
+      }
+    }
+    vertex_count = output_count;
+  }
+  const ClipVertex* const clipped = polygons[0];
+  for (int i = 1; i + 1 < vertex_count; i++) {
+    QueueTriangle(clipped[0], clipped[i], clipped[i + 1], material);
+  }
+}
+
+void SoftwareRasterizer::QueueTriangle(const ClipVertex& a, const ClipVertex& b,
+                                       const ClipVertex& c, uint32_t material) {
+  const ClipVertex* const vertices[3] = {&a, &b, &c};
+  Triangle triangle;
+  int64_t xs[3];
+  int64_t ys[3];
+  for (int i = 0; i < 3; i++) {
+    const glm::vec4& position = vertices[i]->position;
+    if (position.w <= 0) {
+      return;
+    }
+    const float inverse_w = 1.f / position.w;
+    const glm::vec3 ndc = glm::vec3(position) * inverse_w;
+    xs[i] = std::llround((viewport[0] + (ndc.x * 0.5f + 0.5f) * viewport[2]) *
+                         kSubpixelScale);
+    ys[i] = std::llround((viewport[1] + (ndc.y * 0.5f + 0.5f) * viewport[3]) *
+                         kSubpixelScale);
+    triangle.depths[i] = ndc.z * 0.5f + 0.5f;
+    triangle.inverse_ws[i] = inverse_w;
+    triangle.varyings[i] = {vertices[i]->varyings.uv * inverse_w,
+                            vertices[i]->varyings.normal * inverse_w};
+  }
+
+  // Twice the area, which is negative for back faces.
+  const int64_t area =
+      (xs[1] - xs[0]) * (ys[2] - ys[0]) - (xs[2] - xs[0]) * (ys[1] - ys[0]);
+  if (area <= 0) {
+    return;
+  }
+  triangle.inverse_area = 1.f / (float)area;
+  for (int i = 0; i < 3; i++) {
+    const int from = (i + 1) % 3;
+    const int to = (i + 2) % 3;
+    const int64_t dx = xs[to] - xs[from];
+    const int64_t dy = ys[to] - ys[from];
+    triangle.edge_x[i] = (int32_t)-dy;
+    triangle.edge_y[i] = (int32_t)dx;
+    triangle.edge_offset[i] = dy * xs[from] - dx * ys[from];
+    // Pixels exactly on an edge only belong to the triangle if it is a left or
+    // top edge, so triangles sharing the edge do not both cover them.
+    const bool top_left = dy < 0 || (dy == 0 && dx < 0);
+    if (!top_left) {
+      triangle.edge_offset[i] -= 1;
+    }
+  }
+
+  // Pixels are covered by their centers.
+  const int64_t half_pixel = kSubpixelScale / 2;
+  triangle.min_x = std::max(
+      {FloorToPixel(std::min({xs[0], xs[1], xs[2]}) - half_pixel +
+                    kSubpixelScale - 1),
+       viewport[0], 0});
+  triangle.min_y = std::max(
+      {FloorToPixel(std::min({ys[0], ys[1], ys[2]}) - half_pixel +
+                    kSubpixelScale - 1),
+       viewport[1], 0});
+  triangle.max_x =
+      std::min({FloorToPixel(std::max({xs[0], xs[1], xs[2]}) - half_pixel),
+                viewport[0] + viewport[2] - 1, (int)width - 1});
+  triangle.max_y =
+      std::min({FloorToPixel(std::max({ys[0], ys[1], ys[2]}) - half_pixel),
+                viewport[1] + viewport[3] - 1, (int)height - 1});
+  if (triangle.min_x > triangle.max_x || triangle.min_y > triangle.max_y) {
+    return;
+  }
+  triangle.material = material;
+
+  const uint32_t index = triangles.size();
+  triangles.push_back(triangle);
+  for (int row = triangle.min_y / kTileSize; row <= triangle.max_y / kTileSize;
+       row++) {
+    for (int column = triangle.min_x / kTileSize;
+         column <= triangle.max_x / kTileSize; column++) {
+      tile_triangles[row * tile_columns + column].push_back(index);
+    }
+  }
+}
+
+void SoftwareRasterizer::Flush(int thread_count) {
+  if (triangles.empty()) {
+    materials.clear();
+    return;
+  }
+  PROFILE_SCOPE("SoftwareRasterizer::Flush");
+  shading_light = glm::normalize(light_direction);
+  ForEachIndex(tile_triangles.size(), thread_count,
+               [this](size_t tile) { RasterizeTile(tile); });
+  for (std::vector<uint32_t>& tile : tile_triangles) {
+    tile.clear();
+  }
+  triangles.clear();
+  materials.clear();
+}
+
+void SoftwareRasterizer::RasterizeTile(int tile) {
+  const int tile_min_x = (tile % tile_columns) * kTileSize;
+  const int tile_min_y = (tile / tile_columns) * kTileSize;
+  const int tile_max_x = std::min<int>(tile_min_x + kTileSize, width) - 1;
+  const int tile_max_y = std::min<int>(tile_min_y + kTileSize, height) - 1;
+  for (const uint32_t index : tile_triangles[tile]) {
+    const Triangle& triangle = triangles[index];
+    RasterizeTriangle(triangle, std::max(triangle.min_x, tile_min_x),
+                      std::max(triangle.min_y, tile_min_y),
+                      std::min(triangle.max_x, tile_max_x),
+                      std::min(triangle.max_y, tile_max_y));
+  }
+}
+
+void SoftwareRasterizer::RasterizeTriangle(const Triangle& triangle,
+                                           int min_x, int min_y, int max_x,
+                                           int max_y) {
+  // Returns the value of edge `i` at the center of pixel (`x`, `y`).
+  const auto edge_at = [&triangle](int i, int x, int y) {
+    return triangle.edge_x[i] * (x * kSubpixelScale + kSubpixelScale / 2) +
+           triangle.edge_y[i] * (y * kSubpixelScale + kSubpixelScale / 2) +
+           triangle.edge_offset[i];
+  };
+  const float depth_0 = triangle.depths[0];
+  const float depth_1 = triangle.depths[1] - depth_0;
+  const float depth_2 = triangle.depths[2] - depth_0;
+
+  for (int block_y = min_y; block_y <= max_y; block_y += kBlockSize) {
+    const int block_max_y = std::min(block_y + kBlockSize - 1, max_y);
+    for (int block_x = min_x; block_x <= max_x; block_x += kBlockSize) {
+      const int block_max_x = std::min(block_x + kBlockSize - 1, max_x);
+      // Edges are linear, so their extremes over a block are at its corners.
+      bool outside = false;
+      bool covered = true;
+      for (int i = 0; i < 3 && !outside; i++) {
+        const int64_t corners[4] = {edge_at(i, block_x, block_y),
+                                    edge_at(i, block_max_x, block_y),
+                                    edge_at(i, block_x, block_max_y),
+                                    edge_at(i, block_max_x, block_max_y)};
+        outside =
+            std::max({corners[0], corners[1], corners[2], corners[3]}) < 0;
+        covered &=
+            std::min({corners[0], corners[1], corners[2], corners[3]}) >= 0;
+      }
+      if (outside) {
+        continue;
+      }
+
+      for (int y = block_y; y <= block_max_y; y++) {
+        int64_t edges[3] = {edge_at(0, block_x, y), edge_at(1, block_x, y),
+                            edge_at(2, block_x, y)};
+        const size_t row = (size_t)y * width;
+        for (int x = block_x; x <= block_max_x; x++) {
+          if (covered || (edges[0] | edges[1] | edges[2]) >= 0) {
+            const float weight_1 = (float)edges[1] * triangle.inverse_area;
+            const float weight_2 = (float)edges[2] * triangle.inverse_area;
+            const float depth =
+                depth_0 + weight_1 * depth_1 + weight_2 * depth_2;
+            const size_t index = row + x;
+            if (depth < depths[index]) {
+              depths[index] = depth;
+              colours[index] = PackColour(Shade(triangle, weight_1, weight_2));
+            }
+          }
+          for (int i = 0; i < 3; i++) {
+            edges[i] += triangle.edge_x[i] * kSubpixelScale;
+          }
+        }
+      }
+    }
+  }
+}
+
+glm::vec4 SoftwareRasterizer::Shade(const Triangle& triangle, float weight_1,
+                                    float weight_2) const {
+  const float weight_0 = 1 - weight_1 - weight_2;
+  const float w = 1.f / (weight_0 * triangle.inverse_ws[0] +
+                         weight_1 * triangle.inverse_ws[1] +
+                         weight_2 * triangle.inverse_ws[2]);
+  const Varyings* const varyings = triangle.varyings;
+  const SoftwareMaterial& material = materials[triangle.material];
+
+  glm::vec4 colour = material.colour;
+  if (material.texture) {
+    const glm::vec2 uv = (weight_0 * varyings[0].uv +
+                          weight_1 * varyings[1].uv +
+                          weight_2 * varyings[2].uv) *
+                         w;
+    colour *= SampleTexture(*material.texture, uv, material.linear_filter);
+  }
+  if (material.lit) {
+    const glm::vec3 normal = weight_0 * varyings[0].normal +
+                             weight_1 * varyings[1].normal +
+                             weight_2 * varyings[2].normal;
+    const float length = glm::length(normal);
+    if (length > 0) {
+      const float light =
+          std::max(glm::dot(normal / length, shading_light), 0.f);
+      colour = glm::vec4(glm::vec3(colour) * (ambient + (1 - ambient) * light),
+                         colour.w);
+    }
+  }
+  return colour;
+}
+
+std::shared_ptr<Texture> SoftwareRasterizer::ReadPixels() const {
+  std::shared_ptr<Texture> texture(
+      new Texture(Texture::PixelType::RGBA, 8, width, height));
+  Texture::pixel_rgba_8* const data = texture->GetDataAsRGBA8();
+  for (uint32_t y = 0; y < height; y++) {
+    const uint32_t* const row = &colours[(size_t)y * width];
+    Texture::pixel_rgba_8* const flipped_row =
+        &data[(size_t)(height - 1 - y) * width];
+    for (uint32_t x = 0; x < width; x++) {
+      const uint32_t colour = row[x];
+      flipped_row[x] =
+          Texture::pixel_rgba_8(colour & 0xFF, (colour >> 8) & 0xFF,
+                                (colour >> 16) & 0xFF, colour >> 24);
+    }
+  }
+  return texture;
+}
+
+float SoftwareRasterizer::GetDepth(uint32_t x, uint32_t y) const {
+  CHECK(x < width && y < height);
+  return depths[(size_t)y * width + x];
+}
@@ -0,0 +1,121 @@
+
+#include "systems/software_render_system.h"
+
+#include <algorithm>
+#include <cmath>
+#include <utility>
+#include <vector>
+
+#include "engine.h"
+#include "resources/texture_formats/png_texture.h"
+#include "utility/profiler.h"
+
+SoftwareRenderSuperSystem::SoftwareRenderSuperSystem(uint32_t width,
+                                                     uint32_t height)
+    : rasterizer(width, height) {}
+
+void SoftwareRenderSuperSystem::Init() {
+  if (addition_mode == RenderSuperSystem::RenderSystemAddition::InitWorlds) {
+    for (const std::shared_ptr<World>& world : GetEngine()->GetWorlds()) {
+      if (!world->GetSystem<RenderSystem>()) {
+        world->AddSystem(std::shared_ptr<RenderSystem>(new RenderSystem()));
+      }
+    }
+  }
+}
+
+void SoftwareRenderSuperSystem::LateUpdate(float delta_seconds) { Render(); }
+
+void SoftwareRenderSuperSystem::DrawMesh(
+    const Mesh& mesh, const glm::mat4& model,
+    const glm::mat4& model_view_projection, const SoftwareMaterial& material) {
+  rasterizer.DrawMesh(mesh, model, model_view_projection, material);
+}
+
+void SoftwareRenderSuperSystem::Render() {
+  PROFILE_SCOPE("SoftwareRenderSuperSystem::Render");
+  std::vector<std::pair<std::shared_ptr<RenderSystem>, std::shared_ptr<Camera>>>
+      ordered_cameras;
+  for (const std::shared_ptr<RenderSystem>& render_system : render_systems) {
+    for (const std::shared_ptr<Camera>& camera : render_system->cameras) {
+      if (camera->render) {
+        ordered_cameras.push_back(std::make_pair(render_system, camera));
+      }
+    }
+  }
+  std::stable_sort(
+      ordered_cameras.begin(), ordered_cameras.end(),
+      [](const std::pair<std::shared_ptr<RenderSystem>,
+                         std::shared_ptr<Camera>>& a,
+         const std::pair<std::shared_ptr<RenderSystem>,
+                         std::shared_ptr<Camera>>& b) {
+        return a.second->sort_order < b.second->sort_order;
+      });
+
+  const std::shared_ptr<SoftwareRenderSuperSystem> self =
+      std::static_pointer_cast<SoftwareRenderSuperSystem>(
+          this->shared_from_this());
+  const int width = rasterizer.GetWidth();
+  const int height = rasterizer.GetHeight();
+  for (const auto& [render_system, camera] : ordered_cameras) {
+    PROFILE_SCOPE("Camera pass");
+    int x1 = (int)ceil(width * camera->viewport[0].x),
+        y1 = (int)ceil(height * camera->viewport[0].y),
+        x2 = (int)ceil(width * camera->viewport[1].x),
+        y2 = (int)ceil(height * camera->viewport[1].y);
+    if (x2 <= x1 || y2 <= y1) {
+      continue;
+    }
+    rasterizer.SetViewport(x1, y1, x2 - x1, y2 - y1);
+    rasterizer.Clear(clear_colour,
+                     bool(camera->clear_flags & (Camera::ClearFlags::Colour)),
+                     bool(camera->clear_flags & (Camera::ClearFlags::Depth)));
+
+    const glm::mat4 projection_view =
+        camera->GetProjectionMatrix((float)(x2 - x1) / (float)(y2 - y1)) *
+        camera->GetViewMatrix();
+    for (const std::shared_ptr<Renderable>& renderable :
+         render_system->renderables) {
+      renderable->RenderSoftware(self, projection_view);
+    }
+    rasterizer.Flush(thread_count);
+  }
+}
+
+void SoftwareRenderSuperSystem::Resize(uint32_t width, uint32_t height) {
+  rasterizer.Resize(width, height);
+}
+
+std::shared_ptr<Texture> SoftwareRenderSuperSystem::GetFrame() const {
+  return rasterizer.ReadPixels();
+}
+
+absl::Status SoftwareRenderSuperSystem::SaveFrame(
+    const std::string& file) const {
+  return PngTexture::Save(*rasterizer.ReadPixels(), file);
+}
+
+SoftwareRasterizer& SoftwareRenderSuperSystem::GetRasterizer() {
+  return rasterizer;
+}
+
+void SoftwareRenderSuperSystem::NotifyOfWorldInitialization(
+    const std::shared_ptr<World>& world) {
+  if (addition_mode == RenderSuperSystem::RenderSystemAddition::AllWorlds) {
+    if (!world->GetSystem<RenderSystem>()) {
+      world->AddSystem(std::shared_ptr<RenderSystem>(new RenderSystem()));
+    }
+  }
+}
+
+void SoftwareRenderSuperSystem::NotifyOfSystemAddition(
+    const std::shared_ptr<World>& world,
+    const std::shared_ptr<System>& system) {
+  render_systems.AddSystem(system);
+}
+
+void SoftwareRenderSuperSystem::NotifyOfSystemRemoval(
+    const std::shared_ptr<World>& world,
+    const std::shared_ptr<System>& system) {
+  render_systems.RemoveSystem(system);
+}
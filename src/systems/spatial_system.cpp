@@ -0,0 +1,189 @@
+
+#include "systems/spatial_system.h"
+
+#include <glog/logging.h>
+
+#include "nodes/node_type_tag.h"
+#include "utility/parallel.h"
+
+SpatialSystem::SpatialSystem(const LooseOctree::Settings& settings)
+    : octree(settings) {}
+
+SpatialSystem::~SpatialSystem() {
+  for (const Entry& entry : entries) {
+    if (entry.transform && entry.transform->GetListener() == this) {
+      entry.transform->SetListener(nullptr);
+    }
+  }
+}
+
+void SpatialSystem::Flush() {
+  for (uint32_t id : dirty_ids) {
+    Entry& entry = entries[id];
+    if (!entry.dirty) {
+      continue;
+    }
+    entry.dirty = false;
+    const AABB bounds = entry.bounded->GetLocalBounds().Transformed(
+        entry.transform->GetGlobalMatrix());
+    if (bounds.IsEmpty()) {
+      if (octree.Contains(id)) {
+        octree.Remove(id);
+      }
+    } else if (octree.Contains(id)) {
+      octree.Update(id, bounds);
+    } else {
+      octree.Insert(id, bounds);
+    }
+  }
+  dirty_ids.clear();
+}
+
+void SpatialSystem::Refresh(Transform& node) {
+  const auto it = ids.find(&node);
+  if (it != ids.end()) {
+    MarkDirty(it->second);
+  }
+}
+
+std::vector<Transform*> SpatialSystem::QueryBox(const AABB& box) const {
+  std::vector<uint32_t> results;
+  octree.QueryBox(box, results);
+  std::vector<Transform*> nodes;
+  ToNodes(results, nodes);
+  return nodes;
+}
+
+std::vector<Transform*> SpatialSystem::QuerySphere(const glm::vec3& center,
+                                                   float radius) const {
+  std::vector<uint32_t> results;
+  octree.QuerySphere(center, radius, results);
+  std::vector<Transform*> nodes;
+  ToNodes(results, nodes);
+  return nodes;
+}
+
+std::vector<Transform*> SpatialSystem::QueryNearest(const glm::vec3& point,
+                                                    int count,
+                                                    float max_distance) const {
+  std::vector<uint32_t> results;
+  octree.QueryNearest(point, count, results, max_distance);
+  std::vector<Transform*> nodes;
+  ToNodes(results, nodes);
+  return nodes;
+}
+
+SpatialHit SpatialSystem::Raycast(const Ray& ray, float max_distance) const {
+  SpatialHit hit;
+  uint32_t id;
+  if (octree.Raycast(ray, max_distance, id, hit.distance)) {
+    hit.node = entries[id].transform;
+  }
+  return hit;
+}
+
+std::vector<std::vector<Transform*>> SpatialSystem::QueryBoxBatch(
+    const std::vector<AABB>& boxes, int thread_count) const {
+  std::vector<std::vector<Transform*>> nodes(boxes.size());
+  ForEachIndex(boxes.size(), thread_count, [&](size_t index) {
+    nodes[index] = QueryBox(boxes[index]);
+  });
+  return nodes;
+}
+
+std::vector<std::vector<Transform*>> SpatialSystem::QueryNearestBatch(
+    const std::vector<glm::vec3>& points, int count, float max_distance,
+    int thread_count) const {
+  std::vector<std::vector<Transform*>> nodes(points.size());
+  ForEachIndex(points.size(), thread_count, [&](size_t index) {
+    nodes[index] = QueryNearest(points[index], count, max_distance);
+  });
+  return nodes;
+}
+
+std::vector<SpatialHit> SpatialSystem::RaycastBatch(
+    const std::vector<Ray>& rays, float max_distance,
+    int thread_count) const {
+  std::vector<SpatialHit> hits(rays.size());
+  ForEachIndex(rays.size(), thread_count, [&](size_t index) {
+    hits[index] = Raycast(rays[index], max_distance);
+  });
+  return hits;
+}
+
+void SpatialSystem::NotifyOfNodeTreeAttachment(
+    const std::vector<std::shared_ptr<Node>>& nodes) {
+  const NodeTypeMask tags =
+      GetNodeTypeTag<Transform>() | GetNodeTypeTag<Bounded>();
+  for (const std::shared_ptr<Node>& node : nodes) {
+    if ((node->GetTypeMask() & tags) != tags) {
+      continue;
+    }
+    Transform* transform = static_cast<Transform*>(node.get());
+    CHECK(!transform->GetListener() || transform->GetListener() == this)
+        << "Node " << node->name << " is tracked by another listener.";
+    uint32_t id;
+    if (free_ids.empty()) {
+      id = entries.size();
+      entries.emplace_back();
+    } else {
+      id = free_ids.back();
+      free_ids.pop_back();
+    }
+    if (!ids.try_emplace(transform, id).second) {
+      free_ids.push_back(id);
+      continue;
+    }
+    Entry& entry = entries[id];
+    entry.transform = transform;
+    entry.bounded = dynamic_cast<const Bounded*>(transform);
+    transform->SetListener(this);
+    MarkDirty(id);
+  }
+}
+
+void SpatialSystem::NotifyOfNodeTreeDetachment(
+    const std::vector<std::shared_ptr<Node>>& nodes) {
+  const NodeTypeMask tags =
+      GetNodeTypeTag<Transform>() | GetNodeTypeTag<Bounded>();
+  for (const std::shared_ptr<Node>& node : nodes) {
+    if ((node->GetTypeMask() & tags) != tags) {
+      continue;
+    }
+    const auto it = ids.find(static_cast<const Transform*>(node.get()));
+    if (it == ids.end()) {
+      continue;
+    }
+    const uint32_t id = it->second;
+    ids.erase(it);
+    if (octree.Contains(id)) {
+      octree.Remove(id);
+    }
+    entries[id].transform->SetListener(nullptr);
+    entries[id] = Entry();
+    free_ids.push_back(id);
+  }
+}
+
+void SpatialSystem::NotifyOfGlobalTransformChange(Transform& transform) {
+  const auto it = ids.find(&transform);
+  if (it != ids.end()) {
+    MarkDirty(it->second);
+  }
+}
+
+void SpatialSystem::MarkDirty(uint32_t id) {
+  Entry& entry = entries[id];
+  if (!entry.dirty) {
+    entry.dirty = true;
+    dirty_ids.push_back(id);
+  }
+}
+
+void SpatialSystem::ToNodes(const std::vector<uint32_t>& results,
+                            std::vector<Transform*>& nodes) const {
+  nodes.reserve(nodes.size() + results.size());
+  for (uint32_t id : results) {
+    nodes.push_back(entries[id].transform);
+  }
+}
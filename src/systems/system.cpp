@@ -1,6 +1,22 @@
 
 #include "systems/system.h"
 
+#include "nodes/utility.h"
+
 std::shared_ptr<World> System::GetWorld() const { return world.lock(); }
 
 std::shared_ptr<Engine> System::GetEngine() const { return engine.lock(); }
+
+void System::NotifyOfNodeTreeAttachment(
+    const std::vector<std::shared_ptr<Node>>& nodes) {
+  for (const std::shared_ptr<Node>& root : CollectSubtreeRoots(nodes)) {
+    NotifyOfNodeAttachment(root);
+  }
+}
+
+void System::NotifyOfNodeTreeDetachment(
+    const std::vector<std::shared_ptr<Node>>& nodes) {
+  for (const std::shared_ptr<Node>& root : CollectSubtreeRoots(nodes)) {
+    NotifyOfNodeDetachment(root);
+  }
+}
@@ -0,0 +1,147 @@
+
+#include "systems/threaded_render_device.h"
+
+#include <glog/logging.h>
+
+#include <utility>
+
+#include "utility/profiler.h"
+
+ThreadedRenderDevice::ThreadedRenderDevice(
+    std::unique_ptr<RenderDevice> target_, ContextHooks hooks_,
+    int max_frames_in_flight_)
+    : target(std::move(target_)),
+      hooks(std::move(hooks_)),
+      max_frames_in_flight(max_frames_in_flight_),
+      recording(new Frame()) {
+  CHECK(target) << "ThreadedRenderDevice requires a target device.";
+  CHECK_GE(max_frames_in_flight, 1);
+  worker = std::thread(&ThreadedRenderDevice::RenderLoop, this);
+}
+
+ThreadedRenderDevice::~ThreadedRenderDevice() {
+  Flush();
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    stopping = true;
+  }
+  condition.notify_all();
+  worker.join();
+}
+
+glm::ivec2 ThreadedRenderDevice::GetSurfaceSize() {
+  return target->GetSurfaceSize();
+}
+
+void ThreadedRenderDevice::BeginFrame() { recording->submission_count = 0; }
+
+void ThreadedRenderDevice::Submit(const RenderCommandBuffer& commands) {
+  // Assigning over a kept buffer reuses its memory.
+  if (recording->submission_count < recording->submissions.size()) {
+    recording->submissions[recording->submission_count] = commands;
+  } else {
+    recording->submissions.push_back(commands);
+  }
+  recording->submission_count++;
+}
+
+void ThreadedRenderDevice::EndFrame() {
+  PROFILE_SCOPE("Wait for render thread");
+  if (caller_has_context) {
+    if (hooks.release) {
+      hooks.release();
+    }
+    caller_has_context = false;
+  }
+  std::unique_lock<std::mutex> lock(mutex);
+  condition.wait(lock, [this]() {
+    return (int)pending.size() + (executing ? 1 : 0) < max_frames_in_flight;
+  });
+  pending.push_back(std::move(recording));
+  if (free_frames.empty()) {
+    recording.reset(new Frame());
+  } else {
+    recording = std::move(free_frames.back());
+    free_frames.pop_back();
+  }
+  frame_stats = worker_stats;
+  lock.unlock();
+  condition.notify_all();
+}
+
+void ThreadedRenderDevice::Flush() {
+  {
+    std::unique_lock<std::mutex> lock(mutex);
+    condition.wait(lock, [this]() { return pending.empty() && !executing; });
+    if (worker_has_context) {
+      release_requested = true;
+      condition.notify_all();
+      condition.wait(lock, [this]() { return !worker_has_context; });
+    }
+    frame_stats = worker_stats;
+  }
+  if (!caller_has_context) {
+    if (hooks.acquire) {
+      hooks.acquire();
+    }
+    caller_has_context = true;
+  }
+}
+
+const RenderDevice::Stats& ThreadedRenderDevice::GetFrameStats() const {
+  return frame_stats;
+}
+
+void ThreadedRenderDevice::RenderLoop() {
+  std::unique_lock<std::mutex> lock(mutex);
+  while (true) {
+    condition.wait(lock, [this]() {
+      return stopping || !pending.empty() ||
+             (release_requested && worker_has_context);
+    });
+    if (!pending.empty()) {
+      std::unique_ptr<Frame> frame = std::move(pending.front());
+      pending.pop_front();
+      executing = true;
+      const bool acquire = !worker_has_context;
+      worker_has_context = true;
+      lock.unlock();
+
+      if (acquire && hooks.acquire) {
+        hooks.acquire();
+      }
+      Stats stats;
+      {
+        PROFILE_SCOPE("Render frame");
+        target->BeginFrame();
+        for (size_t i = 0; i < frame->submission_count; i++) {
+          target->Submit(frame->submissions[i]);
+        }
+        target->EndFrame();
+        stats = target->GetFrameStats();
+      }
+      // Drop references to the frame's resources now rather than whenever the
+      // frame is next recorded into.
+      for (size_t i = 0; i < frame->submission_count; i++) {
+        frame->submissions[i].Reset();
+      }
+
+      lock.lock();
+      worker_stats = stats;
+      executing = false;
+      free_frames.push_back(std::move(frame));
+      condition.notify_all();
+    } else if (release_requested && worker_has_context) {
+      lock.unlock();
+      if (hooks.release) {
+        hooks.release();
+      }
+      lock.lock();
+      worker_has_context = false;
+      release_requested = false;
+      condition.notify_all();
+    } else if (stopping) {
+      break;
+    }
+  }
+}
@@ -0,0 +1,570 @@
+
+#include "utility/collision.h"
+
+#include <algorithm>
+#include <cmath>
+#include <glm/gtc/constants.hpp>
+#include <limits>
+
+CollisionShape CollisionShape::Sphere(float radius) {
+  CollisionShape shape;
+  shape.type = Type::Sphere;
+  shape.radius = radius;
+  return shape;
+}
+
+CollisionShape CollisionShape::Capsule(float radius, float half_height) {
+  CollisionShape shape;
+  shape.type = Type::Capsule;
+  shape.radius = radius;
+  shape.half_height = half_height;
+  return shape;
+}
+
+CollisionShape CollisionShape::Box(const glm::vec3& half_extents) {
+  CollisionShape shape;
+  shape.type = Type::Box;
+  shape.half_extents = half_extents;
+  return shape;
+}
+
+AABB CollisionShape::GetLocalBounds() const {
+  switch (type) {
+    case Type::Sphere:
+      return AABB::FromCenter(glm::vec3(0), glm::vec3(radius));
+    case Type::Capsule:
+      return AABB::FromCenter(glm::vec3(0),
+                              glm::vec3(radius, radius + half_height, radius));
+    case Type::Box:
+      return AABB::FromCenter(glm::vec3(0), half_extents);
+  }
+  return AABB();
+}
+
+AABB CollisionShape::GetBounds(const glm::vec3& position,
+                               const glm::quat& rotation) const {
+  switch (type) {
+    case Type::Sphere:
+      return AABB::FromCenter(position, glm::vec3(radius));
+    case Type::Capsule:
+      return AABB::FromCenter(
+          position,
+          glm::abs(rotation * glm::vec3(0, half_height, 0)) + radius);
+    case Type::Box: {
+      const glm::mat3 axes = glm::mat3_cast(rotation);
+      return AABB::FromCenter(position, glm::abs(axes[0]) * half_extents.x +
+                                            glm::abs(axes[1]) * half_extents.y +
+                                            glm::abs(axes[2]) * half_extents.z);
+    }
+  }
+  return AABB();
+}
+
+glm::vec3 CollisionShape::GetInertia(float mass) const {
+  switch (type) {
+    case Type::Sphere:
+      return glm::vec3(0.4f * mass * radius * radius);
+    case Type::Capsule: {
+      // A cylinder with a hemisphere on each end, splitting the mass by volume.
+      const float height = 2 * half_height;
+      const float cylinder_volume = glm::pi<float>() * radius * radius * height;
+      const float sphere_volume =
+          4.f / 3.f * glm::pi<float>() * radius * radius * radius;
+      const float cylinder_mass =
+          mass * cylinder_volume / (cylinder_volume + sphere_volume);
+      const float sphere_mass = mass - cylinder_mass;
+      const float axial = cylinder_mass * radius * radius * 0.5f +
+                          sphere_mass * radius * radius * 0.4f;
+      const float lateral =
+          cylinder_mass * (radius * radius * 0.25f + height * height / 12) +
+          sphere_mass * (radius * radius * 0.4f + height * height * 0.25f +
+                         height * radius * 0.375f);
+      return glm::vec3(lateral, axial, lateral);
+    }
+    case Type::Box: {
+      const glm::vec3 squared = half_extents * half_extents;
+      return mass / 3 *
+             glm::vec3(squared.y + squared.z, squared.x + squared.z,
+                       squared.x + squared.y);
+    }
+  }
+  return glm::vec3(0);
+}
+
+// Returns the point on the segment from `start` to `end` closest to `point`.
+glm::vec3 ClosestPointOnSegment(const glm::vec3& point, const glm::vec3& start,
+                                const glm::vec3& end) {
+  const glm::vec3 direction = end - start;
+  const float length_squared = glm::dot(direction, direction);
+  if (length_squared <= 0) {
+    return start;
+  }
+  return start +
+         direction * glm::clamp(glm::dot(point - start, direction) /
+                                    length_squared,
+                                0.f, 1.f);
+}
+
+// Finds the closest points between the segments `start_a` to `end_a` and
+// `start_b` to `end_b`. See Ericson, Real-Time Collision Detection, 5.1.9.
+void ClosestPointsOnSegments(const glm::vec3& start_a, const glm::vec3& end_a,
+                             const glm::vec3& start_b, const glm::vec3& end_b,
+                             glm::vec3& point_a, glm::vec3& point_b) {
+  constexpr float kEpsilon = 1e-12f;
+  const glm::vec3 direction_a = end_a - start_a;
+  const glm::vec3 direction_b = end_b - start_b;
+  const glm::vec3 offset = start_a - start_b;
+  const float length_a = glm::dot(direction_a, direction_a);
+  const float length_b = glm::dot(direction_b, direction_b);
+  const float f = glm::dot(direction_b, offset);
+  float s = 0;
+  float t = 0;
+  if (length_a <= kEpsilon) {
+    t = length_b <= kEpsilon ? 0 : glm::clamp(f / length_b, 0.f, 1.f);
+  } else {
+    const float c = glm::dot(direction_a, offset);
+    if (length_b <= kEpsilon) {
+      s = glm::clamp(-c / length_a, 0.f, 1.f);
+    } else {
+      const float b = glm::dot(direction_a, direction_b);
+      const float denominator = length_a * length_b - b * b;
+      s = denominator > kEpsilon
+              ? glm::clamp((b * f - c * length_b) / denominator, 0.f, 1.f)
+              : 0;
+      t = (b * s + f) / length_b;
+      if (t < 0) {
+        t = 0;
+        s = glm::clamp(-c / length_a, 0.f, 1.f);
+      } else if (t > 1) {
+        t = 1;
+        s = glm::clamp((b - c) / length_a, 0.f, 1.f);
+      }
+    }
+  }
+  point_a = start_a + direction_a * s;
+  point_b = start_b + direction_b * t;
+}
+
+// Returns the segment between the centers of the end spheres of `capsule`.
+void GetCapsuleSegment(const PlacedShape& capsule, glm::vec3& start,
+                       glm::vec3& end) {
+  const glm::vec3 axis =
+      capsule.rotation * glm::vec3(0, capsule.shape.half_height, 0);
+  start = capsule.position - axis;
+  end = capsule.position + axis;
+}
+
+// Returns the point in `box` closest to `point`.
+glm::vec3 ClosestPointOnBox(const glm::vec3& point, const PlacedShape& box) {
+  const glm::vec3 local =
+      glm::conjugate(box.rotation) * (point - box.position);
+  return box.position +
+         box.rotation * glm::clamp(local, -box.shape.half_extents,
+                                   box.shape.half_extents);
+}
+
+// Adds the contact between spheres at `center_a` and `center_b`, if they are
+// within `margin` of each other.
+bool AddSphereContact(const glm::vec3& center_a, float radius_a,
+                      const glm::vec3& center_b, float radius_b, float margin,
+                      ContactManifold& manifold) {
+  const glm::vec3 offset = center_b - center_a;
+  const float distance = glm::length(offset);
+  const float depth = radius_a + radius_b - distance;
+  if (depth < -margin || manifold.point_count == ContactManifold::kMaxPoints) {
+    return false;
+  }
+  ContactPoint& point = manifold.points[manifold.point_count++];
+  point.normal = distance > 1e-6f ? offset / distance : glm::vec3(0, 1, 0);
+  point.depth = depth;
+  point.position = (center_a + point.normal * radius_a + center_b -
+                    point.normal * radius_b) *
+                   0.5f;
+  return true;
+}
+
+// Adds the contact between the sphere at `center` and `box`, if they are
+// within `margin` of each other. The normal points from the sphere to the box.
+bool AddSphereBoxContact(const glm::vec3& center, float radius,
+                         const PlacedShape& box, float margin,
+                         ContactManifold& manifold) {
+  if (manifold.point_count == ContactManifold::kMaxPoints) {
+    return false;
+  }
+  const glm::vec3& half_extents = box.shape.half_extents;
+  const glm::vec3 local =
+      glm::conjugate(box.rotation) * (center - box.position);
+  glm::vec3 box_point = glm::clamp(local, -half_extents, half_extents);
+  const glm::vec3 offset = local - box_point;
+  const float distance_squared = glm::dot(offset, offset);
+  glm::vec3 local_normal(0);
+  float depth;
+  if (distance_squared > 0) {
+    const float distance = std::sqrt(distance_squared);
+    local_normal = -offset / distance;
+    depth = radius - distance;
+  } else {
+    // The center is inside the box, so push it out through the nearest face.
+    const glm::vec3 face_distances = half_extents - glm::abs(local);
+    int axis = 0;
+    if (face_distances[1] < face_distances[axis]) {
+      axis = 1;
+    }
+    if (face_distances[2] < face_distances[axis]) {
+      axis = 2;
+    }
+    const float side = local[axis] < 0 ? -1.f : 1.f;
+    local_normal[axis] = -side;
+    box_point[axis] = side * half_extents[axis];
+    depth = radius + face_distances[axis];
+  }
+  if (depth < -margin) {
+    return false;
+  }
+  ContactPoint& point = manifold.points[manifold.point_count++];
+  point.normal = box.rotation * local_normal;
+  point.depth = depth;
+  point.position = (box.position + box.rotation * box_point + center +
+                    point.normal * radius) *
+                   0.5f;
+  return true;
+}
+
+bool CollideCapsules(const PlacedShape& a, const PlacedShape& b, float margin,
+                     ContactManifold& manifold) {
+  glm::vec3 start_a, end_a, start_b, end_b;
+  GetCapsuleSegment(a, start_a, end_a);
+  GetCapsuleSegment(b, start_b, end_b);
+  const glm::vec3 direction_a = end_a - start_a;
+  const glm::vec3 direction_b = end_b - start_b;
+  const float length_a = glm::dot(direction_a, direction_a);
+  const glm::vec3 normal = glm::cross(direction_a, direction_b);
+  const float length_b = glm::dot(direction_b, direction_b);
+  if (length_a > 0 &&
+      glm::dot(normal, normal) <= 1e-6f * length_a * length_b) {
+    // Parallel capsules touch along a line, so add a point at each end of the
+    // part of `b` alongside `a` to keep them from rolling.
+    float t_start = glm::dot(start_b - start_a, direction_a) / length_a;
+    float t_end = glm::dot(end_b - start_a, direction_a) / length_a;
+    if (t_start > t_end) {
+      std::swap(t_start, t_end);
+    }
+    t_start = std::max(t_start, 0.f);
+    t_end = std::min(t_end, 1.f);
+    if (t_start < t_end) {
+      for (float t : {t_start, t_end}) {
+        const glm::vec3 point_a = start_a + direction_a * t;
+        AddSphereContact(point_a, a.shape.radius,
+                         ClosestPointOnSegment(point_a, start_b, end_b),
+                         b.shape.radius, margin, manifold);
+      }
+      return manifold.point_count > 0;
+    }
+  }
+  glm::vec3 point_a, point_b;
+  ClosestPointsOnSegments(start_a, end_a, start_b, end_b, point_a, point_b);
+  return AddSphereContact(point_a, a.shape.radius, point_b, b.shape.radius,
+                          margin, manifold);
+}
+
+bool CollideCapsuleBox(const PlacedShape& capsule, const PlacedShape& box,
+                       float margin, ContactManifold& manifold) {
+  glm::vec3 start, end;
+  GetCapsuleSegment(capsule, start, end);
+  AddSphereBoxContact(start, capsule.shape.radius, box, margin, manifold);
+  AddSphereBoxContact(end, capsule.shape.radius, box, margin, manifold);
+  if (manifold.point_count == 0) {
+    // The middle of the capsule may touch the box when neither end does. A few
+    // rounds of projecting between the two shapes find the closest point.
+    glm::vec3 point = capsule.position;
+    for (int i = 0; i < 4; i++) {
+      point = ClosestPointOnSegment(ClosestPointOnBox(point, box), start, end);
+    }
+    AddSphereBoxContact(point, capsule.shape.radius, box, margin, manifold);
+  }
+  return manifold.point_count > 0;
+}
+
+struct OrientedBox {
+  glm::vec3 center;
+  glm::mat3 axes;
+  glm::vec3 half_extents;
+
+  explicit OrientedBox(const PlacedShape& box)
+      : center(box.position),
+        axes(glm::mat3_cast(box.rotation)),
+        half_extents(box.shape.half_extents) {}
+
+  // Returns half the length of the box projected onto `axis`.
+  float Project(const glm::vec3& axis) const {
+    return half_extents.x * std::abs(glm::dot(axes[0], axis)) +
+           half_extents.y * std::abs(glm::dot(axes[1], axis)) +
+           half_extents.z * std::abs(glm::dot(axes[2], axis));
+  }
+};
+
+// Clips the polygon `input` to where dot(`normal`, point) <= `offset`, writing
+// the result to `output`. Returns the number of points in the result, which is
+// at most one more than `input_count`.
+int ClipPolygon(const glm::vec3* input, int input_count,
+                const glm::vec3& normal, float offset, glm::vec3* output) {
+  int output_count = 0;
+  for (int i = 0; i < input_count; i++) {
+    const glm::vec3& current = input[i];
+    const glm::vec3& next = input[(i + 1) % input_count];
+    const float current_distance = glm::dot(normal, current) - offset;
+    const float next_distance = glm::dot(normal, next) - offset;
+    if (current_distance <= 0) {
+      output[output_count++] = current;
+    }
+    if ((current_distance <= 0) != (next_distance <= 0)) {
+      output[output_count++] =
+          current + (next - current) *
+                        (current_distance / (current_distance - next_distance));
+    }
+  }
+  return output_count;
+}
+
+// Adds up to four of `points` to `manifold`: the deepest point, then the point
+// furthest from it, then the points furthest to either side of the line
+// between them, which keeps the area they cover large.
+void AddReducedPoints(const ContactPoint* points, int count,
+                      ContactManifold& manifold) {
+  if (count <= ContactManifold::kMaxPoints) {
+    std::copy(points, points + count, manifold.points);
+    manifold.point_count = count;
+    return;
+  }
+  int chosen[ContactManifold::kMaxPoints] = {0, 0, 0, 0};
+  for (int i = 1; i < count; i++) {
+    if (points[i].depth > points[chosen[0]].depth) {
+      chosen[0] = i;
+    }
+  }
+  const glm::vec3& first = points[chosen[0]].position;
+  float best_distance = -1;
+  for (int i = 0; i < count; i++) {
+    const glm::vec3 offset = points[i].position - first;
+    const float distance = glm::dot(offset, offset);
+    if (distance > best_distance) {
+      best_distance = distance;
+      chosen[1] = i;
+    }
+  }
+  const glm::vec3 line = points[chosen[1]].position - first;
+  float best_left = 0;
+  float best_right = 0;
+  chosen[2] = chosen[3] = chosen[0];
+  for (int i = 0; i < count; i++) {
+    const float side = glm::dot(glm::cross(line, points[i].position - first),
+                                points[i].normal);
+    if (side > best_left) {
+      best_left = side;
+      chosen[2] = i;
+    } else if (side < best_right) {
+      best_right = side;
+      chosen[3] = i;
+    }
+  }
+  manifold.point_count = 0;
+  for (int i = 0; i < ContactManifold::kMaxPoints; i++) {
+    if (std::find(chosen, chosen + i, chosen[i]) == chosen + i) {
+      manifold.points[manifold.point_count++] = points[chosen[i]];
+    }
+  }
+}
+
+// Finds the contacts of two boxes with the separating axis test. Boxes touching
+// face to face are clipped against each other to find up to four points, while
+// boxes touching edge to edge have one point.
+bool CollideBoxes(const PlacedShape& a_shape, const PlacedShape& b_shape,
+                  float margin, ContactManifold& manifold) {
+  const OrientedBox a(a_shape);
+  const OrientedBox b(b_shape);
+  const glm::vec3 offset = b.center - a.center;
+
+  float face_overlap = std::numeric_limits<float>::infinity();
+  int face = 0;
+  for (int i = 0; i < 6; i++) {
+    const glm::vec3& axis = i < 3 ? a.axes[i] : b.axes[i - 3];
+    const float overlap =
+        a.Project(axis) + b.Project(axis) - std::abs(glm::dot(offset, axis));
+    if (overlap < -margin) {
+      return false;
+    }
+    if (overlap < face_overlap) {
+      face_overlap = overlap;
+      face = i;
+    }
+  }
+  float edge_overlap = std::numeric_limits<float>::infinity();
+  int edge = -1;
+  glm::vec3 edge_axis;
+  for (int i = 0; i < 3; i++) {
+    for (int j = 0; j < 3; j++) {
+      glm::vec3 axis = glm::cross(a.axes[i], b.axes[j]);
+      const float length = glm::length(axis);
+      // Parallel edges are already covered by the face axes.
+      if (length < 1e-4f) {
+        continue;
+      }
+      axis /= length;
+      const float overlap =
+          a.Project(axis) + b.Project(axis) - std::abs(glm::dot(offset, axis));
+      if (overlap < -margin) {
+        return false;
+      }
+      if (overlap < edge_overlap) {
+        edge_overlap = overlap;
+        edge = i * 3 + j;
+        edge_axis = axis;
+      }
+    }
+  }
+
+  // Face contacts are much more stable, so edges are only used when they are
+  // clearly the axis of least overlap.
+  if (edge >= 0 && edge_overlap < face_overlap * 0.95f - 0.01f) {
+    const int i = edge / 3;
+    const int j = edge % 3;
+    const glm::vec3 normal =
+        glm::dot(edge_axis, offset) < 0 ? -edge_axis : edge_axis;
+    // Find the edge of each box furthest towards the other box.
+    glm::vec3 edge_a = a.center;
+    glm::vec3 edge_b = b.center;
+    for (int k = 0; k < 3; k++) {
+      if (k != i) {
+        edge_a += a.axes[k] * (glm::dot(a.axes[k], normal) > 0
+                                   ? a.half_extents[k]
+                                   : -a.half_extents[k]);
+      }
+      if (k != j) {
+        edge_b += b.axes[k] * (glm::dot(b.axes[k], normal) < 0
+                                   ? b.half_extents[k]
+                                   : -b.half_extents[k]);
+      }
+    }
+    const glm::vec3 along_a = a.axes[i] * a.half_extents[i];
+    const glm::vec3 along_b = b.axes[j] * b.half_extents[j];
+    glm::vec3 point_a, point_b;
+    ClosestPointsOnSegments(edge_a - along_a, edge_a + along_a,
+                            edge_b - along_b, edge_b + along_b, point_a,
+                            point_b);
+    ContactPoint& point = manifold.points[manifold.point_count++];
+    point.normal = normal;
+    point.depth = edge_overlap;
+    point.position = (point_a + point_b) * 0.5f;
+    return true;
+  }
+
+  const bool a_is_reference = face < 3;
+  const OrientedBox& reference = a_is_reference ? a : b;
+  const OrientedBox& incident = a_is_reference ? b : a;
+  const int reference_axis = face % 3;
+  const glm::vec3 normal = glm::dot(reference.axes[reference_axis], offset) < 0
+                               ? -reference.axes[reference_axis]
+                               : reference.axes[reference_axis];
+  // The normal of the reference face, pointing towards the incident box.
+  const glm::vec3 reference_normal = a_is_reference ? normal : -normal;
+  const glm::vec3 reference_center =
+      reference.center +
+      reference_normal * reference.half_extents[reference_axis];
+
+  // The incident face is the one facing most against the reference face.
+  int incident_axis = 0;
+  for (int k = 1; k < 3; k++) {
+    if (std::abs(glm::dot(incident.axes[k], reference_normal)) >
+        std::abs(glm::dot(incident.axes[incident_axis], reference_normal))) {
+      incident_axis = k;
+    }
+  }
+  const float incident_side =
+      glm::dot(incident.axes[incident_axis], reference_normal) > 0 ? -1.f
+                                                                   : 1.f;
+  const glm::vec3 incident_center =
+      incident.center + incident.axes[incident_axis] *
+                            (incident.half_extents[incident_axis] *
+                             incident_side);
+  const int u = (incident_axis + 1) % 3;
+  const int v = (incident_axis + 2) % 3;
+  const glm::vec3 along_u = incident.axes[u] * incident.half_extents[u];
+  const glm::vec3 along_v = incident.axes[v] * incident.half_extents[v];
+  // Clipping a quad by four planes leaves at most eight points.
+  glm::vec3 polygon[8] = {
+      incident_center + along_u + along_v, incident_center - along_u + along_v,
+      incident_center - along_u - along_v, incident_center + along_u - along_v};
+  int polygon_count = 4;
+  glm::vec3 clipped[8];
+  for (int k = 0; k < 3; k++) {
+    if (k == reference_axis) {
+      continue;
+    }
+    for (float side : {1.f, -1.f}) {
+      const glm::vec3 side_normal = reference.axes[k] * side;
+      polygon_count = ClipPolygon(
+          polygon, polygon_count, side_normal,
+          glm::dot(side_normal, reference.center) + reference.half_extents[k],
+          clipped);
+      std::copy(clipped, clipped + polygon_count, polygon);
+    }
+  }
+
+  ContactPoint points[8];
+  int point_count = 0;
+  for (int k = 0; k < polygon_count; k++) {
+    const float separation =
+        glm::dot(polygon[k] - reference_center, reference_normal);
+    if (separation > margin) {
+      continue;
+    }
+    ContactPoint& point = points[point_count++];
+    point.normal = normal;
+    point.depth = -separation;
+    point.position = polygon[k] - reference_normal * (separation * 0.5f);
+  }
+  AddReducedPoints(points, point_count, manifold);
+  return manifold.point_count > 0;
+}
+
+bool Collide(const PlacedShape& a, const PlacedShape& b, float margin,
+             ContactManifold& manifold) {
+  manifold.point_count = 0;
+  // Each pair of shape types is handled once, with the lower type first.
+  if (b.shape.type < a.shape.type) {
+    if (!Collide(b, a, margin, manifold)) {
+      return false;
+    }
+    for (int i = 0; i < manifold.point_count; i++) {
+      manifold.points[i].normal = -manifold.points[i].normal;
+    }
+    return true;
+  }
+  switch (a.shape.type) {
+    case CollisionShape::Type::Sphere:
+      switch (b.shape.type) {
+        case CollisionShape::Type::Sphere:
+          return AddSphereContact(a.position, a.shape.radius, b.position,
+                                  b.shape.radius, margin, manifold);
+        case CollisionShape::Type::Capsule: {
+          glm::vec3 start, end;
+          GetCapsuleSegment(b, start, end);
+          return AddSphereContact(a.position, a.shape.radius,
+                                  ClosestPointOnSegment(a.position, start, end),
+                                  b.shape.radius, margin, manifold);
+        }
+        case CollisionShape::Type::Box:
+          return AddSphereBoxContact(a.position, a.shape.radius, b, margin,
+                                     manifold);
+      }
+      break;
+    case CollisionShape::Type::Capsule:
+      if (b.shape.type == CollisionShape::Type::Capsule) {
+        return CollideCapsules(a, b, margin, manifold);
+      }
+      return CollideCapsuleBox(a, b, margin, manifold);
+    case CollisionShape::Type::Box:
+      return CollideBoxes(a, b, margin, manifold);
+  }
+  return false;
+}
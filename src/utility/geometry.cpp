@@ -0,0 +1,126 @@
+
+#include "utility/geometry.h"
+
+#include <algorithm>
+
+AABB AABB::FromCenter(const glm::vec3& center, const glm::vec3& extents) {
+  return AABB(center - extents, center + extents);
+}
+
+bool AABB::IsEmpty() const {
+  return min.x > max.x || min.y > max.y || min.z > max.z;
+}
+
+float AABB::GetSurfaceArea() const {
+  if (IsEmpty()) {
+    return 0;
+  }
+  const glm::vec3 size = max - min;
+  return 2 * (size.x * size.y + size.y * size.z + size.z * size.x);
+}
+
+void AABB::Expand(const glm::vec3& point) {
+  min = glm::min(min, point);
+  max = glm::max(max, point);
+}
+
+void AABB::Expand(const AABB& box) {
+  min = glm::min(min, box.min);
+  max = glm::max(max, box.max);
+}
+
+bool AABB::Contains(const glm::vec3& point) const {
+  return point.x >= min.x && point.y >= min.y && point.z >= min.z &&
+         point.x <= max.x && point.y <= max.y && point.z <= max.z;
+}
+
+bool AABB::Contains(const AABB& box) const {
+  return box.min.x >= min.x && box.min.y >= min.y && box.min.z >= min.z &&
+         box.max.x <= max.x && box.max.y <= max.y && box.max.z <= max.z;
+}
+
+bool AABB::Intersects(const AABB& box) const {
+  return box.max.x >= min.x && box.max.y >= min.y && box.max.z >= min.z &&
+         box.min.x <= max.x && box.min.y <= max.y && box.min.z <= max.z;
+}
+
+float AABB::DistanceSquared(const glm::vec3& point) const {
+  const glm::vec3 offset =
+      glm::max(glm::max(min - point, point - max), glm::vec3(0, 0, 0));
+  return glm::dot(offset, offset);
+}
+
+AABB AABB::Transformed(const glm::mat4& matrix) const {
+  if (IsEmpty()) {
+    return AABB();
+  }
+  // The extents along each new axis are the sum of the old extents projected
+  // onto it, so the box never needs its eight corners transformed.
+  const glm::vec3 center = glm::vec3(matrix * glm::vec4(GetCenter(), 1));
+  const glm::vec3 extents = GetExtents();
+  glm::vec3 new_extents(0, 0, 0);
+  for (int column = 0; column < 3; column++) {
+    new_extents += glm::abs(glm::vec3(matrix[column])) * extents[column];
+  }
+  return FromCenter(center, new_extents);
+}
+
+Frustum::Frustum(const glm::mat4& matrix) {
+  // Each clip-space bound, such as -w <= x, is a plane in the source space.
+  // GLM matrices are column-major, so rows are gathered across the columns.
+  const glm::vec4 row_x(matrix[0][0], matrix[1][0], matrix[2][0], matrix[3][0]);
+  const glm::vec4 row_y(matrix[0][1], matrix[1][1], matrix[2][1], matrix[3][1]);
+  const glm::vec4 row_z(matrix[0][2], matrix[1][2], matrix[2][2], matrix[3][2]);
+  const glm::vec4 row_w(matrix[0][3], matrix[1][3], matrix[2][3], matrix[3][3]);
+  planes[0] = row_w + row_x;
+  planes[1] = row_w - row_x;
+  planes[2] = row_w + row_y;
+  planes[3] = row_w - row_y;
+  planes[4] = row_w + row_z;
+  planes[5] = row_w - row_z;
+}
+
+bool Frustum::Intersects(const AABB& box) const {
+  if (box.IsEmpty()) {
+    return false;
+  }
+  for (const glm::vec4& plane : planes) {
+    // The corner of the box furthest along the plane's normal.
+    const glm::vec3 corner(plane.x >= 0 ? box.max.x : box.min.x,
+                           plane.y >= 0 ? box.max.y : box.min.y,
+                           plane.z >= 0 ? box.max.z : box.min.z);
+    if (glm::dot(glm::vec3(plane), corner) + plane.w < 0) {
+      return false;
+    }
+  }
+  return true;
+}
+
+Ray::Ray(const glm::vec3& origin_, const glm::vec3& direction_)
+    : origin(origin_),
+      direction(direction_),
+      // Division by zero gives infinities, which the slab test relies on.
+      inverse_direction(1.0f / direction_.x, 1.0f / direction_.y,
+                        1.0f / direction_.z) {}
+
+bool IntersectRay(const Ray& ray, const AABB& box, float max_distance,
+                  float& distance) {
+  float near = 0;
+  float far = max_distance;
+  for (int axis = 0; axis < 3; axis++) {
+    float t0 = (box.min[axis] - ray.origin[axis]) * ray.inverse_direction[axis];
+    float t1 = (box.max[axis] - ray.origin[axis]) * ray.inverse_direction[axis];
+    if (t0 > t1) {
+      std::swap(t0, t1);
+    }
+    // Written so that NaNs (from a zero direction on the slab's boundary)
+    // leave the interval unchanged.
+    near = t0 > near ? t0 : near;
+    far = t1 < far ? t1 : far;
+    if (near > far) {
+      return false;
+    }
+  }
+  distance = near;
+  return true;
+}
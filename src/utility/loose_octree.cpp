@@ -0,0 +1,336 @@
+
+#include "utility/loose_octree.h"
+
+#include <glog/logging.h>
+
+#include <algorithm>
+#include <queue>
+#include <utility>
+
+LooseOctree::LooseOctree(const Settings& settings_) : settings(settings_) {
+  CHECK(settings.half_size > 0) << "The root cell of an octree must have size.";
+  Cell root;
+  root.center = settings.center;
+  root.half_size = settings.half_size;
+  root.parent = kNoCell;
+  root.depth = 0;
+  cells.push_back(std::move(root));
+}
+
+void LooseOctree::Insert(uint32_t id, const AABB& bounds) {
+  CHECK(!bounds.IsEmpty()) << "Cannot insert an empty box into an octree.";
+  if (id >= objects.size()) {
+    objects.resize(id + 1);
+  }
+  CHECK(objects[id].cell == kNoCell) << "Box " << id << " is already added.";
+  objects[id].bounds = bounds;
+  AddToCell(id, FindCell(bounds, kRootCell));
+}
+
+void LooseOctree::Update(uint32_t id, const AABB& bounds) {
+  CHECK(Contains(id)) << "Box " << id << " is not in the octree.";
+  CHECK(!bounds.IsEmpty()) << "Cannot move a box in an octree to be empty.";
+  objects[id].bounds = bounds;
+  const uint32_t old_cell = objects[id].cell;
+  const uint32_t new_cell = FindCell(bounds, kRootCell);
+  if (new_cell == old_cell) {
+    return;
+  }
+  // Only release cells once the box is in its new cell, so cells on both paths
+  // are not released and then immediately recreated.
+  RemoveFromCell(id);
+  AddToCell(id, new_cell);
+  ReleaseEmptyCells(old_cell);
+}
+
+void LooseOctree::Remove(uint32_t id) {
+  CHECK(Contains(id)) << "Box " << id << " is not in the octree.";
+  const uint32_t old_cell = objects[id].cell;
+  RemoveFromCell(id);
+  ReleaseEmptyCells(old_cell);
+}
+
+bool LooseOctree::Contains(uint32_t id) const {
+  return id < objects.size() && objects[id].cell != kNoCell;
+}
+
+const AABB& LooseOctree::GetBounds(uint32_t id) const {
+  DCHECK(Contains(id));
+  return objects[id].bounds;
+}
+
+void LooseOctree::QueryBox(const AABB& box,
+                           std::vector<uint32_t>& results) const {
+  std::vector<uint32_t> stack{kRootCell};
+  while (!stack.empty()) {
+    const Cell& cell = cells[stack.back()];
+    stack.pop_back();
+    for (uint32_t id : cell.objects) {
+      if (objects[id].bounds.Intersects(box)) {
+        results.push_back(id);
+      }
+    }
+    if (cell.first_child == kNoCell) {
+      continue;
+    }
+    for (uint32_t child = cell.first_child; child < cell.first_child + 8;
+         child++) {
+      if (cells[child].subtree_count != 0 &&
+          GetLooseBounds(child).Intersects(box)) {
+        stack.push_back(child);
+      }
+    }
+  }
+}
+
+void LooseOctree::QuerySphere(const glm::vec3& center, float radius,
+                              std::vector<uint32_t>& results) const {
+  const float radius_squared = radius * radius;
+  std::vector<uint32_t> stack{kRootCell};
+  while (!stack.empty()) {
+    const Cell& cell = cells[stack.back()];
+    stack.pop_back();
+    for (uint32_t id : cell.objects) {
+      if (objects[id].bounds.DistanceSquared(center) <= radius_squared) {
+        results.push_back(id);
+      }
+    }
+    if (cell.first_child == kNoCell) {
+      continue;
+    }
+    for (uint32_t child = cell.first_child; child < cell.first_child + 8;
+         child++) {
+      if (cells[child].subtree_count != 0 &&
+          GetLooseBounds(child).DistanceSquared(center) <= radius_squared) {
+        stack.push_back(child);
+      }
+    }
+  }
+}
+
+void LooseOctree::QueryNearest(const glm::vec3& point, int count,
+                               std::vector<uint32_t>& results,
+                               float max_distance) const {
+  if (count <= 0) {
+    return;
+  }
+  const float max_distance_squared = max_distance * max_distance;
+  // Cells and boxes are visited closest first. A cell is never closer than
+  // the boxes in it, so a box is only visited once everything closer has
+  // been.
+  struct Entry {
+    float distance_squared;
+    bool is_object;
+    uint32_t index;
+
+    bool operator>(const Entry& other) const {
+      return distance_squared > other.distance_squared;
+    }
+  };
+  std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> queue;
+  queue.push(Entry{0, false, kRootCell});
+  int found = 0;
+  while (!queue.empty() && found < count) {
+    const Entry entry = queue.top();
+    queue.pop();
+    if (entry.is_object) {
+      results.push_back(entry.index);
+      found++;
+      continue;
+    }
+    const Cell& cell = cells[entry.index];
+    for (uint32_t id : cell.objects) {
+      const float distance_squared =
+          objects[id].bounds.DistanceSquared(point);
+      if (distance_squared <= max_distance_squared) {
+        queue.push(Entry{distance_squared, true, id});
+      }
+    }
+    if (cell.first_child == kNoCell) {
+      continue;
+    }
+    for (uint32_t child = cell.first_child; child < cell.first_child + 8;
+         child++) {
+      if (cells[child].subtree_count == 0) {
+        continue;
+      }
+      const float distance_squared =
+          GetLooseBounds(child).DistanceSquared(point);
+      if (distance_squared <= max_distance_squared) {
+        queue.push(Entry{distance_squared, false, child});
+      }
+    }
+  }
+}
+
+bool LooseOctree::Raycast(const Ray& ray, float max_distance, uint32_t& id,
+                          float& distance) const {
+  // Cells are visited in the order the ray enters them, stopping once the
+  // closest hit is before the next cell.
+  using Entry = std::pair<float, uint32_t>;
+  std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> queue;
+  queue.push(Entry(0.0f, kRootCell));
+  bool hit = false;
+  float closest = max_distance;
+  while (!queue.empty() && queue.top().first <= closest) {
+    const Cell& cell = cells[queue.top().second];
+    queue.pop();
+    for (uint32_t object : cell.objects) {
+      float object_distance;
+      if (IntersectRay(ray, objects[object].bounds, closest,
+                       object_distance) &&
+          (!hit || object_distance < closest)) {
+        hit = true;
+        closest = object_distance;
+        id = object;
+      }
+    }
+    if (cell.first_child == kNoCell) {
+      continue;
+    }
+    for (uint32_t child = cell.first_child; child < cell.first_child + 8;
+         child++) {
+      float child_distance;
+      if (cells[child].subtree_count != 0 &&
+          IntersectRay(ray, GetLooseBounds(child), closest, child_distance)) {
+        queue.push(Entry(child_distance, child));
+      }
+    }
+  }
+  if (hit) {
+    distance = closest;
+  }
+  return hit;
+}
+
+uint32_t LooseOctree::FindCell(const AABB& bounds, uint32_t cell) const {
+  const glm::vec3 center = bounds.GetCenter();
+  const glm::vec3 extents = bounds.GetExtents();
+  const float extent = std::max(extents.x, std::max(extents.y, extents.z));
+
+  if (cell == kRootCell) {
+    const glm::vec3 offset = glm::abs(center - cells[kRootCell].center);
+    if (std::max(offset.x, std::max(offset.y, offset.z)) >
+        cells[kRootCell].half_size) {
+      return kRootCell;
+    }
+  }
+  while (cells[cell].first_child != kNoCell &&
+         cells[cell].half_size * 0.5f >= extent) {
+    const glm::vec3& cell_center = cells[cell].center;
+    const uint32_t octant = (center.x >= cell_center.x ? 1 : 0) |
+                            (center.y >= cell_center.y ? 2 : 0) |
+                            (center.z >= cell_center.z ? 4 : 0);
+    cell = cells[cell].first_child + octant;
+  }
+  return cell;
+}
+
+void LooseOctree::SplitCell(uint32_t cell) {
+  uint32_t first_child;
+  if (free_children.empty()) {
+    first_child = cells.size();
+    cells.resize(cells.size() + 8);
+  } else {
+    first_child = free_children.back();
+    free_children.pop_back();
+  }
+  const float child_half_size = cells[cell].half_size * 0.5f;
+  for (uint32_t i = 0; i < 8; i++) {
+    Cell& child = cells[first_child + i];
+    child.center = cells[cell].center +
+                   glm::vec3(i & 1 ? child_half_size : -child_half_size,
+                             i & 2 ? child_half_size : -child_half_size,
+                             i & 4 ? child_half_size : -child_half_size);
+    child.half_size = child_half_size;
+    child.parent = cell;
+    child.first_child = kNoCell;
+    child.depth = cells[cell].depth + 1;
+    child.subtree_count = 0;
+    child.objects.clear();
+  }
+  cells[cell].first_child = first_child;
+
+  // Move every box that fits into a child. Boxes that stay keep their order.
+  std::vector<uint32_t> staying;
+  for (uint32_t id : cells[cell].objects) {
+    const uint32_t child = FindCell(objects[id].bounds, cell);
+    if (child == cell) {
+      objects[id].slot = staying.size();
+      staying.push_back(id);
+      continue;
+    }
+    objects[id].cell = child;
+    objects[id].slot = cells[child].objects.size();
+    cells[child].objects.push_back(id);
+    cells[child].subtree_count++;
+  }
+  cells[cell].objects = std::move(staying);
+  for (uint32_t child = first_child; child < first_child + 8; child++) {
+    if (CanSplit(child)) {
+      SplitCell(child);
+    }
+  }
+}
+
+bool LooseOctree::CanSplit(uint32_t cell) const {
+  return cells[cell].first_child == kNoCell &&
+         cells[cell].depth < settings.max_depth &&
+         cells[cell].objects.size() > settings.split_count;
+}
+
+AABB LooseOctree::GetLooseBounds(uint32_t cell) const {
+  return AABB::FromCenter(cells[cell].center,
+                          glm::vec3(cells[cell].half_size * 2));
+}
+
+void LooseOctree::AddToCell(uint32_t id, uint32_t cell) {
+  Object& object = objects[id];
+  object.cell = cell;
+  object.slot = cells[cell].objects.size();
+  cells[cell].objects.push_back(id);
+  for (uint32_t ancestor = cell; ancestor != kNoCell;
+       ancestor = cells[ancestor].parent) {
+    cells[ancestor].subtree_count++;
+  }
+  if (CanSplit(cell)) {
+    SplitCell(cell);
+  }
+}
+
+void LooseOctree::RemoveFromCell(uint32_t id) {
+  Object& object = objects[id];
+  std::vector<uint32_t>& cell_objects = cells[object.cell].objects;
+  cell_objects[object.slot] = cell_objects.back();
+  objects[cell_objects[object.slot]].slot = object.slot;
+  cell_objects.pop_back();
+  for (uint32_t ancestor = object.cell; ancestor != kNoCell;
+       ancestor = cells[ancestor].parent) {
+    cells[ancestor].subtree_count--;
+  }
+  object.cell = kNoCell;
+}
+
+void LooseOctree::ReleaseEmptyCells(uint32_t cell) {
+  uint32_t highest_empty_cell = kNoCell;
+  for (; cell != kNoCell && cells[cell].subtree_count == 0;
+       cell = cells[cell].parent) {
+    highest_empty_cell = cell;
+  }
+  if (highest_empty_cell != kNoCell) {
+    ReleaseChildren(highest_empty_cell);
+  }
+}
+
+void LooseOctree::ReleaseChildren(uint32_t cell) {
+  const uint32_t first_child = cells[cell].first_child;
+  if (first_child == kNoCell) {
+    return;
+  }
+  for (uint32_t child = first_child; child < first_child + 8; child++) {
+    DCHECK(cells[child].subtree_count == 0);
+    ReleaseChildren(child);
+  }
+  cells[cell].first_child = kNoCell;
+  free_children.push_back(first_child);
+}
@@ -0,0 +1,47 @@
+
+#include "utility/parallel.h"
+
+WorkerPool::WorkerPool(int thread_count) {
+  for (int i = 1; i < thread_count; i++) {
+    workers.emplace_back(&WorkerPool::WorkerLoop, this);
+  }
+}
+
+WorkerPool::~WorkerPool() {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    stopping = true;
+  }
+  job_ready.notify_all();
+  for (std::thread& worker : workers) {
+    worker.join();
+  }
+}
+
+void WorkerPool::WorkerLoop() {
+  uint64_t last_generation = 0;
+  std::unique_lock<std::mutex> lock(mutex);
+  while (true) {
+    job_ready.wait(lock, [this, last_generation]() {
+      return stopping || generation != last_generation;
+    });
+    if (stopping) {
+      return;
+    }
+    // The caller waits for every worker before starting another job, so no
+    // job is ever skipped.
+    last_generation = generation;
+    lock.unlock();
+    RunJob();
+    lock.lock();
+    if (--busy_workers == 0) {
+      job_done.notify_one();
+    }
+  }
+}
+
+void WorkerPool::RunJob() {
+  for (size_t index = next_index++; index < job_count; index = next_index++) {
+    job_run(job_function, index);
+  }
+}
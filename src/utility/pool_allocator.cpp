@@ -0,0 +1,52 @@
+
+#include "utility/pool_allocator.h"
+
+#include <algorithm>
+
+FixedSizePool::FixedSizePool(size_t block_size_, size_t alignment_)
+    : alignment(std::max(alignment_, alignof(FreeBlock))) {
+  // Every block must be able to hold a free list entry, and every block after
+  // the first must stay aligned.
+  block_size = std::max(block_size_, sizeof(FreeBlock));
+  block_size = (block_size + alignment - 1) / alignment * alignment;
+  blocks_per_chunk = std::max<size_t>(kChunkSize / block_size, 1);
+}
+
+FixedSizePool::~FixedSizePool() {
+  for (void* chunk : chunks) {
+    ::operator delete(chunk, std::align_val_t(alignment));
+  }
+}
+
+void* FixedSizePool::Allocate() {
+  std::lock_guard<std::mutex> lock(mutex);
+  if (!free_list) {
+    AddChunk();
+  }
+  FreeBlock* block = free_list;
+  free_list = block->next;
+  return block;
+}
+
+void FixedSizePool::Free(void* block) {
+  if (!block) {
+    return;
+  }
+  std::lock_guard<std::mutex> lock(mutex);
+  FreeBlock* free_block = static_cast<FreeBlock*>(block);
+  free_block->next = free_list;
+  free_list = free_block;
+}
+
+void FixedSizePool::AddChunk() {
+  unsigned char* chunk = static_cast<unsigned char*>(::operator new(
+      block_size * blocks_per_chunk, std::align_val_t(alignment)));
+  chunks.push_back(chunk);
+  // Link the blocks in address order so consecutive allocations are adjacent.
+  for (size_t i = blocks_per_chunk; i > 0; i--) {
+    FreeBlock* block =
+        reinterpret_cast<FreeBlock*>(chunk + (i - 1) * block_size);
+    block->next = free_list;
+    free_list = block;
+  }
+}
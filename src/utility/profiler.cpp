@@ -0,0 +1,136 @@
+
+#include "utility/profiler.h"
+
+#include <cxxabi.h>
+
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+
+#include "utility/status.h"
+
+Profiler Profiler::instance;
+
+void Profiler::SetEnabled(bool enabled_) {
+  enabled.store(enabled_, std::memory_order_relaxed);
+}
+
+void Profiler::Record(const Event& event) { Push(GetThreadBuffer(), event); }
+
+void Profiler::RecordOnTrack(const char* track, const Event& event) {
+  Push(GetTrackBuffer(track), event);
+}
+
+uint64_t Profiler::Now() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+const char* Profiler::GetTypeName(const std::type_info& type) {
+  // Each thread remembers the names it has looked up, so naming the same
+  // types every frame takes neither the lock nor a demangle. Names are never
+  // removed, so cached pointers stay valid.
+  thread_local absl::flat_hash_map<const std::type_info*, const char*> cache;
+  const char*& cached = cache[&type];
+  if (cached) {
+    return cached;
+  }
+  std::lock_guard<std::mutex> lock(type_names_mutex);
+  std::unique_ptr<std::string>& name = type_names[std::type_index(type)];
+  if (!name) {
+    int status = 0;
+    char* demangled = abi::__cxa_demangle(type.name(), nullptr, nullptr,
+                                          &status);
+    name.reset(new std::string(status == 0 ? demangled : type.name()));
+    free(demangled);
+  }
+  cached = name->c_str();
+  return cached;
+}
+
+Profiler::ThreadBuffer& Profiler::GetThreadBuffer() {
+  thread_local ThreadBuffer* buffer = nullptr;
+  if (!buffer) {
+    std::lock_guard<std::mutex> lock(buffers_mutex);
+    buffers.emplace_back(new ThreadBuffer());
+    buffer = buffers.back().get();
+    buffer->name = STATUS_MESSAGE("Thread " << buffers.size());
+  }
+  return *buffer;
+}
+
+Profiler::ThreadBuffer& Profiler::GetTrackBuffer(const char* track) {
+  std::lock_guard<std::mutex> lock(buffers_mutex);
+  for (size_t i = 0; i < track_names.size(); i++) {
+    if (track_names[i] == track) {
+      return *track_buffers[i];
+    }
+  }
+  buffers.emplace_back(new ThreadBuffer());
+  ThreadBuffer* buffer = buffers.back().get();
+  buffer->name = track;
+  track_names.push_back(track);
+  track_buffers.push_back(buffer);
+  return *buffer;
+}
+
+void Profiler::Push(ThreadBuffer& buffer, const Event& event) {
+  // Only the owning thread writes, so a relaxed load of the index is enough.
+  const uint64_t index = buffer.write_index.load(std::memory_order_relaxed);
+  buffer.events[index % kEventsPerThread] = event;
+  buffer.write_index.store(index + 1, std::memory_order_release);
+}
+
+// Writes `value` to `stream` as a JSON string.
+void WriteJsonString(std::ostream& stream, const char* value) {
+  stream << '"';
+  for (const char* c = value; *c; c++) {
+    if (*c == '"' || *c == '\\') {
+      stream << '\\';
+    }
+    stream << *c;
+  }
+  stream << '"';
+}
+
+absl::Status Profiler::WriteChromeTrace(const std::string& path) const {
+  std::ofstream file(path, std::ios_base::out | std::ios_base::trunc);
+  if (!file.is_open()) {
+    return absl::FailedPreconditionError(
+        STATUS_MESSAGE("Failed to open file \"" << path << "\""));
+  }
+  std::lock_guard<std::mutex> lock(buffers_mutex);
+  // Timestamps are in microseconds since the profiler's epoch, and would be
+  // rounded to a few significant digits by default.
+  file << std::fixed << std::setprecision(3);
+  file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+  bool first = true;
+  for (size_t thread = 0; thread < buffers.size(); thread++) {
+    const ThreadBuffer& buffer = *buffers[thread];
+    file << (first ? "" : ",") << "\n{\"name\":\"thread_name\",\"ph\":\"M\","
+         << "\"pid\":0,\"tid\":" << thread << ",\"args\":{\"name\":";
+    WriteJsonString(file, buffer.name.c_str());
+    file << "}}";
+    first = false;
+
+    const uint64_t end = buffer.write_index.load(std::memory_order_acquire);
+    const uint64_t begin = end > kEventsPerThread ? end - kEventsPerThread : 0;
+    for (uint64_t i = begin; i < end; i++) {
+      const Event& event = buffer.events[i % kEventsPerThread];
+      // Chrome traces are in microseconds.
+      file << ",\n{\"name\":";
+      WriteJsonString(file, event.name);
+      file << ",\"ph\":\"X\",\"pid\":0,\"tid\":" << thread
+           << ",\"ts\":" << event.start_ns / 1000.0
+           << ",\"dur\":" << (event.end_ns - event.start_ns) / 1000.0 << "}";
+    }
+  }
+  file << "\n]}\n";
+  if (file.bad()) {
+    return absl::UnknownError(
+        STATUS_MESSAGE("Failed to write file \"" << path << "\""));
+  }
+  return absl::OkStatus();
+}
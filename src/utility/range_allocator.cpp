@@ -0,0 +1,59 @@
+
+#include "utility/range_allocator.h"
+
+#include <iterator>
+
+RangeAllocator::RangeAllocator(uint64_t capacity_) : capacity(0) {
+  Grow(capacity_);
+}
+
+uint64_t RangeAllocator::Allocate(uint64_t size) {
+  if (size == 0) {
+    return kInvalidOffset;
+  }
+  for (auto it = free_ranges.begin(); it != free_ranges.end(); ++it) {
+    if (it->second < size) {
+      continue;
+    }
+    const uint64_t offset = it->first;
+    const uint64_t remaining = it->second - size;
+    free_ranges.erase(it);
+    if (remaining > 0) {
+      free_ranges.insert(std::make_pair(offset + size, remaining));
+    }
+    return offset;
+  }
+  return kInvalidOffset;
+}
+
+void RangeAllocator::Free(uint64_t offset, uint64_t size) {
+  if (size == 0) {
+    return;
+  }
+  auto it = free_ranges.insert(std::make_pair(offset, size)).first;
+  // Merge with the following range.
+  auto next = std::next(it);
+  if (next != free_ranges.end() && offset + it->second == next->first) {
+    it->second += next->second;
+    free_ranges.erase(next);
+  }
+  // Merge with the preceding range.
+  if (it != free_ranges.begin()) {
+    auto previous = std::prev(it);
+    if (previous->first + previous->second == it->first) {
+      previous->second += it->second;
+      free_ranges.erase(it);
+    }
+  }
+}
+
+void RangeAllocator::Grow(uint64_t new_capacity) {
+  if (new_capacity <= capacity) {
+    return;
+  }
+  const uint64_t old_capacity = capacity;
+  capacity = new_capacity;
+  Free(old_capacity, new_capacity - old_capacity);
+}
+
+uint64_t RangeAllocator::GetCapacity() const { return capacity; }
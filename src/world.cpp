@@ -3,26 +3,34 @@
 
 #include <glog/logging.h>
 
+#include "ecs/entity_bridge.h"
 #include "engine.h"
+#include "nodes/utility.h"
+#include "utility/profiler.h"
 
 void World::SetRoot(const std::shared_ptr<Node>& new_root) {
   if (root) {
-    PropagateNodeDetachment(root);
+    const std::vector<std::shared_ptr<Node>> nodes = CollectPreOrderNodes(root);
+    PropagateNodeDetachment(nodes);
 
-    root->world = std::shared_ptr<World>();
+    UnregisterNodes(nodes);
   }
 
   CHECK(new_root.get());
   root = new_root;
-  root->world = this->shared_from_this();
+  const std::vector<std::shared_ptr<Node>> nodes = CollectPreOrderNodes(root);
+  RegisterNodes(nodes);
 
-  PropagateNodeAttachment(root);
+  PropagateNodeAttachment(nodes);
 }
 
 const std::shared_ptr<System>& World::AddSystem(
     const std::shared_ptr<System>& new_system, int index) {
   // Only allow adding `new_system` if it is not a part of some world.
   CHECK(!new_system->GetWorld().get());
+  // The system would be told of the whole tree, then again of the batched
+  // nodes.
+  CHECK(batch_depth == 0) << "Systems cannot be added during a batch.";
   const std::shared_ptr<World> this_ptr = this->shared_from_this();
   new_system->engine = GetEngine();
   new_system->world = this_ptr;
@@ -38,7 +46,7 @@ const std::shared_ptr<System>& World::AddSystem(
     new_system->Init();
 
     if (root) {
-      new_system->NotifyOfNodeAttachment(root);
+      new_system->NotifyOfNodeTreeAttachment(CollectPreOrderNodes(root));
     }
     GetEngine()->PropagateSystemAddition(this_ptr, new_system);
   }
@@ -59,11 +67,42 @@ void World::RemoveSystem(const std::shared_ptr<System>& system) {
 }
 
 std::shared_ptr<Node> World::CreateEmptyRoot() {
-  std::shared_ptr<Node> root(new Node());
+  std::shared_ptr<Node> root = Spawn<Node>();
   SetRoot(root);
   return root;
 }
 
+void World::BeginBatch() { batch_depth++; }
+
+void World::EndBatch() {
+  CHECK(batch_depth > 0) << "EndBatch called without a BeginBatch.";
+  batch_depth--;
+  if (batch_depth > 0) {
+    return;
+  }
+
+  std::vector<std::shared_ptr<Node>> attached_nodes;
+  std::vector<std::shared_ptr<Node>> detached_nodes;
+  for (std::shared_ptr<Node>& node : batch_nodes) {
+    const bool was_attached = batch_node_was_attached[node.get()];
+    const bool is_attached = node->world.lock().get() == this;
+    if (was_attached && !is_attached) {
+      detached_nodes.push_back(std::move(node));
+    } else if (!was_attached && is_attached) {
+      attached_nodes.push_back(std::move(node));
+    }
+  }
+  batch_nodes.clear();
+  batch_node_was_attached.clear();
+
+  if (!detached_nodes.empty()) {
+    PropagateNodeDetachment(detached_nodes);
+  }
+  if (!attached_nodes.empty()) {
+    PropagateNodeAttachment(attached_nodes);
+  }
+}
+
 std::shared_ptr<Node> World::GetRoot() const { return root; }
 
 std::shared_ptr<Engine> World::GetEngine() const { return engine.lock(); }
@@ -72,21 +111,88 @@ const std::vector<std::shared_ptr<System>>& World::GetSystems() const {
   return systems;
 }
 
-void World::PropagateNodeAttachment(const std::shared_ptr<Node>& node) {
+void World::PropagateNodeAttachment(
+    const std::vector<std::shared_ptr<Node>>& nodes) {
   if (!is_initialized) {
     return;
   }
+  if (batch_depth > 0) {
+    RecordBatchedNodes(nodes, /*attached=*/true);
+    return;
+  }
   for (const std::shared_ptr<System>& system : systems) {
-    system->NotifyOfNodeAttachment(node);
+    system->NotifyOfNodeTreeAttachment(nodes);
   }
 }
 
-void World::PropagateNodeDetachment(const std::shared_ptr<Node>& node) {
+void World::PropagateNodeDetachment(
+    const std::vector<std::shared_ptr<Node>>& nodes) {
   if (!is_initialized) {
     return;
   }
+  if (batch_depth > 0) {
+    RecordBatchedNodes(nodes, /*attached=*/false);
+    return;
+  }
   for (const std::shared_ptr<System>& system : systems) {
-    system->NotifyOfNodeDetachment(node);
+    system->NotifyOfNodeTreeDetachment(nodes);
+  }
+}
+
+void World::RecordBatchedNodes(const std::vector<std::shared_ptr<Node>>& nodes,
+                               bool attached) {
+  for (const std::shared_ptr<Node>& node : nodes) {
+    // Only the first record of a node matters: a node first seen detaching was
+    // in the world before the batch, and vice versa.
+    if (batch_node_was_attached.try_emplace(node.get(), !attached).second) {
+      batch_nodes.push_back(node);
+    }
+  }
+}
+
+void World::RegisterNodes(const std::vector<std::shared_ptr<Node>>& nodes) {
+  const std::shared_ptr<World> this_ptr = this->shared_from_this();
+  const NodeTypeMask bridge_tag = GetNodeTypeTag<EntityBridge>();
+  for (const std::shared_ptr<Node>& node : nodes) {
+    node->world = this_ptr;
+    if (free_node_slots.empty()) {
+      node->handle = {(uint32_t)node_slots.size(), 0};
+      node_slots.push_back({node.get(), 0});
+    } else {
+      const uint32_t index = free_node_slots.back();
+      free_node_slots.pop_back();
+      node_slots[index].node = node.get();
+      node->handle = {index, node_slots[index].generation};
+    }
+
+    EntityBridge* bridge = (node->GetTypeMask() & bridge_tag)
+                               ? dynamic_cast<EntityBridge*>(node.get())
+                               : nullptr;
+    if (bridge) {
+      bridge->entity =
+          entities.Create(NodeComponent{node.get(), node->handle});
+      bridge->CreateComponents(entities, bridge->entity);
+    }
+  }
+}
+
+void World::UnregisterNodes(const std::vector<std::shared_ptr<Node>>& nodes) {
+  const NodeTypeMask bridge_tag = GetNodeTypeTag<EntityBridge>();
+  for (const std::shared_ptr<Node>& node : nodes) {
+    EntityBridge* bridge = (node->GetTypeMask() & bridge_tag)
+                               ? dynamic_cast<EntityBridge*>(node.get())
+                               : nullptr;
+    if (bridge) {
+      entities.Destroy(bridge->entity);
+      bridge->entity = Entity();
+    }
+
+    NodeSlot& slot = node_slots[node->handle.index];
+    slot.node = nullptr;
+    slot.generation++;
+    free_node_slots.push_back(node->handle.index);
+    node->world = std::shared_ptr<World>();
+    node->handle = NodeHandle();
   }
 }
 
@@ -95,29 +201,34 @@ void World::Init() {
     return;
   }
   is_initialized = true;
+  const std::vector<std::shared_ptr<Node>> nodes =
+      root ? CollectPreOrderNodes(root) : std::vector<std::shared_ptr<Node>>();
   for (const std::shared_ptr<System>& system : systems) {
     system->Init();
 
     if (root) {
-      system->NotifyOfNodeAttachment(root);
+      system->NotifyOfNodeTreeAttachment(nodes);
     }
   }
 }
 
 void World::Update(float delta_seconds) {
   for (const std::shared_ptr<System>& system : systems) {
+    PROFILE_SCOPE_TYPE(*system);
     system->Update(delta_seconds);
   }
 }
 
 void World::FixedUpdate(float delta_seconds) {
   for (const std::shared_ptr<System>& system : systems) {
+    PROFILE_SCOPE_TYPE(*system);
     system->FixedUpdate(delta_seconds);
   }
 }
 
 void World::LateUpdate(float delta_seconds) {
   for (const std::shared_ptr<System>& system : systems) {
+    PROFILE_SCOPE_TYPE(*system);
     system->LateUpdate(delta_seconds);
   }
 }
@@ -12,6 +12,9 @@
 #include "resources/transit/transit_write.h"
 #include "utility/status.h"
 
+ABSL_FLAG(bool, mesh_bvh, true,
+          "Whether to store a BVH with each mesh, so it is not built at load.");
+
 absl::Status ConvertFiles(const std::vector<char*>& filenames) {
   for (const char* file_cstr : filenames) {
     const std::string basename =
@@ -28,6 +31,9 @@ absl::Status ConvertFiles(const std::vector<char*>& filenames) {
           return absl::FailedPreconditionError(STATUS_MESSAGE(
               "Failed to open output file " << out_mesh_filename));
         }
+        if (absl::GetFlag(FLAGS_mesh_bvh)) {
+          primitive.mesh->GetBVH();
+        }
         RETURN_IF_ERROR(transit::Save(mesh_file, primitive.mesh));
         LOG(INFO) << "Wrote mesh " << name << ", prim #" << i << " to file "
                   << out_mesh_filename;
@@ -22,16 +22,29 @@ absl::Status Save(std::ostream& stream, const std::shared_ptr<Mesh>& mesh) {
       indexing_mode ? mesh->triangles.size() : mesh->small_triangles.size();
   json_data["triangles"] = triangle_count;
   json_data["indexingMode"] = indexing_mode ? "big" : "small";
+  const std::shared_ptr<const MeshBVH> bvh = mesh->GetBuiltBVH();
+  if (bvh) {
+    json_data["bvhNodes"] = (unsigned int)bvh->GetNodes().size();
+  }
   std::stringstream json_ss;
   json_ss << json_data;
   const std::string& json_string = json_ss.str();
 
   TransitHeader header = CreateHeader("MESH");
+  // Version 1.1 adds the BVH after the triangles.
+  if (bvh) {
+    header.version[1] = 1;
+  }
   header.json_length = json_string.length();
   header.data_length =
       sizeof(Mesh::Vertex) * mesh->vertices.size() +
       (indexing_mode ? sizeof(Mesh::Triangle) : sizeof(Mesh::SmallTriangle)) *
           triangle_count;
+  if (bvh) {
+    header.data_length +=
+        bvh->GetNodes().size() * (6 * sizeof(float) + 2 * sizeof(uint32_t)) +
+        bvh->GetTriangleOrder().size() * sizeof(uint32_t);
+  }
   RETURN_IF_ERROR(WriteHeader(stream, header));
   stream.write(json_string.c_str(), json_string.length());
   {
@@ -67,6 +80,22 @@ absl::Status Save(std::ostream& stream, const std::shared_ptr<Mesh>& mesh) {
     stream.write((char*)triangles.data(),
                  sizeof(Mesh::SmallTriangle) * triangles.size());
   }
+  if (bvh) {
+    for (const MeshBVH::Node& node : bvh->GetNodes()) {
+      const glm::vec3 bounds[2] = {htob(node.bounds.min),
+                                   htob(node.bounds.max)};
+      const uint32_t counts[2] = {htob(node.offset),
+                                  htob(node.triangle_count)};
+      stream.write((char*)bounds, sizeof(bounds));
+      stream.write((char*)counts, sizeof(counts));
+    }
+    std::vector<uint32_t> triangle_order = bvh->GetTriangleOrder();
+    for (uint32_t& triangle : triangle_order) {
+      triangle = htob(triangle);
+    }
+    stream.write((char*)triangle_order.data(),
+                 sizeof(uint32_t) * triangle_order.size());
+  }
   if (stream.bad()) {
     return absl::FailedPreconditionError("Failed to write mesh to stream");
   }